@@ -0,0 +1,81 @@
+#include <shaders.h>
+
+const struct SM_ProgramInfo smProgramInfo[NUM_PROGRAM_KINDS] = {
+        [PROGRAM_arc] = { "arc" },
+        [PROGRAM_circle] = { "circle" },
+        [PROGRAM_line] = { "line" },
+};
+
+const struct SM_ShaderInfo smShaderInfo[NUM_SHADER_KINDS] = {
+        [SHADER_arc_frag] = { SHADERTYPE_FRAGMENT, "arc_frag", "example-shaders/arc.frag" },
+        [SHADER_arc_vert] = { SHADERTYPE_VERTEX, "arc_vert", "example-shaders/arc.vert" },
+        [SHADER_circle_frag] = { SHADERTYPE_FRAGMENT, "circle_frag", "example-shaders/circle.frag" },
+        [SHADER_circle_vert] = { SHADERTYPE_VERTEX, "circle_vert", "example-shaders/circle.vert" },
+        [SHADER_line_frag] = { SHADERTYPE_FRAGMENT, "line_frag", "example-shaders/line.frag" },
+        [SHADER_line_vert] = { SHADERTYPE_VERTEX, "line_vert", "example-shaders/line.vert" },
+};
+
+const char *const smShaderDefines[NUM_SHADER_KINDS] = {
+        [SHADER_arc_frag] = NULL,
+        [SHADER_arc_vert] = NULL,
+        [SHADER_circle_frag] = NULL,
+        [SHADER_circle_vert] = NULL,
+        [SHADER_line_frag] = NULL,
+        [SHADER_line_vert] = NULL,
+};
+
+const struct SM_LinkInfo smLinkInfo[] = {
+        { PROGRAM_arc, SHADER_arc_frag },
+        { PROGRAM_arc, SHADER_arc_vert },
+        { PROGRAM_circle, SHADER_circle_frag },
+        { PROGRAM_circle, SHADER_circle_vert },
+        { PROGRAM_line, SHADER_line_frag },
+        { PROGRAM_line, SHADER_line_vert },
+};
+
+const int numLinkInfos = sizeof smLinkInfo / sizeof smLinkInfo[0];
+
+const struct SM_UniformInfo smUniformInfo[NUM_UNIFORM_KINDS] = {
+};
+
+const struct SM_AttributeInfo smAttributeInfo[NUM_ATTRIBUTE_KINDS] = {
+        [ATTRIBUTE_arc_centerPoint] = { PROGRAM_arc, GRAFIKATTRTYPE_VEC2, "centerPoint" },
+        [ATTRIBUTE_arc_color] = { PROGRAM_arc, GRAFIKATTRTYPE_VEC3, "color" },
+        [ATTRIBUTE_arc_diffAngle] = { PROGRAM_arc, GRAFIKATTRTYPE_FLOAT, "diffAngle" },
+        [ATTRIBUTE_arc_orientation] = { PROGRAM_arc, GRAFIKATTRTYPE_INT, "orientation" },
+        [ATTRIBUTE_arc_position] = { PROGRAM_arc, GRAFIKATTRTYPE_VEC2, "position" },
+        [ATTRIBUTE_arc_radius] = { PROGRAM_arc, GRAFIKATTRTYPE_FLOAT, "radius" },
+        [ATTRIBUTE_arc_startPoint] = { PROGRAM_arc, GRAFIKATTRTYPE_VEC2, "startPoint" },
+        [ATTRIBUTE_circle_centerPoint] = { PROGRAM_circle, GRAFIKATTRTYPE_VEC2, "centerPoint" },
+        [ATTRIBUTE_circle_color] = { PROGRAM_circle, GRAFIKATTRTYPE_VEC3, "color" },
+        [ATTRIBUTE_circle_diff] = { PROGRAM_circle, GRAFIKATTRTYPE_VEC2, "diff" },
+        [ATTRIBUTE_circle_radius] = { PROGRAM_circle, GRAFIKATTRTYPE_FLOAT, "radius" },
+        [ATTRIBUTE_line_color] = { PROGRAM_line, GRAFIKATTRTYPE_VEC3, "color" },
+        [ATTRIBUTE_line_normal] = { PROGRAM_line, GRAFIKATTRTYPE_VEC2, "normal" },
+        [ATTRIBUTE_line_position] = { PROGRAM_line, GRAFIKATTRTYPE_VEC2, "position" },
+};
+
+GfxProgram gfxProgram[NUM_PROGRAM_KINDS];
+GfxShader gfxShader[NUM_SHADER_KINDS];
+GfxUniformLocation gfxUniformLocation[NUM_UNIFORM_KINDS];
+GfxAttributeLocation gfxAttributeLocation[NUM_ATTRIBUTE_KINDS];
+
+const struct SM_Description smDescription = {
+        .programInfo = smProgramInfo,
+        .shaderInfo = smShaderInfo,
+        .linkInfo = smLinkInfo,
+        .uniformInfo = smUniformInfo,
+        .attributeInfo = smAttributeInfo,
+
+        .gfxProgram = gfxProgram,
+        .gfxShader = gfxShader,
+        .gfxUniformLocation = gfxUniformLocation,
+        .gfxAttributeLocation = gfxAttributeLocation,
+
+        .numPrograms = NUM_PROGRAM_KINDS,
+        .numShaders = NUM_SHADER_KINDS,
+        .numUniforms = NUM_UNIFORM_KINDS,
+        .numAttributes = NUM_ATTRIBUTE_KINDS,
+        .numLinks = sizeof smLinkInfo / sizeof smLinkInfo[0],
+};
+
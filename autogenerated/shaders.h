@@ -0,0 +1,145 @@
+#ifndef AUTOGENERATED_SHADERS_H_INCLUDED
+#define AUTOGENERATED_SHADERS_H_INCLUDED
+
+#include <glsl-processor.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+#define SM_STATIC_ASSERT(x) static_assert(x, #x)
+#else
+#define SM_STATIC_ASSERT(x) _Static_assert(x, #x)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+        PROGRAM_arc,
+        PROGRAM_circle,
+        PROGRAM_line,
+        NUM_PROGRAM_KINDS,
+};
+
+enum {
+        SHADER_arc_frag,
+        SHADER_arc_vert,
+        SHADER_circle_frag,
+        SHADER_circle_vert,
+        SHADER_line_frag,
+        SHADER_line_vert,
+        NUM_SHADER_KINDS,
+};
+
+enum {
+        NUM_UNIFORM_KINDS,
+};
+
+enum {
+        ATTRIBUTE_arc_centerPoint,
+        ATTRIBUTE_arc_color,
+        ATTRIBUTE_arc_diffAngle,
+        ATTRIBUTE_arc_orientation,
+        ATTRIBUTE_arc_position,
+        ATTRIBUTE_arc_radius,
+        ATTRIBUTE_arc_startPoint,
+        ATTRIBUTE_circle_centerPoint,
+        ATTRIBUTE_circle_color,
+        ATTRIBUTE_circle_diff,
+        ATTRIBUTE_circle_radius,
+        ATTRIBUTE_line_color,
+        ATTRIBUTE_line_normal,
+        ATTRIBUTE_line_position,
+        NUM_ATTRIBUTE_KINDS,
+};
+
+extern const struct SM_ShaderInfo smShaderInfo[NUM_SHADER_KINDS];
+// the defines of each shader variant, NULL for plain shaders
+extern const char *const smShaderDefines[NUM_SHADER_KINDS];
+extern const struct SM_ProgramInfo smProgramInfo[NUM_PROGRAM_KINDS];
+extern const struct SM_LinkInfo smLinkInfo[];
+extern const int numLinkInfos;
+extern const struct SM_UniformInfo smUniformInfo[NUM_UNIFORM_KINDS];
+extern const struct SM_AttributeInfo smAttributeInfo[NUM_ATTRIBUTE_KINDS];
+extern const struct SM_Description smDescription;
+
+extern GfxShader gfxShader[NUM_SHADER_KINDS];
+extern GfxProgram gfxProgram[NUM_PROGRAM_KINDS];
+extern GfxUniformLocation gfxUniformLocation[NUM_UNIFORM_KINDS];
+extern GfxAttributeLocation gfxAttributeLocation[NUM_ATTRIBUTE_KINDS];
+
+struct arcShader_Vertex {
+        float centerPoint[2];
+        float color[3];
+        float diffAngle;
+        int32_t orientation;
+        float position[2];
+        float radius;
+        float startPoint[2];
+};
+SM_STATIC_ASSERT(offsetof(struct arcShader_Vertex, centerPoint) == 0);
+SM_STATIC_ASSERT(offsetof(struct arcShader_Vertex, color) == 8);
+SM_STATIC_ASSERT(offsetof(struct arcShader_Vertex, diffAngle) == 20);
+SM_STATIC_ASSERT(offsetof(struct arcShader_Vertex, orientation) == 24);
+SM_STATIC_ASSERT(offsetof(struct arcShader_Vertex, position) == 28);
+SM_STATIC_ASSERT(offsetof(struct arcShader_Vertex, radius) == 36);
+SM_STATIC_ASSERT(offsetof(struct arcShader_Vertex, startPoint) == 40);
+SM_STATIC_ASSERT(sizeof (struct arcShader_Vertex) == 48);
+static inline void arcShader_setup_vao(GfxVAO vao, GfxVBO vbo)
+{
+        set_GfxVAO_attribute(vao, vbo, gfxAttributeLocation[ATTRIBUTE_arc_centerPoint], GRAFIKATTRTYPE_VEC2, sizeof (struct arcShader_Vertex), offsetof(struct arcShader_Vertex, centerPoint));
+        set_GfxVAO_attribute(vao, vbo, gfxAttributeLocation[ATTRIBUTE_arc_color], GRAFIKATTRTYPE_VEC3, sizeof (struct arcShader_Vertex), offsetof(struct arcShader_Vertex, color));
+        set_GfxVAO_attribute(vao, vbo, gfxAttributeLocation[ATTRIBUTE_arc_diffAngle], GRAFIKATTRTYPE_FLOAT, sizeof (struct arcShader_Vertex), offsetof(struct arcShader_Vertex, diffAngle));
+        set_GfxVAO_attribute(vao, vbo, gfxAttributeLocation[ATTRIBUTE_arc_orientation], GRAFIKATTRTYPE_INT, sizeof (struct arcShader_Vertex), offsetof(struct arcShader_Vertex, orientation));
+        set_GfxVAO_attribute(vao, vbo, gfxAttributeLocation[ATTRIBUTE_arc_position], GRAFIKATTRTYPE_VEC2, sizeof (struct arcShader_Vertex), offsetof(struct arcShader_Vertex, position));
+        set_GfxVAO_attribute(vao, vbo, gfxAttributeLocation[ATTRIBUTE_arc_radius], GRAFIKATTRTYPE_FLOAT, sizeof (struct arcShader_Vertex), offsetof(struct arcShader_Vertex, radius));
+        set_GfxVAO_attribute(vao, vbo, gfxAttributeLocation[ATTRIBUTE_arc_startPoint], GRAFIKATTRTYPE_VEC2, sizeof (struct arcShader_Vertex), offsetof(struct arcShader_Vertex, startPoint));
+}
+
+struct circleShader_Vertex {
+        float centerPoint[2];
+        float color[3];
+        float diff[2];
+        float radius;
+};
+SM_STATIC_ASSERT(offsetof(struct circleShader_Vertex, centerPoint) == 0);
+SM_STATIC_ASSERT(offsetof(struct circleShader_Vertex, color) == 8);
+SM_STATIC_ASSERT(offsetof(struct circleShader_Vertex, diff) == 20);
+SM_STATIC_ASSERT(offsetof(struct circleShader_Vertex, radius) == 28);
+SM_STATIC_ASSERT(sizeof (struct circleShader_Vertex) == 32);
+static inline void circleShader_setup_vao(GfxVAO vao, GfxVBO vbo)
+{
+        set_GfxVAO_attribute(vao, vbo, gfxAttributeLocation[ATTRIBUTE_circle_centerPoint], GRAFIKATTRTYPE_VEC2, sizeof (struct circleShader_Vertex), offsetof(struct circleShader_Vertex, centerPoint));
+        set_GfxVAO_attribute(vao, vbo, gfxAttributeLocation[ATTRIBUTE_circle_color], GRAFIKATTRTYPE_VEC3, sizeof (struct circleShader_Vertex), offsetof(struct circleShader_Vertex, color));
+        set_GfxVAO_attribute(vao, vbo, gfxAttributeLocation[ATTRIBUTE_circle_diff], GRAFIKATTRTYPE_VEC2, sizeof (struct circleShader_Vertex), offsetof(struct circleShader_Vertex, diff));
+        set_GfxVAO_attribute(vao, vbo, gfxAttributeLocation[ATTRIBUTE_circle_radius], GRAFIKATTRTYPE_FLOAT, sizeof (struct circleShader_Vertex), offsetof(struct circleShader_Vertex, radius));
+}
+
+struct lineShader_Vertex {
+        float color[3];
+        float normal[2];
+        float position[2];
+};
+SM_STATIC_ASSERT(offsetof(struct lineShader_Vertex, color) == 0);
+SM_STATIC_ASSERT(offsetof(struct lineShader_Vertex, normal) == 12);
+SM_STATIC_ASSERT(offsetof(struct lineShader_Vertex, position) == 20);
+SM_STATIC_ASSERT(sizeof (struct lineShader_Vertex) == 28);
+static inline void lineShader_setup_vao(GfxVAO vao, GfxVBO vbo)
+{
+        set_GfxVAO_attribute(vao, vbo, gfxAttributeLocation[ATTRIBUTE_line_color], GRAFIKATTRTYPE_VEC3, sizeof (struct lineShader_Vertex), offsetof(struct lineShader_Vertex, color));
+        set_GfxVAO_attribute(vao, vbo, gfxAttributeLocation[ATTRIBUTE_line_normal], GRAFIKATTRTYPE_VEC2, sizeof (struct lineShader_Vertex), offsetof(struct lineShader_Vertex, normal));
+        set_GfxVAO_attribute(vao, vbo, gfxAttributeLocation[ATTRIBUTE_line_position], GRAFIKATTRTYPE_VEC2, sizeof (struct lineShader_Vertex), offsetof(struct lineShader_Vertex, position));
+}
+
+
+
+#ifdef __cplusplus
+
+#endif // #ifdef __cplusplus
+
+#ifdef __cplusplus
+} // extern "C" {
+#endif
+#endif
@@ -0,0 +1,365 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 199309L  // for clock_gettime()
+#endif
+
+#include <glsl-processor/defs.h>
+#include <glsl-processor/logging.h>
+#include <glsl-processor/memory.h>
+#include <glsl-processor/parse.h>
+#include <glsl-processor/builder.h>
+#include <glsl-processor/scan.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* A small benchmark for the lexer and parser. It generates a synthetic corpus
+ * of shader files in memory and measures, for each of the scanning
+ * implementations that the CPU supports, the throughput of the scanning
+ * functions alone and of gp_parse(), in full and in reflection mode, and with
+ * streamed input files. With the best implementation, it also measures
+ * gp_parse_parallel() with increasing numbers of threads. The "comments"
+ * corpus has large license headers and doc comments. */
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define HAVE_RDTSC 1
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define HAVE_RDTSC 1
+#else
+#define HAVE_RDTSC 0
+#endif
+
+struct MemoryBuffer {
+        char *data;
+        size_t length;
+};
+
+static void append_to_buffer_f(struct MemoryBuffer *mb, const char *fmt, ...)
+{
+        va_list ap;
+        va_list ap2;
+        va_start(ap, fmt);
+        va_copy(ap2, ap);
+        size_t need = vsnprintf(NULL, 0, fmt, ap);
+        REALLOC_MEMORY(&mb->data, mb->length + need + 1);
+        vsnprintf(mb->data + mb->length, need + 1, fmt, ap2);
+        mb->length += need;
+        va_end(ap2);
+        va_end(ap);
+}
+
+enum {
+        CORPUS_CODE,
+        CORPUS_COMMENTS,
+        NUM_CORPUS_KINDS
+};
+
+static const char *const corpusKindString[NUM_CORPUS_KINDS] = {
+        [CORPUS_CODE] = "code",
+        [CORPUS_COMMENTS] = "comments",
+};
+
+static void generate_license_header(struct MemoryBuffer *mb)
+{
+        append_to_buffer_f(mb, "/*\n");
+        for (int i = 0; i < 40; i++)
+                append_to_buffer_f(mb,
+                        " * Permission is hereby granted, free of charge, to any person obtaining a copy %2d\n", i);
+        append_to_buffer_f(mb, " */\n\n");
+}
+
+static void generate_doc_comment(struct MemoryBuffer *mb, int i)
+{
+        append_to_buffer_f(mb,
+                "/**\n"
+                " * compute_something_%d() - computes something that is needed for the\n"
+                " * final color. The position is given in world space and the scale must\n"
+                " * be positive. This comment is unnecessarily long because real shader\n"
+                " * libraries contain a lot of documentation.\n"
+                " */\n"
+                "// See also: the other functions in this file.\n", i);
+}
+
+static void generate_shader(struct MemoryBuffer *mb, int seed, int corpusKind)
+{
+        if (corpusKind == CORPUS_COMMENTS)
+                generate_license_header(mb);
+        append_to_buffer_f(mb, "#version 330\n\n");
+        for (int i = 0; i < 8; i++)
+                append_to_buffer_f(mb, "uniform vec4 uniformValue%d_%d;\n", seed, i);
+        append_to_buffer_f(mb, "\n");
+        for (int i = 0; i < 6; i++)
+                append_to_buffer_f(mb, "in vec3 inputAttribute%d;\n", i);
+        append_to_buffer_f(mb, "out vec4 outputColor;\n\n");
+        for (int i = 0; i < 12; i++) {
+                if (corpusKind == CORPUS_COMMENTS)
+                        generate_doc_comment(mb, i);
+                append_to_buffer_f(mb,
+                        "float compute_something_%d(vec3 position, float scale)\n"
+                        "{\n"
+                        "        float accumulated = 0.0;\n"
+                        "        accumulated += (position.x - 1.5) * (position.y + 2.25) / scale;\n"
+                        "        accumulated -= dot(position, vec3(0.5, 0.25, %d.125)) * 3.0;\n"
+                        "        if (accumulated > 100.0 && scale > 0.0) {\n"
+                        "                accumulated = accumulated * 0.5 + length(position);\n"
+                        "        }\n"
+                        "        else\n"
+                        "                accumulated = -accumulated;\n"
+                        "        return accumulated * uniformValue%d_%d.x;\n"
+                        "}\n"
+                        "\n", i, i, seed, i % 8);
+        }
+        append_to_buffer_f(mb,
+                "void main()\n"
+                "{\n"
+                "        float value = compute_something_0(inputAttribute0, 2.0);\n"
+                "        outputColor = vec4(inputAttribute1 * value, 1.0);\n"
+                "}\n");
+}
+
+/* wall clock time. clock() would add up the time of all threads. */
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+static double get_time(void)
+{
+        LARGE_INTEGER count;
+        LARGE_INTEGER frequency;
+        QueryPerformanceCounter(&count);
+        QueryPerformanceFrequency(&frequency);
+        return (double) count.QuadPart / (double) frequency.QuadPart;
+}
+#else
+static double get_time(void)
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+#endif
+
+/* Skips whitespace and comments like the lexer does, and steps over
+ * everything else with a simple loop. This isolates the scanning functions
+ * from the rest of the lexer and from the parser. */
+static long long skip_whitespace_and_comments(const char *p, const char *end)
+{
+        long long numSkipped = 0;
+        while (p < end) {
+                const char *q = gp_scan_skip_whitespace(p, end);
+                numSkipped += q - p;
+                p = q;
+                if (end - p >= 2 && p[0] == '/' && p[1] == '*') {
+                        q = gp_scan_find_comment_end(p + 2, end);
+                        q = q ? q + 2 : end;
+                        numSkipped += q - p;
+                        p = q;
+                }
+                else if (end - p >= 2 && p[0] == '/' && p[1] == '/') {
+                        q = gp_scan_find_newline(p + 2, end);
+                        numSkipped += q - p;
+                        p = q;
+                }
+                else {
+                        do
+                                p++;
+                        while (p < end && (unsigned char) *p > 32 && *p != '/');
+                }
+        }
+        return numSkipped;
+}
+
+/* for the streamed files */
+static int read_memory_buffer(void *userData, int offset, char *buffer, int size)
+{
+        struct MemoryBuffer *mb = userData;
+        if ((size_t) offset >= mb->length)
+                return 0;
+        if ((size_t) size > mb->length - offset)
+                size = (int) (mb->length - offset);
+        memcpy(buffer, mb->data + offset, size);
+        return size;
+}
+
+static void print_result(const char *what, long long totalBytes,
+                         double seconds, unsigned long long cycles)
+{
+        printf("%-8s %-8s time: %8.3f ms, %8.1f MB/s", what,
+               gp_scanImplKindString[gp_scan_get_impl()],
+               1000.0 * seconds, seconds > 0.0 ? totalBytes / seconds / 1e6 : 0.0);
+#if HAVE_RDTSC
+        printf(", %.3f bytes/cycle", (double) totalBytes / (double) cycles);
+#endif
+        printf("\n");
+}
+
+static void run_scan_benchmark(struct MemoryBuffer *files, int numFiles,
+                               long long totalBytes, int numRounds)
+{
+        double bestSeconds = -1.0;
+        unsigned long long bestCycles = 0;
+        long long numSkipped = 0;
+        for (int round = 0; round < numRounds; round++) {
+                double start = get_time();
+#if HAVE_RDTSC
+                unsigned long long startCycles = __rdtsc();
+#endif
+                numSkipped = 0;
+                for (int i = 0; i < numFiles; i++)
+                        numSkipped += skip_whitespace_and_comments(
+                                files[i].data, files[i].data + files[i].length);
+#if HAVE_RDTSC
+                unsigned long long cycles = __rdtsc() - startCycles;
+                if (round == 0 || cycles < bestCycles)
+                        bestCycles = cycles;
+#endif
+                double seconds = get_time() - start;
+                if (round == 0 || seconds < bestSeconds)
+                        bestSeconds = seconds;
+        }
+        print_result("scan", totalBytes, bestSeconds, bestCycles);
+        if (numSkipped <= 0)
+                gp_fatal_f("Nothing was skipped?");
+}
+
+/* numThreads == 0 means gp_parse(), otherwise gp_parse_parallel() */
+static void run_parse_benchmark(struct GP_Builder *builder, const char *name, long long totalBytes,
+                                int numRounds, int numThreads, int parseMode, int outputMode)
+{
+        double bestSeconds = -1.0;
+        unsigned long long bestCycles = 0;
+        // the sizes of the output of each shader, in the last round
+        int numShaders = 0;
+        const char **shaderNames = NULL;
+        int *unminifiedSizes = NULL;
+        int *minifiedSizes = NULL;
+        for (int round = 0; round < numRounds; round++) {
+                struct GP_Ctx ctx;
+                gp_setup(&ctx);
+                gp_builder_to_ctx(builder, &ctx);
+                ctx.parseMode = parseMode;
+                ctx.outputMode = outputMode;
+                double start = get_time();
+#if HAVE_RDTSC
+                unsigned long long startCycles = __rdtsc();
+#endif
+                if (numThreads == 0)
+                        gp_parse(&ctx);
+                else
+                        gp_parse_parallel(&ctx, numThreads);
+#if HAVE_RDTSC
+                unsigned long long cycles = __rdtsc() - startCycles;
+                if (round == 0 || cycles < bestCycles)
+                        bestCycles = cycles;
+#endif
+                double seconds = get_time() - start;
+                if (round == 0 || seconds < bestSeconds)
+                        bestSeconds = seconds;
+                if (outputMode == GP_OUTPUT_MODE_MINIFIED && round == numRounds - 1) {
+                        // the names are owned by the builder
+                        numShaders = ctx.desc.numShaders;
+                        ALLOC_MEMORY(&shaderNames, numShaders);
+                        ALLOC_MEMORY(&unminifiedSizes, numShaders);
+                        ALLOC_MEMORY(&minifiedSizes, numShaders);
+                        for (int i = 0; i < numShaders; i++) {
+                                shaderNames[i] = ctx.desc.shaderInfo[i].shaderName;
+                                unminifiedSizes[i] = ctx.shaderfileAsts[i].unminifiedSize;
+                                minifiedSizes[i] = ctx.shaderfileAsts[i].outputSize;
+                        }
+                }
+                gp_teardown(&ctx);
+        }
+        char what[32];
+        if (numThreads == 0)
+                snprintf(what, sizeof what, "%s", name);
+        else
+                snprintf(what, sizeof what, "%s/%d", name, numThreads);
+        print_result(what, totalBytes, bestSeconds, bestCycles);
+        if (outputMode == GP_OUTPUT_MODE_MINIFIED) {
+                long long unminifiedBytes = 0;
+                long long minifiedBytes = 0;
+                for (int i = 0; i < numShaders; i++) {
+                        printf("minified %-16s %8d -> %8d bytes (%.1f%%)\n",
+                               shaderNames[i], unminifiedSizes[i], minifiedSizes[i],
+                               unminifiedSizes[i] > 0 ? 100.0 * minifiedSizes[i] / unminifiedSizes[i] : 100.0);
+                        unminifiedBytes += unminifiedSizes[i];
+                        minifiedBytes += minifiedSizes[i];
+                }
+                printf("minified the output from %lld to %lld bytes (%.1f%%)\n",
+                       unminifiedBytes, minifiedBytes,
+                       unminifiedBytes > 0 ? 100.0 * minifiedBytes / unminifiedBytes : 100.0);
+                FREE_MEMORY(&shaderNames);
+                FREE_MEMORY(&unminifiedSizes);
+                FREE_MEMORY(&minifiedSizes);
+        }
+}
+
+int main(int argc, const char **argv)
+{
+        int numFiles = argc > 1 ? atoi(argv[1]) : 2000;
+        int numRounds = argc > 2 ? atoi(argv[2]) : 5;
+        int corpusKind = CORPUS_CODE;
+        if (argc > 3) {
+                for (corpusKind = 0; corpusKind < NUM_CORPUS_KINDS; corpusKind++)
+                        if (!strcmp(argv[3], corpusKindString[corpusKind]))
+                                break;
+        }
+        if (numFiles <= 0 || numRounds <= 0 || corpusKind == NUM_CORPUS_KINDS)
+                gp_fatal_f("Usage: %s [numFiles] [numRounds] [code|comments]", argv[0]);
+
+        struct GP_Builder builder;
+        struct GP_Builder streamedBuilder;
+        struct MemoryBuffer *files;
+        gp_builder_setup(&builder);
+        gp_builder_setup(&streamedBuilder);
+        ALLOC_MEMORY(&files, numFiles);
+        long long totalBytes = 0;
+        for (int i = 0; i < numFiles; i++) {
+                char fileID[64];
+                char shaderID[64];
+                snprintf(fileID, sizeof fileID, "file%d.vert", i);
+                snprintf(shaderID, sizeof shaderID, "shader%d", i);
+                struct MemoryBuffer *mb = &files[i];
+                memset(mb, 0, sizeof *mb);
+                generate_shader(mb, i, corpusKind);
+                gp_builder_create_file_borrowed(&builder, fileID, mb->data, (int) mb->length);
+                gp_builder_create_shader(&builder, shaderID, fileID, GP_SHADERTYPE_VERTEX);
+                gp_builder_create_file_streamed(&streamedBuilder, fileID, read_memory_buffer, mb);
+                gp_builder_create_shader(&streamedBuilder, shaderID, fileID, GP_SHADERTYPE_VERTEX);
+                totalBytes += mb->length;
+        }
+        gp_builder_process(&builder);
+        gp_builder_process(&streamedBuilder);
+
+        printf("parsing %d files (\"%s\" corpus), %lld bytes, best of %d rounds\n",
+               numFiles, corpusKindString[corpusKind], totalBytes, numRounds);
+        for (int i = 0; i < GP_NUM_SCAN_IMPL_KINDS; i++) {
+                if (!gp_scan_impl_supported(i))
+                        continue;
+                gp_scan_select_impl(i);
+                run_scan_benchmark(files, numFiles, totalBytes, numRounds);
+                run_parse_benchmark(&builder, "parse", totalBytes, numRounds, 0,
+                                    GP_PARSE_MODE_FULL, GP_OUTPUT_MODE_BUFFER);
+                run_parse_benchmark(&builder, "reflect", totalBytes, numRounds, 0,
+                                    GP_PARSE_MODE_REFLECTION, GP_OUTPUT_MODE_BUFFER);
+                run_parse_benchmark(&streamedBuilder, "stream", totalBytes, numRounds, 0,
+                                    GP_PARSE_MODE_FULL, GP_OUTPUT_MODE_BUFFER);
+        }
+        // the best scanning implementation is still selected
+        run_parse_benchmark(&builder, "minify", totalBytes, numRounds, 0,
+                            GP_PARSE_MODE_FULL, GP_OUTPUT_MODE_MINIFIED);
+        for (int numThreads = 2; numThreads <= 2 * gp_get_number_of_cpus(); numThreads *= 2)
+                run_parse_benchmark(&builder, "parse", totalBytes, numRounds, numThreads,
+                                    GP_PARSE_MODE_FULL, GP_OUTPUT_MODE_BUFFER);
+
+        // the builders borrow the buffers
+        gp_builder_teardown(&builder);
+        gp_builder_teardown(&streamedBuilder);
+        for (int i = 0; i < numFiles; i++)
+                FREE_MEMORY(&files[i].data);
+        FREE_MEMORY(&files);
+        return 0;
+}
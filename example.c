@@ -3,6 +3,7 @@
 #include <glsl-processor/memory.h>
 #include <glsl-processor/parse.h>
 #include <glsl-processor/builder.h>
+#include <glsl-processor/layout.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
@@ -111,6 +112,24 @@ static void append_to_buffer(struct MemoryBuffer *mb, const char *data)
         append_to_buffer_f(mb, "%s", data);
 }
 
+static void append_c_string_literal(struct MemoryBuffer *mb, const char *string)
+{
+        append_to_buffer(mb, "\"");
+        for (const char *p = string; *p; p++) {
+                if (*p == '\\' || *p == '"')
+                        append_to_buffer_f(mb, "\\%c", *p);
+                else if (*p == '\n')
+                        append_to_buffer(mb, "\\n");
+                else if (*p == '\t')
+                        append_to_buffer(mb, "\\t");
+                else if ((unsigned char) *p < 0x20)
+                        append_to_buffer_f(mb, "\\%03o", (unsigned char) *p);
+                else
+                        append_to_buffer_f(mb, "%c", *p);
+        }
+        append_to_buffer(mb, "\"");
+}
+
 static void append_filepath_component(struct MemoryBuffer *mb, const char *comp)
 {
         // TODO: make code more correct, at least for Windows and Linux
@@ -161,10 +180,44 @@ static const char *const TYPE_to_GRAFIKATTRIBUTETYPE[GP_NUM_TYPE_KINDS] = {
         [GP_TYPE_INT] = "GRAFIKATTRTYPE_INT",
         [GP_TYPE_UINT] = "GRAFIKATTRTYPE_UINT",
         [GP_TYPE_FLOAT] = "GRAFIKATTRTYPE_FLOAT",
-        [GP_TYPE_DOUBLE] = "GRAFIKUNIFORMTYPE_DOUBLE",
+        [GP_TYPE_DOUBLE] = "GRAFIKATTRTYPE_DOUBLE",
         [GP_TYPE_VEC2] = "GRAFIKATTRTYPE_VEC2",
         [GP_TYPE_VEC3] = "GRAFIKATTRTYPE_VEC3",
         [GP_TYPE_VEC4] = "GRAFIKATTRTYPE_VEC4",
+        [GP_TYPE_DVEC2] = "GRAFIKATTRTYPE_DVEC2",
+        [GP_TYPE_DVEC3] = "GRAFIKATTRTYPE_DVEC3",
+        [GP_TYPE_DVEC4] = "GRAFIKATTRTYPE_DVEC4",
+        [GP_TYPE_IVEC2] = "GRAFIKATTRTYPE_IVEC2",
+        [GP_TYPE_IVEC3] = "GRAFIKATTRTYPE_IVEC3",
+        [GP_TYPE_IVEC4] = "GRAFIKATTRTYPE_IVEC4",
+        [GP_TYPE_UVEC2] = "GRAFIKATTRTYPE_UVEC2",
+        [GP_TYPE_UVEC3] = "GRAFIKATTRTYPE_UVEC3",
+        [GP_TYPE_UVEC4] = "GRAFIKATTRTYPE_UVEC4",
+        [GP_TYPE_MAT2] = "GRAFIKATTRTYPE_MAT2",
+        [GP_TYPE_MAT3] = "GRAFIKATTRTYPE_MAT3",
+        [GP_TYPE_MAT4] = "GRAFIKATTRTYPE_MAT4",
+        [GP_TYPE_MAT2X3] = "GRAFIKATTRTYPE_MAT2X3",
+        [GP_TYPE_MAT2X4] = "GRAFIKATTRTYPE_MAT2X4",
+        [GP_TYPE_MAT3X2] = "GRAFIKATTRTYPE_MAT3X2",
+        [GP_TYPE_MAT3X4] = "GRAFIKATTRTYPE_MAT3X4",
+        [GP_TYPE_MAT4X2] = "GRAFIKATTRTYPE_MAT4X2",
+        [GP_TYPE_MAT4X3] = "GRAFIKATTRTYPE_MAT4X3",
+        [GP_TYPE_DMAT2] = "GRAFIKATTRTYPE_DMAT2",
+        [GP_TYPE_DMAT3] = "GRAFIKATTRTYPE_DMAT3",
+        [GP_TYPE_DMAT4] = "GRAFIKATTRTYPE_DMAT4",
+        [GP_TYPE_DMAT2X3] = "GRAFIKATTRTYPE_DMAT2X3",
+        [GP_TYPE_DMAT2X4] = "GRAFIKATTRTYPE_DMAT2X4",
+        [GP_TYPE_DMAT3X2] = "GRAFIKATTRTYPE_DMAT3X2",
+        [GP_TYPE_DMAT3X4] = "GRAFIKATTRTYPE_DMAT3X4",
+        [GP_TYPE_DMAT4X2] = "GRAFIKATTRTYPE_DMAT4X2",
+        [GP_TYPE_DMAT4X3] = "GRAFIKATTRTYPE_DMAT4X3",
+};
+
+/* A matrix attribute takes a location for each column. The columns are set up
+ * as vectors: COLUMN_TYPE_to_GRAFIKATTRIBUTETYPE[componentTypeKind][numRows] */
+static const char *const COLUMN_TYPE_to_GRAFIKATTRIBUTETYPE[GP_NUM_TYPE_KINDS][5] = {
+        [GP_TYPE_FLOAT] = { [2] = "GRAFIKATTRTYPE_VEC2", [3] = "GRAFIKATTRTYPE_VEC3", [4] = "GRAFIKATTRTYPE_VEC4" },
+        [GP_TYPE_DOUBLE] = { [2] = "GRAFIKATTRTYPE_DVEC2", [3] = "GRAFIKATTRTYPE_DVEC3", [4] = "GRAFIKATTRTYPE_DVEC4" },
 };
 
 static const char *const TYPE_to_GRAFIKUNIFORMTYPE[GP_NUM_TYPE_KINDS] = {
@@ -181,6 +234,272 @@ static const char *const TYPE_to_GRAFIKUNIFORMTYPE[GP_NUM_TYPE_KINDS] = {
         [GP_TYPE_MAT4] = "GRAFIKUNIFORMTYPE_MAT4",
 };
 
+static const char *const TYPE_to_C_COMPONENT_TYPE[GP_NUM_TYPE_KINDS] = {
+        [GP_TYPE_BOOL] = "uint32_t",  // bools take 4 bytes in a block
+        [GP_TYPE_INT] = "int32_t",
+        [GP_TYPE_UINT] = "uint32_t",
+        [GP_TYPE_FLOAT] = "float",
+        [GP_TYPE_DOUBLE] = "double",
+};
+
+/* A C struct with the layout of the block, with padding where needed, such
+ * that the whole block can be written to the buffer at once. Vectors are
+ * arrays of components, and matrices arrays of (padded) columns, or rows if
+ * they are row-major. The array elements are padded to the array stride. */
+static void write_block_struct(struct WriteCtx *wc, struct GP_Ctx *ctx, const struct GP_ProgramBlock *programBlock)
+{
+        const char *programName = ctx->desc.programInfo[programBlock->programIndex].programName;
+        const char *blockName = programBlock->blockName;
+        const struct GP_BlockDecl *block = programBlock->blockDecl;
+        if (block->size == -1) {
+                append_to_buffer_f(&wc->hFileHandle, "// %s: the layout of the block is up to the implementation, use std140 or std430\n\n", blockName);
+                return;
+        }
+        append_to_buffer_f(&wc->hFileHandle, "struct %sShader_%s {\n", programName, blockName);
+        int offset = 0;
+        int numPaddings = 0;
+        for (int i = 0; i < block->numMembers; i++) {
+                const struct GP_BlockMember *member = &block->members[i];
+                if (member->offset > offset)
+                        append_to_buffer_f(&wc->hFileHandle, INDENT "char _padding%d[%d];\n", numPaddings++, member->offset - offset);
+                int componentTypeKind;
+                int numColumns;
+                int numRows;
+                GP_ENSURE(gp_get_type_shape(member->typeKind, &componentTypeKind, &numColumns, &numRows));
+                int componentSize = componentTypeKind == GP_TYPE_DOUBLE ? 8 : 4;
+                append_to_buffer_f(&wc->hFileHandle, INDENT "%s %s", TYPE_to_C_COMPONENT_TYPE[componentTypeKind], gp_atom_string(ctx, member->name));
+                if (member->arrayLength == -1)
+                        append_to_buffer_f(&wc->hFileHandle, "[]");
+                else if (member->arrayLength > 0)
+                        append_to_buffer_f(&wc->hFileHandle, "[%d]", member->arrayLength);
+                if (numColumns > 1) {
+                        int numVectors = member->isRowMajor ? numRows : numColumns;
+                        append_to_buffer_f(&wc->hFileHandle, "[%d][%d]", numVectors, member->matrixStride / componentSize);
+                }
+                else if (member->arrayLength != 0) {
+                        if (member->arrayStride > componentSize || numRows > 1)
+                                append_to_buffer_f(&wc->hFileHandle, "[%d]", member->arrayStride / componentSize);
+                }
+                else if (numRows > 1) {
+                        append_to_buffer_f(&wc->hFileHandle, "[%d]", numRows);
+                }
+                append_to_buffer_f(&wc->hFileHandle, ";\n");
+                offset = member->offset + member->size;
+        }
+        int isRuntimeSized = block->members[block->numMembers - 1].arrayLength == -1;
+        if (!isRuntimeSized && block->size > offset)
+                append_to_buffer_f(&wc->hFileHandle, INDENT "char _padding%d[%d];\n", numPaddings++, block->size - offset);
+        append_to_buffer_f(&wc->hFileHandle, "};\n");
+        for (int i = 0; i < block->numMembers; i++)
+                append_to_buffer_f(&wc->hFileHandle, "SM_STATIC_ASSERT(offsetof(struct %sShader_%s, %s) == %d);\n",
+                        programName, blockName, gp_atom_string(ctx, block->members[i].name), block->members[i].offset);
+        // the size of a struct with a flexible array member can include padding
+        if (!isRuntimeSized)
+                append_to_buffer_f(&wc->hFileHandle, "SM_STATIC_ASSERT(sizeof (struct %sShader_%s) == %d);\n",
+                        programName, blockName, block->size);
+        append_to_buffer_f(&wc->hFileHandle, "\n");
+}
+
+/* How the generated setter of a uniform type takes the value, and how the
+ * value is uploaded. The values are stored as an array of floats, that is
+ * either a parameter, or is made from the parameters (valuesDecl). */
+static const struct {
+        const char *params;
+        const char *args;  // the params, passed on
+        const char *valuesName;
+        const char *valuesDecl;  // NULL if valuesName is a parameter
+        int numFloats;
+        const char *uploadFunction;
+} UNIFORM_SETTER_INFO[GP_NUM_TYPE_KINDS] = {
+        [GP_TYPE_FLOAT] = { "float x", "x", "values", "const float values[1] = { x };", 1, "set_GfxProgram_uniform_1f" },
+        [GP_TYPE_VEC2] = { "float x, float y", "x, y", "values", "const float values[2] = { x, y };", 2, "set_GfxProgram_uniform_2f" },
+        [GP_TYPE_VEC3] = { "float x, float y, float z", "x, y, z", "values", "const float values[3] = { x, y, z };", 3, "set_GfxProgram_uniform_3f" },
+        [GP_TYPE_VEC4] = { "float x, float y, float z, float w", "x, y, z, w", "values", "const float values[4] = { x, y, z, w };", 4, "set_GfxProgram_uniform_4f" },
+        [GP_TYPE_MAT2] = { "float *fourFloats", "fourFloats", "fourFloats", NULL, 4, "set_GfxProgram_uniform_mat2f" },
+        [GP_TYPE_MAT3] = { "float *nineFloats", "nineFloats", "nineFloats", NULL, 9, "set_GfxProgram_uniform_mat3f" },
+        [GP_TYPE_MAT4] = { "float *sixteenFloats", "sixteenFloats", "sixteenFloats", NULL, 16, "set_GfxProgram_uniform_mat4f" },
+};
+
+static int is_settable_uniform_type(int typeKind)
+{
+        if (typeKind == GP_TYPE_SAMPLER2D)
+                return 0;  // cannot be set, can it?
+        if (UNIFORM_SETTER_INFO[typeKind].params == NULL)
+                gp_fatal_f("Not implemented!");
+        return 1;
+}
+
+/* For the uniforms [first, end) of ctx->programUniforms, which are those of
+ * one program: The setters only store the values in a shadow copy, and mark
+ * the ones that changed. These are uploaded by %sShader_flush(), which the
+ * render functions call. Most uniform sets don't change the value, and they
+ * don't reach GL this way. */
+static void write_uniform_setters(struct WriteCtx *wc, struct GP_Ctx *ctx, int first, int end)
+{
+        struct MemoryBuffer *h = &wc->hFileHandle;
+        const char *programName = ctx->desc.programInfo[ctx->programUniforms[first].programIndex].programName;
+
+        /* The values are in a nested struct, so the names of the uniforms
+         * can't collide with the other fields. */
+        append_to_buffer_f(h, "struct %sShader_Uniforms {\n", programName);
+        int numSettable = 0;
+        for (int i = first; i < end; i++)
+                if (is_settable_uniform_type(ctx->programUniforms[i].typeKind))
+                        numSettable++;
+        if (numSettable > 0) {
+                append_to_buffer_f(h, INDENT "struct {\n");
+                for (int i = first; i < end; i++) {
+                        const char *uniformName = ctx->programUniforms[i].uniformName;
+                        int typeKind = ctx->programUniforms[i].typeKind;
+                        if (!is_settable_uniform_type(typeKind))
+                                continue;
+                        append_to_buffer_f(h, INDENT INDENT "float %s[%d];\n", uniformName, UNIFORM_SETTER_INFO[typeKind].numFloats);
+                }
+                append_to_buffer_f(h, INDENT "} values;\n");
+        }
+        int numDirtyWords = numSettable > 0 ? (numSettable + 31) / 32 : 1;
+        append_to_buffer_f(h, INDENT "unsigned dirty[%d];  // a bit for each uniform that was changed since the last flush\n", numDirtyWords);
+        append_to_buffer_f(h, "};\n");
+        append_to_buffer_f(h, "extern struct %sShader_Uniforms %sShaderUniforms;\n", programName, programName);
+
+        int bit = 0;
+        for (int i = first; i < end; i++) {
+                const char *uniformName = ctx->programUniforms[i].uniformName;
+                int typeKind = ctx->programUniforms[i].typeKind;
+                if (!is_settable_uniform_type(typeKind))
+                        continue;
+                const char *values = UNIFORM_SETTER_INFO[typeKind].valuesName;
+                const char *valuesDecl = UNIFORM_SETTER_INFO[typeKind].valuesDecl;
+                append_to_buffer_f(h, "static inline void %sShader_set_%s(%s) { %s%s", programName, uniformName,
+                        UNIFORM_SETTER_INFO[typeKind].params, valuesDecl ? valuesDecl : "", valuesDecl ? " " : "");
+                append_to_buffer_f(h, "if (memcmp(%sShaderUniforms.values.%s, %s, sizeof %sShaderUniforms.values.%s) != 0) { ",
+                        programName, uniformName, values, programName, uniformName);
+                append_to_buffer_f(h, "memcpy(%sShaderUniforms.values.%s, %s, sizeof %sShaderUniforms.values.%s); %sShaderUniforms.dirty[%d] |= 1u << %d; } }\n",
+                        programName, uniformName, values, programName, uniformName, programName, bit / 32, bit % 32);
+                bit++;
+        }
+
+        append_to_buffer_f(h, "static inline void %sShader_flush(void)\n{\n", programName);
+        append_to_buffer_f(h, INDENT "struct %sShader_Uniforms *u = &%sShaderUniforms;\n", programName, programName);
+        bit = 0;
+        for (int i = first; i < end; i++) {
+                const char *uniformName = ctx->programUniforms[i].uniformName;
+                int typeKind = ctx->programUniforms[i].typeKind;
+                if (!is_settable_uniform_type(typeKind))
+                        continue;
+                append_to_buffer_f(h, INDENT "if (u->dirty[%d] & 1u << %d) %s(gfxProgram[PROGRAM_%s], gfxUniformLocation[UNIFORM_%s_%s], ",
+                        bit / 32, bit % 32, UNIFORM_SETTER_INFO[typeKind].uploadFunction, programName, programName, uniformName);
+                if (UNIFORM_SETTER_INFO[typeKind].valuesDecl == NULL) {
+                        append_to_buffer_f(h, "u->values.%s", uniformName);
+                }
+                else {
+                        for (int j = 0; j < UNIFORM_SETTER_INFO[typeKind].numFloats; j++)
+                                append_to_buffer_f(h, "%su->values.%s[%d]", j > 0 ? ", " : "", uniformName, j);
+                }
+                append_to_buffer_f(h, ");\n");
+                bit++;
+        }
+        append_to_buffer_f(h, INDENT "memset(%sShaderUniforms.dirty, 0, sizeof %sShaderUniforms.dirty);\n}\n", programName, programName);
+        append_to_buffer_f(h, "// after the program was (re)linked, all values have to be uploaded again\n");
+        append_to_buffer_f(h, "static inline void %sShader_invalidate(void) { memset(%sShaderUniforms.dirty, 0xFF, sizeof %sShaderUniforms.dirty); }\n",
+                programName, programName, programName);
+        append_to_buffer_f(h, "static inline void %sShader_render(GfxVAO vao, int firstVertice, int length) { %sShader_flush(); render_with_GfxProgram(gfxProgram[PROGRAM_%s], vao, firstVertice, length); }\n",
+                programName, programName, programName);
+        append_to_buffer_f(h, "static inline void %sShader_render_primitive(int gfxPrimitiveKind, GfxVAO vao, int firstVertice, int length) { %sShader_flush(); render_primitive_with_GfxProgram(gfxPrimitiveKind, gfxProgram[PROGRAM_%s], vao, firstVertice, length); }\n",
+                programName, programName, programName);
+        append_to_buffer_f(h, "\n");
+}
+
+/* For the attributes [first, end) of ctx->programAttributes, which are those
+ * of one program: a C struct with the interleaved layout of a vertex, and a
+ * function that sets up all attributes of a VAO to read from a buffer of
+ * these vertices. The layout is checked by the compiler. */
+static void write_vertex_layout(struct WriteCtx *wc, struct GP_Ctx *ctx, int first, int end)
+{
+        struct MemoryBuffer *h = &wc->hFileHandle;
+        const char *programName = ctx->desc.programInfo[ctx->programAttributes[first].programIndex].programName;
+        int vertexSize = ctx->programAttributes[first].vertexSize;
+
+        append_to_buffer_f(h, "struct %sShader_Vertex {\n", programName);
+        // the fields in the order of their offsets
+        int offset = 0;
+        int numPaddings = 0;
+        for (int numWritten = 0; numWritten < end - first; numWritten++) {
+                const struct GP_ProgramAttribute *attribute = NULL;
+                for (int i = first; i < end; i++)
+                        if (ctx->programAttributes[i].offset >= offset
+                            && (attribute == NULL || ctx->programAttributes[i].offset < attribute->offset))
+                                attribute = &ctx->programAttributes[i];
+                if (attribute->offset > offset)
+                        append_to_buffer_f(h, INDENT "char _padding%d[%d];\n", numPaddings++, attribute->offset - offset);
+                int componentTypeKind;
+                int numColumns;
+                int numRows;
+                GP_ENSURE(gp_get_type_shape(attribute->typeKind, &componentTypeKind, &numColumns, &numRows));
+                int componentSize = componentTypeKind == GP_TYPE_DOUBLE ? 8 : 4;
+                append_to_buffer_f(h, INDENT "%s %s", TYPE_to_C_COMPONENT_TYPE[componentTypeKind], attribute->attributeName);
+                if (numColumns > 1)
+                        append_to_buffer_f(h, "[%d][%d]", numColumns, numRows);
+                else if (numRows > 1)
+                        append_to_buffer_f(h, "[%d]", numRows);
+                append_to_buffer_f(h, ";\n");
+                offset = attribute->offset + numColumns * numRows * componentSize;
+        }
+        if (vertexSize > offset)
+                append_to_buffer_f(h, INDENT "char _padding%d[%d];\n", numPaddings++, vertexSize - offset);
+        append_to_buffer_f(h, "};\n");
+        for (int i = first; i < end; i++)
+                append_to_buffer_f(h, "SM_STATIC_ASSERT(offsetof(struct %sShader_Vertex, %s) == %d);\n",
+                        programName, ctx->programAttributes[i].attributeName, ctx->programAttributes[i].offset);
+        append_to_buffer_f(h, "SM_STATIC_ASSERT(sizeof (struct %sShader_Vertex) == %d);\n", programName, vertexSize);
+
+        append_to_buffer_f(h, "static inline void %sShader_setup_vao(GfxVAO vao, GfxVBO vbo)\n{\n", programName);
+        for (int i = first; i < end; i++) {
+                const char *attributeName = ctx->programAttributes[i].attributeName;
+                int typeKind = ctx->programAttributes[i].typeKind;
+                int componentTypeKind;
+                int numColumns;
+                int numRows;
+                GP_ENSURE(gp_get_type_shape(typeKind, &componentTypeKind, &numColumns, &numRows));
+                if (numColumns == 1) {
+                        const char *typeName = TYPE_to_GRAFIKATTRIBUTETYPE[typeKind];
+                        GP_ENSURE(typeName != NULL);
+                        append_to_buffer_f(h, INDENT "set_GfxVAO_attribute(vao, vbo, gfxAttributeLocation[ATTRIBUTE_%s_%s], %s, sizeof (struct %sShader_Vertex), offsetof(struct %sShader_Vertex, %s));\n",
+                                programName, attributeName, typeName, programName, programName, attributeName);
+                        continue;
+                }
+                // the columns are at consecutive locations
+                const char *columnTypeName = COLUMN_TYPE_to_GRAFIKATTRIBUTETYPE[componentTypeKind][numRows];
+                GP_ENSURE(columnTypeName != NULL);
+                int columnSize = numRows * (componentTypeKind == GP_TYPE_DOUBLE ? 8 : 4);
+                for (int column = 0; column < numColumns; column++)
+                        append_to_buffer_f(h, INDENT "set_GfxVAO_attribute(vao, vbo, gfxAttributeLocation[ATTRIBUTE_%s_%s] + %d, %s, sizeof (struct %sShader_Vertex), offsetof(struct %sShader_Vertex, %s) + %d);\n",
+                                programName, attributeName, column, columnTypeName, programName, programName, attributeName, column * columnSize);
+        }
+        append_to_buffer_f(h, "}\n\n");
+}
+
+/* The C++ interface calls the C functions */
+static void write_cpp_uniform_setters(struct WriteCtx *wc, struct GP_Ctx *ctx, int first, int end)
+{
+        struct MemoryBuffer *h = &wc->hFileHandle;
+        const char *programName = ctx->desc.programInfo[ctx->programUniforms[first].programIndex].programName;
+        append_to_buffer_f(h, "static struct {\n");
+        append_to_buffer_f(h, INDENT "static inline void render(GfxVAO vao, int firstVertice, int length) { %sShader_render(vao, firstVertice, length); }\n", programName);
+        append_to_buffer_f(h, INDENT "static inline void render_primitive(int gfxPrimitiveKind, GfxVAO vao, int firstVertice, int length) { %sShader_render_primitive(gfxPrimitiveKind, vao, firstVertice, length); }\n", programName);
+        append_to_buffer_f(h, INDENT "static inline void flush() { %sShader_flush(); }\n", programName);
+        append_to_buffer_f(h, INDENT "static inline void invalidate() { %sShader_invalidate(); }\n", programName);
+        for (int i = first; i < end; i++) {
+                const char *uniformName = ctx->programUniforms[i].uniformName;
+                int typeKind = ctx->programUniforms[i].typeKind;
+                if (!is_settable_uniform_type(typeKind))
+                        continue;
+                append_to_buffer_f(h, INDENT "static inline void set_%s(%s) { %sShader_set_%s(%s); }\n",
+                        uniformName, UNIFORM_SETTER_INFO[typeKind].params, programName, uniformName, UNIFORM_SETTER_INFO[typeKind].args);
+        }
+        append_to_buffer_f(h, "} %sShader;\n\n", programName);
+}
+
 void write_c_interface(struct GP_Ctx *ctx, const char *autogenDirpath)
 {
         struct WriteCtx mtsCtx = { 0 };
@@ -196,7 +515,24 @@ void write_c_interface(struct GP_Ctx *ctx, const char *autogenDirpath)
                 "#define AUTOGENERATED_SHADERS_H_INCLUDED\n"
                 "\n"
                 "#include <glsl-processor.h>\n"
-                "\n"
+                "\n");
+
+        if (ctx->numProgramUniforms > 0)
+                append_to_buffer_f(&wc->hFileHandle, "#include <string.h>  // for the shadow copies of the uniforms\n\n");
+
+        if (ctx->numProgramBlocks > 0 || ctx->numProgramAttributes > 0)
+                append_to_buffer_f(&wc->hFileHandle,
+                        "#include <stddef.h>\n"
+                        "#include <stdint.h>\n"
+                        "\n"
+                        "#ifdef __cplusplus\n"
+                        "#define SM_STATIC_ASSERT(x) static_assert(x, #x)\n"
+                        "#else\n"
+                        "#define SM_STATIC_ASSERT(x) _Static_assert(x, #x)\n"
+                        "#endif\n"
+                        "\n");
+
+        append_to_buffer_f(&wc->hFileHandle,
                 "#ifdef __cplusplus\n"
                 "extern \"C\" {\n"
                 "#endif\n"
@@ -236,6 +572,8 @@ void write_c_interface(struct GP_Ctx *ctx, const char *autogenDirpath)
 
         append_to_buffer_f(&wc->hFileHandle,
                 "extern const struct SM_ShaderInfo smShaderInfo[NUM_SHADER_KINDS];\n"
+                "// the defines of each shader variant, NULL for plain shaders\n"
+                "extern const char *const smShaderDefines[NUM_SHADER_KINDS];\n"
                 "extern const struct SM_ProgramInfo smProgramInfo[NUM_PROGRAM_KINDS];\n"
                 "extern const struct SM_LinkInfo smLinkInfo[];\n"
                 "extern const int numLinkInfos;\n"
@@ -261,6 +599,20 @@ void write_c_interface(struct GP_Ctx *ctx, const char *autogenDirpath)
                         info->shaderName, gp_shadertypeKindString[info->shaderType], info->shaderName, info->fileID);
         }
         append_to_buffer_f(&wc->cFileHandle, "};\n\n");
+
+        /* The loader needs the defines of a variant to compile it. They are
+         * in an array of their own, so struct SM_ShaderInfo stays as it is. */
+        append_to_buffer_f(&wc->cFileHandle, "const char *const smShaderDefines[NUM_SHADER_KINDS] = {\n");
+        for (int i = 0; i < ctx->desc.numShaders; i++) {
+                struct GP_ShaderInfo *info = &ctx->desc.shaderInfo[i];
+                append_to_buffer_f(&wc->cFileHandle, INDENT "[SHADER_%s] = ", info->shaderName);
+                if (info->defines != NULL)
+                        append_c_string_literal(&wc->cFileHandle, info->defines);
+                else
+                        append_to_buffer(&wc->cFileHandle, "NULL");
+                append_to_buffer(&wc->cFileHandle, ",\n");
+        }
+        append_to_buffer_f(&wc->cFileHandle, "};\n\n");
         
         append_to_buffer_f(&wc->cFileHandle, "const struct SM_LinkInfo smLinkInfo[] = {\n");
         for (int i = 0; i < ctx->desc.numLinks; i++) {
@@ -315,6 +667,15 @@ void write_c_interface(struct GP_Ctx *ctx, const char *autogenDirpath)
                 "\n"
         );
 
+        for (int i = 0; i < ctx->numProgramUniforms; i++) {
+                int programIndex = ctx->programUniforms[i].programIndex;
+                const char *programName = ctx->desc.programInfo[programIndex].programName;
+                if (i == 0 || programIndex != ctx->programUniforms[i - 1].programIndex)
+                        append_to_buffer_f(&wc->cFileHandle, "struct %sShader_Uniforms %sShaderUniforms;\n", programName, programName);
+        }
+        if (ctx->numProgramUniforms > 0)
+                append_to_buffer_f(&wc->cFileHandle, "\n");
+
         append_to_buffer_f(&wc->cFileHandle,
                 "const struct SM_Description smDescription = {\n"
                 INDENT ".programInfo = smProgramInfo,\n"
@@ -336,60 +697,33 @@ void write_c_interface(struct GP_Ctx *ctx, const char *autogenDirpath)
                 "};\n\n"
         );
 
-        for (int i = 0; i < ctx->numProgramUniforms; i++) {
-                int programIndex = ctx->programUniforms[i].programIndex;
-                int typeKind = ctx->programUniforms[i].typeKind;
-                const char *programName = ctx->desc.programInfo[programIndex].programName;
-                if (i == 0 || programIndex != ctx->programUniforms[i - 1].programIndex) {
-                        append_to_buffer_f(&wc->hFileHandle, "static inline void %sShader_render(GfxVAO vao, int firstVertice, int length) { render_with_GfxProgram(gfxProgram[PROGRAM_%s], vao, firstVertice, length); }\n", programName, programName);
-                        append_to_buffer_f(&wc->hFileHandle, "static inline void %sShader_render_primitive(int gfxPrimitiveKind, GfxVAO vao, int firstVertice, int length) { render_primitive_with_GfxProgram(gfxPrimitiveKind, gfxProgram[PROGRAM_%s], vao, firstVertice, length); }\n", programName, programName);
-                }
-                const char *uniformName = ctx->programUniforms[i].uniformName;
-                append_to_buffer_f(&wc->hFileHandle, "static inline void %sShader_set_%s", programName, uniformName);
-                const char *fmt;
-                switch (typeKind) {
-                case GP_TYPE_FLOAT: fmt = "(float x) { set_GfxProgram_uniform_1f(gfxProgram[PROGRAM_%s], gfxUniformLocation[UNIFORM_%s_%s], x); }\n"; break;
-                case GP_TYPE_VEC2: fmt = "(float x, float y) { set_GfxProgram_uniform_2f(gfxProgram[PROGRAM_%s], gfxUniformLocation[UNIFORM_%s_%s], x, y); }\n"; break;
-                case GP_TYPE_VEC3: fmt = "(float x, float y, float z) { set_GfxProgram_uniform_3f(gfxProgram[PROGRAM_%s], gfxUniformLocation[UNIFORM_%s_%s], x, y, z); }\n"; break;
-                case GP_TYPE_VEC4: fmt = "(float x, float y, float z, float w) { set_GfxProgram_uniform_4f(gfxProgram[PROGRAM_%s], gfxUniformLocation[UNIFORM_%s_%s], x, y, z, w); }\n"; break;
-                case GP_TYPE_MAT2: fmt = "(float *fourFloats) { set_GfxProgram_uniform_mat2f(gfxProgram[PROGRAM_%s], gfxUniformLocation[UNIFORM_%s_%s], fourFloats); }\n"; break;
-                case GP_TYPE_MAT3: fmt = "(float *nineFloats) { set_GfxProgram_uniform_mat3f(gfxProgram[PROGRAM_%s], gfxUniformLocation[UNIFORM_%s_%s], nineFloats); }\n"; break;
-                case GP_TYPE_MAT4: fmt = "(float *sixteenFloats) { set_GfxProgram_uniform_mat4f(gfxProgram[PROGRAM_%s], gfxUniformLocation[UNIFORM_%s_%s], sixteenFloats); }\n"; break;
-                case GP_TYPE_SAMPLER2D: continue;  // cannot be set, can it?
-                default: gp_fatal_f("Not implemented!");
-                }
-                append_to_buffer_f(&wc->hFileHandle, fmt, programName, programName, uniformName);
+        for (int i = 0; i < ctx->numProgramUniforms;) {
+                int end = i + 1;
+                while (end < ctx->numProgramUniforms && ctx->programUniforms[end].programIndex == ctx->programUniforms[i].programIndex)
+                        end++;
+                write_uniform_setters(wc, ctx, i, end);
+                i = end;
+        }
+        for (int i = 0; i < ctx->numProgramAttributes;) {
+                int end = i + 1;
+                while (end < ctx->numProgramAttributes && ctx->programAttributes[end].programIndex == ctx->programAttributes[i].programIndex)
+                        end++;
+                write_vertex_layout(wc, ctx, i, end);
+                i = end;
         }
+        for (int i = 0; i < ctx->numProgramBlocks; i++)
+                write_block_struct(wc, ctx, &ctx->programBlocks[i]);
 
         append_to_buffer_f(&wc->hFileHandle,
                 "\n"
                 "\n"
                 "#ifdef __cplusplus\n\n");
-        for (int i = 0; i < ctx->numProgramUniforms; i++) {
-                int programIndex = ctx->programUniforms[i].programIndex;
-                int typeKind = ctx->programUniforms[i].typeKind;
-                const char *uniformName = ctx->programUniforms[i].uniformName;
-                const char *programName = ctx->desc.programInfo[programIndex].programName;
-                if (i == 0 || programIndex != ctx->programUniforms[i - 1].programIndex) {
-                        append_to_buffer_f(&wc->hFileHandle, "static struct {\n");
-                        append_to_buffer_f(&wc->hFileHandle, INDENT "static inline void render(GfxVAO vao, int firstVertice, int length) { render_with_GfxProgram(gfxProgram[PROGRAM_%s], vao, firstVertice, length); }\n", programName);
-                        append_to_buffer_f(&wc->hFileHandle, INDENT "static inline void render_primitive(int gfxPrimitiveKind, GfxVAO vao, int firstVertice, int length) { render_with_GfxProgram(int gfxPrimitiveKind, gfxProgram[PROGRAM_%s], vao, firstVertice, length); }\n", programName);
-                }
-                append_to_buffer_f(&wc->hFileHandle, INDENT "static inline void set_%s", uniformName);
-                const char *fmt;
-                switch (typeKind) {
-                case GP_TYPE_FLOAT: fmt = "(float x) { set_GfxProgram_uniform_1f(gfxProgram[PROGRAM_%s], gfxUniformLocation[UNIFORM_%s_%s], x); }\n"; break;
-                case GP_TYPE_VEC2: fmt = "(float x, float y) { set_GfxProgram_uniform_2f(gfxProgram[PROGRAM_%s], gfxUniformLocation[UNIFORM_%s_%s], x, y); }\n"; break;
-                case GP_TYPE_VEC3: fmt = "(float x, float y, float z) { set_GfxProgram_uniform_3f(gfxProgram[PROGRAM_%s], gfxUniformLocation[UNIFORM_%s_%s], x, y, z); }\n"; break;
-                case GP_TYPE_VEC4: fmt = "(float x, float y, float z, float w) { set_GfxProgram_uniform_4f(gfxProgram[PROGRAM_%s], gfxUniformLocation[UNIFORM_%s_%s], x, y, z, w); }\n"; break;
-                case GP_TYPE_MAT2: fmt = "(float *fourFloats) { set_GfxProgram_uniform_mat2f(gfxProgram[PROGRAM_%s], gfxUniformLocation[UNIFORM_%s_%s], fourFloats); }\n"; break;
-                case GP_TYPE_MAT3: fmt = "(float *nineFloats) { set_GfxProgram_uniform_mat3f(gfxProgram[PROGRAM_%s], gfxUniformLocation[UNIFORM_%s_%s], nineFloats); }\n"; break;
-                case GP_TYPE_MAT4: fmt = "(float *sixteenFloats) { set_GfxProgram_uniform_mat4f(gfxProgram[PROGRAM_%s], gfxUniformLocation[UNIFORM_%s_%s], sixteenFloats); }\n"; break;
-                default: gp_fatal_f("Not implemented!");
-                }
-                append_to_buffer_f(&wc->hFileHandle, fmt, programName, programName, uniformName);
-                if (i + 1 == ctx->numProgramUniforms || programIndex != ctx->programUniforms[i + 1].programIndex)
-                        append_to_buffer_f(&wc->hFileHandle, "} %sShader;\n\n", programName);
+        for (int i = 0; i < ctx->numProgramUniforms;) {
+                int end = i + 1;
+                while (end < ctx->numProgramUniforms && ctx->programUniforms[end].programIndex == ctx->programUniforms[i].programIndex)
+                        end++;
+                write_cpp_uniform_setters(wc, ctx, i, end);
+                i = end;
         }
         append_to_buffer_f(&wc->hFileHandle, "#endif // #ifdef __cplusplus\n\n");
 
@@ -447,25 +781,9 @@ static const struct {
 int main(void)
 {
         struct GP_Builder sp = {0};
-        for (int i = 0; i < LENGTH(shaders); i++) {
-                const char *filepath = shaders[i].fileID;
-                FILE *f = fopen(filepath, "rb");
-                if (f == NULL)
-                        gp_fatal_f("Failed to open shader file '%s'", filepath);
-                fseek(f, 0, SEEK_END);
-                long size = ftell(f);
-                char *data;
-                ALLOC_MEMORY(&data, size + 1);
-                fseek(f, 0, SEEK_SET);
-                size_t nread = fread(data, 1, size + 1, f);
-                if (nread != size)
-                        gp_fatal_f("Expected to read %d bytes from '%s', but got %d",
-                                size, filepath, nread);
-                if (ferror(f))
-                        gp_fatal_f("I/O error while reading from '%s'", filepath);
-                fclose(f);
-                gp_builder_create_file(&sp, shaders[i].fileID, data, size);
-        }
+        // the fileIDs are the paths of the files
+        for (int i = 0; i < LENGTH(shaders); i++)
+                gp_builder_map_file(&sp, shaders[i].fileID, shaders[i].fileID);
         for (int i = 0; i < LENGTH(shaders); i++)
                 gp_builder_create_shader(&sp, shaders[i].shaderID, shaders[i].fileID, shaders[i].shadertypeKind);
         for (int i = 0; i < LENGTH(programs); i++)
@@ -475,6 +793,8 @@ int main(void)
         gp_builder_process(&sp);
         struct GP_Ctx ctx = {0};
         gp_builder_to_ctx(&sp, &ctx);
+        // we only generate interfaces, and don't need to look into function bodies
+        ctx.parseMode = GP_PARSE_MODE_REFLECTION;
         gp_parse(&ctx);
         write_c_interface(&ctx, "autogenerated/");
         gp_teardown(&ctx);
@@ -43,6 +43,16 @@ enum {
         GP_TOKEN_DOUBLEAMPERSAND,
         GP_TOKEN_PIPE,
         GP_TOKEN_DOUBLEPIPE,
+        GP_TOKEN_LEFTBRACKET,
+        GP_TOKEN_RIGHTBRACKET,
+        GP_TOKEN_QUESTIONMARK,
+        GP_TOKEN_COLON,
+        GP_TOKEN_CARET,
+        GP_TOKEN_TILDE,
+        GP_TOKEN_LEFTSHIFT,
+        GP_TOKEN_RIGHTSHIFT,
+        GP_TOKEN_INCREMENT,
+        GP_TOKEN_DECREMENT,
         GP_NUM_TOKEN_KINDS
 };
 
@@ -76,6 +86,55 @@ enum {
         GP_NUM_BINOP_KINDS,
 };
 
+/* GLSL keywords, except for the names of the built-in types. */
+enum {
+        GP_KEYWORD_CONST,
+        GP_KEYWORD_UNIFORM,
+        GP_KEYWORD_BUFFER,
+        GP_KEYWORD_SHARED,
+        GP_KEYWORD_ATTRIBUTE,
+        GP_KEYWORD_VARYING,
+        GP_KEYWORD_COHERENT,
+        GP_KEYWORD_VOLATILE,
+        GP_KEYWORD_RESTRICT,
+        GP_KEYWORD_READONLY,
+        GP_KEYWORD_WRITEONLY,
+        GP_KEYWORD_LAYOUT,
+        GP_KEYWORD_CENTROID,
+        GP_KEYWORD_FLAT,
+        GP_KEYWORD_SMOOTH,
+        GP_KEYWORD_NOPERSPECTIVE,
+        GP_KEYWORD_PATCH,
+        GP_KEYWORD_SAMPLE,
+        GP_KEYWORD_INVARIANT,
+        GP_KEYWORD_PRECISE,
+        GP_KEYWORD_BREAK,
+        GP_KEYWORD_CONTINUE,
+        GP_KEYWORD_DO,
+        GP_KEYWORD_FOR,
+        GP_KEYWORD_WHILE,
+        GP_KEYWORD_SWITCH,
+        GP_KEYWORD_CASE,
+        GP_KEYWORD_DEFAULT,
+        GP_KEYWORD_IF,
+        GP_KEYWORD_ELSE,
+        GP_KEYWORD_SUBROUTINE,
+        GP_KEYWORD_IN,
+        GP_KEYWORD_OUT,
+        GP_KEYWORD_INOUT,
+        GP_KEYWORD_TRUE,
+        GP_KEYWORD_FALSE,
+        GP_KEYWORD_LOWP,
+        GP_KEYWORD_MEDIUMP,
+        GP_KEYWORD_HIGHP,
+        GP_KEYWORD_PRECISION,
+        GP_KEYWORD_STRUCT,
+        GP_KEYWORD_RETURN,
+        GP_KEYWORD_DISCARD,
+        GP_KEYWORD_VOID,
+        GP_NUM_KEYWORD_KINDS
+};
+
 // TODO: The "prim" no longer makes sense
 enum {
         GP_TYPE_BOOL,
@@ -90,6 +149,106 @@ enum {
         GP_TYPE_MAT3,
         GP_TYPE_MAT4,
         GP_TYPE_SAMPLER2D,
+        GP_TYPE_DVEC2,
+        GP_TYPE_DVEC3,
+        GP_TYPE_DVEC4,
+        GP_TYPE_BVEC2,
+        GP_TYPE_BVEC3,
+        GP_TYPE_BVEC4,
+        GP_TYPE_IVEC2,
+        GP_TYPE_IVEC3,
+        GP_TYPE_IVEC4,
+        GP_TYPE_UVEC2,
+        GP_TYPE_UVEC3,
+        GP_TYPE_UVEC4,
+        GP_TYPE_MAT2X3,
+        GP_TYPE_MAT2X4,
+        GP_TYPE_MAT3X2,
+        GP_TYPE_MAT3X4,
+        GP_TYPE_MAT4X2,
+        GP_TYPE_MAT4X3,
+        GP_TYPE_DMAT2,
+        GP_TYPE_DMAT3,
+        GP_TYPE_DMAT4,
+        GP_TYPE_DMAT2X3,
+        GP_TYPE_DMAT2X4,
+        GP_TYPE_DMAT3X2,
+        GP_TYPE_DMAT3X4,
+        GP_TYPE_DMAT4X2,
+        GP_TYPE_DMAT4X3,
+        GP_TYPE_SAMPLER1D,
+        GP_TYPE_SAMPLER3D,
+        GP_TYPE_SAMPLERCUBE,
+        GP_TYPE_SAMPLER1DARRAY,
+        GP_TYPE_SAMPLER2DARRAY,
+        GP_TYPE_SAMPLERCUBEARRAY,
+        GP_TYPE_SAMPLER2DRECT,
+        GP_TYPE_SAMPLERBUFFER,
+        GP_TYPE_SAMPLER2DMS,
+        GP_TYPE_SAMPLER2DMSARRAY,
+        GP_TYPE_SAMPLER1DSHADOW,
+        GP_TYPE_SAMPLER2DSHADOW,
+        GP_TYPE_SAMPLERCUBESHADOW,
+        GP_TYPE_SAMPLER1DARRAYSHADOW,
+        GP_TYPE_SAMPLER2DARRAYSHADOW,
+        GP_TYPE_SAMPLERCUBEARRAYSHADOW,
+        GP_TYPE_SAMPLER2DRECTSHADOW,
+        GP_TYPE_ISAMPLER1D,
+        GP_TYPE_ISAMPLER2D,
+        GP_TYPE_ISAMPLER3D,
+        GP_TYPE_ISAMPLERCUBE,
+        GP_TYPE_ISAMPLER1DARRAY,
+        GP_TYPE_ISAMPLER2DARRAY,
+        GP_TYPE_ISAMPLERCUBEARRAY,
+        GP_TYPE_ISAMPLER2DRECT,
+        GP_TYPE_ISAMPLERBUFFER,
+        GP_TYPE_ISAMPLER2DMS,
+        GP_TYPE_ISAMPLER2DMSARRAY,
+        GP_TYPE_USAMPLER1D,
+        GP_TYPE_USAMPLER2D,
+        GP_TYPE_USAMPLER3D,
+        GP_TYPE_USAMPLERCUBE,
+        GP_TYPE_USAMPLER1DARRAY,
+        GP_TYPE_USAMPLER2DARRAY,
+        GP_TYPE_USAMPLERCUBEARRAY,
+        GP_TYPE_USAMPLER2DRECT,
+        GP_TYPE_USAMPLERBUFFER,
+        GP_TYPE_USAMPLER2DMS,
+        GP_TYPE_USAMPLER2DMSARRAY,
+        GP_TYPE_IMAGE1D,
+        GP_TYPE_IMAGE2D,
+        GP_TYPE_IMAGE3D,
+        GP_TYPE_IMAGECUBE,
+        GP_TYPE_IMAGE1DARRAY,
+        GP_TYPE_IMAGE2DARRAY,
+        GP_TYPE_IMAGECUBEARRAY,
+        GP_TYPE_IMAGE2DRECT,
+        GP_TYPE_IMAGEBUFFER,
+        GP_TYPE_IMAGE2DMS,
+        GP_TYPE_IMAGE2DMSARRAY,
+        GP_TYPE_IIMAGE1D,
+        GP_TYPE_IIMAGE2D,
+        GP_TYPE_IIMAGE3D,
+        GP_TYPE_IIMAGECUBE,
+        GP_TYPE_IIMAGE1DARRAY,
+        GP_TYPE_IIMAGE2DARRAY,
+        GP_TYPE_IIMAGECUBEARRAY,
+        GP_TYPE_IIMAGE2DRECT,
+        GP_TYPE_IIMAGEBUFFER,
+        GP_TYPE_IIMAGE2DMS,
+        GP_TYPE_IIMAGE2DMSARRAY,
+        GP_TYPE_UIMAGE1D,
+        GP_TYPE_UIMAGE2D,
+        GP_TYPE_UIMAGE3D,
+        GP_TYPE_UIMAGECUBE,
+        GP_TYPE_UIMAGE1DARRAY,
+        GP_TYPE_UIMAGE2DARRAY,
+        GP_TYPE_UIMAGECUBEARRAY,
+        GP_TYPE_UIMAGE2DRECT,
+        GP_TYPE_UIMAGEBUFFER,
+        GP_TYPE_UIMAGE2DMS,
+        GP_TYPE_UIMAGE2DMSARRAY,
+        GP_TYPE_ATOMIC_UINT,
         GP_NUM_TYPE_KINDS
 };
 
@@ -97,8 +256,18 @@ struct GP_UnopInfo {
         char *text;
 };
 
+/* Operators with a higher precedence bind more tightly. Operators of the
+ * same precedence have the same associativity. */
 struct GP_BinopInfo {
         char *text;
+        int precedence;
+        int isRightAssociative;
+};
+
+/* additional names for built-in types, like "mat2x2" for "mat2" */
+struct GP_TypeAlias {
+        const char *name;
+        int typeKind;
 };
 
 struct GP_UnopTokenInfo {
@@ -111,54 +280,81 @@ struct GP_BinopTokenInfo {
         int binopKind;
 };
 
-typedef int GP_Expr;
-typedef int GP_Stmt;
-typedef int GP_TypeExpr;
-
-struct GP_LitExpr {
-        double floatingValue;  // TODO better representation
-};
-
-struct GP_BinopExpr {
-        GP_Expr exprLeft;
-        GP_Expr exprRight;
+/* A view into the contents of one of the input files. The text is not
+ * zero-terminated and is only copied out when a consumer asks for it. */
+struct GP_Span {
+        int fileIndex;
+        int offset;
+        int length;
 };
 
-struct GP_ExprNode {
-        int exprKind;
-        union {
-                struct GP_LitExpr tLit;
-                struct GP_BinopExpr tBinop;
-        } data;
+/* A position in one of the input files. Lines and columns start at 1,
+ * columns count bytes. */
+struct GP_SourceLoc {
+        int fileIndex;
+        int line;
+        int column;
 };
 
-struct GP_ExprStmt {
-        GP_Expr expr;
-};
+/* An interned identifier, see intern.h */
+typedef int GP_Atom;
 
-struct GP_ReturnStmt {
-        GP_Expr expr;
-};
+typedef int GP_Expr;
+typedef int GP_Stmt;
+typedef int GP_TypeExpr;
 
-struct GP_IfStmt {
-        GP_Expr condExpr;
-        GP_Stmt stmt;
+enum {
+        GP_EXPR_LITERAL,
+        GP_EXPR_NAME,
+        GP_EXPR_UNOP,
+        GP_EXPR_BINOP,
+        GP_EXPR_CALL,
+        GP_EXPR_MEMBER,
+        GP_NUM_EXPR_KINDS
 };
 
-struct GP_IfElseStmt {
-        GP_Expr condExpr;
-        GP_Stmt ifBranchStmt;
-        GP_Stmt elseBranchStmt;
+enum {
+        GP_STMT_COMPOUND,
+        GP_STMT_VARIABLE,
+        GP_STMT_IF,
+        GP_STMT_RETURN,
+        GP_STMT_DISCARD,
+        GP_STMT_EXPR,
+        GP_NUM_STMT_KINDS
 };
 
-struct GP_StmtNode {
-        int stmtKind;
-        union {
-                struct GP_ExprStmt tExpr;
-                struct GP_ReturnStmt tReturn;
-                struct GP_IfStmt tIf;
-                struct GP_IfElseStmt tIfElse;
-        } data;
+/* The expressions and statements of the function bodies of a file are stored
+ * in two pools, as structures of arrays that are indexed by GP_Expr and
+ * GP_Stmt. Children are referred to by their index in the pool as well, and
+ * -1 means that an optional child is absent. The meaning of the operands
+ * depends on the kind of the node:
+ *
+ *      GP_EXPR_LITERAL   operand0: index in literalValues and literalKinds
+ *      GP_EXPR_NAME      operand0: GP_Atom
+ *      GP_EXPR_UNOP      operand0: GP_UNOP_*, operand1: GP_Expr
+ *      GP_EXPR_BINOP     operand0: GP_BINOP_*, operand1 and operand2: GP_Expr
+ *      GP_EXPR_CALL      operand0: the called GP_Expr, operand1: node list of
+ *                        the argument GP_Exprs
+ *      GP_EXPR_MEMBER    operand0: GP_Expr, operand1: GP_Atom of the member
+ *
+ *      GP_STMT_COMPOUND  operand0: node list of GP_Stmts
+ *      GP_STMT_VARIABLE  operand0: GP_TYPE_*, operand1: GP_Atom, operand2:
+ *                        initializer GP_Expr or -1
+ *      GP_STMT_IF        operand0: condition GP_Expr, operand1: GP_Stmt,
+ *                        operand2: else branch GP_Stmt or -1
+ *      GP_STMT_RETURN    operand0: GP_Expr or -1
+ *      GP_STMT_DISCARD   -
+ *      GP_STMT_EXPR      operand0: GP_Expr
+ *
+ * A node list is an offset in nodeLists, where the number of nodes is stored,
+ * followed by the nodes. */
+struct GP_NodePool {
+        unsigned char *kinds;  // GP_EXPR_* or GP_STMT_*
+        int *operand0;
+        int *operand1;
+        int *operand2;
+        int numNodes;
+        int numNodesAllocated;
 };
 
 /* we probably should get rid of this type. GLSL has - to my knowledge - only
@@ -169,31 +365,74 @@ struct GP_TypeExpr {
 };
 
 struct GP_UniformDecl {
-        char *uniDeclName;
+        GP_Atom uniDeclName;
         struct GP_TypeExpr *uniDeclTypeExpr;
 };
 
 struct GP_VariableDecl {
         int inOrOut;
         struct GP_TypeExpr *typeExpr;
-        char *name;
+        GP_Atom name;
 };
 
 struct GP_FuncDecl {
-        char *name;
+        GP_Atom name;
         struct GP_TypeExpr *returnTypeExpr;
         struct GP_TypeExpr **argTypeExprs;
-        char **argNames;
+        GP_Atom *argNames;
         int numArgs;
 };
 
 struct GP_FuncDefn {
-        char *name;
+        GP_Atom name;
         struct GP_TypeExpr *returnTypeExpr;
         struct GP_TypeExpr **argTypeExprs;
-        char **argNames;
+        GP_Atom *argNames;
         int numArgs;
-        GP_Stmt bodyStmt;
+        GP_Stmt bodyStmt;  // GP_STMT_COMPOUND, or -1 if the body was skipped
+};
+
+enum {
+        GP_BLOCK_UNIFORM,  // "uniform"
+        GP_BLOCK_BUFFER,  // "buffer", a shader storage block
+        GP_NUM_BLOCK_KINDS
+};
+
+enum {
+        GP_BLOCK_LAYOUT_SHARED,  // the default
+        GP_BLOCK_LAYOUT_PACKED,
+        GP_BLOCK_LAYOUT_STD140,
+        GP_BLOCK_LAYOUT_STD430,
+        GP_NUM_BLOCK_LAYOUT_KINDS
+};
+
+/* A member of an interface block. The offset, alignment, size and strides
+ * are in bytes, see layout.h. With the shared and packed layouts they are up
+ * to the implementation, and are -1 here. */
+struct GP_BlockMember {
+        int typeKind;
+        GP_Atom name;
+        int arrayLength;  // 0 if not an array, -1 if the array is runtime-sized
+        int isRowMajor;
+        int explicitOffset;  // from the "offset" layout qualifier, -1 if not given
+        int explicitAlignment;  // from the "align" layout qualifier, -1 if not given
+        int offset;
+        int alignment;  // the actual alignment, with the "align" qualifier applied
+        int size;  // of all elements (0 for a runtime-sized array)
+        int arrayStride;  // 0 if not an array
+        int matrixStride;  // 0 if not a matrix
+};
+
+struct GP_BlockDecl {
+        int blockKind;  // GP_BLOCK_*
+        int layoutKind;  // GP_BLOCK_LAYOUT_*
+        int binding;  // -1 if not given
+        GP_Atom blockName;
+        GP_Atom instanceName;  // -1 if the members are in the global scope
+        int instanceArrayLength;  // 0 if the instance is not an array
+        struct GP_BlockMember *members;
+        int numMembers;
+        int size;  // -1 like the member offsets
 };
 
 enum {
@@ -201,30 +440,82 @@ enum {
         GP_DIRECTIVE_VARIABLE,  // "in" or "out"
         GP_DIRECTIVE_FUNCDECL,
         GP_DIRECTIVE_FUNCDEFN,
+        GP_DIRECTIVE_BLOCK,  // "uniform" or "buffer" interface block
 };
 
 struct GP_ToplevelNode {
         int directiveKind;
+        struct GP_SourceLoc loc;  // where the first token of the item is
+        /* The range of the preprocessed output that belongs to the item,
+         * including the whitespace before it. -1 if the item shares a macro
+         * expansion with other output, so it can't be cut out. */
+        int outputStart;
+        int outputEnd;
         union {
                 struct GP_UniformDecl *tUniform;
+                struct GP_BlockDecl *tBlock;
                 struct GP_VariableDecl *tVariable;
                 struct GP_FuncDecl *tFuncdecl;
                 struct GP_FuncDefn *tFuncdefn;
         } data;
 };
 
+enum {
+        GP_GENERATED_TEXT = -1,  // fileIndex of output spans in generatedText
+};
+
 struct GP_ShaderfileAst {
         // For now, for simplicity and pointer stability, an array of pointers...
         struct GP_ToplevelNode **toplevelNodes;
         int numToplevelNodes;
-        /* preprocessed output */
+        int numToplevelNodesAllocated;
+        /* Preprocessed output. With GP_OUTPUT_MODE_BUFFER, the text is in
+         * output (zero-terminated, or NULL if it is empty). With
+         * GP_OUTPUT_MODE_SPANS, it is the concatenation of the outputSpans,
+         * which refer to the input files, or to generatedText if their
+         * fileIndex is GP_GENERATED_TEXT (that is the text of macro
+         * expansions). outputSize is the length of the text in both
+         * modes. With GP_OUTPUT_MODE_MINIFIED, unminifiedSize is the size
+         * that the output had before it was minified. */
         char *output;
         int outputSize;
+        int outputAllocated;
+        int unminifiedSize;
+        struct GP_Span *outputSpans;
+        int numOutputSpans;
+        int numOutputSpansAllocated;
+        char *generatedText;
+        int generatedTextSize;
+        int generatedTextAllocated;
+        /* the function bodies, see GP_NodePool */
+        struct GP_NodePool exprPool;
+        struct GP_NodePool stmtPool;
+        int *nodeLists;
+        int nodeListsSize;
+        int nodeListsAllocated;
+        double *literalValues;
+        unsigned char *literalKinds;  // GP_LITERAL_*
+        int numLiteralValues;
+        int numLiteralValuesAllocated;
 };
 
+static inline int gp_node_list_length(const struct GP_ShaderfileAst *fa, int nodeList)
+{
+        return fa->nodeLists[nodeList];
+}
+
+static inline const int *gp_node_list_nodes(const struct GP_ShaderfileAst *fa, int nodeList)
+{
+        return &fa->nodeLists[nodeList + 1];
+}
+
 extern const char *const gp_tokenKindString[GP_NUM_TOKEN_KINDS];
 extern const char *const gp_typeKindString[GP_NUM_TYPE_KINDS];
 extern const char *const gp_typeString[GP_NUM_TYPE_KINDS];
+extern const char *const gp_keywordKindString[GP_NUM_KEYWORD_KINDS];
+extern const char *const gp_keywordString[GP_NUM_KEYWORD_KINDS];
+extern const struct GP_TypeAlias gp_typeAlias[];
+extern const int gp_numTypeAliases;
 extern const char *const gp_shadertypeKindString[GP_NUM_SHADERTYPE_KINDS];
 extern const struct GP_UnopInfo gp_unopInfo[GP_NUM_UNOP_KINDS];
 extern const struct GP_UnopTokenInfo gp_unopTokenInfo[];
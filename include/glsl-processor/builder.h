@@ -25,8 +25,29 @@ void gp_builder_teardown(struct GP_Builder *ctx);
 void gp_builder_process(struct GP_Builder *ctx);
 void gp_builder_to_ctx(struct GP_Builder *sp, struct GP_Ctx *ctx);
 
+/* The data is copied. */
 void gp_builder_create_file(struct GP_Builder *ctx, const char *fileID, const char *data, int size);
+/* The data is not copied. It must stay valid and unchanged until the file is
+ * destroyed, and as long as a GP_Ctx that was made from the builder is used
+ * (the spans in the ASTs point into it). The caller releases it. */
+void gp_builder_create_file_borrowed(struct GP_Builder *ctx, const char *fileID, const char *data, int size);
+/* The file at filepath is mapped into memory read-only, instead of being read
+ * into a buffer. It is unmapped when the file is destroyed (so the contract
+ * of gp_builder_create_file_borrowed() applies). It must not be modified
+ * while it is mapped. */
+void gp_builder_map_file(struct GP_Builder *ctx, const char *fileID, const char *filepath);
+/* The file is not buffered. It is read with readFunc in blocks while it is
+ * parsed. See GP_ReadFunc. Tokens and preprocessor directive lines can't be
+ * longer than a block (see streamBlockSize in GP_Ctx). */
+void gp_builder_create_file_streamed(struct GP_Builder *ctx, const char *fileID, GP_ReadFunc *readFunc, void *readUserData);
 void gp_builder_create_shader(struct GP_Builder *ctx, const char *shaderID, const char *fileID, int shadertypeKind);
+/* A shader that is made from the file with some macros predefined, for
+ * example "USE_SHADOWS MAX_LIGHTS=4" (see GP_ShaderInfo). Several variants
+ * of a file are parsed in one gp_parse() call, and the file is lexed only
+ * once for all of them. Each variant is preprocessed and parsed on its own
+ * (see GP_ParseUnit). Shaders with the same file and the same defines
+ * string share the parse result. */
+void gp_builder_create_shader_variant(struct GP_Builder *ctx, const char *shaderID, const char *fileID, int shadertypeKind, const char *defines);
 void gp_builder_create_program(struct GP_Builder *ctx, const char *programID);
 void gp_builder_create_link(struct GP_Builder *ctx, const char *programID, const char *shaderID);
 
@@ -0,0 +1,18 @@
+#ifndef GP_CALLGRAPH_H_INCLUDED
+#define GP_CALLGRAPH_H_INCLUDED
+
+#include <glsl-processor/parse.h>
+
+/* Removes the definitions and declarations of the functions that are not
+ * reachable from main() from the preprocessed output of fa. The call graph
+ * is built from the function bodies. Functions are identified by their
+ * names, so all overloads of a called function are kept. The nodes stay in
+ * the AST, but their output ranges are updated (removed functions get an
+ * empty range).
+ *
+ * Nothing is removed if fa has no main(), or if a function body was not
+ * parsed (GP_PARSE_MODE_REFLECTION). A function that can't be cut out of the
+ * output (see GP_ToplevelNode) is kept, together with what it calls. */
+void gp_remove_dead_functions(struct GP_Ctx *ctx, struct GP_ShaderfileAst *fa);
+
+#endif
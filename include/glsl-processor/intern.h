@@ -0,0 +1,47 @@
+#ifndef GP_INTERN_H_INCLUDED
+#define GP_INTERN_H_INCLUDED
+
+#include <glsl-processor/ast.h>
+#include <glsl-processor/memory.h>
+
+/* Intern table for identifiers. Each distinct string is stored exactly once
+ * and is identified by its atom, which is its index in the table (atoms are
+ * handed out in the order in which the strings are first seen). Comparing
+ * atoms is equivalent to comparing the strings. The stored strings are
+ * zero-terminated and don't move while the table exists. */
+
+struct GP_InternTable {
+        /* indexed by atom */
+        const char **strings;
+        int *lengths;
+        unsigned *hashes;
+        int numAtoms;
+        int numAtomsAllocated;
+
+        /* open addressing, contains atom + 1, or 0 for an empty slot */
+        int *buckets;
+        int numBuckets;  // power of 2
+
+        struct GP_Arena stringArena;
+};
+
+void gp_intern_setup(struct GP_InternTable *table);
+void gp_intern_teardown(struct GP_InternTable *table);
+GP_Atom gp_intern_string(struct GP_InternTable *table, const char *string, int length);
+/* For callers that need the hash themselves, to pick one of several tables */
+unsigned gp_intern_hash(const char *string, int length);
+GP_Atom gp_intern_string_with_hash(struct GP_InternTable *table, const char *string, int length, unsigned hash);
+/* Returns -1 if the string was never interned */
+GP_Atom gp_intern_find_string(struct GP_InternTable *table, const char *string, int length);
+
+static inline const char *gp_intern_table_string(struct GP_InternTable *table, GP_Atom atom)
+{
+        return table->strings[atom];
+}
+
+static inline int gp_intern_table_length(struct GP_InternTable *table, GP_Atom atom)
+{
+        return table->lengths[atom];
+}
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef GP_KEYWORDHASH_H_INCLUDED
+#define GP_KEYWORDHASH_H_INCLUDED
+
+#include <glsl-processor/ast.h>
+#include <string.h>
+
+/* Perfect hash over the GLSL keywords and the names of the built-in types.
+ * The tables in src/keywordhash.c are generated by tools/gen-keywordhash.c
+ * (run "make keywordhash" after changing the keyword or type lists in
+ * src/data.c). The generator searches a seed for which gp_keyword_hash() maps
+ * each name to a different slot. */
+
+#define GP_KEYWORD_HASH_SIZE 2048
+
+struct GP_KeywordHashEntry {
+        const char *name;
+        int length;
+        int keywordKind;  // -1 if the name is a type name
+        int typeKind;  // -1 if the name is not a type name
+};
+
+extern const unsigned gp_keywordHashSeed;
+extern const int gp_keywordHashMaxLength;
+extern const struct GP_KeywordHashEntry gp_keywordHashEntries[];
+/* index of the entry plus 1, or 0 for an empty slot */
+extern const unsigned char gp_keywordHashTable[GP_KEYWORD_HASH_SIZE];
+
+static inline unsigned gp_keyword_hash(unsigned seed, const char *p, int length)
+{
+        unsigned h = seed ^ (unsigned) length;
+        for (int i = 0; i < length; i++)
+                h = (h ^ (unsigned char) p[i]) * 16777619u;
+        return (h ^ (h >> 16)) & (GP_KEYWORD_HASH_SIZE - 1);
+}
+
+/* Returns NULL if the name is neither a keyword nor a type name */
+static inline const struct GP_KeywordHashEntry *gp_lookup_keyword(const char *p, int length)
+{
+        if (length > gp_keywordHashMaxLength)
+                return NULL;
+        int idx = gp_keywordHashTable[gp_keyword_hash(gp_keywordHashSeed, p, length)];
+        if (idx == 0)
+                return NULL;
+        const struct GP_KeywordHashEntry *entry = &gp_keywordHashEntries[idx - 1];
+        if (entry->length != length || memcmp(entry->name, p, length) != 0)
+                return NULL;
+        return entry;
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef GP_LAYOUT_H_INCLUDED
+#define GP_LAYOUT_H_INCLUDED
+
+#include <glsl-processor/ast.h>
+
+/* The memory layout of interface blocks, by the std140 and std430 rules of
+ * the OpenGL specification. A matrix is laid out like an array of its column
+ * vectors, or of its row vectors if it is row-major. */
+
+/* The shape of a type that can be a member of a block: the type of its
+ * components (GP_TYPE_BOOL, GP_TYPE_INT, GP_TYPE_UINT, GP_TYPE_FLOAT or
+ * GP_TYPE_DOUBLE) and its numbers of columns and rows. Vectors and scalars
+ * have one column. Returns 0 if the type is opaque (a sampler, an image or
+ * an atomic counter), which can't be in a block. */
+int gp_get_type_shape(int typeKind, int *componentTypeKind, int *numColumns, int *numRows);
+
+/* Computes the offsets, alignments, sizes and strides of the members, and the
+ * size of the block, if it has the std140 or std430 layout. The size is
+ * rounded up to the alignment of the block. If the last member is a
+ * runtime-sized array, the size is where the array starts. The offset and
+ * align qualifiers of the members are applied. Returns the index of the first
+ * member with an invalid offset qualifier (one that is not a multiple of the
+ * base alignment, or that is within the previous member), or -1. */
+int gp_compute_block_layout(struct GP_BlockDecl *block);
+
+struct GP_ProgramAttribute;
+
+/* Computes the offsets of the attributes of one program in an interleaved
+ * vertex, and the size of the vertex. The components of an attribute are
+ * tightly packed (a matrix is its columns), and each attribute is aligned to
+ * the size of its components. The attributes with doubles come first, such
+ * that there is no padding between the attributes. The size of the vertex is
+ * rounded up to the largest alignment, such that all vertices of a buffer are
+ * aligned. */
+void gp_compute_vertex_layout(struct GP_ProgramAttribute *attributes, int numAttributes);
+
+#endif
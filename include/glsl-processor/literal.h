@@ -0,0 +1,34 @@
+#ifndef GP_LITERAL_H_INCLUDED
+#define GP_LITERAL_H_INCLUDED
+
+/* Number literals. The lexer finds where a literal ends (it is a
+ * preprocessing number), and the functions here convert between the text
+ * and the value. Conversions are correctly rounded, and they don't depend on
+ * the locale. */
+
+enum {
+        GP_LITERAL_INT,
+        GP_LITERAL_UINT,  // "u" suffix
+        GP_LITERAL_FLOAT,  // no suffix or "f" suffix
+        GP_LITERAL_DOUBLE,  // "lf" suffix
+        GP_NUM_LITERAL_KINDS,
+};
+
+enum {
+        GP_LITERAL_BUFFER_SIZE = 48,
+};
+
+/* Returns the GP_LITERAL_* kind of the literal, or -1 if the text is not a
+ * valid GLSL literal. Integers (decimal, octal or hex) must fit in 32 bits,
+ * the value of an int is that of the bit pattern (0xFFFFFFFF is -1).
+ * The value of a float literal is rounded to float precision, since that is
+ * the type of the literal. */
+int gp_parse_literal(const char *text, int length, double *value);
+
+/* Writes the shortest literal of the given kind that has the given value,
+ * which must be representable in that kind (and finite). The buffer must
+ * have room for GP_LITERAL_BUFFER_SIZE characters. The text is not
+ * zero-terminated, the length is returned. */
+int gp_format_literal(int literalKind, double value, char *buffer);
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef GP_MAPFILE_H_INCLUDED
+#define GP_MAPFILE_H_INCLUDED
+
+/* Read-only memory mappings of whole files, over mmap() and the Win32 API.
+ * The pages are read from the file when they are first touched, so the
+ * contents are never copied to the heap. */
+
+struct GP_MappedFile {
+        const char *data;  // NULL for an empty file
+        int size;
+};
+
+/* Fatal error if the file can't be opened or mapped */
+void gp_map_file(struct GP_MappedFile *mappedFile, const char *filepath);
+void gp_unmap_file(struct GP_MappedFile *mappedFile);
+
+#endif
@@ -15,4 +15,35 @@ void _gp_free_memory(struct GP_LogCtx logCtx, void **inoutPtr);
 #define REALLOC_MEMORY(inoutPtr, numElems) realloc_memory((void**) (inoutPtr), (numElems), sizeof **(inoutPtr))
 #define FREE_MEMORY(inoutPtr) free_memory((void**) (inoutPtr))
 
+/* A bump allocator. Memory that is allocated from an arena can't be freed
+ * individually. It is all released at once by gp_arena_teardown(). A zeroed
+ * arena is a valid empty arena. */
+
+struct GP_ArenaBlock {
+        struct GP_ArenaBlock *next;
+        size_t size;
+        size_t used;
+};
+
+struct GP_Arena {
+        struct GP_ArenaBlock *blocks;  // the first one is the current one
+        size_t numBytesAllocated;  // sum of the sizes of the blocks
+};
+
+void gp_arena_setup(struct GP_Arena *arena);
+void gp_arena_teardown(struct GP_Arena *arena);
+/* Releases all memory of the arena, like gp_arena_teardown(), but keeps the
+ * current block for reuse. */
+void gp_arena_reset(struct GP_Arena *arena);
+/* Moves all memory of src to dst, leaving src empty. Pointers into the memory
+ * stay valid. */
+void gp_arena_merge(struct GP_Arena *dst, struct GP_Arena *src);
+void *_gp_arena_alloc(struct GP_LogCtx logCtx, struct GP_Arena *arena, size_t numElems, size_t elemSize);
+/* The old contents are copied over. The new memory is allocated in place if
+ * ptr is the last allocation from the arena, and if there is room. */
+void *_gp_arena_realloc(struct GP_LogCtx logCtx, struct GP_Arena *arena, void *ptr, size_t oldNumElems, size_t newNumElems, size_t elemSize);
+
+#define ARENA_ALLOC_MEMORY(arena, outPtr, numElems) (*(outPtr) = _gp_arena_alloc(GP_MAKE_LOGCTX(), (arena), (numElems), sizeof **(outPtr)))
+#define ARENA_REALLOC_MEMORY(arena, inoutPtr, oldNumElems, newNumElems) (*(inoutPtr) = _gp_arena_realloc(GP_MAKE_LOGCTX(), (arena), *(inoutPtr), (oldNumElems), (newNumElems), sizeof **(inoutPtr)))
+
 #endif
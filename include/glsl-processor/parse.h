@@ -2,11 +2,26 @@
 #define GP_PARSE_H_INCLUDED
 
 #include <glsl-processor/ast.h>
+#include <glsl-processor/intern.h>
+#include <glsl-processor/memory.h>
+#include <glsl-processor/thread.h>
+
+/* Reads up to size bytes of a streamed file, starting at offset, into buffer.
+ * Returns the number of bytes that were read, 0 at the end of the file, or
+ * -1 on error. A file can be read more than once (for example, if it is
+ * included by multiple files), and gp_parse_parallel() may call the function
+ * from multiple threads at once. */
+typedef int GP_ReadFunc(void *userData, int offset, char *buffer, int size);
 
 struct GP_FileInfo {
         char *fileID;
+        /* contents is NULL and size is -1 if the file is streamed: it is
+         * read in blocks using readFunc while it is parsed, and the parser
+         * holds only a window of 2 blocks of it in memory. */
         char *contents;
         int size;
+        GP_ReadFunc *readFunc;
+        void *readUserData;
 };
 
 struct GP_ProgramInfo {
@@ -17,6 +32,9 @@ struct GP_ShaderInfo {
         char *shaderName;
         char *fileID;
         int shaderType;
+        /* Macros that are defined before the file is parsed: "NAME" or
+         * "NAME=VALUE", separated by whitespace. NULL if there are none. */
+        char *defines;
 };
 
 struct GP_LinkInfo {
@@ -35,26 +53,103 @@ struct GP_Desc {
         int numLinks;
 };
 
+/* The names of the program uniforms and attributes are the strings of the
+ * atoms, they are owned by the intern table of the GP_Ctx. */
 struct GP_ProgramUniform {
         int programIndex;
         int typeKind;
-        char *uniformName;
+        GP_Atom uniformAtom;
+        const char *uniformName;
 };
 
 struct GP_ProgramAttribute {
         int programIndex;
         int typeKind;
-        char *attributeName;
+        GP_Atom attributeAtom;
+        const char *attributeName;
+        /* where the attribute is in an interleaved vertex of the program, and
+         * the size of the vertex (the stride of the buffer) */
+        int offset;
+        int vertexSize;
+};
+
+/* An interface block of a program. The blocks of the same name in the
+ * shaders of a program must have the same members and layout, blockDecl is
+ * one of them. */
+struct GP_ProgramBlock {
+        int programIndex;
+        GP_Atom blockAtom;
+        const char *blockName;
+        const struct GP_BlockDecl *blockDecl;
+};
+
+/* The offsets where the lines of a file start. This is built from the file
+ * contents when it is first needed. */
+struct GP_LineIndex {
+        int *lineStarts;
+        int numLines;
+};
+
+/* The tokens of a file, lexed once from start to end, such that files that
+ * are parsed more than once (variants of a shader, or included files) are
+ * not lexed again. A kind of -1 marks text that failed to lex: the lexer is
+ * run there again when it is reached, to report the error. */
+struct GP_CachedToken {
+        int start;
+        int end;
+        short tokenKind;
+        short keywordKind;
+        short typeKind;
+        short literalKind;
+        double floatingValue;
+};
+
+struct GP_TokenCache {
+        struct GP_CachedToken *tokens;
+        int numTokens;
+};
+
+/* A file together with the macros that are predefined for it. Shaders with
+ * the same parse unit share the parse result. Different units of a file
+ * share only the token cache. Each unit is preprocessed and parsed on its own,
+ * even where the file has no conditionals, for three reasons:
+ * - A declaration outside of all conditionals can still differ between the
+ *   units, through the macros that are expanded in it (MAX_LIGHTS). Whether
+ *   it differs is only known after it was preprocessed for the unit.
+ * - The nodes of a unit refer to its own pools and to positions in its own
+ *   output. A node that is taken from another unit must be copied and
+ *   renumbered, which costs about as much as parsing the cached tokens.
+ * - The units are parsed in parallel, without an order among them. */
+struct GP_ParseUnit {
+        int fileIndex;
+        const char *defines;  // see GP_ShaderInfo
+};
+
+/* Include guard detection, as the file is parsed. A file is guarded if all
+ * its tokens and directives are in one "#ifndef X" group (without #elif or
+ * #else). Including it again while X is defined has no effect. */
+enum {
+        GP_GUARD_START,  // nothing seen yet
+        GP_GUARD_INSIDE,  // inside the #ifndef group
+        GP_GUARD_AFTER,  // after the #endif of the group
+        GP_GUARD_NONE,  // not guarded
+};
+
+enum {
+        GP_FILE_NOT_GUARDED = -1,  // or not included yet
+        GP_FILE_ONCE = -2,  // #pragma once
 };
 
-/* for parsing state */
+/* for parsing state. All positions are offsets in the file. */
 struct GP_FileStackItem {
+        int fileIndex;
         const char *fileID;
+        /* The bytes of the file from windowStart on that are in memory.
+         * Unless the file is streamed, that is the whole file. */
         const char *contents;
         int size;
+        int windowStart;
         int cursorPos;
-        int savedCharacter;
-        int haveSavedCharacter;
 
         // we need to remember the file position from which we would start the
         // next copy-input-to-output operation. Note that sometimes we skip a
@@ -63,25 +158,232 @@ struct GP_FileStackItem {
         int indexOfFirstUnconsumedToken;
         // we can temporarily suppress copying input to output.
         int outputSuspended;
+
+        /* If the file has a token cache, the tokens are taken from there.
+         * tokenCacheIndex is the index of the next token. */
+        const struct GP_TokenCache *tokenCache;
+        int tokenCacheIndex;
+
+        int guardState;  // GP_GUARD_*
+        int guardMacro;  // the X of "#ifndef X"
+        int guardConditional;  // the index of its conditional
+
+        /* The line index of the file. For a streamed file, it may only be
+         * complete up to the end of the window while the file is read. */
+        struct GP_LineIndex lineIndex;
+
+        /* only for streamed files */
+        int isStreamed;
+        int isAtEndOfFile;  // no more data than what is in the window
+        char *window;  // contents points here
+        int windowCapacity;
+        GP_ReadFunc *readFunc;
+        void *readUserData;
+        int numLineStartsAllocated;  // if lineIndex is being built, or 0
+        /* When the window is moved, the whitespace and comments after the
+         * last consumed token are copied to the output, although they might
+         * be dropped later (before a preprocessor directive, or at the end of
+         * the file). This is the output size before that copy, or -1. */
+        int tentativeOutputSize;
+};
+
+/* A token as the preprocessor sees it. Macro bodies and the arguments of
+ * macro invocations are lists of these. The text is a copy, so it stays valid
+ * when the window of a streamed file moves. */
+struct GP_PPToken {
+        int tokenKind;
+        int flags;  // GP_PPTOKEN_*
+        int keywordKind;  // like tokenKeywordKind in GP_Parser
+        int typeKind;
+        int paramIndex;  // in macro bodies, the parameter that is referenced, or -1
+        int literalKind;  // like tokenLiteralKind in GP_Parser
+        double floatingValue;
+        struct GP_Span span;  // where the token is from, like tokenSpan in GP_Parser
+        const char *text;  // zero-terminated
+        int textLength;
+};
+
+enum {
+        GP_PPTOKEN_LEADING_SPACE = 1 << 0,  // whitespace before the token
+        GP_PPTOKEN_NO_EXPAND = 1 << 1,  // names a macro that was being expanded
+        GP_PPTOKEN_PASTE = 1 << 2,  // in macro bodies, followed by "##"
+        GP_PPTOKEN_PASTED = 1 << 3,  // made by "##". The text is in the scratchArena.
+};
+
+enum {
+        GP_BUILTIN_MACRO_NONE,
+        GP_BUILTIN_MACRO_LINE,
+        GP_BUILTIN_MACRO_FILE,
+        GP_BUILTIN_MACRO_VERSION,
+};
+
+/* The name of a macro is its index in the macroNames table of the parser.
+ * #undef only clears isDefined. */
+struct GP_Macro {
+        const char *name;
+        int isDefined;
+        int builtinKind;  // GP_BUILTIN_MACRO_*
+        int isFunctionLike;
+        int numParams;
+        const char **paramNames;
+        struct GP_PPToken *body;
+        int numBodyTokens;
+        int hasPaste;  // the body contains "##"
+        /* While the macro is expanded, the index of its frame, and -1
+         * otherwise. Names of the macro are not expanded during that time. */
+        int expandingFrame;
+        /* The cached result of expanding an object-like macro completely.
+         * It is valid if expansionGeneration is the macroGeneration of the
+         * parser, i.e. if no macro was defined or undefined since. */
+        struct GP_PPToken *expansion;
+        int numExpansionTokens;
+        int expansionGeneration;
+};
+
+/* The tokens of a macro that is being expanded. The tokens are either in a
+ * list that doesn't move (a macro body or a cached expansion) or on the
+ * ppTokenStack, from stackIndex on. */
+struct GP_MacroFrame {
+        const struct GP_PPToken *tokens;
+        int stackIndex;
+        int numTokens;
+        int pos;
+        int macro;  // the macro that is disabled while the frame is read, or -1
+        int isFinal;  // the tokens need no further expansion
+        int hasLeadingSpace;  // replaces the flag of the first token
+};
+
+/* An #if, #ifdef or #ifndef whose group is currently being parsed */
+struct GP_Conditional {
+        int fileStackSize;  // of the file that contains the directive
+        int haveElse;
+        struct GP_SourceLoc loc;
+};
+
+/* Identifiers are interned into one of several tables, chosen by the hash of
+ * the identifier, so that parallel parsers rarely wait for each other. An
+ * atom encodes the index of its table in the low bits. */
+enum {
+        GP_INTERN_SHARD_BITS = 6,
+        GP_NUM_INTERN_SHARDS = 1 << GP_INTERN_SHARD_BITS,
+};
+
+/* How much of the shader files gp_parse() looks at. In reflection mode, the
+ * bodies of function definitions are skipped by matching braces, which is
+ * enough for generating the interfaces (uniforms, attributes, function
+ * signatures). The preprocessed output is the same in both modes. Syntax
+ * errors inside function bodies are not detected in reflection mode. */
+enum {
+        GP_PARSE_MODE_FULL,
+        GP_PARSE_MODE_REFLECTION,
+};
+
+enum {
+        GP_DEFAULT_STREAM_BLOCK_SIZE = 64 * 1024,
+};
+
+/* How the preprocessed output of the files is stored. With
+ * GP_OUTPUT_MODE_SPANS, the text is not copied, the output is a list of spans
+ * of the input files instead (adjacent ranges are merged into one span). The
+ * spans can be passed to writev() (using gp_output_span_data(), unless the
+ * file is streamed), or gp_alloc_output_string() makes a copy of the text.
+ * GP_OUTPUT_MODE_MINIFIED is like GP_OUTPUT_MODE_BUFFER, but the output is
+ * minified after parsing: comments and the whitespace that is not needed are
+ * removed, and the parameters and local variables of the functions get short
+ * names. Everything that is reflected by name keeps its name. The line breaks
+ * are kept, in all modes the lines of the output are on the line numbers of
+ * the lines of the file that they are from (included files aside). */
+enum {
+        GP_OUTPUT_MODE_BUFFER,
+        GP_OUTPUT_MODE_SPANS,
+        GP_OUTPUT_MODE_MINIFIED,
 };
 
 struct GP_Ctx {
         // copy of input data
         struct GP_Desc desc;
 
-        // allocated and written in parsing stage
-        struct GP_ShaderfileAst *shaderfileAsts;
-        int currentShaderIndex;  // global state for simpler code
+        // GP_PARSE_MODE_*. Can be set before parsing. The default is
+        // GP_PARSE_MODE_FULL.
+        int parseMode;
+        // The size of the blocks in which streamed files are read. 0 means
+        // GP_DEFAULT_STREAM_BLOCK_SIZE. In streamed files, a token can't be
+        // longer than a block, and neither can a preprocessor directive (the
+        // whole line, with continued lines and comments). A longer #define is
+        // a "Line too long" parse error.
+        int streamBlockSize;
+        // GP_OUTPUT_MODE_*. Can be set before parsing. The default is
+        // GP_OUTPUT_MODE_BUFFER.
+        int outputMode;
+        // Can be set before parsing. If set, the functions that can't be
+        // reached from main() are removed from the output, see callgraph.h.
+        // The lines below a removed function move up by its lines.
+        int removeDeadFunctions;
+        // Can be set before parsing. If set, operations on literals in
+        // expressions are folded, in the AST and in the output.
+        int foldConstants;
+
+        // allocated and written in parsing stage. The AST nodes are
+        // allocated from the arena.
+        struct GP_Arena arena;
+        /* Each parse unit (a file with predefined macros) that is used by a
+         * shader is parsed only once, with its #includes expanded. The
+         * entries in shaderfileAsts are shallow copies of the entries in
+         * unitAsts: shaders with the same parse unit share the toplevel
+         * nodes and the output. */
+        struct GP_ParseUnit *parseUnits;
+        int numParseUnits;
+        struct GP_ShaderfileAst *unitAsts;  // indexed by unit
+        struct GP_ShaderfileAst *shaderfileAsts;  // indexed by shaderIndex
+
+        /* indexed by fileIndex. A file gets a token cache when it is
+         * parsed for the second time (streamed files never do). */
+        struct GP_TokenCache *tokenCaches;
+        int *fileParseCounts;
+
+        // all identifiers that were parsed are interned here
+        struct GP_InternTable internShards[GP_NUM_INTERN_SHARDS];
+
+        // indexed by fileIndex. Allocated when it is first needed.
+        struct GP_LineIndex *lineIndices;
+
+        // hash index over the fileIDs: the atom of each fileID is the
+        // fileIndex. Built by gp_index_files().
+        struct GP_InternTable fileIDTable;
 
         /* This stuff here is completely computed from the parsed data. */
         struct GP_ProgramUniform *programUniforms;
         struct GP_ProgramAttribute *programAttributes;
+        struct GP_ProgramBlock *programBlocks;
         int numProgramUniforms;
         int numProgramAttributes;
+        int numProgramBlocks;
+
+        /* Only set while gp_parse_parallel() runs. They protect the
+         * internShards, and the lineIndices and tokenCaches. */
+        struct GP_Mutex *internShardMutexes;
+        struct GP_Mutex *lineIndexMutex;
+};
+
+/* The text of a literal expression in the output. The literal can be the
+ * result of folding, or be in parentheses. The first and last character tell
+ * whether other text can take its place without being lexed together with
+ * the text around it. */
+struct GP_LiteralOutput {
+        int start;  // -1 if the text is not in the output as it is
+        int end;
+        char firstChar;
+        char lastChar;
+};
+
+/* The state of one parser. Each worker thread has its own. */
+struct GP_Parser {
+        struct GP_Ctx *ctx;
 
-        /*
-         * PARSING STATE
-         */
+        // The AST nodes are allocated from here. When parsing is finished,
+        // the memory is moved to the arena of the ctx.
+        struct GP_Arena arena;
+        struct GP_ShaderfileAst *currentAst;  // global state for simpler code
 
         /* the file stack is used for processing #include directives -
          * in general the parser reads from multiple files. */
@@ -90,19 +392,140 @@ struct GP_Ctx {
         /* the current fileInfo is duplicated here, to simplify the code. */
         struct GP_FileStackItem file;
 
-        /* this is backing storage for dynamically allocated token data. It is
-         * valid only for the last token that was lexed using this context. */
+        /* Data of the last token that was lexed using this parser. The text
+         * of NAME and STRING tokens is not copied, tokenSpan refers directly
+         * to the contents of the file that holds the token. */
         int haveSavedToken;
         int tokenKind; // this will always be valid, even if !haveSavedToken
+        /* for LITERAL tokens: the GP_LITERAL_* kind (-1 if the text is not a
+         * valid literal) and the value */
+        int tokenLiteralKind;
         double tokenFloatingValue;
-        char *tokenBuffer;
-        int tokenBufferLength;
-        int tokenBufferCapacity;
+        struct GP_Span tokenSpan;
+        /* for NAME tokens: GP_KEYWORD_* and GP_TYPE_* kinds or -1 */
+        int tokenKeywordKind;
+        int tokenTypeKind;
+        int tokenStart;  // file position of the first character of the token
+        int tokenEnd;  // file position directly after the token
+
+        /* location of the toplevel item that is currently parsed */
+        struct GP_SourceLoc currentToplevelLoc;
+        /* The layout of the interface blocks that have no layout qualifiers,
+         * as set with "layout(std140) uniform;" for example. Indexed by
+         * GP_BLOCK_*. */
+        int defaultBlockLayoutKinds[GP_NUM_BLOCK_KINDS];
+        int defaultBlockIsRowMajor[GP_NUM_BLOCK_KINDS];
+
+        /* The text of the current token. For STRING tokens, it does not
+         * include the quotes. */
+        const char *tokenText;
+        int tokenHasLeadingSpace;
+        /* The current token is a pending token, not from the file */
+        int tokenIsPending;
+
+        /* Preprocessor state. It is reset for each file that is parsed. The
+         * macro definitions, including their bodies and cached expansions,
+         * are allocated from ppArena. */
+        struct GP_Arena ppArena;
+        struct GP_InternTable macroNames;
+        struct GP_Macro *macros;
+        int numMacros;
+        int numMacrosAllocated;
+        int numUserMacros;  // number of #defines so far
+        int macroGeneration;  // incremented by each #define and #undef
+        unsigned char macroFirstChars[256 / 8];  // bit set of the first characters of the macro names
+        int versionNumber;  // from the #version directive, for __VERSION__
+        struct GP_Conditional *conditionals;
+        int numConditionals;
+        int numConditionalsAllocated;
+        /* indexed by fileIndex: for files that were included (or parsed)
+         * already, the macro that guards them, or GP_FILE_ONCE, or
+         * GP_FILE_NOT_GUARDED. */
+        int *fileGuards;
+        /* While lexing a directive, lexEnd is the file position of the end
+         * of its line and the lexer returns EOF there. If lexNoPop is set,
+         * the lexer returns EOF at the end of the current file instead of
+         * continuing with the including file. */
+        int lexEnd;
+        int lexNoPop;
+
+        /* Scratch space for expanding macros (and for evaluating #if
+         * expressions). It is cleared when the next expansion starts. The
+         * ppTokenStack holds the tokens of the frames that are not in a
+         * macro, i.e. arguments and substituted bodies. Fully expanded tokens
+         * are appended to expandedTokens. The text of the tokens that are
+         * read from the file while expanding is in scratchArena. */
+        struct GP_PPToken *ppTokenStack;
+        int ppTokenStackSize;
+        int ppTokenStackAllocated;
+        struct GP_MacroFrame *macroFrames;
+        int numMacroFrames;
+        int numMacroFramesAllocated;
+        int *macroArgStarts;
+        int macroArgStartsSize;
+        int macroArgStartsAllocated;
+        struct GP_PPToken *expandedTokens;
+        int numExpandedTokens;
+        int numExpandedTokensAllocated;
+        struct GP_Arena scratchArena;
+        int expansionDepth;
+        /* The frames below isolationFrameBase are not visible to the current
+         * expansion. If the result depends on them anyway (or on a built-in
+         * macro), expansionIsContextDependent is set and it is not cached. */
+        int isolationFrameBase;
+        int expansionIsContextDependent;
+        /* The result of the last macro invocation in the file. These tokens
+         * are returned by the lexer before it continues with the file. They
+         * are expandedTokens[pendingTokenIndex] to
+         * expandedTokens[pendingTokenEnd - 1]. Their position in the file is
+         * pendingTokenPos. The output of the invocation, including the
+         * whitespace before it, starts at pendingOutputStart. */
+        int pendingTokenIndex;
+        int pendingTokenEnd;
+        int pendingTokenPos;
+        int pendingOutputStart;
+
+        /* The children of the node lists that are currently being parsed.
+         * Lists can be nested, so they are collected here and then copied to
+         * the nodeLists of the current AST in one piece. */
+        int *nodeStack;
+        int nodeStackSize;
+        int nodeStackAllocated;
+        int expressionDepth;  // nesting of parse_expression()
+
+        /* If constants are folded: where the text of each literal expression
+         * is in the output, indexed like literalValues of the current AST. */
+        struct GP_LiteralOutput *literalOutputs;
+        int literalOutputsAllocated;
 };
 
 void gp_setup(struct GP_Ctx *ctx);
 void gp_teardown(struct GP_Ctx *ctx);
 void gp_parse(struct GP_Ctx *ctx);
+/* Like gp_parse(), but the files are parsed by numThreads threads (by as many
+ * threads as there are CPUs if numThreads <= 0). */
+void gp_parse_parallel(struct GP_Ctx *ctx, int numThreads);
+/* Builds the index that is used to look up files by their fileID.
+ * gp_builder_to_ctx() calls this, and gp_parse() calls it if needed. */
+void gp_index_files(struct GP_Ctx *ctx);
+
+/* gp_span_data() and gp_span_equals() can't be used with spans in streamed
+ * files. gp_alloc_span_string() reads the text of those. */
+const char *gp_span_data(struct GP_Ctx *ctx, struct GP_Span span);
+int gp_span_equals(struct GP_Ctx *ctx, struct GP_Span span, const char *string);
+char *gp_alloc_span_string(struct GP_Ctx *ctx, struct GP_Span span);
+/* Returns the preprocessed output as a zero-terminated string, in either
+ * output mode. The string must be freed with FREE_MEMORY(). */
+char *gp_alloc_output_string(struct GP_Ctx *ctx, const struct GP_ShaderfileAst *fa);
+/* The text of one of the outputSpans of fa */
+const char *gp_output_span_data(struct GP_Ctx *ctx, const struct GP_ShaderfileAst *fa, struct GP_Span span);
+
+/* Maps a byte offset in a file to a line and column number */
+struct GP_SourceLoc gp_compute_source_loc(struct GP_Ctx *ctx, int fileIndex, int offset);
+
+GP_Atom gp_intern_span(struct GP_Ctx *ctx, struct GP_Span span);
+const char *gp_atom_string(struct GP_Ctx *ctx, GP_Atom atom);
+int gp_atom_length(struct GP_Ctx *ctx, GP_Atom atom);
 
 
 #endif
@@ -0,0 +1,70 @@
+#ifndef GP_SCAN_H_INCLUDED
+#define GP_SCAN_H_INCLUDED
+
+/* Fast scanning primitives for the lexer. There are SSE2 and AVX2
+ * implementations and a portable scalar fallback. The best implementation
+ * that the CPU supports is chosen at runtime. */
+
+enum {
+        GP_SCAN_IMPL_SCALAR,
+        GP_SCAN_IMPL_SSE2,
+        GP_SCAN_IMPL_AVX2,
+        GP_NUM_SCAN_IMPL_KINDS
+};
+
+struct GP_ScanImpl {
+        /* first character in [p, end) that is not whitespace (any character
+         * <= 32). Returns end if there is none. */
+        const char *(*skip_whitespace)(const char *p, const char *end);
+        /* first '\n' in [p, end). Returns end if there is none. */
+        const char *(*find_newline)(const char *p, const char *end);
+        /* first "*" that is directly followed by "/" in [p, end). Returns
+         * NULL if there is none. */
+        const char *(*find_comment_end)(const char *p, const char *end);
+        /* number of '\n' characters in [p, end) */
+        int (*count_newlines)(const char *p, const char *end);
+        /* first character in [p, end) that is one of { } / " #. These are
+         * the characters that matter when skipping a block of code. Returns
+         * end if there is none. */
+        const char *(*find_block_char)(const char *p, const char *end);
+};
+
+extern const char *const gp_scanImplKindString[GP_NUM_SCAN_IMPL_KINDS];
+
+/* The implementation that is currently used. Until gp_scan_init() selects
+ * the best supported one (gp_parse() does that), it is the scalar one. */
+extern struct GP_ScanImpl gp_scanImpl;
+
+void gp_scan_init(void);
+int gp_scan_impl_supported(int implKind);
+/* for testing and benchmarking. The implementation must be supported, and
+ * no other thread may be scanning at the time. */
+void gp_scan_select_impl(int implKind);
+int gp_scan_get_impl(void);
+
+static inline const char *gp_scan_skip_whitespace(const char *p, const char *end)
+{
+        return gp_scanImpl.skip_whitespace(p, end);
+}
+
+static inline const char *gp_scan_find_newline(const char *p, const char *end)
+{
+        return gp_scanImpl.find_newline(p, end);
+}
+
+static inline const char *gp_scan_find_comment_end(const char *p, const char *end)
+{
+        return gp_scanImpl.find_comment_end(p, end);
+}
+
+static inline int gp_scan_count_newlines(const char *p, const char *end)
+{
+        return gp_scanImpl.count_newlines(p, end);
+}
+
+static inline const char *gp_scan_find_block_char(const char *p, const char *end)
+{
+        return gp_scanImpl.find_block_char(p, end);
+}
+
+#endif
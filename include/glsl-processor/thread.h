@@ -0,0 +1,59 @@
+#ifndef GP_THREAD_H_INCLUDED
+#define GP_THREAD_H_INCLUDED
+
+/* A minimal threading layer over pthreads and the Win32 API, for parsing in
+ * parallel. */
+
+#if defined(_WIN32)
+struct GP_Mutex {
+        void *srwlock;  // an SRWLOCK. It is a single pointer, zero is unlocked.
+};
+
+struct GP_Thread {
+        void *handle;
+        void (*func)(void *arg);
+        void *arg;
+};
+
+struct GP_Once {
+        void *initOnce;  // an INIT_ONCE, which is a single pointer, too
+};
+
+#define GP_ONCE_INIT { 0 }
+#else
+#include <pthread.h>
+
+struct GP_Mutex {
+        pthread_mutex_t mutex;
+};
+
+struct GP_Thread {
+        pthread_t thread;
+        void (*func)(void *arg);
+        void *arg;
+};
+
+struct GP_Once {
+        pthread_once_t once;
+};
+
+#define GP_ONCE_INIT { PTHREAD_ONCE_INIT }
+#endif
+
+void gp_mutex_setup(struct GP_Mutex *mutex);
+void gp_mutex_teardown(struct GP_Mutex *mutex);
+void gp_mutex_lock(struct GP_Mutex *mutex);
+void gp_mutex_unlock(struct GP_Mutex *mutex);
+
+/* The thread struct must stay in place until gp_thread_join() returns. */
+void gp_thread_start(struct GP_Thread *thread, void (*func)(void *arg), void *arg);
+void gp_thread_join(struct GP_Thread *thread);
+
+/* Calls the function, unless it was called with the once struct before. When
+ * this returns, the call has completed, also if it was made by another
+ * thread. The once struct must be initialized with GP_ONCE_INIT. */
+void gp_call_once(struct GP_Once *once, void (*func)(void));
+
+int gp_get_number_of_cpus(void);
+
+#endif
@@ -1,13 +1,26 @@
 #include <glsl-processor/memory.h>
 #include <glsl-processor/builder.h>
+#include <glsl-processor/mapfile.h>
 #include <glsl-processor/parse.h>
 #include <string.h>
 #include <stdlib.h>
 
+/* Who releases the contents of a file */
+enum {
+        GP_BUILDER_FILE_OWNED,  // a copy that the builder made
+        GP_BUILDER_FILE_BORROWED,  // the caller
+        GP_BUILDER_FILE_MAPPED,  // unmapped by the builder
+        GP_BUILDER_FILE_STREAMED,  // there are no contents
+};
+
 struct GP_Builder_File {
         char *fileID;
         char *contents;
         int size;
+        int ownershipKind;
+        struct GP_MappedFile mappedFile;  // if GP_BUILDER_FILE_MAPPED
+        GP_ReadFunc *readFunc;
+        void *readUserData;
 };
 
 struct GP_Builder_Program {
@@ -18,6 +31,7 @@ struct GP_Builder_Shader {
         char *shaderID;
         char *fileID;
         int shadertypeKind;
+        char *defines;  // NULL if there are none
 };
 
 struct GP_Builder_Link {
@@ -94,13 +108,97 @@ static int gp_builder_find_link(struct GP_Builder *builder, const char *programI
         return -1;
 }
 
-void gp_builder_create_file(struct GP_Builder *builder, const char *fileID, const char *data, int size)
+/* These are only valid after the arrays were sorted by gp_builder_process() */
+
+static int compare_fileID_to_file(const void *key, const void *elem)
+{
+        const struct GP_Builder_File *file = elem;
+        return strcmp(key, file->fileID);
+}
+
+static int compare_programID_to_program(const void *key, const void *elem)
+{
+        const struct GP_Builder_Program *program = elem;
+        return strcmp(key, program->programID);
+}
+
+static int compare_shaderID_to_shader(const void *key, const void *elem)
+{
+        const struct GP_Builder_Shader *shader = elem;
+        return strcmp(key, shader->shaderID);
+}
+
+static int gp_builder_search_file(struct GP_Builder *builder, const char *fileID)
+{
+        struct GP_Builder_File *file = bsearch(fileID, builder->files, builder->numFiles,
+                                              sizeof *builder->files, compare_fileID_to_file);
+        return file ? (int) (file - builder->files) : -1;
+}
+
+static int gp_builder_search_program(struct GP_Builder *builder, const char *programID)
+{
+        struct GP_Builder_Program *program = bsearch(programID, builder->programs, builder->numPrograms,
+                                                    sizeof *builder->programs, compare_programID_to_program);
+        return program ? (int) (program - builder->programs) : -1;
+}
+
+static int gp_builder_search_shader(struct GP_Builder *builder, const char *shaderID)
+{
+        struct GP_Builder_Shader *shader = bsearch(shaderID, builder->shaders, builder->numShaders,
+                                                  sizeof *builder->shaders, compare_shaderID_to_shader);
+        return shader ? (int) (shader - builder->shaders) : -1;
+}
+
+static struct GP_Builder_File *gp_builder_add_file(struct GP_Builder *builder, const char *fileID, int ownershipKind)
 {
         int idx = builder->numFiles++;
         REALLOC_MEMORY(&builder->files, builder->numFiles);
-        builder->files[idx].fileID = gp_builder_create_string(fileID);
-        builder->files[idx].contents = gp_builder_create_buffer(data, size);
-        builder->files[idx].size = size;
+        struct GP_Builder_File *file = &builder->files[idx];
+        memset(file, 0, sizeof *file);
+        file->fileID = gp_builder_create_string(fileID);
+        file->ownershipKind = ownershipKind;
+        return file;
+}
+
+static void gp_builder_release_file(struct GP_Builder_File *file)
+{
+        gp_builder_destroy_string(file->fileID);
+        if (file->ownershipKind == GP_BUILDER_FILE_OWNED)
+                gp_builder_destroy_buffer(file->contents);
+        else if (file->ownershipKind == GP_BUILDER_FILE_MAPPED)
+                gp_unmap_file(&file->mappedFile);
+}
+
+void gp_builder_create_file(struct GP_Builder *builder, const char *fileID, const char *data, int size)
+{
+        struct GP_Builder_File *file = gp_builder_add_file(builder, fileID, GP_BUILDER_FILE_OWNED);
+        file->contents = gp_builder_create_buffer(data, size);
+        file->size = size;
+}
+
+void gp_builder_create_file_borrowed(struct GP_Builder *builder, const char *fileID, const char *data, int size)
+{
+        struct GP_Builder_File *file = gp_builder_add_file(builder, fileID, GP_BUILDER_FILE_BORROWED);
+        // a NULL contents pointer would mean a streamed file to the parser
+        file->contents = data ? (char *) data : "";
+        file->size = size;
+}
+
+void gp_builder_map_file(struct GP_Builder *builder, const char *fileID, const char *filepath)
+{
+        struct GP_Builder_File *file = gp_builder_add_file(builder, fileID, GP_BUILDER_FILE_MAPPED);
+        gp_map_file(&file->mappedFile, filepath);
+        file->contents = file->mappedFile.data ? (char *) file->mappedFile.data : "";
+        file->size = file->mappedFile.size;
+}
+
+void gp_builder_create_file_streamed(struct GP_Builder *builder, const char *fileID,
+                                     GP_ReadFunc *readFunc, void *readUserData)
+{
+        struct GP_Builder_File *file = gp_builder_add_file(builder, fileID, GP_BUILDER_FILE_STREAMED);
+        file->size = -1;
+        file->readFunc = readFunc;
+        file->readUserData = readUserData;
 }
 
 void gp_builder_create_program(struct GP_Builder *builder, const char *programID)
@@ -111,12 +209,18 @@ void gp_builder_create_program(struct GP_Builder *builder, const char *programID
 }
 
 void gp_builder_create_shader(struct GP_Builder *builder, const char *shaderID, const char *fileID, int shadertypeKind)
+{
+        gp_builder_create_shader_variant(builder, shaderID, fileID, shadertypeKind, NULL);
+}
+
+void gp_builder_create_shader_variant(struct GP_Builder *builder, const char *shaderID, const char *fileID, int shadertypeKind, const char *defines)
 {
         int idx = builder->numShaders++;
         REALLOC_MEMORY(&builder->shaders, builder->numShaders);
         builder->shaders[idx].shaderID = gp_builder_create_string(shaderID);
         builder->shaders[idx].fileID = gp_builder_create_string(fileID);
         builder->shaders[idx].shadertypeKind = shadertypeKind;
+        builder->shaders[idx].defines = defines ? gp_builder_create_string(defines) : NULL;
 }
 
 void gp_builder_create_link(struct GP_Builder *builder, const char *programID, const char *shaderID)
@@ -131,8 +235,7 @@ void gp_builder_destroy_file(struct GP_Builder *builder, const char *fileID)
 {
         int idx = gp_builder_find_file(builder, fileID);
         if (idx != -1) {
-                gp_builder_destroy_string(builder->files[idx].fileID);
-                gp_builder_destroy_buffer(builder->files[idx].contents);
+                gp_builder_release_file(&builder->files[idx]);
                 GP_DELETE_FROM_ARRAY(&builder->files, &builder->numFiles, idx);
         }
 }
@@ -152,6 +255,8 @@ void gp_builder_destroy_shader(struct GP_Builder *builder, const char *shaderID)
         if (idx != -1) {
                 gp_builder_destroy_string(builder->shaders[idx].shaderID);
                 gp_builder_destroy_string(builder->shaders[idx].fileID);
+                if (builder->shaders[idx].defines)
+                        gp_builder_destroy_string(builder->shaders[idx].defines);
                 GP_DELETE_FROM_ARRAY(&builder->shaders, &builder->numShaders, idx);
         }
 }
@@ -215,18 +320,18 @@ void gp_builder_process(struct GP_Builder *builder)
                     && !strcmp(builder->links[i].shaderID, builder->links[i-1].shaderID))
                         gp_fatal_f("Multiple links '%s -> %s' given",
                                 builder->links[i].programID, builder->links[i].shaderID);
-        for (int i = 1; i < builder->numShaders; i++)
-                if (gp_builder_find_file(builder, builder->shaders[i].fileID) == -1)
+        for (int i = 0; i < builder->numShaders; i++)
+                if (gp_builder_search_file(builder, builder->shaders[i].fileID) == -1)
                         gp_fatal_f("Shader '%s' needs file '%s' but it doesn't exist",
                                    builder->shaders[i].shaderID,
                                    builder->shaders[i].fileID);
         for (int i = 0; i < builder->numLinks; i++) {
-                if (gp_builder_find_program(builder, builder->links[i].programID) == -1)
+                if (gp_builder_search_program(builder, builder->links[i].programID) == -1)
                         gp_fatal_f("In Link '%s -> %s': No such program '%s'",
                                 builder->links[i].programID,
                                 builder->links[i].shaderID,
                                 builder->links[i].programID);
-                if (gp_builder_find_shader(builder, builder->links[i].shaderID) == -1)
+                if (gp_builder_search_shader(builder, builder->links[i].shaderID) == -1)
                         gp_fatal_f("In Link '%s -> %s': No such shader '%s'",
                                 builder->links[i].programID,
                                 builder->links[i].shaderID,
@@ -252,6 +357,8 @@ void gp_builder_to_ctx(struct GP_Builder *sp, struct GP_Ctx *ctx)
                 desc->fileInfo[i].fileID = sp->files[i].fileID;
                 desc->fileInfo[i].contents = sp->files[i].contents;
                 desc->fileInfo[i].size = sp->files[i].size;
+                desc->fileInfo[i].readFunc = sp->files[i].readFunc;
+                desc->fileInfo[i].readUserData = sp->files[i].readUserData;
         }
         for (int i = 0; i < sp->numPrograms; i++)
                 desc->programInfo[i].programName = sp->programs[i].programID;
@@ -259,15 +366,17 @@ void gp_builder_to_ctx(struct GP_Builder *sp, struct GP_Ctx *ctx)
                 desc->shaderInfo[i].shaderName = sp->shaders[i].shaderID;
                 desc->shaderInfo[i].fileID = sp->shaders[i].fileID;
                 desc->shaderInfo[i].shaderType = sp->shaders[i].shadertypeKind;
+                desc->shaderInfo[i].defines = sp->shaders[i].defines;
         }
         for (int i = 0; i < sp->numLinks; i++) {
-                int programIndex = gp_builder_find_program(sp, sp->links[i].programID);
-                int shaderIndex = gp_builder_find_shader(sp, sp->links[i].shaderID);
+                int programIndex = gp_builder_search_program(sp, sp->links[i].programID);
+                int shaderIndex = gp_builder_search_shader(sp, sp->links[i].shaderID);
                 GP_ENSURE(programIndex != -1);  //should have been caught earlier
                 GP_ENSURE(shaderIndex != -1);  //should have been caught earlier
                 desc->linkInfo[i].programIndex = programIndex;
                 desc->linkInfo[i].shaderIndex = shaderIndex;
         }
+        gp_index_files(ctx);
 }
 
 void gp_builder_setup(struct GP_Builder *builder)
@@ -278,14 +387,16 @@ void gp_builder_setup(struct GP_Builder *builder)
 void gp_builder_teardown(struct GP_Builder *builder)
 {
         for (int i = 0; i < builder->numFiles; i++) {
-                gp_builder_destroy_string(builder->files[i].fileID);
-                gp_builder_destroy_buffer(builder->files[i].contents);
+                gp_builder_release_file(&builder->files[i]);
         }
         for (int i = 0; i < builder->numPrograms; i++) {
                 gp_builder_destroy_string(builder->programs[i].programID);
         }
         for (int i = 0; i < builder->numShaders; i++) {
                 gp_builder_destroy_string(builder->shaders[i].shaderID);
+                gp_builder_destroy_string(builder->shaders[i].fileID);
+                if (builder->shaders[i].defines)
+                        gp_builder_destroy_string(builder->shaders[i].defines);
         }
         for (int i = 0; i < builder->numLinks; i++) {
                 gp_builder_destroy_string(builder->links[i].programID);
@@ -0,0 +1,337 @@
+#include <glsl-processor/defs.h>
+#include <glsl-processor/logging.h>
+#include <glsl-processor/memory.h>
+#include <glsl-processor/callgraph.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The definitions and declarations of the functions, sorted by name. The
+ * functions are identified by the first of their nodes in this order. */
+struct GP_FunctionNode {
+        GP_Atom name;
+        int nodeIndex;  // in the toplevelNodes
+};
+
+struct GP_CallGraph {
+        const struct GP_ShaderfileAst *fa;
+        struct GP_FunctionNode *functionNodes;
+        int numFunctionNodes;
+        unsigned char *isReachable;  // indexed like functionNodes
+        int *worklist;  // functions that are reachable, but not visited yet
+        int numWork;
+        /* The statements and expressions of the function body that is
+         * visited. Statements are stored as 2 * stmt, expressions as
+         * 2 * expr + 1. */
+        int *nodeStack;
+        int nodeStackSize;
+        int nodeStackAllocated;
+};
+
+struct GP_OutputRange {
+        int start;
+        int end;
+};
+
+static int compare_function_nodes(const void *a, const void *b)
+{
+        const struct GP_FunctionNode *x = a;
+        const struct GP_FunctionNode *y = b;
+        if (x->name != y->name)
+                return (x->name > y->name) - (x->name < y->name);
+        return (x->nodeIndex > y->nodeIndex) - (x->nodeIndex < y->nodeIndex);
+}
+
+/* Returns the function with the given name, or -1 if there is none (the
+ * name of a built-in function, or a constructor) */
+static int find_function(struct GP_CallGraph *graph, GP_Atom name)
+{
+        int lo = 0;
+        int hi = graph->numFunctionNodes;
+        while (lo < hi) {
+                int mid = lo + (hi - lo) / 2;
+                if (graph->functionNodes[mid].name < name)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+        if (lo == graph->numFunctionNodes || graph->functionNodes[lo].name != name)
+                return -1;
+        return lo;
+}
+
+static void reach_function(struct GP_CallGraph *graph, GP_Atom name)
+{
+        int function = find_function(graph, name);
+        if (function != -1 && !graph->isReachable[function]) {
+                graph->isReachable[function] = 1;
+                graph->worklist[graph->numWork++] = function;
+        }
+}
+
+static void push_node(struct GP_CallGraph *graph, int ref)
+{
+        if (graph->nodeStackSize == graph->nodeStackAllocated) {
+                graph->nodeStackAllocated = graph->nodeStackAllocated ? 2 * graph->nodeStackAllocated : 64;
+                REALLOC_MEMORY(&graph->nodeStack, graph->nodeStackAllocated);
+        }
+        graph->nodeStack[graph->nodeStackSize++] = ref;
+}
+
+static void push_stmt(struct GP_CallGraph *graph, GP_Stmt stmt)
+{
+        push_node(graph, 2 * stmt);
+}
+
+static void push_expr(struct GP_CallGraph *graph, GP_Expr expr)
+{
+        push_node(graph, 2 * expr + 1);
+}
+
+static void push_node_list(struct GP_CallGraph *graph, int nodeList, int isExpr)
+{
+        int length = gp_node_list_length(graph->fa, nodeList);
+        const int *nodes = gp_node_list_nodes(graph->fa, nodeList);
+        for (int i = 0; i < length; i++)
+                push_node(graph, 2 * nodes[i] + isExpr);
+}
+
+/* Marks the functions that are called in the body as reachable. The body is
+ * walked with an explicit stack since expressions can be nested deeply. */
+static void visit_function_body(struct GP_CallGraph *graph, GP_Stmt bodyStmt)
+{
+        const struct GP_NodePool *exprPool = &graph->fa->exprPool;
+        const struct GP_NodePool *stmtPool = &graph->fa->stmtPool;
+        graph->nodeStackSize = 0;
+        push_stmt(graph, bodyStmt);
+        while (graph->nodeStackSize > 0) {
+                int ref = graph->nodeStack[--graph->nodeStackSize];
+                int node = ref >> 1;
+                if (ref & 1) {
+                        int operand0 = exprPool->operand0[node];
+                        int operand1 = exprPool->operand1[node];
+                        switch (exprPool->kinds[node]) {
+                        case GP_EXPR_LITERAL:
+                        case GP_EXPR_NAME:
+                                break;
+                        case GP_EXPR_UNOP:
+                                push_expr(graph, operand1);
+                                break;
+                        case GP_EXPR_BINOP:
+                                push_expr(graph, operand1);
+                                push_expr(graph, exprPool->operand2[node]);
+                                break;
+                        case GP_EXPR_CALL:
+                                if (exprPool->kinds[operand0] == GP_EXPR_NAME)
+                                        reach_function(graph, exprPool->operand0[operand0]);
+                                else
+                                        push_expr(graph, operand0);
+                                push_node_list(graph, operand1, 1);
+                                break;
+                        case GP_EXPR_MEMBER:
+                                push_expr(graph, operand0);
+                                break;
+                        default:
+                                gp_fatal_f("Unhandled expression kind %d", exprPool->kinds[node]);
+                        }
+                }
+                else {
+                        int operand0 = stmtPool->operand0[node];
+                        int operand1 = stmtPool->operand1[node];
+                        int operand2 = stmtPool->operand2[node];
+                        switch (stmtPool->kinds[node]) {
+                        case GP_STMT_COMPOUND:
+                                push_node_list(graph, operand0, 0);
+                                break;
+                        case GP_STMT_VARIABLE:
+                                if (operand2 != -1)
+                                        push_expr(graph, operand2);
+                                break;
+                        case GP_STMT_IF:
+                                push_expr(graph, operand0);
+                                push_stmt(graph, operand1);
+                                if (operand2 != -1)
+                                        push_stmt(graph, operand2);
+                                break;
+                        case GP_STMT_RETURN:
+                                if (operand0 != -1)
+                                        push_expr(graph, operand0);
+                                break;
+                        case GP_STMT_DISCARD:
+                                break;
+                        case GP_STMT_EXPR:
+                                push_expr(graph, operand0);
+                                break;
+                        default:
+                                gp_fatal_f("Unhandled statement kind %d", stmtPool->kinds[node]);
+                        }
+                }
+        }
+}
+
+static void remove_output_ranges_from_buffer(struct GP_ShaderfileAst *fa,
+                                             const struct GP_OutputRange *ranges, int numRanges)
+{
+        int size = ranges[0].start;
+        for (int i = 0; i < numRanges; i++) {
+                int end = i + 1 < numRanges ? ranges[i + 1].start : fa->outputSize;
+                memmove(fa->output + size, fa->output + ranges[i].end, end - ranges[i].end);
+                size += end - ranges[i].end;
+        }
+        fa->outputSize = size;
+        fa->output[size] = '\0';
+}
+
+/* Each range splits at most one span in two, so there are at most
+ * numOutputSpans + numRanges spans afterwards. */
+static void remove_output_ranges_from_spans(struct GP_ShaderfileAst *fa,
+                                            const struct GP_OutputRange *ranges, int numRanges)
+{
+        struct GP_Span *spans;
+        int numSpans = 0;
+        int numAllocated = fa->numOutputSpans + numRanges;
+        ALLOC_MEMORY(&spans, numAllocated);
+        int pos = 0;  // output position of the current span
+        int r = 0;
+        for (int i = 0; i < fa->numOutputSpans; i++) {
+                struct GP_Span span = fa->outputSpans[i];
+                int spanEnd = pos + span.length;
+                // the parts of the span that are not in a range are kept
+                int keepStart = pos;
+                for (;;) {
+                        int keepEnd = spanEnd;
+                        if (r < numRanges && ranges[r].start < spanEnd)
+                                keepEnd = ranges[r].start > keepStart ? ranges[r].start : keepStart;
+                        if (keepEnd > keepStart) {
+                                struct GP_Span *last = numSpans > 0 ? &spans[numSpans - 1] : NULL;
+                                int offset = span.offset + (keepStart - pos);
+                                if (last != NULL && last->fileIndex == span.fileIndex
+                                    && last->offset + last->length == offset)
+                                        last->length += keepEnd - keepStart;
+                                else {
+                                        GP_ENSURE(numSpans < numAllocated);
+                                        spans[numSpans].fileIndex = span.fileIndex;
+                                        spans[numSpans].offset = offset;
+                                        spans[numSpans].length = keepEnd - keepStart;
+                                        numSpans++;
+                                }
+                        }
+                        if (keepEnd == spanEnd)
+                                break;
+                        // skip the range, it may continue in the next span
+                        if (ranges[r].end >= spanEnd) {
+                                if (ranges[r].end == spanEnd)
+                                        r++;
+                                break;
+                        }
+                        keepStart = ranges[r].end;
+                        r++;
+                }
+                pos = spanEnd;
+        }
+        FREE_MEMORY(&fa->outputSpans);
+        fa->outputSpans = spans;
+        fa->numOutputSpans = numSpans;
+        fa->numOutputSpansAllocated = numAllocated;
+        int numRemoved = 0;
+        for (int i = 0; i < numRanges; i++)
+                numRemoved += ranges[i].end - ranges[i].start;
+        fa->outputSize -= numRemoved;
+}
+
+void gp_remove_dead_functions(struct GP_Ctx *ctx, struct GP_ShaderfileAst *fa)
+{
+        struct GP_CallGraph graph = {0};
+        graph.fa = fa;
+        int mainNodeIndex = -1;
+        for (int i = 0; i < fa->numToplevelNodes; i++) {
+                const struct GP_ToplevelNode *node = fa->toplevelNodes[i];
+                if (node->directiveKind == GP_DIRECTIVE_FUNCDEFN) {
+                        if (node->data.tFuncdefn->bodyStmt == -1)
+                                return;  // the calls are not known
+                        if (!strcmp(gp_atom_string(ctx, node->data.tFuncdefn->name), "main"))
+                                mainNodeIndex = i;
+                }
+                if (node->directiveKind == GP_DIRECTIVE_FUNCDEFN || node->directiveKind == GP_DIRECTIVE_FUNCDECL)
+                        graph.numFunctionNodes++;
+        }
+        if (mainNodeIndex == -1)
+                return;  // not a complete shader
+
+        ALLOC_MEMORY(&graph.functionNodes, graph.numFunctionNodes);
+        ALLOC_MEMORY(&graph.isReachable, graph.numFunctionNodes);
+        ALLOC_MEMORY(&graph.worklist, graph.numFunctionNodes);
+        memset(graph.isReachable, 0, graph.numFunctionNodes);
+        graph.numFunctionNodes = 0;
+        for (int i = 0; i < fa->numToplevelNodes; i++) {
+                const struct GP_ToplevelNode *node = fa->toplevelNodes[i];
+                struct GP_FunctionNode *functionNode = &graph.functionNodes[graph.numFunctionNodes];
+                if (node->directiveKind == GP_DIRECTIVE_FUNCDEFN)
+                        functionNode->name = node->data.tFuncdefn->name;
+                else if (node->directiveKind == GP_DIRECTIVE_FUNCDECL)
+                        functionNode->name = node->data.tFuncdecl->name;
+                else
+                        continue;
+                functionNode->nodeIndex = i;
+                graph.numFunctionNodes++;
+        }
+        qsort(graph.functionNodes, graph.numFunctionNodes, sizeof *graph.functionNodes, compare_function_nodes);
+
+        reach_function(&graph, fa->toplevelNodes[mainNodeIndex]->data.tFuncdefn->name);
+        // what can't be removed must stay complete
+        for (int i = 0; i < graph.numFunctionNodes; i++)
+                if (fa->toplevelNodes[graph.functionNodes[i].nodeIndex]->outputStart == -1)
+                        reach_function(&graph, graph.functionNodes[i].name);
+        while (graph.numWork > 0) {
+                int function = graph.worklist[--graph.numWork];
+                for (int i = function; i < graph.numFunctionNodes
+                     && graph.functionNodes[i].name == graph.functionNodes[function].name; i++) {
+                        const struct GP_ToplevelNode *node = fa->toplevelNodes[graph.functionNodes[i].nodeIndex];
+                        if (node->directiveKind == GP_DIRECTIVE_FUNCDEFN)
+                                visit_function_body(&graph, node->data.tFuncdefn->bodyStmt);
+                }
+        }
+
+        /* The toplevel nodes are in output order, so the ranges are sorted
+         * and they don't overlap. The output ranges of the nodes are moved
+         * to where their text ends up. */
+        struct GP_OutputRange *ranges;
+        int numRanges = 0;
+        int numRemoved = 0;
+        ALLOC_MEMORY(&ranges, graph.numFunctionNodes);
+        for (int i = 0; i < fa->numToplevelNodes; i++) {
+                struct GP_ToplevelNode *node = fa->toplevelNodes[i];
+                if (node->outputStart == -1)
+                        continue;
+                GP_Atom name = -1;
+                if (node->directiveKind == GP_DIRECTIVE_FUNCDEFN)
+                        name = node->data.tFuncdefn->name;
+                else if (node->directiveKind == GP_DIRECTIVE_FUNCDECL)
+                        name = node->data.tFuncdecl->name;
+                if (name == -1 || graph.isReachable[find_function(&graph, name)]
+                    || node->outputStart == node->outputEnd) {
+                        node->outputStart -= numRemoved;
+                        node->outputEnd -= numRemoved;
+                        continue;
+                }
+                GP_ENSURE(numRanges == 0 || ranges[numRanges - 1].end <= node->outputStart);
+                ranges[numRanges].start = node->outputStart;
+                ranges[numRanges].end = node->outputEnd;
+                numRanges++;
+                int start = node->outputStart - numRemoved;
+                numRemoved += node->outputEnd - node->outputStart;
+                node->outputStart = start;
+                node->outputEnd = start;
+        }
+        if (numRanges > 0) {
+                if (ctx->outputMode == GP_OUTPUT_MODE_SPANS)
+                        remove_output_ranges_from_spans(fa, ranges, numRanges);
+                else
+                        remove_output_ranges_from_buffer(fa, ranges, numRanges);
+        }
+
+        FREE_MEMORY(&ranges);
+        FREE_MEMORY(&graph.functionNodes);
+        FREE_MEMORY(&graph.isReachable);
+        FREE_MEMORY(&graph.worklist);
+        FREE_MEMORY(&graph.nodeStack);
+}
@@ -14,6 +14,7 @@ const char *const gp_tokenKindString[GP_NUM_TOKEN_KINDS] = {
         ENUM_KIND_STRING( GP_TOKEN_RIGHTPAREN ),
         ENUM_KIND_STRING( GP_TOKEN_LEFTBRACE ),
         ENUM_KIND_STRING( GP_TOKEN_RIGHTBRACE ),
+        ENUM_KIND_STRING( GP_TOKEN_DOT ),
         ENUM_KIND_STRING( GP_TOKEN_COMMA ),
         ENUM_KIND_STRING( GP_TOKEN_SEMICOLON ),
         ENUM_KIND_STRING( GP_TOKEN_PLUS ),
@@ -37,6 +38,16 @@ const char *const gp_tokenKindString[GP_NUM_TOKEN_KINDS] = {
         ENUM_KIND_STRING( GP_TOKEN_DOUBLEAMPERSAND ),
         ENUM_KIND_STRING( GP_TOKEN_PIPE ),
         ENUM_KIND_STRING( GP_TOKEN_DOUBLEPIPE ),
+        ENUM_KIND_STRING( GP_TOKEN_LEFTBRACKET ),
+        ENUM_KIND_STRING( GP_TOKEN_RIGHTBRACKET ),
+        ENUM_KIND_STRING( GP_TOKEN_QUESTIONMARK ),
+        ENUM_KIND_STRING( GP_TOKEN_COLON ),
+        ENUM_KIND_STRING( GP_TOKEN_CARET ),
+        ENUM_KIND_STRING( GP_TOKEN_TILDE ),
+        ENUM_KIND_STRING( GP_TOKEN_LEFTSHIFT ),
+        ENUM_KIND_STRING( GP_TOKEN_RIGHTSHIFT ),
+        ENUM_KIND_STRING( GP_TOKEN_INCREMENT ),
+        ENUM_KIND_STRING( GP_TOKEN_DECREMENT ),
 };
 
 const struct GP_UnopInfo gp_unopInfo[GP_NUM_UNOP_KINDS] = {
@@ -50,27 +61,27 @@ const struct GP_UnopTokenInfo gp_unopTokenInfo[] = {
 };
 
 const struct GP_BinopInfo gp_binopInfo[GP_NUM_BINOP_KINDS] = {
-#define MAKE(x, y) [x] = { y }
-        MAKE( GP_BINOP_EQ, "==" ),
-        MAKE( GP_BINOP_NE, "!=" ),
-        MAKE( GP_BINOP_LT, "<" ),
-        MAKE( GP_BINOP_LE, "<=" ),
-        MAKE( GP_BINOP_GE, ">=" ),
-        MAKE( GP_BINOP_GT, ">" ),
-        MAKE( GP_BINOP_PLUS, "+" ),
-        MAKE( GP_BINOP_MINUS, "-" ),
-        MAKE( GP_BINOP_MUL, "*" ),
-        MAKE( GP_BINOP_DIV, "/" ),
-        MAKE( GP_BINOP_MOD, "%" ),
-        MAKE( GP_BINOP_ASSIGN, "=" ),
-        MAKE( GP_BINOP_PLUSASSIGN, "+=" ),
-        MAKE( GP_BINOP_MINUSASSIGN, "-=" ),
-        MAKE( GP_BINOP_MULASSIGN, "*=" ),
-        MAKE( GP_BINOP_DIVASSIGN, "/=" ),
-        MAKE( GP_BINOP_BITAND, "&" ),
-        MAKE( GP_BINOP_BITOR, "|" ),
-        MAKE( GP_BINOP_LOGICALAND, "&&" ),
-        MAKE( GP_BINOP_LOGICALOR, "||" ),
+#define MAKE(x, y, prec, right) [x] = { y, prec, right }
+        MAKE( GP_BINOP_EQ, "==", 6, 0 ),
+        MAKE( GP_BINOP_NE, "!=", 6, 0 ),
+        MAKE( GP_BINOP_LT, "<", 7, 0 ),
+        MAKE( GP_BINOP_LE, "<=", 7, 0 ),
+        MAKE( GP_BINOP_GE, ">=", 7, 0 ),
+        MAKE( GP_BINOP_GT, ">", 7, 0 ),
+        MAKE( GP_BINOP_PLUS, "+", 8, 0 ),
+        MAKE( GP_BINOP_MINUS, "-", 8, 0 ),
+        MAKE( GP_BINOP_MUL, "*", 9, 0 ),
+        MAKE( GP_BINOP_DIV, "/", 9, 0 ),
+        MAKE( GP_BINOP_MOD, "%", 9, 0 ),
+        MAKE( GP_BINOP_ASSIGN, "=", 1, 1 ),
+        MAKE( GP_BINOP_PLUSASSIGN, "+=", 1, 1 ),
+        MAKE( GP_BINOP_MINUSASSIGN, "-=", 1, 1 ),
+        MAKE( GP_BINOP_MULASSIGN, "*=", 1, 1 ),
+        MAKE( GP_BINOP_DIVASSIGN, "/=", 1, 1 ),
+        MAKE( GP_BINOP_BITAND, "&", 5, 0 ),
+        MAKE( GP_BINOP_BITOR, "|", 4, 0 ),
+        MAKE( GP_BINOP_LOGICALAND, "&&", 3, 0 ),
+        MAKE( GP_BINOP_LOGICALOR, "||", 2, 0 ),
 #undef MAKE
 };
 
@@ -114,6 +125,211 @@ const char *const gp_typeString[GP_NUM_TYPE_KINDS] = {
         ENUM_TO_STRING( GP_TYPE_MAT3, "mat3" ),
         ENUM_TO_STRING( GP_TYPE_MAT4, "mat4" ),
         ENUM_TO_STRING( GP_TYPE_SAMPLER2D, "sampler2D" ),
+        ENUM_TO_STRING( GP_TYPE_DVEC2, "dvec2" ),
+        ENUM_TO_STRING( GP_TYPE_DVEC3, "dvec3" ),
+        ENUM_TO_STRING( GP_TYPE_DVEC4, "dvec4" ),
+        ENUM_TO_STRING( GP_TYPE_BVEC2, "bvec2" ),
+        ENUM_TO_STRING( GP_TYPE_BVEC3, "bvec3" ),
+        ENUM_TO_STRING( GP_TYPE_BVEC4, "bvec4" ),
+        ENUM_TO_STRING( GP_TYPE_IVEC2, "ivec2" ),
+        ENUM_TO_STRING( GP_TYPE_IVEC3, "ivec3" ),
+        ENUM_TO_STRING( GP_TYPE_IVEC4, "ivec4" ),
+        ENUM_TO_STRING( GP_TYPE_UVEC2, "uvec2" ),
+        ENUM_TO_STRING( GP_TYPE_UVEC3, "uvec3" ),
+        ENUM_TO_STRING( GP_TYPE_UVEC4, "uvec4" ),
+        ENUM_TO_STRING( GP_TYPE_MAT2X3, "mat2x3" ),
+        ENUM_TO_STRING( GP_TYPE_MAT2X4, "mat2x4" ),
+        ENUM_TO_STRING( GP_TYPE_MAT3X2, "mat3x2" ),
+        ENUM_TO_STRING( GP_TYPE_MAT3X4, "mat3x4" ),
+        ENUM_TO_STRING( GP_TYPE_MAT4X2, "mat4x2" ),
+        ENUM_TO_STRING( GP_TYPE_MAT4X3, "mat4x3" ),
+        ENUM_TO_STRING( GP_TYPE_DMAT2, "dmat2" ),
+        ENUM_TO_STRING( GP_TYPE_DMAT3, "dmat3" ),
+        ENUM_TO_STRING( GP_TYPE_DMAT4, "dmat4" ),
+        ENUM_TO_STRING( GP_TYPE_DMAT2X3, "dmat2x3" ),
+        ENUM_TO_STRING( GP_TYPE_DMAT2X4, "dmat2x4" ),
+        ENUM_TO_STRING( GP_TYPE_DMAT3X2, "dmat3x2" ),
+        ENUM_TO_STRING( GP_TYPE_DMAT3X4, "dmat3x4" ),
+        ENUM_TO_STRING( GP_TYPE_DMAT4X2, "dmat4x2" ),
+        ENUM_TO_STRING( GP_TYPE_DMAT4X3, "dmat4x3" ),
+        ENUM_TO_STRING( GP_TYPE_SAMPLER1D, "sampler1D" ),
+        ENUM_TO_STRING( GP_TYPE_SAMPLER3D, "sampler3D" ),
+        ENUM_TO_STRING( GP_TYPE_SAMPLERCUBE, "samplerCube" ),
+        ENUM_TO_STRING( GP_TYPE_SAMPLER1DARRAY, "sampler1DArray" ),
+        ENUM_TO_STRING( GP_TYPE_SAMPLER2DARRAY, "sampler2DArray" ),
+        ENUM_TO_STRING( GP_TYPE_SAMPLERCUBEARRAY, "samplerCubeArray" ),
+        ENUM_TO_STRING( GP_TYPE_SAMPLER2DRECT, "sampler2DRect" ),
+        ENUM_TO_STRING( GP_TYPE_SAMPLERBUFFER, "samplerBuffer" ),
+        ENUM_TO_STRING( GP_TYPE_SAMPLER2DMS, "sampler2DMS" ),
+        ENUM_TO_STRING( GP_TYPE_SAMPLER2DMSARRAY, "sampler2DMSArray" ),
+        ENUM_TO_STRING( GP_TYPE_SAMPLER1DSHADOW, "sampler1DShadow" ),
+        ENUM_TO_STRING( GP_TYPE_SAMPLER2DSHADOW, "sampler2DShadow" ),
+        ENUM_TO_STRING( GP_TYPE_SAMPLERCUBESHADOW, "samplerCubeShadow" ),
+        ENUM_TO_STRING( GP_TYPE_SAMPLER1DARRAYSHADOW, "sampler1DArrayShadow" ),
+        ENUM_TO_STRING( GP_TYPE_SAMPLER2DARRAYSHADOW, "sampler2DArrayShadow" ),
+        ENUM_TO_STRING( GP_TYPE_SAMPLERCUBEARRAYSHADOW, "samplerCubeArrayShadow" ),
+        ENUM_TO_STRING( GP_TYPE_SAMPLER2DRECTSHADOW, "sampler2DRectShadow" ),
+        ENUM_TO_STRING( GP_TYPE_ISAMPLER1D, "isampler1D" ),
+        ENUM_TO_STRING( GP_TYPE_ISAMPLER2D, "isampler2D" ),
+        ENUM_TO_STRING( GP_TYPE_ISAMPLER3D, "isampler3D" ),
+        ENUM_TO_STRING( GP_TYPE_ISAMPLERCUBE, "isamplerCube" ),
+        ENUM_TO_STRING( GP_TYPE_ISAMPLER1DARRAY, "isampler1DArray" ),
+        ENUM_TO_STRING( GP_TYPE_ISAMPLER2DARRAY, "isampler2DArray" ),
+        ENUM_TO_STRING( GP_TYPE_ISAMPLERCUBEARRAY, "isamplerCubeArray" ),
+        ENUM_TO_STRING( GP_TYPE_ISAMPLER2DRECT, "isampler2DRect" ),
+        ENUM_TO_STRING( GP_TYPE_ISAMPLERBUFFER, "isamplerBuffer" ),
+        ENUM_TO_STRING( GP_TYPE_ISAMPLER2DMS, "isampler2DMS" ),
+        ENUM_TO_STRING( GP_TYPE_ISAMPLER2DMSARRAY, "isampler2DMSArray" ),
+        ENUM_TO_STRING( GP_TYPE_USAMPLER1D, "usampler1D" ),
+        ENUM_TO_STRING( GP_TYPE_USAMPLER2D, "usampler2D" ),
+        ENUM_TO_STRING( GP_TYPE_USAMPLER3D, "usampler3D" ),
+        ENUM_TO_STRING( GP_TYPE_USAMPLERCUBE, "usamplerCube" ),
+        ENUM_TO_STRING( GP_TYPE_USAMPLER1DARRAY, "usampler1DArray" ),
+        ENUM_TO_STRING( GP_TYPE_USAMPLER2DARRAY, "usampler2DArray" ),
+        ENUM_TO_STRING( GP_TYPE_USAMPLERCUBEARRAY, "usamplerCubeArray" ),
+        ENUM_TO_STRING( GP_TYPE_USAMPLER2DRECT, "usampler2DRect" ),
+        ENUM_TO_STRING( GP_TYPE_USAMPLERBUFFER, "usamplerBuffer" ),
+        ENUM_TO_STRING( GP_TYPE_USAMPLER2DMS, "usampler2DMS" ),
+        ENUM_TO_STRING( GP_TYPE_USAMPLER2DMSARRAY, "usampler2DMSArray" ),
+        ENUM_TO_STRING( GP_TYPE_IMAGE1D, "image1D" ),
+        ENUM_TO_STRING( GP_TYPE_IMAGE2D, "image2D" ),
+        ENUM_TO_STRING( GP_TYPE_IMAGE3D, "image3D" ),
+        ENUM_TO_STRING( GP_TYPE_IMAGECUBE, "imageCube" ),
+        ENUM_TO_STRING( GP_TYPE_IMAGE1DARRAY, "image1DArray" ),
+        ENUM_TO_STRING( GP_TYPE_IMAGE2DARRAY, "image2DArray" ),
+        ENUM_TO_STRING( GP_TYPE_IMAGECUBEARRAY, "imageCubeArray" ),
+        ENUM_TO_STRING( GP_TYPE_IMAGE2DRECT, "image2DRect" ),
+        ENUM_TO_STRING( GP_TYPE_IMAGEBUFFER, "imageBuffer" ),
+        ENUM_TO_STRING( GP_TYPE_IMAGE2DMS, "image2DMS" ),
+        ENUM_TO_STRING( GP_TYPE_IMAGE2DMSARRAY, "image2DMSArray" ),
+        ENUM_TO_STRING( GP_TYPE_IIMAGE1D, "iimage1D" ),
+        ENUM_TO_STRING( GP_TYPE_IIMAGE2D, "iimage2D" ),
+        ENUM_TO_STRING( GP_TYPE_IIMAGE3D, "iimage3D" ),
+        ENUM_TO_STRING( GP_TYPE_IIMAGECUBE, "iimageCube" ),
+        ENUM_TO_STRING( GP_TYPE_IIMAGE1DARRAY, "iimage1DArray" ),
+        ENUM_TO_STRING( GP_TYPE_IIMAGE2DARRAY, "iimage2DArray" ),
+        ENUM_TO_STRING( GP_TYPE_IIMAGECUBEARRAY, "iimageCubeArray" ),
+        ENUM_TO_STRING( GP_TYPE_IIMAGE2DRECT, "iimage2DRect" ),
+        ENUM_TO_STRING( GP_TYPE_IIMAGEBUFFER, "iimageBuffer" ),
+        ENUM_TO_STRING( GP_TYPE_IIMAGE2DMS, "iimage2DMS" ),
+        ENUM_TO_STRING( GP_TYPE_IIMAGE2DMSARRAY, "iimage2DMSArray" ),
+        ENUM_TO_STRING( GP_TYPE_UIMAGE1D, "uimage1D" ),
+        ENUM_TO_STRING( GP_TYPE_UIMAGE2D, "uimage2D" ),
+        ENUM_TO_STRING( GP_TYPE_UIMAGE3D, "uimage3D" ),
+        ENUM_TO_STRING( GP_TYPE_UIMAGECUBE, "uimageCube" ),
+        ENUM_TO_STRING( GP_TYPE_UIMAGE1DARRAY, "uimage1DArray" ),
+        ENUM_TO_STRING( GP_TYPE_UIMAGE2DARRAY, "uimage2DArray" ),
+        ENUM_TO_STRING( GP_TYPE_UIMAGECUBEARRAY, "uimageCubeArray" ),
+        ENUM_TO_STRING( GP_TYPE_UIMAGE2DRECT, "uimage2DRect" ),
+        ENUM_TO_STRING( GP_TYPE_UIMAGEBUFFER, "uimageBuffer" ),
+        ENUM_TO_STRING( GP_TYPE_UIMAGE2DMS, "uimage2DMS" ),
+        ENUM_TO_STRING( GP_TYPE_UIMAGE2DMSARRAY, "uimage2DMSArray" ),
+        ENUM_TO_STRING( GP_TYPE_ATOMIC_UINT, "atomic_uint" ),
+};
+
+const struct GP_TypeAlias gp_typeAlias[] = {
+        { "mat2x2", GP_TYPE_MAT2 },
+        { "mat3x3", GP_TYPE_MAT3 },
+        { "mat4x4", GP_TYPE_MAT4 },
+        { "dmat2x2", GP_TYPE_DMAT2 },
+        { "dmat3x3", GP_TYPE_DMAT3 },
+        { "dmat4x4", GP_TYPE_DMAT4 },
+};
+
+const int gp_numTypeAliases = LENGTH(gp_typeAlias);
+
+const char *const gp_keywordString[GP_NUM_KEYWORD_KINDS] = {
+        ENUM_TO_STRING( GP_KEYWORD_CONST, "const" ),
+        ENUM_TO_STRING( GP_KEYWORD_UNIFORM, "uniform" ),
+        ENUM_TO_STRING( GP_KEYWORD_BUFFER, "buffer" ),
+        ENUM_TO_STRING( GP_KEYWORD_SHARED, "shared" ),
+        ENUM_TO_STRING( GP_KEYWORD_ATTRIBUTE, "attribute" ),
+        ENUM_TO_STRING( GP_KEYWORD_VARYING, "varying" ),
+        ENUM_TO_STRING( GP_KEYWORD_COHERENT, "coherent" ),
+        ENUM_TO_STRING( GP_KEYWORD_VOLATILE, "volatile" ),
+        ENUM_TO_STRING( GP_KEYWORD_RESTRICT, "restrict" ),
+        ENUM_TO_STRING( GP_KEYWORD_READONLY, "readonly" ),
+        ENUM_TO_STRING( GP_KEYWORD_WRITEONLY, "writeonly" ),
+        ENUM_TO_STRING( GP_KEYWORD_LAYOUT, "layout" ),
+        ENUM_TO_STRING( GP_KEYWORD_CENTROID, "centroid" ),
+        ENUM_TO_STRING( GP_KEYWORD_FLAT, "flat" ),
+        ENUM_TO_STRING( GP_KEYWORD_SMOOTH, "smooth" ),
+        ENUM_TO_STRING( GP_KEYWORD_NOPERSPECTIVE, "noperspective" ),
+        ENUM_TO_STRING( GP_KEYWORD_PATCH, "patch" ),
+        ENUM_TO_STRING( GP_KEYWORD_SAMPLE, "sample" ),
+        ENUM_TO_STRING( GP_KEYWORD_INVARIANT, "invariant" ),
+        ENUM_TO_STRING( GP_KEYWORD_PRECISE, "precise" ),
+        ENUM_TO_STRING( GP_KEYWORD_BREAK, "break" ),
+        ENUM_TO_STRING( GP_KEYWORD_CONTINUE, "continue" ),
+        ENUM_TO_STRING( GP_KEYWORD_DO, "do" ),
+        ENUM_TO_STRING( GP_KEYWORD_FOR, "for" ),
+        ENUM_TO_STRING( GP_KEYWORD_WHILE, "while" ),
+        ENUM_TO_STRING( GP_KEYWORD_SWITCH, "switch" ),
+        ENUM_TO_STRING( GP_KEYWORD_CASE, "case" ),
+        ENUM_TO_STRING( GP_KEYWORD_DEFAULT, "default" ),
+        ENUM_TO_STRING( GP_KEYWORD_IF, "if" ),
+        ENUM_TO_STRING( GP_KEYWORD_ELSE, "else" ),
+        ENUM_TO_STRING( GP_KEYWORD_SUBROUTINE, "subroutine" ),
+        ENUM_TO_STRING( GP_KEYWORD_IN, "in" ),
+        ENUM_TO_STRING( GP_KEYWORD_OUT, "out" ),
+        ENUM_TO_STRING( GP_KEYWORD_INOUT, "inout" ),
+        ENUM_TO_STRING( GP_KEYWORD_TRUE, "true" ),
+        ENUM_TO_STRING( GP_KEYWORD_FALSE, "false" ),
+        ENUM_TO_STRING( GP_KEYWORD_LOWP, "lowp" ),
+        ENUM_TO_STRING( GP_KEYWORD_MEDIUMP, "mediump" ),
+        ENUM_TO_STRING( GP_KEYWORD_HIGHP, "highp" ),
+        ENUM_TO_STRING( GP_KEYWORD_PRECISION, "precision" ),
+        ENUM_TO_STRING( GP_KEYWORD_STRUCT, "struct" ),
+        ENUM_TO_STRING( GP_KEYWORD_RETURN, "return" ),
+        ENUM_TO_STRING( GP_KEYWORD_DISCARD, "discard" ),
+        ENUM_TO_STRING( GP_KEYWORD_VOID, "void" ),
+};
+
+const char *const gp_keywordKindString[GP_NUM_KEYWORD_KINDS] = {
+        ENUM_KIND_STRING(GP_KEYWORD_CONST),
+        ENUM_KIND_STRING(GP_KEYWORD_UNIFORM),
+        ENUM_KIND_STRING(GP_KEYWORD_BUFFER),
+        ENUM_KIND_STRING(GP_KEYWORD_SHARED),
+        ENUM_KIND_STRING(GP_KEYWORD_ATTRIBUTE),
+        ENUM_KIND_STRING(GP_KEYWORD_VARYING),
+        ENUM_KIND_STRING(GP_KEYWORD_COHERENT),
+        ENUM_KIND_STRING(GP_KEYWORD_VOLATILE),
+        ENUM_KIND_STRING(GP_KEYWORD_RESTRICT),
+        ENUM_KIND_STRING(GP_KEYWORD_READONLY),
+        ENUM_KIND_STRING(GP_KEYWORD_WRITEONLY),
+        ENUM_KIND_STRING(GP_KEYWORD_LAYOUT),
+        ENUM_KIND_STRING(GP_KEYWORD_CENTROID),
+        ENUM_KIND_STRING(GP_KEYWORD_FLAT),
+        ENUM_KIND_STRING(GP_KEYWORD_SMOOTH),
+        ENUM_KIND_STRING(GP_KEYWORD_NOPERSPECTIVE),
+        ENUM_KIND_STRING(GP_KEYWORD_PATCH),
+        ENUM_KIND_STRING(GP_KEYWORD_SAMPLE),
+        ENUM_KIND_STRING(GP_KEYWORD_INVARIANT),
+        ENUM_KIND_STRING(GP_KEYWORD_PRECISE),
+        ENUM_KIND_STRING(GP_KEYWORD_BREAK),
+        ENUM_KIND_STRING(GP_KEYWORD_CONTINUE),
+        ENUM_KIND_STRING(GP_KEYWORD_DO),
+        ENUM_KIND_STRING(GP_KEYWORD_FOR),
+        ENUM_KIND_STRING(GP_KEYWORD_WHILE),
+        ENUM_KIND_STRING(GP_KEYWORD_SWITCH),
+        ENUM_KIND_STRING(GP_KEYWORD_CASE),
+        ENUM_KIND_STRING(GP_KEYWORD_DEFAULT),
+        ENUM_KIND_STRING(GP_KEYWORD_IF),
+        ENUM_KIND_STRING(GP_KEYWORD_ELSE),
+        ENUM_KIND_STRING(GP_KEYWORD_SUBROUTINE),
+        ENUM_KIND_STRING(GP_KEYWORD_IN),
+        ENUM_KIND_STRING(GP_KEYWORD_OUT),
+        ENUM_KIND_STRING(GP_KEYWORD_INOUT),
+        ENUM_KIND_STRING(GP_KEYWORD_TRUE),
+        ENUM_KIND_STRING(GP_KEYWORD_FALSE),
+        ENUM_KIND_STRING(GP_KEYWORD_LOWP),
+        ENUM_KIND_STRING(GP_KEYWORD_MEDIUMP),
+        ENUM_KIND_STRING(GP_KEYWORD_HIGHP),
+        ENUM_KIND_STRING(GP_KEYWORD_PRECISION),
+        ENUM_KIND_STRING(GP_KEYWORD_STRUCT),
+        ENUM_KIND_STRING(GP_KEYWORD_RETURN),
+        ENUM_KIND_STRING(GP_KEYWORD_DISCARD),
+        ENUM_KIND_STRING(GP_KEYWORD_VOID),
 };
 
 const char *const gp_typeKindString[GP_NUM_TYPE_KINDS] = {
@@ -129,6 +345,106 @@ const char *const gp_typeKindString[GP_NUM_TYPE_KINDS] = {
         ENUM_KIND_STRING(GP_TYPE_MAT3),
         ENUM_KIND_STRING(GP_TYPE_MAT4),
         ENUM_KIND_STRING(GP_TYPE_SAMPLER2D),
+        ENUM_KIND_STRING(GP_TYPE_DVEC2),
+        ENUM_KIND_STRING(GP_TYPE_DVEC3),
+        ENUM_KIND_STRING(GP_TYPE_DVEC4),
+        ENUM_KIND_STRING(GP_TYPE_BVEC2),
+        ENUM_KIND_STRING(GP_TYPE_BVEC3),
+        ENUM_KIND_STRING(GP_TYPE_BVEC4),
+        ENUM_KIND_STRING(GP_TYPE_IVEC2),
+        ENUM_KIND_STRING(GP_TYPE_IVEC3),
+        ENUM_KIND_STRING(GP_TYPE_IVEC4),
+        ENUM_KIND_STRING(GP_TYPE_UVEC2),
+        ENUM_KIND_STRING(GP_TYPE_UVEC3),
+        ENUM_KIND_STRING(GP_TYPE_UVEC4),
+        ENUM_KIND_STRING(GP_TYPE_MAT2X3),
+        ENUM_KIND_STRING(GP_TYPE_MAT2X4),
+        ENUM_KIND_STRING(GP_TYPE_MAT3X2),
+        ENUM_KIND_STRING(GP_TYPE_MAT3X4),
+        ENUM_KIND_STRING(GP_TYPE_MAT4X2),
+        ENUM_KIND_STRING(GP_TYPE_MAT4X3),
+        ENUM_KIND_STRING(GP_TYPE_DMAT2),
+        ENUM_KIND_STRING(GP_TYPE_DMAT3),
+        ENUM_KIND_STRING(GP_TYPE_DMAT4),
+        ENUM_KIND_STRING(GP_TYPE_DMAT2X3),
+        ENUM_KIND_STRING(GP_TYPE_DMAT2X4),
+        ENUM_KIND_STRING(GP_TYPE_DMAT3X2),
+        ENUM_KIND_STRING(GP_TYPE_DMAT3X4),
+        ENUM_KIND_STRING(GP_TYPE_DMAT4X2),
+        ENUM_KIND_STRING(GP_TYPE_DMAT4X3),
+        ENUM_KIND_STRING(GP_TYPE_SAMPLER1D),
+        ENUM_KIND_STRING(GP_TYPE_SAMPLER3D),
+        ENUM_KIND_STRING(GP_TYPE_SAMPLERCUBE),
+        ENUM_KIND_STRING(GP_TYPE_SAMPLER1DARRAY),
+        ENUM_KIND_STRING(GP_TYPE_SAMPLER2DARRAY),
+        ENUM_KIND_STRING(GP_TYPE_SAMPLERCUBEARRAY),
+        ENUM_KIND_STRING(GP_TYPE_SAMPLER2DRECT),
+        ENUM_KIND_STRING(GP_TYPE_SAMPLERBUFFER),
+        ENUM_KIND_STRING(GP_TYPE_SAMPLER2DMS),
+        ENUM_KIND_STRING(GP_TYPE_SAMPLER2DMSARRAY),
+        ENUM_KIND_STRING(GP_TYPE_SAMPLER1DSHADOW),
+        ENUM_KIND_STRING(GP_TYPE_SAMPLER2DSHADOW),
+        ENUM_KIND_STRING(GP_TYPE_SAMPLERCUBESHADOW),
+        ENUM_KIND_STRING(GP_TYPE_SAMPLER1DARRAYSHADOW),
+        ENUM_KIND_STRING(GP_TYPE_SAMPLER2DARRAYSHADOW),
+        ENUM_KIND_STRING(GP_TYPE_SAMPLERCUBEARRAYSHADOW),
+        ENUM_KIND_STRING(GP_TYPE_SAMPLER2DRECTSHADOW),
+        ENUM_KIND_STRING(GP_TYPE_ISAMPLER1D),
+        ENUM_KIND_STRING(GP_TYPE_ISAMPLER2D),
+        ENUM_KIND_STRING(GP_TYPE_ISAMPLER3D),
+        ENUM_KIND_STRING(GP_TYPE_ISAMPLERCUBE),
+        ENUM_KIND_STRING(GP_TYPE_ISAMPLER1DARRAY),
+        ENUM_KIND_STRING(GP_TYPE_ISAMPLER2DARRAY),
+        ENUM_KIND_STRING(GP_TYPE_ISAMPLERCUBEARRAY),
+        ENUM_KIND_STRING(GP_TYPE_ISAMPLER2DRECT),
+        ENUM_KIND_STRING(GP_TYPE_ISAMPLERBUFFER),
+        ENUM_KIND_STRING(GP_TYPE_ISAMPLER2DMS),
+        ENUM_KIND_STRING(GP_TYPE_ISAMPLER2DMSARRAY),
+        ENUM_KIND_STRING(GP_TYPE_USAMPLER1D),
+        ENUM_KIND_STRING(GP_TYPE_USAMPLER2D),
+        ENUM_KIND_STRING(GP_TYPE_USAMPLER3D),
+        ENUM_KIND_STRING(GP_TYPE_USAMPLERCUBE),
+        ENUM_KIND_STRING(GP_TYPE_USAMPLER1DARRAY),
+        ENUM_KIND_STRING(GP_TYPE_USAMPLER2DARRAY),
+        ENUM_KIND_STRING(GP_TYPE_USAMPLERCUBEARRAY),
+        ENUM_KIND_STRING(GP_TYPE_USAMPLER2DRECT),
+        ENUM_KIND_STRING(GP_TYPE_USAMPLERBUFFER),
+        ENUM_KIND_STRING(GP_TYPE_USAMPLER2DMS),
+        ENUM_KIND_STRING(GP_TYPE_USAMPLER2DMSARRAY),
+        ENUM_KIND_STRING(GP_TYPE_IMAGE1D),
+        ENUM_KIND_STRING(GP_TYPE_IMAGE2D),
+        ENUM_KIND_STRING(GP_TYPE_IMAGE3D),
+        ENUM_KIND_STRING(GP_TYPE_IMAGECUBE),
+        ENUM_KIND_STRING(GP_TYPE_IMAGE1DARRAY),
+        ENUM_KIND_STRING(GP_TYPE_IMAGE2DARRAY),
+        ENUM_KIND_STRING(GP_TYPE_IMAGECUBEARRAY),
+        ENUM_KIND_STRING(GP_TYPE_IMAGE2DRECT),
+        ENUM_KIND_STRING(GP_TYPE_IMAGEBUFFER),
+        ENUM_KIND_STRING(GP_TYPE_IMAGE2DMS),
+        ENUM_KIND_STRING(GP_TYPE_IMAGE2DMSARRAY),
+        ENUM_KIND_STRING(GP_TYPE_IIMAGE1D),
+        ENUM_KIND_STRING(GP_TYPE_IIMAGE2D),
+        ENUM_KIND_STRING(GP_TYPE_IIMAGE3D),
+        ENUM_KIND_STRING(GP_TYPE_IIMAGECUBE),
+        ENUM_KIND_STRING(GP_TYPE_IIMAGE1DARRAY),
+        ENUM_KIND_STRING(GP_TYPE_IIMAGE2DARRAY),
+        ENUM_KIND_STRING(GP_TYPE_IIMAGECUBEARRAY),
+        ENUM_KIND_STRING(GP_TYPE_IIMAGE2DRECT),
+        ENUM_KIND_STRING(GP_TYPE_IIMAGEBUFFER),
+        ENUM_KIND_STRING(GP_TYPE_IIMAGE2DMS),
+        ENUM_KIND_STRING(GP_TYPE_IIMAGE2DMSARRAY),
+        ENUM_KIND_STRING(GP_TYPE_UIMAGE1D),
+        ENUM_KIND_STRING(GP_TYPE_UIMAGE2D),
+        ENUM_KIND_STRING(GP_TYPE_UIMAGE3D),
+        ENUM_KIND_STRING(GP_TYPE_UIMAGECUBE),
+        ENUM_KIND_STRING(GP_TYPE_UIMAGE1DARRAY),
+        ENUM_KIND_STRING(GP_TYPE_UIMAGE2DARRAY),
+        ENUM_KIND_STRING(GP_TYPE_UIMAGECUBEARRAY),
+        ENUM_KIND_STRING(GP_TYPE_UIMAGE2DRECT),
+        ENUM_KIND_STRING(GP_TYPE_UIMAGEBUFFER),
+        ENUM_KIND_STRING(GP_TYPE_UIMAGE2DMS),
+        ENUM_KIND_STRING(GP_TYPE_UIMAGE2DMSARRAY),
+        ENUM_KIND_STRING(GP_TYPE_ATOMIC_UINT),
 };
 
 const char *const gp_shadertypeKindString[GP_NUM_SHADERTYPE_KINDS] = {
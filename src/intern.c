@@ -0,0 +1,113 @@
+#include <glsl-processor/defs.h>
+#include <glsl-processor/logging.h>
+#include <glsl-processor/memory.h>
+#include <glsl-processor/intern.h>
+#include <string.h>
+
+enum {
+        MIN_NUM_BUCKETS = 256,
+};
+
+unsigned gp_intern_hash(const char *string, int length)
+{
+        unsigned h = 2166136261u;
+        for (int i = 0; i < length; i++)
+                h = (h ^ (unsigned char) string[i]) * 16777619u;
+        return h;
+}
+
+static char *store_string(struct GP_InternTable *table, const char *string, int length)
+{
+        char *stored;
+        ARENA_ALLOC_MEMORY(&table->stringArena, &stored, length + 1);
+        memcpy(stored, string, length);
+        stored[length] = '\0';
+        return stored;
+}
+
+static void grow_buckets(struct GP_InternTable *table)
+{
+        int numBuckets = table->numBuckets ? 2 * table->numBuckets : MIN_NUM_BUCKETS;
+        FREE_MEMORY(&table->buckets);
+        ALLOC_MEMORY(&table->buckets, numBuckets);
+        memset(table->buckets, 0, numBuckets * sizeof *table->buckets);
+        table->numBuckets = numBuckets;
+        for (int atom = 0; atom < table->numAtoms; atom++) {
+                unsigned i = table->hashes[atom] & (numBuckets - 1);
+                while (table->buckets[i])
+                        i = (i + 1) & (numBuckets - 1);
+                table->buckets[i] = atom + 1;
+        }
+}
+
+/* Returns the bucket where the string is stored, or the empty bucket where it
+ * should be stored */
+static int find_bucket(struct GP_InternTable *table, const char *string, int length, unsigned hash)
+{
+        unsigned i = hash & (table->numBuckets - 1);
+        for (;;) {
+                int atom = table->buckets[i] - 1;
+                if (atom == -1)
+                        return i;
+                if (table->hashes[atom] == hash
+                    && table->lengths[atom] == length
+                    && !memcmp(table->strings[atom], string, length))
+                        return i;
+                i = (i + 1) & (table->numBuckets - 1);
+        }
+}
+
+/* A zeroed table is a valid empty table, too. */
+void gp_intern_setup(struct GP_InternTable *table)
+{
+        memset(table, 0, sizeof *table);
+}
+
+void gp_intern_teardown(struct GP_InternTable *table)
+{
+        gp_arena_teardown(&table->stringArena);
+        FREE_MEMORY(&table->strings);
+        FREE_MEMORY(&table->lengths);
+        FREE_MEMORY(&table->hashes);
+        FREE_MEMORY(&table->buckets);
+        memset(table, 0, sizeof *table);
+}
+
+GP_Atom gp_intern_string(struct GP_InternTable *table, const char *string, int length)
+{
+        return gp_intern_string_with_hash(table, string, length, gp_intern_hash(string, length));
+}
+
+GP_Atom gp_intern_string_with_hash(struct GP_InternTable *table, const char *string, int length, unsigned hash)
+{
+        if (table->numBuckets == 0)
+                grow_buckets(table);
+        int bucket = find_bucket(table, string, length, hash);
+        if (table->buckets[bucket])
+                return table->buckets[bucket] - 1;
+
+        GP_Atom atom = table->numAtoms++;
+        if (table->numAtomsAllocated < table->numAtoms) {
+                table->numAtomsAllocated = 2 * table->numAtoms;
+                REALLOC_MEMORY(&table->strings, table->numAtomsAllocated);
+                REALLOC_MEMORY(&table->lengths, table->numAtomsAllocated);
+                REALLOC_MEMORY(&table->hashes, table->numAtomsAllocated);
+        }
+        table->strings[atom] = store_string(table, string, length);
+        table->lengths[atom] = length;
+        table->hashes[atom] = hash;
+        table->buckets[bucket] = atom + 1;
+        // keep the load factor at 1/2 at most
+        if (2 * table->numAtoms > table->numBuckets)
+                grow_buckets(table);
+        return atom;
+}
+
+GP_Atom gp_intern_find_string(struct GP_InternTable *table, const char *string, int length)
+{
+        if (table->numBuckets == 0)
+                return -1;
+        unsigned hash = gp_intern_hash(string, length);
+        int bucket = find_bucket(table, string, length, hash);
+        return table->buckets[bucket] - 1;
+}
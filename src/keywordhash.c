@@ -0,0 +1,303 @@
+/* This file was generated by tools/gen-keywordhash.c. Do not edit. */
+
+#include <glsl-processor/keywordhash.h>
+
+const unsigned gp_keywordHashSeed = 217u;
+
+const int gp_keywordHashMaxLength = 22;
+
+const struct GP_KeywordHashEntry gp_keywordHashEntries[] = {
+        { "const", 5, GP_KEYWORD_CONST, -1 },
+        { "uniform", 7, GP_KEYWORD_UNIFORM, -1 },
+        { "buffer", 6, GP_KEYWORD_BUFFER, -1 },
+        { "shared", 6, GP_KEYWORD_SHARED, -1 },
+        { "attribute", 9, GP_KEYWORD_ATTRIBUTE, -1 },
+        { "varying", 7, GP_KEYWORD_VARYING, -1 },
+        { "coherent", 8, GP_KEYWORD_COHERENT, -1 },
+        { "volatile", 8, GP_KEYWORD_VOLATILE, -1 },
+        { "restrict", 8, GP_KEYWORD_RESTRICT, -1 },
+        { "readonly", 8, GP_KEYWORD_READONLY, -1 },
+        { "writeonly", 9, GP_KEYWORD_WRITEONLY, -1 },
+        { "layout", 6, GP_KEYWORD_LAYOUT, -1 },
+        { "centroid", 8, GP_KEYWORD_CENTROID, -1 },
+        { "flat", 4, GP_KEYWORD_FLAT, -1 },
+        { "smooth", 6, GP_KEYWORD_SMOOTH, -1 },
+        { "noperspective", 13, GP_KEYWORD_NOPERSPECTIVE, -1 },
+        { "patch", 5, GP_KEYWORD_PATCH, -1 },
+        { "sample", 6, GP_KEYWORD_SAMPLE, -1 },
+        { "invariant", 9, GP_KEYWORD_INVARIANT, -1 },
+        { "precise", 7, GP_KEYWORD_PRECISE, -1 },
+        { "break", 5, GP_KEYWORD_BREAK, -1 },
+        { "continue", 8, GP_KEYWORD_CONTINUE, -1 },
+        { "do", 2, GP_KEYWORD_DO, -1 },
+        { "for", 3, GP_KEYWORD_FOR, -1 },
+        { "while", 5, GP_KEYWORD_WHILE, -1 },
+        { "switch", 6, GP_KEYWORD_SWITCH, -1 },
+        { "case", 4, GP_KEYWORD_CASE, -1 },
+        { "default", 7, GP_KEYWORD_DEFAULT, -1 },
+        { "if", 2, GP_KEYWORD_IF, -1 },
+        { "else", 4, GP_KEYWORD_ELSE, -1 },
+        { "subroutine", 10, GP_KEYWORD_SUBROUTINE, -1 },
+        { "in", 2, GP_KEYWORD_IN, -1 },
+        { "out", 3, GP_KEYWORD_OUT, -1 },
+        { "inout", 5, GP_KEYWORD_INOUT, -1 },
+        { "true", 4, GP_KEYWORD_TRUE, -1 },
+        { "false", 5, GP_KEYWORD_FALSE, -1 },
+        { "lowp", 4, GP_KEYWORD_LOWP, -1 },
+        { "mediump", 7, GP_KEYWORD_MEDIUMP, -1 },
+        { "highp", 5, GP_KEYWORD_HIGHP, -1 },
+        { "precision", 9, GP_KEYWORD_PRECISION, -1 },
+        { "struct", 6, GP_KEYWORD_STRUCT, -1 },
+        { "return", 6, GP_KEYWORD_RETURN, -1 },
+        { "discard", 7, GP_KEYWORD_DISCARD, -1 },
+        { "void", 4, GP_KEYWORD_VOID, -1 },
+        { "bool", 4, -1, GP_TYPE_BOOL },
+        { "int", 3, -1, GP_TYPE_INT },
+        { "uint", 4, -1, GP_TYPE_UINT },
+        { "float", 5, -1, GP_TYPE_FLOAT },
+        { "double", 6, -1, GP_TYPE_DOUBLE },
+        { "vec2", 4, -1, GP_TYPE_VEC2 },
+        { "vec3", 4, -1, GP_TYPE_VEC3 },
+        { "vec4", 4, -1, GP_TYPE_VEC4 },
+        { "mat2", 4, -1, GP_TYPE_MAT2 },
+        { "mat3", 4, -1, GP_TYPE_MAT3 },
+        { "mat4", 4, -1, GP_TYPE_MAT4 },
+        { "sampler2D", 9, -1, GP_TYPE_SAMPLER2D },
+        { "dvec2", 5, -1, GP_TYPE_DVEC2 },
+        { "dvec3", 5, -1, GP_TYPE_DVEC3 },
+        { "dvec4", 5, -1, GP_TYPE_DVEC4 },
+        { "bvec2", 5, -1, GP_TYPE_BVEC2 },
+        { "bvec3", 5, -1, GP_TYPE_BVEC3 },
+        { "bvec4", 5, -1, GP_TYPE_BVEC4 },
+        { "ivec2", 5, -1, GP_TYPE_IVEC2 },
+        { "ivec3", 5, -1, GP_TYPE_IVEC3 },
+        { "ivec4", 5, -1, GP_TYPE_IVEC4 },
+        { "uvec2", 5, -1, GP_TYPE_UVEC2 },
+        { "uvec3", 5, -1, GP_TYPE_UVEC3 },
+        { "uvec4", 5, -1, GP_TYPE_UVEC4 },
+        { "mat2x3", 6, -1, GP_TYPE_MAT2X3 },
+        { "mat2x4", 6, -1, GP_TYPE_MAT2X4 },
+        { "mat3x2", 6, -1, GP_TYPE_MAT3X2 },
+        { "mat3x4", 6, -1, GP_TYPE_MAT3X4 },
+        { "mat4x2", 6, -1, GP_TYPE_MAT4X2 },
+        { "mat4x3", 6, -1, GP_TYPE_MAT4X3 },
+        { "dmat2", 5, -1, GP_TYPE_DMAT2 },
+        { "dmat3", 5, -1, GP_TYPE_DMAT3 },
+        { "dmat4", 5, -1, GP_TYPE_DMAT4 },
+        { "dmat2x3", 7, -1, GP_TYPE_DMAT2X3 },
+        { "dmat2x4", 7, -1, GP_TYPE_DMAT2X4 },
+        { "dmat3x2", 7, -1, GP_TYPE_DMAT3X2 },
+        { "dmat3x4", 7, -1, GP_TYPE_DMAT3X4 },
+        { "dmat4x2", 7, -1, GP_TYPE_DMAT4X2 },
+        { "dmat4x3", 7, -1, GP_TYPE_DMAT4X3 },
+        { "sampler1D", 9, -1, GP_TYPE_SAMPLER1D },
+        { "sampler3D", 9, -1, GP_TYPE_SAMPLER3D },
+        { "samplerCube", 11, -1, GP_TYPE_SAMPLERCUBE },
+        { "sampler1DArray", 14, -1, GP_TYPE_SAMPLER1DARRAY },
+        { "sampler2DArray", 14, -1, GP_TYPE_SAMPLER2DARRAY },
+        { "samplerCubeArray", 16, -1, GP_TYPE_SAMPLERCUBEARRAY },
+        { "sampler2DRect", 13, -1, GP_TYPE_SAMPLER2DRECT },
+        { "samplerBuffer", 13, -1, GP_TYPE_SAMPLERBUFFER },
+        { "sampler2DMS", 11, -1, GP_TYPE_SAMPLER2DMS },
+        { "sampler2DMSArray", 16, -1, GP_TYPE_SAMPLER2DMSARRAY },
+        { "sampler1DShadow", 15, -1, GP_TYPE_SAMPLER1DSHADOW },
+        { "sampler2DShadow", 15, -1, GP_TYPE_SAMPLER2DSHADOW },
+        { "samplerCubeShadow", 17, -1, GP_TYPE_SAMPLERCUBESHADOW },
+        { "sampler1DArrayShadow", 20, -1, GP_TYPE_SAMPLER1DARRAYSHADOW },
+        { "sampler2DArrayShadow", 20, -1, GP_TYPE_SAMPLER2DARRAYSHADOW },
+        { "samplerCubeArrayShadow", 22, -1, GP_TYPE_SAMPLERCUBEARRAYSHADOW },
+        { "sampler2DRectShadow", 19, -1, GP_TYPE_SAMPLER2DRECTSHADOW },
+        { "isampler1D", 10, -1, GP_TYPE_ISAMPLER1D },
+        { "isampler2D", 10, -1, GP_TYPE_ISAMPLER2D },
+        { "isampler3D", 10, -1, GP_TYPE_ISAMPLER3D },
+        { "isamplerCube", 12, -1, GP_TYPE_ISAMPLERCUBE },
+        { "isampler1DArray", 15, -1, GP_TYPE_ISAMPLER1DARRAY },
+        { "isampler2DArray", 15, -1, GP_TYPE_ISAMPLER2DARRAY },
+        { "isamplerCubeArray", 17, -1, GP_TYPE_ISAMPLERCUBEARRAY },
+        { "isampler2DRect", 14, -1, GP_TYPE_ISAMPLER2DRECT },
+        { "isamplerBuffer", 14, -1, GP_TYPE_ISAMPLERBUFFER },
+        { "isampler2DMS", 12, -1, GP_TYPE_ISAMPLER2DMS },
+        { "isampler2DMSArray", 17, -1, GP_TYPE_ISAMPLER2DMSARRAY },
+        { "usampler1D", 10, -1, GP_TYPE_USAMPLER1D },
+        { "usampler2D", 10, -1, GP_TYPE_USAMPLER2D },
+        { "usampler3D", 10, -1, GP_TYPE_USAMPLER3D },
+        { "usamplerCube", 12, -1, GP_TYPE_USAMPLERCUBE },
+        { "usampler1DArray", 15, -1, GP_TYPE_USAMPLER1DARRAY },
+        { "usampler2DArray", 15, -1, GP_TYPE_USAMPLER2DARRAY },
+        { "usamplerCubeArray", 17, -1, GP_TYPE_USAMPLERCUBEARRAY },
+        { "usampler2DRect", 14, -1, GP_TYPE_USAMPLER2DRECT },
+        { "usamplerBuffer", 14, -1, GP_TYPE_USAMPLERBUFFER },
+        { "usampler2DMS", 12, -1, GP_TYPE_USAMPLER2DMS },
+        { "usampler2DMSArray", 17, -1, GP_TYPE_USAMPLER2DMSARRAY },
+        { "image1D", 7, -1, GP_TYPE_IMAGE1D },
+        { "image2D", 7, -1, GP_TYPE_IMAGE2D },
+        { "image3D", 7, -1, GP_TYPE_IMAGE3D },
+        { "imageCube", 9, -1, GP_TYPE_IMAGECUBE },
+        { "image1DArray", 12, -1, GP_TYPE_IMAGE1DARRAY },
+        { "image2DArray", 12, -1, GP_TYPE_IMAGE2DARRAY },
+        { "imageCubeArray", 14, -1, GP_TYPE_IMAGECUBEARRAY },
+        { "image2DRect", 11, -1, GP_TYPE_IMAGE2DRECT },
+        { "imageBuffer", 11, -1, GP_TYPE_IMAGEBUFFER },
+        { "image2DMS", 9, -1, GP_TYPE_IMAGE2DMS },
+        { "image2DMSArray", 14, -1, GP_TYPE_IMAGE2DMSARRAY },
+        { "iimage1D", 8, -1, GP_TYPE_IIMAGE1D },
+        { "iimage2D", 8, -1, GP_TYPE_IIMAGE2D },
+        { "iimage3D", 8, -1, GP_TYPE_IIMAGE3D },
+        { "iimageCube", 10, -1, GP_TYPE_IIMAGECUBE },
+        { "iimage1DArray", 13, -1, GP_TYPE_IIMAGE1DARRAY },
+        { "iimage2DArray", 13, -1, GP_TYPE_IIMAGE2DARRAY },
+        { "iimageCubeArray", 15, -1, GP_TYPE_IIMAGECUBEARRAY },
+        { "iimage2DRect", 12, -1, GP_TYPE_IIMAGE2DRECT },
+        { "iimageBuffer", 12, -1, GP_TYPE_IIMAGEBUFFER },
+        { "iimage2DMS", 10, -1, GP_TYPE_IIMAGE2DMS },
+        { "iimage2DMSArray", 15, -1, GP_TYPE_IIMAGE2DMSARRAY },
+        { "uimage1D", 8, -1, GP_TYPE_UIMAGE1D },
+        { "uimage2D", 8, -1, GP_TYPE_UIMAGE2D },
+        { "uimage3D", 8, -1, GP_TYPE_UIMAGE3D },
+        { "uimageCube", 10, -1, GP_TYPE_UIMAGECUBE },
+        { "uimage1DArray", 13, -1, GP_TYPE_UIMAGE1DARRAY },
+        { "uimage2DArray", 13, -1, GP_TYPE_UIMAGE2DARRAY },
+        { "uimageCubeArray", 15, -1, GP_TYPE_UIMAGECUBEARRAY },
+        { "uimage2DRect", 12, -1, GP_TYPE_UIMAGE2DRECT },
+        { "uimageBuffer", 12, -1, GP_TYPE_UIMAGEBUFFER },
+        { "uimage2DMS", 10, -1, GP_TYPE_UIMAGE2DMS },
+        { "uimage2DMSArray", 15, -1, GP_TYPE_UIMAGE2DMSARRAY },
+        { "atomic_uint", 11, -1, GP_TYPE_ATOMIC_UINT },
+        { "mat2x2", 6, -1, GP_TYPE_MAT2 },
+        { "mat3x3", 6, -1, GP_TYPE_MAT3 },
+        { "mat4x4", 6, -1, GP_TYPE_MAT4 },
+        { "dmat2x2", 7, -1, GP_TYPE_DMAT2 },
+        { "dmat3x3", 7, -1, GP_TYPE_DMAT3 },
+        { "dmat4x4", 7, -1, GP_TYPE_DMAT4 },
+};
+
+const unsigned char gp_keywordHashTable[GP_KEYWORD_HASH_SIZE] = {
+        0, 0, 66, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 117, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 125, 0, 0, 0, 0,
+        0, 0, 0, 0, 52, 0, 0, 0, 0, 0, 0, 0, 0, 139, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 113, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 107, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 67, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 160,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 41,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 21, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 140, 0,
+        111, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 38, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 68, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 65, 0, 88, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        148, 0, 0, 0, 0, 83, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 104, 0, 0, 0,
+        0, 0, 7, 0, 0, 0, 91, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 30, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 45, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 75, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 13, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        49, 0, 0, 26, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        130, 0, 0, 0, 0, 0, 0, 0, 0, 0, 82, 0, 119, 0, 0, 0,
+        90, 0, 0, 0, 0, 0, 0, 43, 109, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 29, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 137, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 144, 0, 0, 0, 158, 0,
+        122, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 80, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 22, 0, 103, 142, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 138, 0, 0, 2, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 134, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 40, 0, 0, 0, 58, 0, 0, 0, 0, 0, 0,
+        5, 0, 135, 0, 0, 0, 0, 0, 0, 0, 86, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 98, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 78, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 102, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 151, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 100,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 12,
+        0, 0, 0, 0, 0, 0, 62, 0, 0, 0, 0, 94, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 118, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 141, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 157,
+        108, 0, 0, 0, 120, 79, 0, 0, 153, 0, 0, 0, 0, 0, 0, 84,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        147, 0, 0, 0, 0, 0, 0, 0, 25, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 154, 0, 0, 48, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 112, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 121, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 20, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 101, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 74, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 93, 0,
+        0, 0, 0, 0, 0, 0, 24, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 77, 0, 0, 0, 85, 70, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 33, 0, 0, 0, 0, 0, 126, 0, 0,
+        0, 0, 87, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 31, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 105,
+        0, 0, 0, 0, 0, 0, 0, 143, 0, 131, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 159, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 124,
+        0, 0, 115, 0, 0, 0, 0, 0, 0, 0, 0, 55, 0, 0, 0, 0,
+        0, 0, 73, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 15,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 11, 0, 0, 0, 0, 0, 0,
+        0, 32, 136, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 16, 97, 0, 0, 0, 14, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 37, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 60, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 92, 0, 0, 0, 0, 81, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 46, 0, 0, 0, 0, 0, 23,
+        0, 71, 50, 0, 0, 0, 0, 0, 0, 99, 0, 0, 0, 0, 0, 9,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 63, 0, 0, 156, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 54, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 39, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 61, 0, 0, 0, 0, 0, 0, 128, 0, 0, 0, 0, 0,
+        69, 0, 0, 132, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 129, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 57, 0, 0, 145, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 96, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 44, 0, 0, 4,
+        0, 0, 17, 0, 0, 76, 95, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 10, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 53, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        18, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 42, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 28, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 89, 0, 0, 0, 146,
+        0, 0, 0, 0, 35, 0, 0, 0, 0, 0, 0, 72, 0, 0, 0, 110,
+        0, 0, 19, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 123, 161, 0,
+        162, 0, 0, 0, 0, 0, 0, 0, 0, 47, 0, 0, 114, 0, 0, 0,
+        116, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 0, 0, 0, 0, 0,
+        0, 0, 0, 27, 0, 0, 0, 0, 59, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 150, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 34, 149, 64, 0, 0, 0, 0, 0, 0,
+        8, 0, 0, 0, 0, 51, 133, 155, 0, 127, 0, 0, 0, 0, 152, 0,
+        0, 0, 0, 36, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 56, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 106, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
@@ -0,0 +1,170 @@
+#include <glsl-processor/defs.h>
+#include <glsl-processor/logging.h>
+#include <glsl-processor/memory.h>
+#include <glsl-processor/layout.h>
+#include <glsl-processor/parse.h>
+
+static const struct {
+        unsigned char componentTypeKind;
+        unsigned char numColumns;  // 0 if the type is opaque
+        unsigned char numRows;
+} typeShapes[GP_NUM_TYPE_KINDS] = {
+#define SHAPE(t, c, n, m) [t] = { c, n, m }
+        SHAPE(GP_TYPE_BOOL, GP_TYPE_BOOL, 1, 1),
+        SHAPE(GP_TYPE_INT, GP_TYPE_INT, 1, 1),
+        SHAPE(GP_TYPE_UINT, GP_TYPE_UINT, 1, 1),
+        SHAPE(GP_TYPE_FLOAT, GP_TYPE_FLOAT, 1, 1),
+        SHAPE(GP_TYPE_DOUBLE, GP_TYPE_DOUBLE, 1, 1),
+        SHAPE(GP_TYPE_VEC2, GP_TYPE_FLOAT, 1, 2),
+        SHAPE(GP_TYPE_VEC3, GP_TYPE_FLOAT, 1, 3),
+        SHAPE(GP_TYPE_VEC4, GP_TYPE_FLOAT, 1, 4),
+        SHAPE(GP_TYPE_DVEC2, GP_TYPE_DOUBLE, 1, 2),
+        SHAPE(GP_TYPE_DVEC3, GP_TYPE_DOUBLE, 1, 3),
+        SHAPE(GP_TYPE_DVEC4, GP_TYPE_DOUBLE, 1, 4),
+        SHAPE(GP_TYPE_BVEC2, GP_TYPE_BOOL, 1, 2),
+        SHAPE(GP_TYPE_BVEC3, GP_TYPE_BOOL, 1, 3),
+        SHAPE(GP_TYPE_BVEC4, GP_TYPE_BOOL, 1, 4),
+        SHAPE(GP_TYPE_IVEC2, GP_TYPE_INT, 1, 2),
+        SHAPE(GP_TYPE_IVEC3, GP_TYPE_INT, 1, 3),
+        SHAPE(GP_TYPE_IVEC4, GP_TYPE_INT, 1, 4),
+        SHAPE(GP_TYPE_UVEC2, GP_TYPE_UINT, 1, 2),
+        SHAPE(GP_TYPE_UVEC3, GP_TYPE_UINT, 1, 3),
+        SHAPE(GP_TYPE_UVEC4, GP_TYPE_UINT, 1, 4),
+        SHAPE(GP_TYPE_MAT2, GP_TYPE_FLOAT, 2, 2),
+        SHAPE(GP_TYPE_MAT3, GP_TYPE_FLOAT, 3, 3),
+        SHAPE(GP_TYPE_MAT4, GP_TYPE_FLOAT, 4, 4),
+        SHAPE(GP_TYPE_MAT2X3, GP_TYPE_FLOAT, 2, 3),
+        SHAPE(GP_TYPE_MAT2X4, GP_TYPE_FLOAT, 2, 4),
+        SHAPE(GP_TYPE_MAT3X2, GP_TYPE_FLOAT, 3, 2),
+        SHAPE(GP_TYPE_MAT3X4, GP_TYPE_FLOAT, 3, 4),
+        SHAPE(GP_TYPE_MAT4X2, GP_TYPE_FLOAT, 4, 2),
+        SHAPE(GP_TYPE_MAT4X3, GP_TYPE_FLOAT, 4, 3),
+        SHAPE(GP_TYPE_DMAT2, GP_TYPE_DOUBLE, 2, 2),
+        SHAPE(GP_TYPE_DMAT3, GP_TYPE_DOUBLE, 3, 3),
+        SHAPE(GP_TYPE_DMAT4, GP_TYPE_DOUBLE, 4, 4),
+        SHAPE(GP_TYPE_DMAT2X3, GP_TYPE_DOUBLE, 2, 3),
+        SHAPE(GP_TYPE_DMAT2X4, GP_TYPE_DOUBLE, 2, 4),
+        SHAPE(GP_TYPE_DMAT3X2, GP_TYPE_DOUBLE, 3, 2),
+        SHAPE(GP_TYPE_DMAT3X4, GP_TYPE_DOUBLE, 3, 4),
+        SHAPE(GP_TYPE_DMAT4X2, GP_TYPE_DOUBLE, 4, 2),
+        SHAPE(GP_TYPE_DMAT4X3, GP_TYPE_DOUBLE, 4, 3),
+#undef SHAPE
+};
+
+int gp_get_type_shape(int typeKind, int *componentTypeKind, int *numColumns, int *numRows)
+{
+        GP_ENSURE(0 <= typeKind && typeKind < GP_NUM_TYPE_KINDS);
+        if (typeShapes[typeKind].numColumns == 0)
+                return 0;
+        *componentTypeKind = typeShapes[typeKind].componentTypeKind;
+        *numColumns = typeShapes[typeKind].numColumns;
+        *numRows = typeShapes[typeKind].numRows;
+        return 1;
+}
+
+static int round_up(int x, int alignment)
+{
+        return (x + alignment - 1) / alignment * alignment;
+}
+
+enum {
+        VEC4_ALIGNMENT = 16,  // std140 rounds the alignment of arrays and matrices up to this
+};
+
+static void compute_member_layout(struct GP_BlockMember *member, int isStd140)
+{
+        int componentTypeKind;
+        int numColumns;
+        int numRows;
+        if (!gp_get_type_shape(member->typeKind, &componentTypeKind, &numColumns, &numRows))
+                gp_fatal_f("Unhandled type kind %d", member->typeKind);
+        int componentSize = componentTypeKind == GP_TYPE_DOUBLE ? 8 : 4;  // bools take 4 bytes, too
+        // a matrix is an array of vectors: its columns, or its rows if it is row-major
+        int numVectors = member->isRowMajor ? numRows : numColumns;
+        int vectorLength = member->isRowMajor ? numColumns : numRows;
+        int vectorAlignment = (vectorLength == 1 ? 1 : vectorLength == 2 ? 2 : 4) * componentSize;
+        if (numColumns > 1) {
+                int stride = isStd140 ? round_up(vectorAlignment, VEC4_ALIGNMENT) : vectorAlignment;
+                member->alignment = stride;
+                member->size = numVectors * stride;
+                member->matrixStride = stride;
+        }
+        else {
+                member->alignment = vectorAlignment;
+                member->size = vectorLength * componentSize;
+                member->matrixStride = 0;
+        }
+        member->arrayStride = 0;
+        if (member->arrayLength != 0) {
+                if (isStd140)
+                        member->alignment = round_up(member->alignment, VEC4_ALIGNMENT);
+                member->arrayStride = round_up(member->size, member->alignment);
+                member->size = member->arrayLength == -1 ? 0 : member->arrayLength * member->arrayStride;
+        }
+}
+
+int gp_compute_block_layout(struct GP_BlockDecl *block)
+{
+        if (block->layoutKind != GP_BLOCK_LAYOUT_STD140 && block->layoutKind != GP_BLOCK_LAYOUT_STD430) {
+                for (int i = 0; i < block->numMembers; i++) {
+                        struct GP_BlockMember *member = &block->members[i];
+                        member->offset = -1;
+                        member->alignment = -1;
+                        member->size = -1;
+                        member->arrayStride = -1;
+                        member->matrixStride = -1;
+                }
+                block->size = -1;
+                return -1;
+        }
+        int isStd140 = block->layoutKind == GP_BLOCK_LAYOUT_STD140;
+        int offset = 0;
+        // the block is laid out like a structure. In std140, that is aligned like a vec4
+        int blockAlignment = isStd140 ? VEC4_ALIGNMENT : 1;
+        for (int i = 0; i < block->numMembers; i++) {
+                struct GP_BlockMember *member = &block->members[i];
+                compute_member_layout(member, isStd140);
+                // "offset" must be a multiple of the base alignment, "align" only rounds the offset up
+                if (member->explicitOffset != -1) {
+                        if (member->explicitOffset % member->alignment != 0 || member->explicitOffset < offset)
+                                return i;
+                        offset = member->explicitOffset;
+                }
+                if (member->explicitAlignment > member->alignment)
+                        member->alignment = member->explicitAlignment;
+                member->offset = round_up(offset, member->alignment);
+                offset = member->offset + member->size;
+                if (blockAlignment < member->alignment)
+                        blockAlignment = member->alignment;
+        }
+        int lastIsRuntimeSized = block->numMembers > 0 && block->members[block->numMembers - 1].arrayLength == -1;
+        block->size = lastIsRuntimeSized ? offset : round_up(offset, blockAlignment);
+        return -1;
+}
+
+void gp_compute_vertex_layout(struct GP_ProgramAttribute *attributes, int numAttributes)
+{
+        int offset = 0;
+        int vertexAlignment = 1;
+        // first the attributes with 8 byte components, then those with 4 byte components
+        for (int pass = 0; pass < 2; pass++) {
+                for (int i = 0; i < numAttributes; i++) {
+                        struct GP_ProgramAttribute *attribute = &attributes[i];
+                        int componentTypeKind;
+                        int numColumns;
+                        int numRows;
+                        if (!gp_get_type_shape(attribute->typeKind, &componentTypeKind, &numColumns, &numRows))
+                                gp_fatal_f("Attribute '%s' has a type that can't be in a vertex buffer", attribute->attributeName);
+                        int componentSize = componentTypeKind == GP_TYPE_DOUBLE ? 8 : 4;
+                        if ((componentSize == 8) != (pass == 0))
+                                continue;
+                        attribute->offset = round_up(offset, componentSize);
+                        offset = attribute->offset + numColumns * numRows * componentSize;
+                        if (vertexAlignment < componentSize)
+                                vertexAlignment = componentSize;
+                }
+        }
+        int vertexSize = round_up(offset, vertexAlignment);
+        for (int i = 0; i < numAttributes; i++)
+                attributes[i].vertexSize = vertexSize;
+}
@@ -0,0 +1,308 @@
+#include <glsl-processor/defs.h>
+#include <glsl-processor/logging.h>
+#include <glsl-processor/memory.h>
+#include <glsl-processor/literal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+        /* The significand of a decimal literal is accumulated in an
+         * unsigned long long. Further digits are only counted. */
+        MAX_SIGNIFICAND_DIGITS = 19,
+        /* Any nonzero value overflows or underflows with a larger exponent.
+         * Larger exponents are clamped, such that they don't overflow. */
+        MAX_DECIMAL_EXPONENT = 100000,
+        MAX_FLOAT_DIGITS = 9,  // enough to tell all floats apart
+        MAX_DOUBLE_DIGITS = 17,
+};
+
+/* The powers of ten that are exact in a double (5^22 < 2^53) and in a float
+ * (5^10 < 2^24). If the significand is exact, too, a single multiplication or
+ * division gives the correctly rounded result. */
+static const double exactPowersOfTen[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+static const float exactFloatPowersOfTen[] = {
+        1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f,
+};
+
+static int is_digit(char c)
+{
+        return '0' <= c && c <= '9';
+}
+
+static int parse_integer(const char *p, const char *end, double *value)
+{
+        int base = 10;
+        if (end - p >= 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+                base = 16;
+                p += 2;
+        }
+        else if (p[0] == '0') {
+                base = 8;
+        }
+        unsigned long long d = 0;
+        int numDigits = 0;
+        for (; p < end; p++) {
+                int digit;
+                if (is_digit(*p))
+                        digit = *p - '0';
+                else if (base == 16 && 'a' <= *p && *p <= 'f')
+                        digit = *p - 'a' + 10;
+                else if (base == 16 && 'A' <= *p && *p <= 'F')
+                        digit = *p - 'A' + 10;
+                else
+                        break;
+                if (digit >= base)
+                        return -1;
+                d = d * base + digit;
+                if (d > 0xFFFFFFFFull)
+                        return -1;
+                numDigits++;
+        }
+        if (numDigits == 0)
+                return -1;
+        int literalKind = GP_LITERAL_INT;
+        if (p < end && (*p == 'u' || *p == 'U')) {
+                literalKind = GP_LITERAL_UINT;
+                p++;
+        }
+        if (p != end)
+                return -1;
+        // an int has the bit pattern of the literal, 0xFFFFFFFF is -1
+        if (literalKind == GP_LITERAL_INT)
+                *value = (double) (int) (unsigned) d;
+        else
+                *value = (double) d;
+        return literalKind;
+}
+
+/* The slow path: the C library converts the digits. They are passed without
+ * the decimal point, since strtod() would expect the one of the locale. */
+static double convert_digits_slowly(const char *text, const char *digitsEnd, int exponent, int literalKind)
+{
+        char smallBuffer[128];
+        char *buffer = smallBuffer;
+        int size = (int) (digitsEnd - text) + 16;
+        if (size > (int) sizeof smallBuffer)
+                ALLOC_MEMORY(&buffer, size);
+        int length = 0;
+        for (const char *p = text; p < digitsEnd; p++)
+                if (is_digit(*p))
+                        buffer[length++] = *p;
+        snprintf(buffer + length, 16, "e%d", exponent);
+        double value;
+        if (literalKind == GP_LITERAL_FLOAT)
+                value = strtof(buffer, NULL);
+        else
+                value = strtod(buffer, NULL);
+        if (buffer != smallBuffer)
+                FREE_MEMORY(&buffer);
+        return value;
+}
+
+static int parse_floating(const char *text, const char *end, double *value)
+{
+        const char *p = text;
+        unsigned long long significand = 0;
+        int numSignificantDigits = 0;
+        int isTruncated = 0;  // a nonzero digit did not fit in the significand
+        int numDigits = 0;
+        int numDigitsAfterDot = 0;
+        int haveDot = 0;
+        int exponent = 0;  // the value is significand * 10^exponent
+        for (; p < end; p++) {
+                if (is_digit(*p)) {
+                        numDigits++;
+                        if (haveDot)
+                                numDigitsAfterDot++;
+                        if (numSignificantDigits == 0 && *p == '0') {
+                                if (haveDot)
+                                        exponent--;
+                        }
+                        else if (numSignificantDigits < MAX_SIGNIFICAND_DIGITS) {
+                                significand = 10 * significand + (*p - '0');
+                                numSignificantDigits++;
+                                if (haveDot)
+                                        exponent--;
+                        }
+                        else {
+                                numSignificantDigits++;
+                                isTruncated |= *p != '0';
+                                if (!haveDot)
+                                        exponent++;
+                        }
+                }
+                else if (*p == '.' && !haveDot) {
+                        haveDot = 1;
+                }
+                else {
+                        break;
+                }
+        }
+        if (numDigits == 0)
+                return -1;
+        const char *digitsEnd = p;
+        int haveExponent = 0;
+        int explicitExponent = 0;
+        if (p < end && (*p == 'e' || *p == 'E')) {
+                p++;
+                int sign = 1;
+                if (p < end && (*p == '+' || *p == '-')) {
+                        if (*p == '-')
+                                sign = -1;
+                        p++;
+                }
+                if (p == end || !is_digit(*p))
+                        return -1;
+                for (; p < end && is_digit(*p); p++)
+                        if (explicitExponent < MAX_DECIMAL_EXPONENT)
+                                explicitExponent = 10 * explicitExponent + (*p - '0');
+                explicitExponent *= sign;
+                haveExponent = 1;
+        }
+        if (!haveDot && !haveExponent)
+                return -1;
+        int literalKind = GP_LITERAL_FLOAT;
+        if (p < end && (*p == 'f' || *p == 'F')) {
+                p++;
+        }
+        else if (end - p >= 2 && ((p[0] == 'l' && p[1] == 'f') || (p[0] == 'L' && p[1] == 'F'))) {
+                literalKind = GP_LITERAL_DOUBLE;
+                p += 2;
+        }
+        if (p != end)
+                return -1;
+
+        exponent += explicitExponent;
+        if (significand == 0) {
+                *value = 0.0;
+        }
+        else if (literalKind == GP_LITERAL_FLOAT && !isTruncated && significand <= (1ull << 24)
+                 && -10 <= exponent && exponent <= 10) {
+                float f = (float) significand;
+                if (exponent < 0)
+                        f /= exactFloatPowersOfTen[-exponent];
+                else
+                        f *= exactFloatPowersOfTen[exponent];
+                *value = f;
+        }
+        else if (literalKind == GP_LITERAL_DOUBLE && !isTruncated && significand <= (1ull << 53)
+                 && -22 <= exponent && exponent <= 22) {
+                double d = (double) significand;
+                if (exponent < 0)
+                        d /= exactPowersOfTen[-exponent];
+                else
+                        d *= exactPowersOfTen[exponent];
+                *value = d;
+        }
+        else {
+                *value = convert_digits_slowly(text, digitsEnd, explicitExponent - numDigitsAfterDot, literalKind);
+        }
+        return literalKind;
+}
+
+int gp_parse_literal(const char *text, int length, double *value)
+{
+        const char *end = text + length;
+        if (length == 0)
+                return -1;
+        if (length >= 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X'))
+                return parse_integer(text, end, value);
+        const char *p = text;
+        while (p < end && is_digit(*p))
+                p++;
+        if (p == end || *p == 'u' || *p == 'U')
+                return parse_integer(text, end, value);
+        return parse_floating(text, end, value);
+}
+
+static int is_negative(double value)
+{
+        return value < 0.0 || (value == 0.0 && 1.0 / value < 0.0);
+}
+
+/* Writes the value, rounded to numDigits significant digits, as a GLSL
+ * literal without suffix. */
+static int format_decimal(double value, int numDigits, char *buffer)
+{
+        char scratch[64];
+        snprintf(scratch, sizeof scratch, "%.*e", numDigits - 1, is_negative(value) ? -value : value);
+        // the digits, and the exponent after the 'e'
+        char digits[MAX_DOUBLE_DIGITS + 1];
+        int numWritten = 0;
+        const char *p = scratch;
+        for (; *p != 'e'; p++)
+                if (is_digit(*p) && numWritten < numDigits)
+                        digits[numWritten++] = *p;
+        int exponent = atoi(p + 1);
+        while (numWritten > 1 && digits[numWritten - 1] == '0')
+                numWritten--;
+
+        int length = 0;
+        if (is_negative(value))
+                buffer[length++] = '-';
+        if (exponent < -5 || exponent >= 16) {
+                buffer[length++] = digits[0];
+                buffer[length++] = '.';
+                if (numWritten == 1)
+                        buffer[length++] = '0';
+                for (int i = 1; i < numWritten; i++)
+                        buffer[length++] = digits[i];
+                length += snprintf(buffer + length, GP_LITERAL_BUFFER_SIZE - length, "e%d", exponent);
+        }
+        else if (exponent < 0) {
+                buffer[length++] = '0';
+                buffer[length++] = '.';
+                for (int i = 0; i < -exponent - 1; i++)
+                        buffer[length++] = '0';
+                for (int i = 0; i < numWritten; i++)
+                        buffer[length++] = digits[i];
+        }
+        else {
+                for (int i = 0; i <= exponent; i++)
+                        buffer[length++] = i < numWritten ? digits[i] : '0';
+                buffer[length++] = '.';
+                if (numWritten <= exponent + 1)
+                        buffer[length++] = '0';
+                for (int i = exponent + 1; i < numWritten; i++)
+                        buffer[length++] = digits[i];
+        }
+        return length;
+}
+
+int gp_format_literal(int literalKind, double value, char *buffer)
+{
+        switch (literalKind) {
+        case GP_LITERAL_INT:
+                GP_ENSURE(-2147483648.0 <= value && value <= 2147483647.0);
+                return snprintf(buffer, GP_LITERAL_BUFFER_SIZE, "%d", (int) value);
+        case GP_LITERAL_UINT:
+                GP_ENSURE(0.0 <= value && value <= 4294967295.0);
+                return snprintf(buffer, GP_LITERAL_BUFFER_SIZE, "%uu", (unsigned) value);
+        case GP_LITERAL_FLOAT:
+        case GP_LITERAL_DOUBLE: {
+                GP_ENSURE(value - value == 0.0);  // finite
+                int maxDigits = literalKind == GP_LITERAL_FLOAT ? MAX_FLOAT_DIGITS : MAX_DOUBLE_DIGITS;
+                // the shortest text that converts back to the value
+                for (int numDigits = 1;; numDigits++) {
+                        int length = format_decimal(value, numDigits, buffer);
+                        if (literalKind == GP_LITERAL_DOUBLE) {
+                                buffer[length++] = 'l';
+                                buffer[length++] = 'f';
+                        }
+                        int sign = buffer[0] == '-';
+                        double parsed;
+                        if (numDigits == maxDigits
+                            || (gp_parse_literal(buffer + sign, length - sign, &parsed) == literalKind
+                                && parsed == (sign ? -value : value)))
+                                return length;
+                }
+        }
+        default:
+                gp_fatal_f("Unhandled literal kind %d", literalKind);
+        }
+}
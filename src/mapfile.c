@@ -0,0 +1,84 @@
+#if !defined(_WIN32)
+#define _DEFAULT_SOURCE  // for mmap() and posix_madvise()
+#endif
+
+#include <glsl-processor/defs.h>
+#include <glsl-processor/logging.h>
+#include <glsl-processor/mapfile.h>
+#include <limits.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+void gp_map_file(struct GP_MappedFile *mappedFile, const char *filepath)
+{
+        HANDLE file = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, NULL,
+                                  OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+                gp_fatal_f("Failed to open file '%s'", filepath);
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size))
+                gp_fatal_f("Failed to get the size of file '%s'", filepath);
+        if (size.QuadPart > INT_MAX)
+                gp_fatal_f("File '%s' is too large", filepath);
+        mappedFile->data = NULL;
+        mappedFile->size = (int) size.QuadPart;
+        if (mappedFile->size > 0) {
+                // the view keeps the mapping alive, the handles can be closed
+                HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+                if (mapping == NULL)
+                        gp_fatal_f("Failed to map file '%s'", filepath);
+                mappedFile->data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                if (mappedFile->data == NULL)
+                        gp_fatal_f("Failed to map file '%s'", filepath);
+                CloseHandle(mapping);
+        }
+        CloseHandle(file);
+}
+
+void gp_unmap_file(struct GP_MappedFile *mappedFile)
+{
+        if (mappedFile->data)
+                UnmapViewOfFile(mappedFile->data);
+        memset(mappedFile, 0, sizeof *mappedFile);
+}
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+void gp_map_file(struct GP_MappedFile *mappedFile, const char *filepath)
+{
+        int fd = open(filepath, O_RDONLY);
+        if (fd == -1)
+                gp_fatal_f("Failed to open file '%s': %s", filepath, strerror(errno));
+        struct stat st;
+        if (fstat(fd, &st) == -1)
+                gp_fatal_f("Failed to stat file '%s': %s", filepath, strerror(errno));
+        if (st.st_size > INT_MAX)
+                gp_fatal_f("File '%s' is too large", filepath);
+        mappedFile->data = NULL;
+        mappedFile->size = (int) st.st_size;
+        // mmap() doesn't accept a length of 0
+        if (mappedFile->size > 0) {
+                void *data = mmap(NULL, mappedFile->size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data == MAP_FAILED)
+                        gp_fatal_f("Failed to map file '%s': %s", filepath, strerror(errno));
+                // the parser reads the file front to back
+                posix_madvise(data, mappedFile->size, POSIX_MADV_SEQUENTIAL);
+                mappedFile->data = data;
+        }
+        close(fd);
+}
+
+void gp_unmap_file(struct GP_MappedFile *mappedFile)
+{
+        if (mappedFile->data)
+                munmap((void *) mappedFile->data, mappedFile->size);
+        memset(mappedFile, 0, sizeof *mappedFile);
+}
+#endif
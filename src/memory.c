@@ -1,6 +1,7 @@
 #include <glsl-processor/logging.h>
 #include <glsl-processor/memory.h>
 #include <stdlib.h>
+#include <string.h>
 
 void _gp_alloc_memory(struct GP_LogCtx logCtx, void **outPtr, size_t numElems, size_t elemSize)
 {
@@ -25,3 +26,120 @@ void _gp_free_memory(struct GP_LogCtx logCtx, void **inoutPtr)
         free(*inoutPtr);
         *inoutPtr = NULL;
 }
+
+enum {
+        ARENA_ALIGNMENT = 16,
+        ARENA_BLOCK_SIZE = 64 * 1024,
+};
+
+/* the data of a block starts after the (aligned) header */
+#define ARENA_HEADER_SIZE \
+        ((sizeof (struct GP_ArenaBlock) + ARENA_ALIGNMENT - 1) & ~(size_t) (ARENA_ALIGNMENT - 1))
+
+static size_t align_arena_size(size_t size)
+{
+        return (size + ARENA_ALIGNMENT - 1) & ~(size_t) (ARENA_ALIGNMENT - 1);
+}
+
+static char *get_block_data(struct GP_ArenaBlock *block)
+{
+        return (char *) block + ARENA_HEADER_SIZE;
+}
+
+void gp_arena_setup(struct GP_Arena *arena)
+{
+        memset(arena, 0, sizeof *arena);
+}
+
+void gp_arena_teardown(struct GP_Arena *arena)
+{
+        while (arena->blocks) {
+                struct GP_ArenaBlock *block = arena->blocks;
+                arena->blocks = block->next;
+                FREE_MEMORY(&block);
+        }
+        memset(arena, 0, sizeof *arena);
+}
+
+void gp_arena_reset(struct GP_Arena *arena)
+{
+        struct GP_ArenaBlock *current = arena->blocks;
+        if (current == NULL)
+                return;
+        while (current->next) {
+                struct GP_ArenaBlock *block = current->next;
+                current->next = block->next;
+                FREE_MEMORY(&block);
+        }
+        current->used = 0;
+        arena->numBytesAllocated = current->size;
+}
+
+void gp_arena_merge(struct GP_Arena *dst, struct GP_Arena *src)
+{
+        if (src->blocks == NULL)
+                return;
+        // the blocks of src go behind the current block of dst
+        struct GP_ArenaBlock *last = src->blocks;
+        while (last->next)
+                last = last->next;
+        if (dst->blocks == NULL) {
+                dst->blocks = src->blocks;
+        }
+        else {
+                last->next = dst->blocks->next;
+                dst->blocks->next = src->blocks;
+        }
+        dst->numBytesAllocated += src->numBytesAllocated;
+        memset(src, 0, sizeof *src);
+}
+
+void *_gp_arena_alloc(struct GP_LogCtx logCtx, struct GP_Arena *arena, size_t numElems, size_t elemSize)
+{
+        if (elemSize != 0 && numElems > ((size_t) -1 - ARENA_BLOCK_SIZE) / elemSize)
+                _gp_fatal_f(logCtx, "OOM!\n");
+        size_t numBytes = align_arena_size(numElems * elemSize);
+        struct GP_ArenaBlock *block = arena->blocks;
+        if (block == NULL || block->size - block->used < numBytes) {
+                size_t size = numBytes > ARENA_BLOCK_SIZE ? numBytes : ARENA_BLOCK_SIZE;
+                void *memory;
+                _gp_alloc_memory(logCtx, &memory, ARENA_HEADER_SIZE + size, 1);
+                struct GP_ArenaBlock *newBlock = memory;
+                newBlock->size = size;
+                newBlock->used = 0;
+                arena->numBytesAllocated += size;
+                /* Big allocations get a block of their own. It is full, so we
+                 * keep allocating from the current block. */
+                if (block != NULL && size > ARENA_BLOCK_SIZE) {
+                        newBlock->next = block->next;
+                        block->next = newBlock;
+                }
+                else {
+                        newBlock->next = block;
+                        arena->blocks = newBlock;
+                }
+                block = newBlock;
+        }
+        void *ptr = get_block_data(block) + block->used;
+        block->used += numBytes;
+        return ptr;
+}
+
+void *_gp_arena_realloc(struct GP_LogCtx logCtx, struct GP_Arena *arena, void *ptr, size_t oldNumElems, size_t newNumElems, size_t elemSize)
+{
+        struct GP_ArenaBlock *block = arena->blocks;
+        size_t oldNumBytes = align_arena_size(oldNumElems * elemSize);
+        if (ptr != NULL && block != NULL
+            && (char *) ptr + oldNumBytes == get_block_data(block) + block->used) {
+                size_t offset = (char *) ptr - get_block_data(block);
+                size_t newNumBytes = align_arena_size(newNumElems * elemSize);
+                if (newNumBytes <= block->size - offset) {
+                        block->used = offset + newNumBytes;
+                        return ptr;
+                }
+        }
+        void *newPtr = _gp_arena_alloc(logCtx, arena, newNumElems, elemSize);
+        if (ptr != NULL)
+                memcpy(newPtr, ptr, (oldNumElems < newNumElems ? oldNumElems : newNumElems) * elemSize);
+        return newPtr;
+}
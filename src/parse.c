@@ -1,428 +1,2683 @@
 #include <glsl-processor/defs.h>
 #include <glsl-processor/ast.h>
 #include <glsl-processor/parse.h>
+#include <glsl-processor/callgraph.h>
 #include <glsl-processor/memory.h>
 #include <glsl-processor/logging.h>
+#include <glsl-processor/scan.h>
+#include <glsl-processor/keywordhash.h>
+#include <glsl-processor/layout.h>
+#include <glsl-processor/literal.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
 
-static const struct {
-        int character;
-        int tokenKind;
-} tokInfo1[] = {
-        { '#', GP_TOKEN_HASH },
-        { '(', GP_TOKEN_LEFTPAREN },
-        { ')', GP_TOKEN_RIGHTPAREN },
-        { '{', GP_TOKEN_LEFTBRACE },
-        { '}', GP_TOKEN_RIGHTBRACE },
-        { '.', GP_TOKEN_DOT },
-        { ',', GP_TOKEN_COMMA },
-        { ';', GP_TOKEN_SEMICOLON },
-        { '%', GP_TOKEN_PERCENT },
-        { '!', GP_TOKEN_NOT },
+/* Character classes for the lexer. */
+enum {
+        CHAR_INVALID,
+        CHAR_SPACE,
+        CHAR_NAME,  // letters and underscore
+        CHAR_DIGIT,
+        CHAR_QUOTE,
+        CHAR_SLASH,  // start of a comment, or a punctuation token
+        CHAR_PUNCT,
 };
 
+/* Lexer table, indexed by (unsigned) character. For punctuation characters,
+ * tokenKind1 is the kind of the single-character token. If the next character
+ * is character2, the token is extended to the two-character token tokenKind2,
+ * and likewise for character3 and tokenKind3. */
 static const struct {
-        int character1;
-        int character2;
-        int tokenKind1;
-        int tokenKind2;
-} tokInfo2[] = {
-        { '<', '=', GP_TOKEN_LT, GP_TOKEN_LE },
-        { '>', '=', GP_TOKEN_GT, GP_TOKEN_GE },
-        { '=', '=', GP_TOKEN_EQUALS, GP_TOKEN_DOUBLEEQUALS },
-        { '&', '&', GP_TOKEN_AMPERSAND, GP_TOKEN_DOUBLEAMPERSAND },
-        { '|', '|', GP_TOKEN_PIPE, GP_TOKEN_DOUBLEPIPE },
-        { '+', '=', GP_TOKEN_PLUS, GP_TOKEN_PLUSEQUALS },
-        { '-', '=', GP_TOKEN_MINUS, GP_TOKEN_MINUSEQUALS },
-        { '*', '=', GP_TOKEN_STAR, GP_TOKEN_STAREQUALS },
-        { '/', '=', GP_TOKEN_SLASH, GP_TOKEN_SLASHEQUALS },
+        unsigned char charClass;
+        unsigned char nameChar;  // can be part of a name (after the 1st char)
+        unsigned char tokenKind1;
+        unsigned char character2;
+        unsigned char tokenKind2;
+        unsigned char character3;
+        unsigned char tokenKind3;
+} charInfo[256] = {
+#define SPACE { CHAR_SPACE }
+#define NAME(c) [c] = { CHAR_NAME, 1 }
+#define DIGIT(c) [c] = { CHAR_DIGIT, 1 }
+#define PUNCT1(c, k) [c] = { CHAR_PUNCT, 0, k }
+#define PUNCT2(c, k1, c2, k2) [c] = { CHAR_PUNCT, 0, k1, c2, k2 }
+#define PUNCT3(c, k1, c2, k2, c3, k3) [c] = { CHAR_PUNCT, 0, k1, c2, k2, c3, k3 }
+        /* control characters are treated as whitespace */
+        [0] = SPACE, [1] = SPACE, [2] = SPACE, [3] = SPACE, [4] = SPACE, [5] = SPACE,
+        [6] = SPACE, [7] = SPACE, [8] = SPACE, [9] = SPACE, [10] = SPACE, [11] = SPACE,
+        [12] = SPACE, [13] = SPACE, [14] = SPACE, [15] = SPACE, [16] = SPACE, [17] = SPACE,
+        [18] = SPACE, [19] = SPACE, [20] = SPACE, [21] = SPACE, [22] = SPACE, [23] = SPACE,
+        [24] = SPACE, [25] = SPACE, [26] = SPACE, [27] = SPACE, [28] = SPACE, [29] = SPACE,
+        [30] = SPACE, [31] = SPACE, [32] = SPACE,
+        NAME('a'), NAME('b'), NAME('c'), NAME('d'), NAME('e'), NAME('f'), NAME('g'), NAME('h'),
+        NAME('i'), NAME('j'), NAME('k'), NAME('l'), NAME('m'), NAME('n'), NAME('o'), NAME('p'),
+        NAME('q'), NAME('r'), NAME('s'), NAME('t'), NAME('u'), NAME('v'), NAME('w'), NAME('x'),
+        NAME('y'), NAME('z'),
+        NAME('A'), NAME('B'), NAME('C'), NAME('D'), NAME('E'), NAME('F'), NAME('G'), NAME('H'),
+        NAME('I'), NAME('J'), NAME('K'), NAME('L'), NAME('M'), NAME('N'), NAME('O'), NAME('P'),
+        NAME('Q'), NAME('R'), NAME('S'), NAME('T'), NAME('U'), NAME('V'), NAME('W'), NAME('X'),
+        NAME('Y'), NAME('Z'),
+        NAME('_'),
+        DIGIT('0'), DIGIT('1'), DIGIT('2'), DIGIT('3'), DIGIT('4'), DIGIT('5'), DIGIT('6'), DIGIT('7'),
+        DIGIT('8'), DIGIT('9'),
+        ['"'] = { CHAR_QUOTE },
+        ['/'] = { CHAR_SLASH, 0, GP_TOKEN_SLASH, '=', GP_TOKEN_SLASHEQUALS },
+        PUNCT1( '#', GP_TOKEN_HASH ),
+        PUNCT1( '(', GP_TOKEN_LEFTPAREN ),
+        PUNCT1( ')', GP_TOKEN_RIGHTPAREN ),
+        PUNCT1( '{', GP_TOKEN_LEFTBRACE ),
+        PUNCT1( '}', GP_TOKEN_RIGHTBRACE ),
+        PUNCT1( '.', GP_TOKEN_DOT ),
+        PUNCT1( ',', GP_TOKEN_COMMA ),
+        PUNCT1( ';', GP_TOKEN_SEMICOLON ),
+        PUNCT1( '%', GP_TOKEN_PERCENT ),
+        PUNCT1( '[', GP_TOKEN_LEFTBRACKET ),
+        PUNCT1( ']', GP_TOKEN_RIGHTBRACKET ),
+        PUNCT1( '?', GP_TOKEN_QUESTIONMARK ),
+        PUNCT1( ':', GP_TOKEN_COLON ),
+        PUNCT1( '^', GP_TOKEN_CARET ),
+        PUNCT1( '~', GP_TOKEN_TILDE ),
+        PUNCT2( '!', GP_TOKEN_NOT, '=', GP_TOKEN_NE ),
+        PUNCT3( '<', GP_TOKEN_LT, '=', GP_TOKEN_LE, '<', GP_TOKEN_LEFTSHIFT ),
+        PUNCT3( '>', GP_TOKEN_GT, '=', GP_TOKEN_GE, '>', GP_TOKEN_RIGHTSHIFT ),
+        PUNCT2( '=', GP_TOKEN_EQUALS, '=', GP_TOKEN_DOUBLEEQUALS ),
+        PUNCT2( '&', GP_TOKEN_AMPERSAND, '&', GP_TOKEN_DOUBLEAMPERSAND ),
+        PUNCT2( '|', GP_TOKEN_PIPE, '|', GP_TOKEN_DOUBLEPIPE ),
+        PUNCT3( '+', GP_TOKEN_PLUS, '=', GP_TOKEN_PLUSEQUALS, '+', GP_TOKEN_INCREMENT ),
+        PUNCT3( '-', GP_TOKEN_MINUS, '=', GP_TOKEN_MINUSEQUALS, '-', GP_TOKEN_DECREMENT ),
+        PUNCT2( '*', GP_TOKEN_STAR, '=', GP_TOKEN_STAREQUALS ),
+#undef SPACE
+#undef NAME
+#undef DIGIT
+#undef PUNCT1
+#undef PUNCT2
+#undef PUNCT3
+};
+
+#define CHAR_INFO(c) (&charInfo[(unsigned char) (c)])
+
+/* The kind and value of a token, as determined by lex_token_text() */
+struct GP_LexedToken {
+        int tokenKind;
+        int keywordKind;  // GP_KEYWORD_* and GP_TYPE_* kinds of NAME tokens, or -1
+        int typeKind;
+        int literalKind;  // GP_LITERAL_* kind of LITERAL tokens, or -1 if invalid
+        double floatingValue;
 };
 
-static void compute_line_and_column(struct GP_Ctx *ctx, int *outLine, int *outColumn)
+/* Lexes the token at p, which is not whitespace or a comment. This part of
+ * the lexer looks only at the text, so it is shared with the code that lexes
+ * text in memory (token caches, predefined macros). Returns the end of the
+ * token, or NULL if no token starts at p. */
+static inline const char *lex_token_text(const char *p, const char *end, struct GP_LexedToken *out)
 {
-        int line = 1;
-        int column = 1;
-        for (int i = 0; i < ctx->file.cursorPos; i++) {
-                if (ctx->file.contents[i] == '\n') {
-                        line ++;
-                        column = 0;
+        const char *start = p;
+        int charClass = CHAR_INFO(*p)->charClass;
+        out->keywordKind = -1;
+        out->typeKind = -1;
+        out->literalKind = -1;
+        out->floatingValue = 0.0;
+        if (charClass == CHAR_NAME) {
+                p++;
+                while (p < end && CHAR_INFO(*p)->nameChar)
+                        p++;
+                out->tokenKind = GP_TOKEN_NAME;
+                /* classify keywords and type names once, here */
+                const struct GP_KeywordHashEntry *entry = gp_lookup_keyword(start, (int) (p - start));
+                if (entry) {
+                        out->keywordKind = entry->keywordKind;
+                        out->typeKind = entry->typeKind;
                 }
-                else {
-                        column ++;
+        }
+        else if (charClass == CHAR_DIGIT
+                 || (*p == '.' && p + 1 < end && CHAR_INFO(p[1])->charClass == CHAR_DIGIT)) {
+                /* The token is the whole preprocessing number. If it is not
+                 * a valid literal, that is an error only where the parser
+                 * needs the value. */
+                out->tokenKind = GP_TOKEN_LITERAL;
+                p++;
+                while (p < end && (CHAR_INFO(*p)->nameChar || *p == '.'
+                                   || ((*p == '+' || *p == '-') && (p[-1] == 'e' || p[-1] == 'E'))))
+                        p++;
+                out->literalKind = gp_parse_literal(start, (int) (p - start), &out->floatingValue);
+        }
+        else if (charClass == CHAR_QUOTE) {
+                out->tokenKind = GP_TOKEN_STRING;
+                /* I believe there are no strings in GLSL, but we will
+                 * have a use for them... */
+                p++;
+                while (p < end && *p != '"')
+                        p++;
+                if (p < end)
+                        p++;  // closing quote
+        }
+        else if (charClass == CHAR_PUNCT || charClass == CHAR_SLASH) {
+                const char character2 = CHAR_INFO(*p)->character2;
+                const char character3 = CHAR_INFO(*p)->character3;
+                int tokenKind = CHAR_INFO(*p)->tokenKind1;
+                p++;
+                if (character2 && p < end && *p == character2) {
+                        tokenKind = CHAR_INFO(*start)->tokenKind2;
+                        p++;
+                }
+                else if (character3 && p < end && *p == character3) {
+                        tokenKind = CHAR_INFO(*start)->tokenKind3;
+                        p++;
+                }
+                out->tokenKind = tokenKind;
+        }
+        else {
+                return NULL;
+        }
+        return p;
+}
+
+/* The end of the contents of a STRING token (without the closing quote) */
+static const char *string_token_end(const char *start, const char *end)
+{
+        return end - start >= 2 && end[-1] == '"' ? end - 1 : end;
+}
+
+static void allocate_line_indices(struct GP_Ctx *ctx)
+{
+        if (ctx->lineIndices == NULL) {
+                ALLOC_MEMORY(&ctx->lineIndices, ctx->desc.numFiles);
+                memset(ctx->lineIndices, 0, ctx->desc.numFiles * sizeof *ctx->lineIndices);
+        }
+}
+
+static int get_stream_block_size(struct GP_Ctx *ctx)
+{
+        return ctx->streamBlockSize > 0 ? ctx->streamBlockSize : GP_DEFAULT_STREAM_BLOCK_SIZE;
+}
+
+/* Reads from a streamed file, and fails on I/O errors */
+static int read_stream(struct GP_FileInfo *fileInfo, int offset, char *buffer, int size)
+{
+        int numRead = fileInfo->readFunc(fileInfo->readUserData, offset, buffer, size);
+        if (numRead < 0)
+                gp_fatal_f("Failed to read from file '%s'", fileInfo->fileID);
+        return numRead;
+}
+
+static void copy_span_data(struct GP_Ctx *ctx, struct GP_Span span, char *dest)
+{
+        GP_ENSURE(span.fileIndex != GP_GENERATED_TEXT);
+        struct GP_FileInfo *fileInfo = &ctx->desc.fileInfo[span.fileIndex];
+        if (fileInfo->contents == NULL) {
+                // the reader may return fewer bytes than requested
+                int numRead = 0;
+                while (numRead < span.length) {
+                        int n = read_stream(fileInfo, span.offset + numRead,
+                                            dest + numRead, span.length - numRead);
+                        if (n == 0)
+                                gp_fatal_f("Failed to read from file '%s'", fileInfo->fileID);
+                        numRead += n;
                 }
         }
-        *outLine = line;
-        *outColumn = column;
+        else {
+                memcpy(dest, gp_span_data(ctx, span), span.length);
+        }
+}
+
+static void add_line_start(int **lineStarts, int *numLines, int *numAllocated, int lineStart)
+{
+        if (*numLines == *numAllocated) {
+                *numAllocated = *numAllocated ? 2 * *numAllocated : 256;
+                REALLOC_MEMORY(lineStarts, *numAllocated);
+        }
+        (*lineStarts)[(*numLines)++] = lineStart;
+}
+
+/* Adds the lines that start in [p, end). offset is the file offset of p. */
+static void add_line_starts(int **lineStarts, int *numLines, int *numAllocated,
+                            const char *p, const char *end, int offset)
+{
+        const char *start = p;
+        for (;;) {
+                p = gp_scan_find_newline(p, end);
+                if (p == end)
+                        break;
+                p++;
+                add_line_start(lineStarts, numLines, numAllocated, offset + (int) (p - start));
+        }
+}
+
+/* Streamed files are read once more for this. It is only needed for files
+ * that were not parsed. */
+static void build_line_index_streamed(struct GP_Ctx *ctx, int fileIndex,
+                                      struct GP_Arena *arena, struct GP_LineIndex *lineIndex)
+{
+        struct GP_FileInfo *fileInfo = &ctx->desc.fileInfo[fileIndex];
+        int blockSize = get_stream_block_size(ctx);
+        char *block;
+        int *lineStarts = NULL;
+        int numLines = 0;
+        int numAllocated = 0;
+        ALLOC_MEMORY(&block, blockSize);
+        add_line_start(&lineStarts, &numLines, &numAllocated, 0);
+        for (int offset = 0;;) {
+                int numRead = read_stream(fileInfo, offset, block, blockSize);
+                if (numRead == 0)
+                        break;
+                add_line_starts(&lineStarts, &numLines, &numAllocated, block, block + numRead, offset);
+                offset += numRead;
+        }
+        ARENA_ALLOC_MEMORY(arena, &lineIndex->lineStarts, numLines);
+        memcpy(lineIndex->lineStarts, lineStarts, numLines * sizeof *lineStarts);
+        lineIndex->numLines = numLines;
+        FREE_MEMORY(&lineStarts);
+        FREE_MEMORY(&block);
+}
+
+static void build_line_index(struct GP_Ctx *ctx, int fileIndex,
+                             struct GP_Arena *arena, struct GP_LineIndex *lineIndex)
+{
+        if (ctx->desc.fileInfo[fileIndex].contents == NULL) {
+                build_line_index_streamed(ctx, fileIndex, arena, lineIndex);
+                return;
+        }
+        const char *contents = ctx->desc.fileInfo[fileIndex].contents;
+        const char *end = contents + ctx->desc.fileInfo[fileIndex].size;
+        int numLines = gp_scan_count_newlines(contents, end) + 1;
+        ARENA_ALLOC_MEMORY(arena, &lineIndex->lineStarts, numLines);
+        lineIndex->lineStarts[0] = 0;
+        const char *p = contents;
+        for (int i = 1; i < numLines; i++) {
+                p = gp_scan_find_newline(p, end) + 1;
+                lineIndex->lineStarts[i] = (int) (p - contents);
+        }
+        lineIndex->numLines = numLines;
+}
+
+static struct GP_LineIndex *get_line_index(struct GP_Ctx *ctx, int fileIndex)
+{
+        allocate_line_indices(ctx);
+        struct GP_LineIndex *lineIndex = &ctx->lineIndices[fileIndex];
+        if (lineIndex->lineStarts == NULL)
+                build_line_index(ctx, fileIndex, &ctx->arena, lineIndex);
+        return lineIndex;
+}
+
+/* While parsing, the line indices are published only once they are
+ * complete. When parsing in parallel, they are built outside of the lock. If
+ * another parser was faster, our copy is wasted. */
+static struct GP_LineIndex lookup_line_index(struct GP_Ctx *ctx, int fileIndex)
+{
+        if (ctx->lineIndexMutex == NULL)
+                return ctx->lineIndices[fileIndex];
+        gp_mutex_lock(ctx->lineIndexMutex);
+        struct GP_LineIndex lineIndex = ctx->lineIndices[fileIndex];
+        gp_mutex_unlock(ctx->lineIndexMutex);
+        return lineIndex;
+}
+
+/* Returns the line index that is published, which might not be ours */
+static struct GP_LineIndex publish_line_index(struct GP_Ctx *ctx, int fileIndex,
+                                              struct GP_LineIndex newLineIndex)
+{
+        struct GP_LineIndex *lineIndex = &ctx->lineIndices[fileIndex];
+        if (ctx->lineIndexMutex != NULL)
+                gp_mutex_lock(ctx->lineIndexMutex);
+        if (lineIndex->lineStarts == NULL)
+                *lineIndex = newLineIndex;
+        struct GP_LineIndex publishedLineIndex = *lineIndex;
+        if (ctx->lineIndexMutex != NULL)
+                gp_mutex_unlock(ctx->lineIndexMutex);
+        return publishedLineIndex;
+}
+
+/* Called when a file is pushed, such that the line index is available without
+ * locking while the file is parsed. For streamed files, we start building
+ * the line index if it doesn't exist yet. */
+static struct GP_LineIndex ensure_line_index(struct GP_Parser *parser, int fileIndex)
+{
+        struct GP_Ctx *ctx = parser->ctx;
+        struct GP_LineIndex lineIndex = lookup_line_index(ctx, fileIndex);
+        if (lineIndex.lineStarts != NULL)
+                return lineIndex;
+        if (ctx->desc.fileInfo[fileIndex].contents == NULL) {
+                // continued by refill_window()
+                parser->file.numLineStartsAllocated = 0;
+                add_line_start(&lineIndex.lineStarts, &lineIndex.numLines,
+                               &parser->file.numLineStartsAllocated, 0);
+                return lineIndex;
+        }
+        build_line_index(ctx, fileIndex, &parser->arena, &lineIndex);
+        return publish_line_index(ctx, fileIndex, lineIndex);
+}
+
+static struct GP_SourceLoc compute_source_loc(struct GP_LineIndex *lineIndex, int fileIndex, int offset)
+{
+        // find the last line that starts at or before offset
+        int lo = 0;
+        int hi = lineIndex->numLines;
+        while (hi - lo > 1) {
+                int mid = lo + (hi - lo) / 2;
+                if (lineIndex->lineStarts[mid] <= offset)
+                        lo = mid;
+                else
+                        hi = mid;
+        }
+        struct GP_SourceLoc loc;
+        loc.fileIndex = fileIndex;
+        loc.line = lo + 1;
+        loc.column = offset - lineIndex->lineStarts[lo] + 1;
+        return loc;
+}
+
+struct GP_SourceLoc gp_compute_source_loc(struct GP_Ctx *ctx, int fileIndex, int offset)
+{
+        return compute_source_loc(get_line_index(ctx, fileIndex), fileIndex, offset);
+}
+
+/* The location of the current token, or of the cursor if there is no
+ * current token (for errors from the lexer) */
+static struct GP_SourceLoc compute_current_source_loc(struct GP_Parser *parser)
+{
+        int offset = parser->haveSavedToken ? parser->tokenStart : parser->file.cursorPos;
+        return compute_source_loc(&parser->file.lineIndex, parser->file.fileIndex, offset);
 }
 
 static void NORETURN _gp_fatal_parse_error_fv(
-                struct GP_LogCtx logCtx, struct GP_Ctx *ctx, const char *fmt, va_list ap)
+                struct GP_LogCtx logCtx, struct GP_Parser *parser, const char *fmt, va_list ap)
 {
-        int line;
-        int column;
-        compute_line_and_column(ctx, &line, &column);
+        struct GP_SourceLoc loc = compute_current_source_loc(parser);
         _gp_fatal_begin(logCtx);
         gp_fatal_write_f("while parsing '%s' at %d:%d: ",
-                      ctx->file.fileID, line, column);
+                      parser->ctx->desc.fileInfo[loc.fileIndex].fileID, loc.line, loc.column);
         gp_fatal_write_fv(fmt, ap);
         gp_fatal_end();
 }
 
 static void NORETURN _gp_fatal_parse_error_f(
-                struct GP_LogCtx logCtx, struct GP_Ctx *ctx, const char *fmt, ...)
+                struct GP_LogCtx logCtx, struct GP_Parser *parser, const char *fmt, ...)
 {
         va_list ap;
         va_start(ap, fmt);
-        _gp_fatal_parse_error_fv(logCtx, ctx, fmt, ap);
+        _gp_fatal_parse_error_fv(logCtx, parser, fmt, ap);
         va_end(ap);
 }
 
-#define gp_fatal_parse_error_fv(ctx, fmt, ap) \
-        _gp_fatal_parse_error_fv(GP_MAKE_LOGCTX(), (ctx), (fmt), (ap))
-#define gp_fatal_parse_error_f(ctx, fmt, ...) \
-        _gp_fatal_parse_error_f(GP_MAKE_LOGCTX(), (ctx), (fmt), ##__VA_ARGS__)
+#define gp_fatal_parse_error_fv(parser, fmt, ap) \
+        _gp_fatal_parse_error_fv(GP_MAKE_LOGCTX(), (parser), (fmt), (ap))
+#define gp_fatal_parse_error_f(parser, fmt, ...) \
+        _gp_fatal_parse_error_f(GP_MAKE_LOGCTX(), (parser), (fmt), ##__VA_ARGS__)
+
+static void append_output_span(struct GP_ShaderfileAst *fa, int fileIndex, int offset, int size)
+{
+        struct GP_Span *last = fa->numOutputSpans > 0 ? &fa->outputSpans[fa->numOutputSpans - 1] : NULL;
+        if (last != NULL
+            && last->fileIndex == fileIndex
+            && last->offset + last->length == offset) {
+                last->length += size;
+        }
+        else {
+                if (fa->numOutputSpansAllocated == fa->numOutputSpans) {
+                        fa->numOutputSpansAllocated = fa->numOutputSpans ? 2 * fa->numOutputSpans : 16;
+                        REALLOC_MEMORY(&fa->outputSpans, fa->numOutputSpansAllocated);
+                }
+                struct GP_Span *span = &fa->outputSpans[fa->numOutputSpans++];
+                span->fileIndex = fileIndex;
+                span->offset = offset;
+                span->length = size;
+        }
+        fa->outputSize += size;
+}
+
+static void append_output_bytes(struct GP_ShaderfileAst *fa, const char *data, int size)
+{
+        int idx = fa->outputSize;
+        fa->outputSize += size;
+        if (fa->outputAllocated < fa->outputSize + 1) {
+                fa->outputAllocated = 2 * (fa->outputSize + 1);
+                REALLOC_MEMORY(&fa->output, fa->outputAllocated);
+        }
+        memcpy(fa->output + idx, data, size);
+        fa->output[fa->outputSize] = '\0';
+}
+
+/* The range must be in the window */
+static void append_output(struct GP_Parser *parser, int startOffset, int endOffset)
+{
+        int size = endOffset - startOffset;
+        if (size == 0)
+                return;
+        struct GP_ShaderfileAst *fa = parser->currentAst;
+        if (parser->ctx->outputMode == GP_OUTPUT_MODE_SPANS)
+                append_output_span(fa, parser->file.fileIndex, startOffset, size);
+        else
+                append_output_bytes(fa, parser->file.contents + (startOffset - parser->file.windowStart), size);
+}
+
+/* For text that is not in the input files (macro expansions) */
+static void append_output_text(struct GP_Parser *parser, const char *text, int size)
+{
+        struct GP_ShaderfileAst *fa = parser->currentAst;
+        if (parser->ctx->outputMode == GP_OUTPUT_MODE_SPANS) {
+                int offset = fa->generatedTextSize;
+                fa->generatedTextSize += size;
+                if (fa->generatedTextAllocated < fa->generatedTextSize) {
+                        fa->generatedTextAllocated = 2 * fa->generatedTextSize;
+                        REALLOC_MEMORY(&fa->generatedText, fa->generatedTextAllocated);
+                }
+                memcpy(fa->generatedText + offset, text, size);
+                append_output_span(fa, GP_GENERATED_TEXT, offset, size);
+        }
+        else {
+                append_output_bytes(fa, text, size);
+        }
+}
+
+/* Cuts the output back to the given size, which was an earlier size */
+static void truncate_output(struct GP_Ctx *ctx, struct GP_ShaderfileAst *fa, int size)
+{
+        if (ctx->outputMode == GP_OUTPUT_MODE_SPANS) {
+                int numRemoved = fa->outputSize - size;
+                while (numRemoved > 0) {
+                        struct GP_Span *last = &fa->outputSpans[fa->numOutputSpans - 1];
+                        if (last->length > numRemoved) {
+                                last->length -= numRemoved;
+                                break;
+                        }
+                        numRemoved -= last->length;
+                        fa->numOutputSpans--;
+                }
+        }
+        else if (fa->output != NULL) {
+                fa->output[size] = '\0';
+        }
+        fa->outputSize = size;
+}
+
+/* Replaces the output between start and end, which is not tentative, with
+ * the text. The output positions after end that the parser keeps are moved. */
+static void replace_output(struct GP_Parser *parser, int start, int end, const char *text, int size)
+{
+        struct GP_Ctx *ctx = parser->ctx;
+        struct GP_ShaderfileAst *fa = parser->currentAst;
+        int delta = size - (end - start);
+        if (ctx->outputMode == GP_OUTPUT_MODE_SPANS) {
+                // the spans after end are taken out and appended again
+                int firstTailSpan = fa->numOutputSpans;
+                int pos = fa->outputSize;
+                while (pos > end) {
+                        firstTailSpan--;
+                        pos -= fa->outputSpans[firstTailSpan].length;
+                }
+                int numTailSpans = fa->numOutputSpans - firstTailSpan;
+                struct GP_Span *tailSpans = NULL;
+                if (numTailSpans > 0) {
+                        ALLOC_MEMORY(&tailSpans, numTailSpans);
+                        memcpy(tailSpans, &fa->outputSpans[firstTailSpan], numTailSpans * sizeof *tailSpans);
+                        tailSpans[0].offset += end - pos;
+                        tailSpans[0].length -= end - pos;
+                }
+                truncate_output(ctx, fa, start);
+                append_output_text(parser, text, size);
+                for (int i = 0; i < numTailSpans; i++)
+                        append_output_span(fa, tailSpans[i].fileIndex, tailSpans[i].offset, tailSpans[i].length);
+                FREE_MEMORY(&tailSpans);
+        }
+        else {
+                if (fa->outputAllocated < fa->outputSize + delta + 1) {
+                        fa->outputAllocated = 2 * (fa->outputSize + delta + 1);
+                        REALLOC_MEMORY(&fa->output, fa->outputAllocated);
+                }
+                memmove(fa->output + end + delta, fa->output + end, fa->outputSize - end);
+                memcpy(fa->output + start, text, size);
+                fa->outputSize += delta;
+                fa->output[fa->outputSize] = '\0';
+        }
+        if (parser->file.tentativeOutputSize >= end)
+                parser->file.tentativeOutputSize += delta;
+        if (parser->pendingOutputStart >= end)
+                parser->pendingOutputStart += delta;
+}
 
 /* Move the cursor that indicates the currently processed file position.
  * If copying is not currently suspended, the (forward) range that is described
  * by the move will be copied to the output buffer. */
-static void copy_remaining_bytes(struct GP_Ctx *ctx)
+static void copy_remaining_bytes(struct GP_Parser *parser)
 {
-        if (!ctx->file.outputSuspended) {
+        if (!parser->file.outputSuspended) {
                 // output range from current file
-                int startOffset = ctx->file.outputFilePosition;
-                int endOffset = ctx->file.indexOfFirstUnconsumedToken;
-                int size = endOffset - startOffset;
-                struct GP_ShaderfileAst *fa = &ctx->shaderfileAsts[ctx->currentShaderIndex];
-                int idx = fa->outputSize;
-                fa->outputSize += size;
-                REALLOC_MEMORY(&fa->output, fa->outputSize + 1);
-                memcpy(fa->output + idx, ctx->file.contents + startOffset, size);
-                fa->output[fa->outputSize] = '\0';
+                append_output(parser, parser->file.outputFilePosition,
+                              parser->file.indexOfFirstUnconsumedToken);
         }
-        ctx->file.outputFilePosition = ctx->file.indexOfFirstUnconsumedToken;
+        parser->file.outputFilePosition = parser->file.indexOfFirstUnconsumedToken;
 }
 
-static void suspend_copying(struct GP_Ctx *ctx)
+/* Takes back the whitespace and comments that were copied to the output when
+ * the window of a streamed file was moved. */
+static void drop_tentative_output(struct GP_Parser *parser)
 {
-        GP_ENSURE(!ctx->file.outputSuspended);
-        copy_remaining_bytes(ctx);
-        ctx->file.outputSuspended = 1;
+        if (parser->file.tentativeOutputSize != -1) {
+                truncate_output(parser->ctx, parser->currentAst, parser->file.tentativeOutputSize);
+                parser->file.tentativeOutputSize = -1;
+                parser->file.outputFilePosition = parser->file.indexOfFirstUnconsumedToken;
+        }
 }
 
-static void resume_copying(struct GP_Ctx *ctx)
+static void suspend_copying(struct GP_Parser *parser)
 {
-        GP_ENSURE(ctx->file.outputSuspended);
-        copy_remaining_bytes(ctx); //XXX. this won't copy but just move the outputFilePosition
-        ctx->file.outputSuspended = 0;
+        GP_ENSURE(!parser->file.outputSuspended);
+        drop_tentative_output(parser);
+        copy_remaining_bytes(parser);
+        parser->file.outputSuspended = 1;
 }
 
-static void gp_push_file(struct GP_Ctx *ctx, int fileIndex)
+/* Writes a line break to the output for each line break in the range of the
+ * current file, which is left out of the output. That keeps the lines of the
+ * output where they are in the file, so the line numbers that the GLSL
+ * compiler reports are right. The range might not be in the window anymore,
+ * the line index has it. */
+static void append_line_breaks(struct GP_Parser *parser, int start, int end)
 {
-        //gp_message_f("push file '%s'", ctx->desc.fileInfo[fileIndex].fileID);
+        static const char lineBreaks[] = "\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n";
+        if (start >= end)
+                return;
+        struct GP_LineIndex *lineIndex = &parser->file.lineIndex;
+        int numLineBreaks = compute_source_loc(lineIndex, parser->file.fileIndex, end).line
+                - compute_source_loc(lineIndex, parser->file.fileIndex, start).line;
+        while (numLineBreaks > 0) {
+                int size = numLineBreaks < (int) sizeof lineBreaks - 1 ? numLineBreaks : (int) sizeof lineBreaks - 1;
+                append_output_text(parser, lineBreaks, size);
+                numLineBreaks -= size;
+        }
+}
+
+/* The text that was skipped while copying was suspended (directives and
+ * skipped conditional groups) is replaced by its line breaks. */
+static void resume_copying(struct GP_Parser *parser)
+{
+        GP_ENSURE(parser->file.outputSuspended);
+        int skippedStart = parser->file.outputFilePosition;
+        copy_remaining_bytes(parser); //XXX. this won't copy but just move the outputFilePosition
+        parser->file.outputSuspended = 0;
+        append_line_breaks(parser, skippedStart, parser->file.outputFilePosition);
+}
+
+/* For streamed files: discards the part of the window before keepPos and
+ * reads more of the file. The bytes between the last consumed token and
+ * keepPos, which can only be whitespace and comments, are copied to the
+ * output tentatively. Returns 0 if nothing more could be read. */
+static int refill_window(struct GP_Parser *parser, int keepPos)
+{
+        struct GP_FileStackItem *file = &parser->file;
+        if (!file->isStreamed || file->isAtEndOfFile)
+                return 0;
+        GP_ENSURE(!parser->haveSavedToken);
+        if (!file->outputSuspended) {
+                if (file->tentativeOutputSize == -1) {
+                        copy_remaining_bytes(parser);
+                        if (keepPos > file->outputFilePosition)
+                                file->tentativeOutputSize = parser->currentAst->outputSize;
+                }
+                if (keepPos > file->outputFilePosition) {
+                        append_output(parser, file->outputFilePosition, keepPos);
+                        file->outputFilePosition = keepPos;
+                }
+        }
+        int numKept = file->windowStart + file->size - keepPos;
+        if (numKept == file->windowCapacity)
+                gp_fatal_parse_error_f(parser, "Token too long (the limit is the stream block size)");
+        memmove(file->window, file->window + (keepPos - file->windowStart), numKept);
+        file->windowStart = keepPos;
+        file->size = numKept;
+        struct GP_FileInfo *fileInfo = &parser->ctx->desc.fileInfo[file->fileIndex];
+        int numRead = read_stream(fileInfo, keepPos + numKept,
+                                  file->window + numKept, file->windowCapacity - numKept);
+        if (numRead == 0) {
+                file->isAtEndOfFile = 1;
+                return 0;
+        }
+        if (file->numLineStartsAllocated)
+                add_line_starts(&file->lineIndex.lineStarts, &file->lineIndex.numLines,
+                                &file->numLineStartsAllocated, file->window + numKept,
+                                file->window + numKept + numRead, keepPos + numKept);
+        file->size += numRead;
+        return 1;
+}
+
+/* Streamed files are finished here. They are only popped when they were
+ * read to the end, so the line index is complete. */
+static void finish_streamed_file(struct GP_Parser *parser)
+{
+        struct GP_FileStackItem *file = &parser->file;
+        if (file->numLineStartsAllocated) {
+                struct GP_LineIndex lineIndex;
+                lineIndex.numLines = file->lineIndex.numLines;
+                ARENA_ALLOC_MEMORY(&parser->arena, &lineIndex.lineStarts, lineIndex.numLines);
+                memcpy(lineIndex.lineStarts, file->lineIndex.lineStarts,
+                       lineIndex.numLines * sizeof *lineIndex.lineStarts);
+                FREE_MEMORY(&file->lineIndex.lineStarts);
+                file->numLineStartsAllocated = 0;
+                file->lineIndex = publish_line_index(parser->ctx, file->fileIndex, lineIndex);
+        }
+        FREE_MEMORY(&file->window);
+        file->contents = NULL;
+}
+
+/* Skips whitespace, comments and line continuations in text that is
+ * completely in memory. Returns NULL if a comment is not terminated. */
+static const char *skip_space_in_text(const char *p, const char *end)
+{
+        for (;;) {
+                if (p < end && CHAR_INFO(*p)->charClass == CHAR_SPACE)
+                        p = gp_scan_skip_whitespace(p + 1, end);
+                if (p == end)
+                        return p;
+                if (*p == '\\') {
+                        if (p + 1 < end && p[1] == '\n') {
+                                p += 2;
+                                continue;
+                        }
+                        if (p + 2 < end && p[1] == '\r' && p[2] == '\n') {
+                                p += 3;
+                                continue;
+                        }
+                        return p;
+                }
+                if (*p != '/' || p + 1 == end)
+                        return p;
+                if (p[1] == '*') {
+                        const char *q = gp_scan_find_comment_end(p + 2, end);
+                        if (q == NULL)
+                                return NULL;
+                        p = q + 2;
+                }
+                else if (p[1] == '/')
+                        p = gp_scan_find_newline(p + 2, end);
+                else
+                        return p;
+        }
+}
+
+/* Lexing is a function of the position only, so the tokens can be lexed
+ * from start to end, ignoring the preprocessor. Text that fails to lex gets
+ * an error token, such that the error is reported by the lexer if (and
+ * only if) the parser gets there. */
+static void build_token_cache(struct GP_Ctx *ctx, int fileIndex,
+                              struct GP_Arena *arena, struct GP_TokenCache *cache)
+{
+        const char *contents = ctx->desc.fileInfo[fileIndex].contents;
+        const char *end = contents + ctx->desc.fileInfo[fileIndex].size;
+        struct GP_CachedToken *tokens = NULL;
+        int numTokens = 0;
+        int numAllocated = 0;
+        for (const char *p = contents;;) {
+                const char *start = skip_space_in_text(p, end);
+                if (start == end)
+                        break;
+                if (numTokens == numAllocated) {
+                        numAllocated = numAllocated ? 2 * numAllocated : 1024;
+                        REALLOC_MEMORY(&tokens, numAllocated);
+                }
+                struct GP_CachedToken *token = &tokens[numTokens++];
+                if (start == NULL) {
+                        // unterminated comment
+                        token->start = token->end = (int) (p - contents);
+                        token->tokenKind = -1;
+                        break;
+                }
+                struct GP_LexedToken lexed;
+                p = lex_token_text(start, end, &lexed);
+                token->start = (int) (start - contents);
+                if (p == NULL) {
+                        token->end = token->start + 1;
+                        token->tokenKind = -1;
+                        p = start + 1;
+                        continue;
+                }
+                token->end = (int) (p - contents);
+                token->tokenKind = (short) lexed.tokenKind;
+                token->keywordKind = (short) lexed.keywordKind;
+                token->typeKind = (short) lexed.typeKind;
+                token->literalKind = (short) lexed.literalKind;
+                token->floatingValue = lexed.floatingValue;
+        }
+        // allocate one more, such that the tokens are not NULL
+        ARENA_ALLOC_MEMORY(arena, &cache->tokens, numTokens + 1);
+        memcpy(cache->tokens, tokens, numTokens * sizeof *tokens);
+        cache->numTokens = numTokens;
+        FREE_MEMORY(&tokens);
+}
+
+static void allocate_token_caches(struct GP_Ctx *ctx)
+{
+        if (ctx->tokenCaches == NULL) {
+                ALLOC_MEMORY(&ctx->tokenCaches, ctx->desc.numFiles);
+                ALLOC_MEMORY(&ctx->fileParseCounts, ctx->desc.numFiles);
+                memset(ctx->tokenCaches, 0, ctx->desc.numFiles * sizeof *ctx->tokenCaches);
+                memset(ctx->fileParseCounts, 0, ctx->desc.numFiles * sizeof *ctx->fileParseCounts);
+        }
+}
+
+/* Called when a file is pushed. A file that is parsed only once is lexed
+ * directly, it would not profit from a cache. Like the line indices, the
+ * token caches are built outside of the lock and published when they are
+ * complete. */
+static const struct GP_TokenCache *ensure_token_cache(struct GP_Parser *parser, int fileIndex)
+{
+        struct GP_Ctx *ctx = parser->ctx;
+        if (ctx->desc.fileInfo[fileIndex].contents == NULL)
+                return NULL;
+        struct GP_TokenCache *cache = &ctx->tokenCaches[fileIndex];
+        if (ctx->lineIndexMutex != NULL)
+                gp_mutex_lock(ctx->lineIndexMutex);
+        int parseCount = ++ctx->fileParseCounts[fileIndex];
+        int haveCache = cache->tokens != NULL;
+        if (ctx->lineIndexMutex != NULL)
+                gp_mutex_unlock(ctx->lineIndexMutex);
+        if (haveCache)
+                return cache;
+        if (parseCount < 2)
+                return NULL;
+        struct GP_TokenCache newCache;
+        build_token_cache(ctx, fileIndex, &parser->arena, &newCache);
+        if (ctx->lineIndexMutex != NULL)
+                gp_mutex_lock(ctx->lineIndexMutex);
+        if (cache->tokens == NULL)
+                *cache = newCache;
+        if (ctx->lineIndexMutex != NULL)
+                gp_mutex_unlock(ctx->lineIndexMutex);
+        return cache;
+}
+
+static void gp_push_file(struct GP_Parser *parser, int fileIndex)
+{
+        //gp_message_f("push file '%s'", parser->ctx->desc.fileInfo[fileIndex].fileID);
 
         /* first save the copy to the actual stack */
-        if (ctx->fileStackSize > 0)
-                ctx->fileStack[ctx->fileStackSize - 1] = ctx->file;
+        if (parser->fileStackSize > 0)
+                parser->fileStack[parser->fileStackSize - 1] = parser->file;
 
-        int i = ctx->fileStackSize++;
-        REALLOC_MEMORY(&ctx->fileStack, ctx->fileStackSize);
+        int i = parser->fileStackSize++;
+        REALLOC_MEMORY(&parser->fileStack, parser->fileStackSize);
 
-        struct GP_FileInfo *fileInfo = &ctx->desc.fileInfo[fileIndex];
+        struct GP_FileInfo *fileInfo = &parser->ctx->desc.fileInfo[fileIndex];
         struct GP_FileStackItem fileStackItem = {
+                .fileIndex = fileIndex,
                 .fileID = fileInfo->fileID,
                 .contents = fileInfo->contents,
                 .size = fileInfo->size,
+                .windowStart = 0,
                 .cursorPos = 0,
-                .savedCharacter = -1,
-                .haveSavedCharacter = 0,
                 .outputFilePosition = 0,
                 .indexOfFirstUnconsumedToken = 0,
                 .outputSuspended = 0,
+                .tentativeOutputSize = -1,
+        };
+        parser->file = fileStackItem;
+        parser->file.lineIndex = ensure_line_index(parser, fileIndex);
+        parser->file.tokenCache = ensure_token_cache(parser, fileIndex);
+        if (fileInfo->contents == NULL) {
+                struct GP_FileStackItem *file = &parser->file;
+                file->isStreamed = 1;
+                file->readFunc = fileInfo->readFunc;
+                file->readUserData = fileInfo->readUserData;
+                file->windowCapacity = 2 * get_stream_block_size(parser->ctx);
+                ALLOC_MEMORY(&file->window, file->windowCapacity);
+                file->contents = file->window;
+                file->size = 0;
+                refill_window(parser, 0);
+        }
+        parser->fileStack[i] = parser->file;
+}
+
+static void gp_pop_file(struct GP_Parser *parser)
+{
+        GP_ENSURE(parser->fileStackSize > 0);
+        if (parser->numConditionals > 0) {
+                const struct GP_Conditional *conditional = &parser->conditionals[parser->numConditionals - 1];
+                if (conditional->fileStackSize == parser->fileStackSize)
+                        gp_fatal_parse_error_f(parser, "EOF encountered while looking for the #endif of the conditional at %d:%d",
+                                               conditional->loc.line, conditional->loc.column);
+        }
+        drop_tentative_output(parser);
+        copy_remaining_bytes(parser);
+        if (parser->file.isStreamed)
+                finish_streamed_file(parser);
+        if (parser->file.guardState == GP_GUARD_AFTER
+            && parser->fileGuards[parser->file.fileIndex] == GP_FILE_NOT_GUARDED)
+                parser->fileGuards[parser->file.fileIndex] = parser->file.guardMacro;
+        //gp_message_f("pop file '%s'", parser->ctx->desc.fileInfo[parser->fileStackSize - 1].fileID);
+        --parser->fileStackSize;
+        if (parser->fileStackSize > 0)
+                parser->file = parser->fileStack[parser->fileStackSize - 1];
+}
+
+void gp_index_files(struct GP_Ctx *ctx)
+{
+        gp_intern_teardown(&ctx->fileIDTable);
+        for (int i = 0; i < ctx->desc.numFiles; i++) {
+                const char *fileID = ctx->desc.fileInfo[i].fileID;
+                GP_Atom atom = gp_intern_string(&ctx->fileIDTable, fileID, (int) strlen(fileID));
+                if (atom != i)
+                        gp_fatal_f("Multiple files '%s' given", fileID);
+        }
+}
+
+static int find_file_index(struct GP_Ctx *ctx, const char *fileID, int length)
+{
+        return gp_intern_find_string(&ctx->fileIDTable, fileID, length);
+}
+
+int gp_find_file_index_from_id_or_fatal_error(struct GP_Ctx *ctx, const char *fileID)
+{
+        int fileIndex = find_file_index(ctx, fileID, (int) strlen(fileID));
+        // not a parse error: we are not in any file yet
+        if (fileIndex == -1)
+                gp_fatal_f("No file with this fileID available: '%s'", fileID);
+        return fileIndex;
+}
+
+static void set_token_span(struct GP_Parser *parser, int startPos, int endPos)
+{
+        parser->tokenSpan.fileIndex = parser->file.fileIndex;
+        parser->tokenSpan.offset = startPos;
+        parser->tokenSpan.length = endPos - startPos;
+}
+
+/* The index of the first cached token that starts at pos or after it */
+static int find_cached_token(const struct GP_TokenCache *cache, int pos)
+{
+        int lo = 0;
+        int hi = cache->numTokens;
+        while (lo < hi) {
+                int mid = lo + (hi - lo) / 2;
+                if (cache->tokens[mid].start < pos)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+        return lo;
+}
+
+/* Whether the lexer, started at pos, would produce the cached token i. That
+ * is the case if the token starts at pos or if the previous token ends
+ * there (the space between tokens lexes the same). */
+static int cached_token_is_at(const struct GP_TokenCache *cache, int i, int pos)
+{
+        if (i < cache->numTokens && cache->tokens[i].start == pos)
+                return 1;
+        return (i > 0 ? cache->tokens[i - 1].end : 0) == pos;
+}
+
+/* Returns -1 if the token must be lexed instead. The cursor can be moved
+ * anywhere by the directives. Usually it is still at a token boundary of the
+ * cache. */
+static int look_cached_token(struct GP_Parser *parser)
+{
+        struct GP_FileStackItem *file = &parser->file;
+        const struct GP_TokenCache *cache = file->tokenCache;
+        int pos = file->cursorPos;
+        int i = file->tokenCacheIndex;
+        if (!cached_token_is_at(cache, i, pos)) {
+                i = find_cached_token(cache, pos);
+                if (!cached_token_is_at(cache, i, pos))
+                        return -1;
+        }
+        if (i == cache->numTokens || cache->tokens[i].tokenKind == -1)
+                return -1;  // end of file, or an error
+        const struct GP_CachedToken *token = &cache->tokens[i];
+        if (token->start >= parser->lexEnd) {
+                parser->tokenKind = GP_TOKEN_EOF;
+                return 0;
+        }
+        const char *start = file->contents + token->start;
+        parser->tokenKind = token->tokenKind;
+        parser->tokenKeywordKind = token->keywordKind;
+        parser->tokenTypeKind = token->typeKind;
+        parser->tokenLiteralKind = token->literalKind;
+        parser->tokenFloatingValue = token->floatingValue;
+        if (token->tokenKind == GP_TOKEN_NAME)
+                set_token_span(parser, token->start, token->end);
+        else if (token->tokenKind == GP_TOKEN_STRING)
+                set_token_span(parser, token->start + 1,
+                               (int) (string_token_end(start, file->contents + token->end) - file->contents));
+        file->cursorPos = token->end;
+        file->tokenCacheIndex = i + 1;
+        parser->tokenStart = token->start;
+        parser->tokenEnd = token->end;
+        parser->tokenText = token->tokenKind == GP_TOKEN_STRING ? start + 1 : start;
+        parser->tokenHasLeadingSpace = token->start != pos;
+        parser->haveSavedToken = 1;
+        return 1;
+}
+
+/* The lexer works with a direct pointer cursor over the contents of the
+ * current file. Only when the end of a file is reached, we take the slow path
+ * of popping the file stack. Tokens never straddle two files. */
+static int look_token_no_preproc(struct GP_Parser *parser)
+{
+        if (parser->haveSavedToken)
+                return 1;
+        if (parser->fileStackSize == 0) {
+                parser->tokenKind = GP_TOKEN_EOF;
+                return 0;
+        }
+        if (parser->file.tokenCache != NULL) {
+                int haveToken = look_cached_token(parser);
+                if (haveToken != -1)
+                        return haveToken;
+        }
+/* conversion between file positions and pointers into the window */
+#define POS(ptr) (parser->file.windowStart + (int) ((ptr) - parser->file.contents))
+#define PTR(pos) (parser->file.contents + ((pos) - parser->file.windowStart))
+        const char *end = parser->file.contents + parser->file.size;
+        const char *p = PTR(parser->file.cursorPos);
+        int startPos = parser->file.cursorPos;  // -1 after a file was popped
+        /* skip whitespace and comments */
+        for (;;) {
+                /* In streamed files, a block of lookahead is needed after p
+                 * such that the next token is completely in the window (or
+                 * it is too long), and we see where comments start. */
+                if (parser->file.isStreamed) {
+                        while (2 * (end - p) < parser->file.windowCapacity) {
+                                int pos = POS(p);
+                                int refilled = refill_window(parser, pos);
+                                end = parser->file.contents + parser->file.size;
+                                p = PTR(pos);
+                                if (!refilled)
+                                        break;
+                        }
+                }
+                if (p < end && CHAR_INFO(*p)->charClass == CHAR_SPACE)
+                        p = gp_scan_skip_whitespace(p + 1, end);
+                if (POS(p) >= parser->lexEnd) {
+                        // end of the directive
+                        parser->tokenKind = GP_TOKEN_EOF;
+                        return 0;
+                }
+                if (p == end) {
+                        if (parser->lexNoPop) {
+                                parser->tokenKind = GP_TOKEN_EOF;
+                                return 0;
+                        }
+                        parser->file.cursorPos = POS(p);
+                        gp_pop_file(parser);
+                        if (parser->fileStackSize == 0) {
+                                parser->tokenKind = GP_TOKEN_EOF;
+                                return 0;
+                        }
+                        end = parser->file.contents + parser->file.size;
+                        p = PTR(parser->file.cursorPos);
+                        startPos = -1;
+                        continue;
+                }
+                if (*p == '\\') {
+                        // line continuation
+                        if (p + 1 < end && p[1] == '\n') {
+                                p += 2;
+                                continue;
+                        }
+                        if (p + 2 < end && p[1] == '\r' && p[2] == '\n') {
+                                p += 3;
+                                continue;
+                        }
+                        break;
+                }
+                if (*p != '/' || p + 1 == end)
+                        break;
+                if (p[1] == '*') {
+                        int searchPos = POS(p + 2);
+                        const char *q = gp_scan_find_comment_end(p + 2, end);
+                        while (q == NULL && parser->file.isStreamed) {
+                                // keep the last byte, it might be the '*'
+                                int keepPos = POS(end) - 1;
+                                if (keepPos > searchPos)
+                                        searchPos = keepPos;
+                                int refilled = refill_window(parser, searchPos);
+                                end = parser->file.contents + parser->file.size;
+                                if (!refilled)
+                                        break;
+                                q = gp_scan_find_comment_end(PTR(searchPos), end);
+                        }
+                        if (q == NULL) {
+                                parser->file.cursorPos = POS(end);
+                                gp_fatal_parse_error_f(parser,
+                                        "EOF encountered while expecting end of comment");
+                        }
+                        p = q + 2;
+                }
+                else if (p[1] == '/') {
+                        p = gp_scan_find_newline(p + 2, end);
+                        while (p == end && parser->file.isStreamed) {
+                                int searchPos = POS(p);
+                                int refilled = refill_window(parser, searchPos);
+                                end = parser->file.contents + parser->file.size;
+                                p = PTR(searchPos);
+                                if (!refilled)
+                                        break;
+                                p = gp_scan_find_newline(p, end);
+                        }
+                }
+                else {
+                        break;
+                }
+        }
+        const char *start = p;
+        struct GP_LexedToken token;
+        p = lex_token_text(start, end, &token);
+        if (p == NULL) {
+                parser->file.cursorPos = POS(start);
+                gp_fatal_parse_error_f(parser,
+                                "Failed to lex; initial character: '%c'", *start);
+        }
+        parser->tokenKind = token.tokenKind;
+        parser->tokenKeywordKind = token.keywordKind;
+        parser->tokenTypeKind = token.typeKind;
+        parser->tokenLiteralKind = token.literalKind;
+        parser->tokenFloatingValue = token.floatingValue;
+        if (token.tokenKind == GP_TOKEN_NAME)
+                set_token_span(parser, POS(start), POS(p));
+        else if (token.tokenKind == GP_TOKEN_STRING)
+                set_token_span(parser, POS(start + 1), POS(string_token_end(start, p)));
+        if (p == end && parser->file.isStreamed && !parser->file.isAtEndOfFile) {
+                parser->file.cursorPos = POS(start);
+                gp_fatal_parse_error_f(parser,
+                        "Token too long (the limit is the stream block size)");
+        }
+        parser->file.cursorPos = POS(p);
+        parser->tokenStart = POS(start);
+        parser->tokenEnd = parser->file.cursorPos;
+        parser->tokenText = token.tokenKind == GP_TOKEN_STRING ? start + 1 : start;
+        parser->tokenHasLeadingSpace = parser->tokenStart != startPos;
+        parser->haveSavedToken = 1;
+        return 1;
+#undef POS
+#undef PTR
+}
+
+static void consume_token(struct GP_Parser *parser)
+{
+        GP_ENSURE(parser->haveSavedToken);
+        parser->haveSavedToken = 0;
+        if (parser->tokenIsPending) {
+                // not from the file, it's part of the output already
+                parser->tokenIsPending = 0;
+                parser->pendingTokenIndex++;
+                return;
+        }
+        parser->file.indexOfFirstUnconsumedToken = parser->tokenEnd;
+        // the whitespace before the token is part of the output now
+        parser->file.tentativeOutputSize = -1;
+}
+
+/* Interning is thread safe while gp_parse_parallel() runs. */
+static GP_Atom intern_string(struct GP_Ctx *ctx, const char *string, int length)
+{
+        unsigned hash = gp_intern_hash(string, length);
+        int shard = hash >> (32 - GP_INTERN_SHARD_BITS);
+        if (ctx->internShardMutexes)
+                gp_mutex_lock(&ctx->internShardMutexes[shard]);
+        GP_Atom atom = gp_intern_string_with_hash(&ctx->internShards[shard], string, length, hash);
+        if (ctx->internShardMutexes)
+                gp_mutex_unlock(&ctx->internShardMutexes[shard]);
+        return (atom << GP_INTERN_SHARD_BITS) | shard;
+}
+
+/* The text of the current NAME or STRING token. It is only valid until the
+ * next token is lexed, since the window of a streamed file can move. */
+static const char *token_data(struct GP_Parser *parser)
+{
+        return parser->tokenText;
+}
+
+static int token_equals(struct GP_Parser *parser, const char *string)
+{
+        int length = (int) strlen(string);
+        return parser->tokenSpan.length == length && !memcmp(token_data(parser), string, length);
+}
+
+static GP_Atom intern_token(struct GP_Parser *parser)
+{
+        return intern_string(parser->ctx, token_data(parser), parser->tokenSpan.length);
+}
+
+static int find_file_index_from_token_or_fatal_error(struct GP_Parser *parser)
+{
+        const char *fileID = token_data(parser);
+        int fileIndex = find_file_index(parser->ctx, fileID, parser->tokenSpan.length);
+        if (fileIndex == -1)
+                gp_fatal_parse_error_f(parser, "No file with this fileID available: '%.*s'",
+                                       parser->tokenSpan.length, fileID);
+        return fileIndex;
+}
+
+/* The preprocessor. Directives are handled when the lexer returns a '#'
+ * token. A directive ends at the end of its line: lexEnd is set to the
+ * position of the newline, and the lexer returns EOF there.
+ *
+ * Macros are expanded when the lexer returns the name of a macro. The whole
+ * invocation, with its arguments, is read and expanded completely. The
+ * resulting tokens are written to the output in place of the text of the
+ * invocation, and then they are returned to the parser one by one, as pending
+ * tokens. While expanding, tokens are read from a stack of frames (macro
+ * bodies and arguments), and only the arguments of a function-like macro
+ * invocation can continue in the file.
+ *
+ * "##" in a macro body pastes the tokens on either side into one token (newer
+ * GLSL versions and GLSL ES 3.00 define it). The operands are the arguments
+ * as they were given, before they are expanded. There is no '#' operator, and
+ * a '#' in a macro body is an error. */
+
+enum {
+        MAX_EXPANSION_DEPTH = 256,
+        MAX_PP_EXPRESSION_DEPTH = 256,
+        /* Parentheses and function arguments recurse. This bounds the C
+         * stack that they take, also in threads with small stacks. */
+        MAX_EXPRESSION_DEPTH = 1024,
+        DEFAULT_VERSION_NUMBER = 110,  // if there is no #version directive
+};
+
+/* kinds of directives, as far as skipping conditional groups is concerned */
+enum {
+        PP_DIRECTIVE_OTHER,
+        PP_DIRECTIVE_IF,  // #if, #ifdef, #ifndef
+        PP_DIRECTIVE_ELIF,
+        PP_DIRECTIVE_ELSE,
+        PP_DIRECTIVE_ENDIF,
+};
+
+static int char_at_slow(struct GP_Parser *parser, int pos, int keepPos)
+{
+        struct GP_FileStackItem *file = &parser->file;
+        while (pos >= file->windowStart + file->size) {
+                if (file->isStreamed && !file->isAtEndOfFile
+                    && file->windowStart + file->size - keepPos == file->windowCapacity)
+                        gp_fatal_parse_error_f(parser, "Line too long (the limit is the stream block size)");
+                if (!refill_window(parser, keepPos))
+                        return -1;
+        }
+        return (unsigned char) file->contents[pos - file->windowStart];
+}
+
+/* The byte at the file position, or -1 at the end of the file. The window of
+ * a streamed file is moved if needed, but it keeps keepPos. */
+static inline int char_at(struct GP_Parser *parser, int pos, int keepPos)
+{
+        if (pos < parser->file.windowStart + parser->file.size)
+                return (unsigned char) parser->file.contents[pos - parser->file.windowStart];
+        return char_at_slow(parser, pos, keepPos);
+}
+
+static const char *copy_text(struct GP_Arena *arena, const char *text, int length)
+{
+        char *copy;
+        ARENA_ALLOC_MEMORY(arena, &copy, length + 1);
+        memcpy(copy, text, length);
+        copy[length] = '\0';
+        return copy;
+}
+
+static int add_macro(struct GP_Parser *parser, const char *name, int length)
+{
+        int m = gp_intern_string(&parser->macroNames, name, length);
+        if (m == parser->numMacros) {
+                if (parser->numMacrosAllocated == parser->numMacros) {
+                        parser->numMacrosAllocated = parser->numMacros ? 2 * parser->numMacros : 32;
+                        REALLOC_MEMORY(&parser->macros, parser->numMacrosAllocated);
+                }
+                struct GP_Macro *macro = &parser->macros[parser->numMacros++];
+                memset(macro, 0, sizeof *macro);
+                macro->name = gp_intern_table_string(&parser->macroNames, m);
+                macro->expandingFrame = -1;
+                macro->expansionGeneration = -1;
+        }
+        unsigned char c = (unsigned char) name[0];
+        parser->macroFirstChars[c >> 3] |= 1 << (c & 7);
+        return m;
+}
+
+/* Returns the index of the macro with the given name, or -1 if no such macro
+ * is defined. Most names can be rejected by their first character. */
+static int find_macro(struct GP_Parser *parser, const char *name, int length)
+{
+        unsigned char c = (unsigned char) name[0];
+        if (!(parser->macroFirstChars[c >> 3] & (1 << (c & 7))))
+                return -1;
+        int m = gp_intern_find_string(&parser->macroNames, name, length);
+        if (m == -1 || !parser->macros[m].isDefined)
+                return -1;
+        return m;
+}
+
+static void reset_preprocessor(struct GP_Parser *parser)
+{
+        static const struct {
+                const char *name;
+                int builtinKind;
+        } builtinMacros[] = {
+                { "__LINE__", GP_BUILTIN_MACRO_LINE },
+                { "__FILE__", GP_BUILTIN_MACRO_FILE },
+                { "__VERSION__", GP_BUILTIN_MACRO_VERSION },
         };
-        ctx->fileStack[i] = fileStackItem;
-        ctx->file = fileStackItem;
+        gp_arena_reset(&parser->ppArena);
+        gp_intern_teardown(&parser->macroNames);
+        parser->numMacros = 0;
+        parser->numUserMacros = 0;
+        parser->macroGeneration = 0;
+        memset(parser->macroFirstChars, 0, sizeof parser->macroFirstChars);
+        for (int i = 0; i < LENGTH(builtinMacros); i++) {
+                int m = add_macro(parser, builtinMacros[i].name, (int) strlen(builtinMacros[i].name));
+                parser->macros[m].isDefined = 1;
+                parser->macros[m].builtinKind = builtinMacros[i].builtinKind;
+        }
+        parser->versionNumber = DEFAULT_VERSION_NUMBER;
+        parser->numConditionals = 0;
+        if (parser->fileGuards == NULL)
+                ALLOC_MEMORY(&parser->fileGuards, parser->ctx->desc.numFiles);
+        for (int i = 0; i < parser->ctx->desc.numFiles; i++)
+                parser->fileGuards[i] = GP_FILE_NOT_GUARDED;
+        parser->lexEnd = INT_MAX;
+        parser->lexNoPop = 0;
+        parser->ppTokenStackSize = 0;
+        parser->numMacroFrames = 0;
+        parser->macroArgStartsSize = 0;
+        parser->numExpandedTokens = 0;
+        parser->pendingTokenIndex = 0;
+        parser->pendingTokenEnd = 0;
+        parser->tokenIsPending = 0;
+}
+
+static void teardown_preprocessor(struct GP_Parser *parser)
+{
+        gp_arena_teardown(&parser->ppArena);
+        gp_arena_teardown(&parser->scratchArena);
+        gp_intern_teardown(&parser->macroNames);
+        FREE_MEMORY(&parser->macros);
+        FREE_MEMORY(&parser->conditionals);
+        FREE_MEMORY(&parser->fileGuards);
+        FREE_MEMORY(&parser->ppTokenStack);
+        FREE_MEMORY(&parser->macroFrames);
+        FREE_MEMORY(&parser->macroArgStarts);
+        FREE_MEMORY(&parser->expandedTokens);
+}
+
+/* Makes a preprocessing token from the current token, which is from the
+ * file. The text is copied to the arena. */
+static void make_pptoken(struct GP_Parser *parser, struct GP_Arena *arena, struct GP_PPToken *out)
+{
+        GP_ENSURE(parser->haveSavedToken && !parser->tokenIsPending);
+        int kind = parser->tokenKind;
+        out->tokenKind = kind;
+        out->flags = parser->tokenHasLeadingSpace ? GP_PPTOKEN_LEADING_SPACE : 0;
+        out->keywordKind = kind == GP_TOKEN_NAME ? parser->tokenKeywordKind : -1;
+        out->typeKind = kind == GP_TOKEN_NAME ? parser->tokenTypeKind : -1;
+        out->paramIndex = -1;
+        out->literalKind = kind == GP_TOKEN_LITERAL ? parser->tokenLiteralKind : -1;
+        out->floatingValue = kind == GP_TOKEN_LITERAL ? parser->tokenFloatingValue : 0.0;
+        if (kind == GP_TOKEN_NAME || kind == GP_TOKEN_STRING) {
+                out->span = parser->tokenSpan;
+        }
+        else {
+                out->span.fileIndex = parser->file.fileIndex;
+                out->span.offset = parser->tokenStart;
+                out->span.length = parser->tokenEnd - parser->tokenStart;
+        }
+        out->textLength = parser->tokenEnd - parser->tokenStart;
+        out->text = copy_text(arena, parser->file.contents + (parser->tokenStart - parser->file.windowStart),
+                              out->textLength);
+}
+
+/* For the values of built-in macros and of "defined" */
+static void make_number_pptoken(struct GP_Parser *parser, long long value, struct GP_PPToken *out)
+{
+        char buffer[32];
+        int length = snprintf(buffer, sizeof buffer, "%lld", value);
+        out->tokenKind = GP_TOKEN_LITERAL;
+        out->flags = 0;
+        out->keywordKind = -1;
+        out->typeKind = -1;
+        out->paramIndex = -1;
+        out->literalKind = GP_LITERAL_INT;
+        out->floatingValue = (double) value;
+        out->span.fileIndex = parser->file.fileIndex;
+        out->span.offset = parser->file.cursorPos;
+        out->span.length = 0;
+        out->text = copy_text(&parser->scratchArena, buffer, length);
+        out->textLength = length;
+}
+
+/* Makes a preprocessing token from text that was lexed by lex_token_text().
+ * The span is only partly set, its fileIndex and offset are up to the caller. */
+static void make_lexed_pptoken(const struct GP_LexedToken *lexed, const char *text, int length,
+                               struct GP_PPToken *out)
+{
+        out->tokenKind = lexed->tokenKind;
+        out->flags = 0;
+        out->keywordKind = lexed->keywordKind;
+        out->typeKind = lexed->typeKind;
+        out->paramIndex = -1;
+        out->literalKind = lexed->literalKind;
+        out->floatingValue = lexed->floatingValue;
+        out->text = text;
+        out->textLength = length;
+        out->span.length = length;
+        if (lexed->tokenKind == GP_TOKEN_STRING)
+                out->span.length = (int) (string_token_end(text, text + length) - text) - 1;
+}
+
+/* Tokens are passed by value. They are often copied from the stack itself. */
+static void push_pptoken(struct GP_Parser *parser, struct GP_PPToken token)
+{
+        if (parser->ppTokenStackAllocated == parser->ppTokenStackSize) {
+                parser->ppTokenStackAllocated = parser->ppTokenStackSize ? 2 * parser->ppTokenStackSize : 64;
+                REALLOC_MEMORY(&parser->ppTokenStack, parser->ppTokenStackAllocated);
+        }
+        parser->ppTokenStack[parser->ppTokenStackSize++] = token;
+}
+
+static void push_expanded_token(struct GP_Parser *parser, struct GP_PPToken token)
+{
+        if (parser->numExpandedTokensAllocated == parser->numExpandedTokens) {
+                parser->numExpandedTokensAllocated = parser->numExpandedTokens ? 2 * parser->numExpandedTokens : 64;
+                REALLOC_MEMORY(&parser->expandedTokens, parser->numExpandedTokensAllocated);
+        }
+        parser->expandedTokens[parser->numExpandedTokens++] = token;
+}
+
+static void push_macro_arg_start(struct GP_Parser *parser, int stackIndex)
+{
+        if (parser->macroArgStartsAllocated == parser->macroArgStartsSize) {
+                parser->macroArgStartsAllocated = parser->macroArgStartsSize ? 2 * parser->macroArgStartsSize : 32;
+                REALLOC_MEMORY(&parser->macroArgStarts, parser->macroArgStartsAllocated);
+        }
+        parser->macroArgStarts[parser->macroArgStartsSize++] = stackIndex;
+}
+
+static void push_macro_frame(struct GP_Parser *parser, const struct GP_PPToken *tokens, int stackIndex,
+                             int numTokens, int macro, int isFinal, int hasLeadingSpace)
+{
+        if (parser->numMacroFramesAllocated == parser->numMacroFrames) {
+                parser->numMacroFramesAllocated = parser->numMacroFrames ? 2 * parser->numMacroFrames : 16;
+                REALLOC_MEMORY(&parser->macroFrames, parser->numMacroFramesAllocated);
+        }
+        int frameIndex = parser->numMacroFrames++;
+        struct GP_MacroFrame *frame = &parser->macroFrames[frameIndex];
+        frame->tokens = tokens;
+        frame->stackIndex = stackIndex;
+        frame->numTokens = numTokens;
+        frame->pos = 0;
+        frame->macro = macro;
+        frame->isFinal = isFinal;
+        frame->hasLeadingSpace = hasLeadingSpace;
+        if (macro != -1)
+                parser->macros[macro].expandingFrame = frameIndex;
+}
+
+/* Pops the exhausted frames above frameBase, which enables their macros
+ * again. Returns the frame that has the next token, or NULL. */
+static struct GP_MacroFrame *find_next_frame(struct GP_Parser *parser, int frameBase)
+{
+        while (parser->numMacroFrames > frameBase) {
+                struct GP_MacroFrame *frame = &parser->macroFrames[parser->numMacroFrames - 1];
+                if (frame->pos < frame->numTokens)
+                        return frame;
+                if (frame->macro != -1)
+                        parser->macros[frame->macro].expandingFrame = -1;
+                parser->numMacroFrames--;
+        }
+        return NULL;
+}
+
+static const struct GP_PPToken *get_frame_token(struct GP_Parser *parser, struct GP_MacroFrame *frame)
+{
+        if (frame->tokens != NULL)
+                return &frame->tokens[frame->pos];
+        return &parser->ppTokenStack[frame->stackIndex + frame->pos];
+}
+
+/* Reads the next token from the frames above frameBase, or if they are
+ * exhausted and readFile is set, from the file. Returns 0 if there is none. */
+static int read_pptoken(struct GP_Parser *parser, int frameBase, int readFile,
+                        struct GP_PPToken *out, int *outIsFinal)
+{
+        struct GP_MacroFrame *frame = find_next_frame(parser, frameBase);
+        if (frame != NULL) {
+                *out = *get_frame_token(parser, frame);
+                if (frame->pos == 0) {
+                        out->flags &= ~GP_PPTOKEN_LEADING_SPACE;
+                        if (frame->hasLeadingSpace)
+                                out->flags |= GP_PPTOKEN_LEADING_SPACE;
+                }
+                *outIsFinal = frame->isFinal;
+                frame->pos++;
+                return 1;
+        }
+        if (!readFile || !look_token_no_preproc(parser))
+                return 0;
+        if (parser->tokenKind == GP_TOKEN_HASH)
+                gp_fatal_parse_error_f(parser, "Preprocessing directive in the arguments of a macro invocation");
+        make_pptoken(parser, &parser->scratchArena, out);
+        *outIsFinal = 0;
+        consume_token(parser);
+        return 1;
+}
+
+/* Looks whether the next token is a '(', without reading it */
+static int next_is_leftparen(struct GP_Parser *parser, int frameBase, int readFile)
+{
+        struct GP_MacroFrame *frame = find_next_frame(parser, frameBase);
+        if (frame != NULL)
+                return get_frame_token(parser, frame)->tokenKind == GP_TOKEN_LEFTPAREN;
+        if (!readFile || !look_token_no_preproc(parser))
+                return 0;
+        if (parser->tokenKind == GP_TOKEN_LEFTPAREN)
+                return 1;
+        // put the token back, it will be lexed again
+        parser->file.cursorPos = parser->tokenStart;
+        parser->haveSavedToken = 0;
+        return 0;
+}
+
+static int is_function_like_macro_name(struct GP_Parser *parser, const struct GP_PPToken *token)
+{
+        if (token->tokenKind != GP_TOKEN_NAME || (token->flags & GP_PPTOKEN_NO_EXPAND))
+                return 0;
+        int m = find_macro(parser, token->text, token->textLength);
+        return m != -1 && parser->macros[m].isFunctionLike;
+}
+
+static void expand_frames(struct GP_Parser *parser, int frameBase, int readFile);  // forward declare: recursion
+
+static void begin_builtin_macro_invocation(struct GP_Parser *parser, int m, const struct GP_PPToken *nameToken)
+{
+        long long value = 0;
+        switch (parser->macros[m].builtinKind) {
+        case GP_BUILTIN_MACRO_LINE:
+                value = compute_source_loc(&parser->file.lineIndex, parser->file.fileIndex,
+                                           parser->file.cursorPos).line;
+                break;
+        case GP_BUILTIN_MACRO_FILE:
+                value = parser->file.fileIndex;
+                break;
+        case GP_BUILTIN_MACRO_VERSION:
+                value = parser->versionNumber;
+                break;
+        default:
+                gp_fatal_f("Unhandled built-in macro kind %d", parser->macros[m].builtinKind);
+        }
+        struct GP_PPToken token;
+        make_number_pptoken(parser, value, &token);
+        int stackIndex = parser->ppTokenStackSize;
+        push_pptoken(parser, token);
+        push_macro_frame(parser, NULL, stackIndex, 1, -1, 1, nameToken->flags & GP_PPTOKEN_LEADING_SPACE);
+        parser->expansionIsContextDependent = 1;
+}
+
+/* "##". The text of the two tokens must make exactly one token. */
+static void paste_pptokens(struct GP_Parser *parser, const struct GP_PPToken *left,
+                           const struct GP_PPToken *right, struct GP_PPToken *out)
+{
+        int length = left->textLength + right->textLength;
+        char *text;
+        ARENA_ALLOC_MEMORY(&parser->scratchArena, &text, length + 1);
+        memcpy(text, left->text, left->textLength);
+        memcpy(text + left->textLength, right->text, right->textLength);
+        text[length] = '\0';
+        struct GP_LexedToken lexed;
+        if (length == 0 || lex_token_text(text, text + length, &lexed) != text + length)
+                gp_fatal_parse_error_f(parser, "Pasting '%s' and '%s' does not give a valid token",
+                                       left->text, right->text);
+        struct GP_Span span = left->span;
+        int flags = (left->flags & GP_PPTOKEN_LEADING_SPACE) | GP_PPTOKEN_PASTED;
+        make_lexed_pptoken(&lexed, text, length, out);
+        out->flags = flags;
+        out->span.fileIndex = span.fileIndex;
+        out->span.offset = span.offset;
+}
+
+/* Pushes a token of the replacement of a macro invocation. If the token is the
+ * right operand of "##" and the left operand (from pasteStart on the stack) is
+ * not empty, the token is pasted to the last token of the left operand. */
+static void push_replacement_token(struct GP_Parser *parser, struct GP_PPToken token, int pasteStart)
+{
+        token.flags &= ~GP_PPTOKEN_PASTE;
+        if (pasteStart == -1 || parser->ppTokenStackSize == pasteStart) {
+                push_pptoken(parser, token);
+                return;
+        }
+        struct GP_PPToken *left = &parser->ppTokenStack[parser->ppTokenStackSize - 1];
+        struct GP_PPToken pasted;
+        paste_pptokens(parser, left, &token, &pasted);
+        *left = pasted;
+}
+
+/* Copies the body of macro m to the ppTokenStack, with the arguments of the
+ * invocation substituted (see begin_function_macro_invocation()), and does
+ * the pasting. An empty operand of "##" leaves the other operand as it is.
+ * Returns where the copy starts on the stack. */
+static int substitute_macro_body(struct GP_Parser *parser, int m, int argStartsBase, int expandedBase)
+{
+        const struct GP_Macro *macro = &parser->macros[m];
+        int bodyStart = parser->ppTokenStackSize;
+        /* Where the left operand of "##" starts on the stack, if the last
+         * body token was followed by "##", and -1 otherwise. In "a ## b ## c",
+         * a and b together are the left operand of the second "##". */
+        int pasteStart = -1;
+        for (int i = 0; i < macro->numBodyTokens; i++) {
+                const struct GP_PPToken *bodyToken = &macro->body[i];
+                int operandStart = parser->ppTokenStackSize;
+                if (bodyToken->paramIndex == -1) {
+                        push_replacement_token(parser, *bodyToken, pasteStart);
+                }
+                else {
+                        int param = bodyToken->paramIndex;
+                        int start, end;
+                        if (pasteStart != -1 || (bodyToken->flags & GP_PPTOKEN_PASTE)) {
+                                start = parser->macroArgStarts[argStartsBase + param];
+                                end = parser->macroArgStarts[argStartsBase + param + 1];
+                        }
+                        else {
+                                start = parser->macroArgStarts[expandedBase + 2 * param];
+                                end = parser->macroArgStarts[expandedBase + 2 * param + 1];
+                        }
+                        for (int j = start; j < end; j++) {
+                                struct GP_PPToken argToken = parser->ppTokenStack[j];
+                                if (j == start) {
+                                        argToken.flags &= ~GP_PPTOKEN_LEADING_SPACE;
+                                        argToken.flags |= bodyToken->flags & GP_PPTOKEN_LEADING_SPACE;
+                                }
+                                push_replacement_token(parser, argToken, j == start ? pasteStart : -1);
+                        }
+                }
+                if (!(bodyToken->flags & GP_PPTOKEN_PASTE))
+                        pasteStart = -1;
+                else if (pasteStart == -1)
+                        pasteStart = operandStart;
+        }
+        return bodyStart;
+}
+
+/* The body of an object-like macro is expanded on its own, and the result is
+ * cached unless it depends on the context of the invocation. */
+static void begin_object_macro_invocation(struct GP_Parser *parser, int m, const struct GP_PPToken *nameToken)
+{
+        struct GP_Macro *macro = &parser->macros[m];
+        int hasLeadingSpace = nameToken->flags & GP_PPTOKEN_LEADING_SPACE;
+        if (macro->expansionGeneration == parser->macroGeneration) {
+                push_macro_frame(parser, macro->expansion, 0, macro->numExpansionTokens, m, 1, hasLeadingSpace);
+                return;
+        }
+        int resultStart = parser->numExpandedTokens;
+        int frameBase = parser->numMacroFrames;
+        int isolationFrameBase = parser->isolationFrameBase;
+        int isContextDependent = parser->expansionIsContextDependent;
+        parser->isolationFrameBase = frameBase;
+        parser->expansionIsContextDependent = 0;
+        if (macro->hasPaste) {
+                int bodyStart = substitute_macro_body(parser, m, -1, -1);
+                push_macro_frame(parser, NULL, bodyStart, parser->ppTokenStackSize - bodyStart, m, 0, 0);
+        }
+        else {
+                push_macro_frame(parser, macro->body, 0, macro->numBodyTokens, m, 0, 0);
+        }
+        parser->expansionDepth++;
+        expand_frames(parser, frameBase, 0);
+        parser->expansionDepth--;
+        int numResults = parser->numExpandedTokens - resultStart;
+        /* If the result ends with the name of a function-like macro, the
+         * tokens after the invocation can complete another invocation. */
+        int isCacheable = !parser->expansionIsContextDependent
+                && !(numResults > 0 && is_function_like_macro_name(parser, &parser->expandedTokens[parser->numExpandedTokens - 1]));
+        parser->isolationFrameBase = isolationFrameBase;
+        parser->expansionIsContextDependent |= isContextDependent;
+        macro = &parser->macros[m];
+        if (isCacheable) {
+                /* The tokens are from macro bodies (built-in macros are not
+                 * cached), so their text is in the ppArena already, except
+                 * for the pasted ones. */
+                ARENA_ALLOC_MEMORY(&parser->ppArena, &macro->expansion, numResults);
+                if (numResults > 0)
+                        memcpy(macro->expansion, &parser->expandedTokens[resultStart], numResults * sizeof *macro->expansion);
+                for (int i = 0; i < numResults; i++) {
+                        struct GP_PPToken *token = &macro->expansion[i];
+                        if (token->flags & GP_PPTOKEN_PASTED) {
+                                token->text = copy_text(&parser->ppArena, token->text, token->textLength);
+                                token->flags &= ~GP_PPTOKEN_PASTED;
+                        }
+                }
+                macro->numExpansionTokens = numResults;
+                macro->expansionGeneration = parser->macroGeneration;
+                push_macro_frame(parser, macro->expansion, 0, numResults, m, 1, hasLeadingSpace);
+        }
+        else {
+                int stackIndex = parser->ppTokenStackSize;
+                for (int i = 0; i < numResults; i++)
+                        push_pptoken(parser, parser->expandedTokens[resultStart + i]);
+                push_macro_frame(parser, NULL, stackIndex, numResults, m, 0, hasLeadingSpace);
+        }
+        parser->numExpandedTokens = resultStart;
+}
+
+/* The arguments are collected on the ppTokenStack. Each is expanded on its
+ * own and then substituted into a copy of the body, except where it is an
+ * operand of "##". */
+static int begin_function_macro_invocation(struct GP_Parser *parser, int m, const struct GP_PPToken *nameToken,
+                                           int frameBase, int readFile)
+{
+        if (!next_is_leftparen(parser, frameBase, readFile))
+                return 0;
+        struct GP_PPToken token;
+        int isFinal;
+        read_pptoken(parser, frameBase, readFile, &token, &isFinal);  // '('
+        int argStartsBase = parser->macroArgStartsSize;
+        push_macro_arg_start(parser, parser->ppTokenStackSize);
+        int depth = 0;
+        for (;;) {
+                if (!read_pptoken(parser, frameBase, readFile, &token, &isFinal))
+                        gp_fatal_parse_error_f(parser, "Unterminated invocation of macro '%s'",
+                                               parser->macros[m].name);
+                if (token.tokenKind == GP_TOKEN_LEFTPAREN) {
+                        depth++;
+                }
+                else if (token.tokenKind == GP_TOKEN_RIGHTPAREN) {
+                        if (depth == 0)
+                                break;
+                        depth--;
+                }
+                else if (token.tokenKind == GP_TOKEN_COMMA && depth == 0) {
+                        push_macro_arg_start(parser, parser->ppTokenStackSize);
+                        continue;
+                }
+                push_pptoken(parser, token);
+        }
+        push_macro_arg_start(parser, parser->ppTokenStackSize);  // end of the last argument
+        int numArgs = parser->macroArgStartsSize - argStartsBase - 1;
+        if (numArgs == 1 && parser->macroArgStarts[argStartsBase] == parser->macroArgStarts[argStartsBase + 1])
+                numArgs = 0;  // "()"
+        if (numArgs != parser->macros[m].numParams)
+                gp_fatal_parse_error_f(parser, "Macro '%s' takes %d arguments, but %d were given",
+                                       parser->macros[m].name, parser->macros[m].numParams, numArgs);
+        /* The expanded arguments are appended to the ppTokenStack. Their
+         * starts and ends follow the raw argument starts. */
+        int expandedBase = parser->macroArgStartsSize;
+        for (int i = 0; i < numArgs; i++) {
+                int start = parser->macroArgStarts[argStartsBase + i];
+                int end = parser->macroArgStarts[argStartsBase + i + 1];
+                int resultStart = parser->numExpandedTokens;
+                int argFrameBase = parser->numMacroFrames;
+                push_macro_frame(parser, NULL, start, end - start, -1, 0, 0);
+                parser->expansionDepth++;
+                expand_frames(parser, argFrameBase, 0);
+                parser->expansionDepth--;
+                push_macro_arg_start(parser, parser->ppTokenStackSize);
+                for (int j = resultStart; j < parser->numExpandedTokens; j++)
+                        push_pptoken(parser, parser->expandedTokens[j]);
+                push_macro_arg_start(parser, parser->ppTokenStackSize);
+                parser->numExpandedTokens = resultStart;
+        }
+        int bodyStart = substitute_macro_body(parser, m, argStartsBase, expandedBase);
+        parser->macroArgStartsSize = argStartsBase;
+        push_macro_frame(parser, NULL, bodyStart, parser->ppTokenStackSize - bodyStart, m, 0,
+                         nameToken->flags & GP_PPTOKEN_LEADING_SPACE);
+        return 1;
+}
+
+/* The name of the macro was just read. Pushes a frame with the replacement
+ * of the invocation. Returns 0 if there is no invocation, which is the case
+ * for a function-like macro whose name is not followed by '('. */
+static int begin_macro_invocation(struct GP_Parser *parser, int m, const struct GP_PPToken *nameToken,
+                                  int frameBase, int readFile)
+{
+        if (parser->expansionDepth >= MAX_EXPANSION_DEPTH)
+                gp_fatal_parse_error_f(parser, "Macro expansion nested too deeply (in macro '%s')",
+                                       parser->macros[m].name);
+        if (parser->macros[m].builtinKind != GP_BUILTIN_MACRO_NONE)
+                begin_builtin_macro_invocation(parser, m, nameToken);
+        else if (parser->macros[m].isFunctionLike)
+                return begin_function_macro_invocation(parser, m, nameToken, frameBase, readFile);
+        else
+                begin_object_macro_invocation(parser, m, nameToken);
+        return 1;
+}
+
+/* Rescans the tokens from the frames above frameBase and appends the fully
+ * expanded tokens to expandedTokens. */
+static void expand_frames(struct GP_Parser *parser, int frameBase, int readFile)
+{
+        struct GP_PPToken token;
+        int isFinal;
+        while (read_pptoken(parser, frameBase, 0, &token, &isFinal)) {
+                if (!isFinal && token.tokenKind == GP_TOKEN_NAME && !(token.flags & GP_PPTOKEN_NO_EXPAND)) {
+                        int m = find_macro(parser, token.text, token.textLength);
+                        if (m != -1) {
+                                int expandingFrame = parser->macros[m].expandingFrame;
+                                if (expandingFrame != -1) {
+                                        // never expanded again, even in a different context
+                                        token.flags |= GP_PPTOKEN_NO_EXPAND;
+                                        if (expandingFrame < parser->isolationFrameBase)
+                                                parser->expansionIsContextDependent = 1;
+                                }
+                                else if (begin_macro_invocation(parser, m, &token, frameBase, readFile)) {
+                                        continue;
+                                }
+                        }
+                }
+                push_expanded_token(parser, token);
+        }
+}
+
+static void clear_expansion_state(struct GP_Parser *parser)
+{
+        GP_ENSURE(parser->numMacroFrames == 0);
+        parser->ppTokenStackSize = 0;
+        parser->numExpandedTokens = 0;
+        parser->macroArgStartsSize = 0;
+        parser->pendingTokenIndex = 0;
+        parser->pendingTokenEnd = 0;
+        parser->isolationFrameBase = 0;
+        parser->expansionIsContextDependent = 0;
+        gp_arena_reset(&parser->scratchArena);
+}
+
+/* Whether the two characters would be lexed as part of the same token */
+static int would_paste(int a, int b)
+{
+        if (CHAR_INFO(a)->nameChar && CHAR_INFO(b)->nameChar)
+                return 1;
+        if ((CHAR_INFO(a)->charClass == CHAR_DIGIT && b == '.') || (a == '.' && CHAR_INFO(b)->charClass == CHAR_DIGIT))
+                return 1;
+        if (a == '/' && (b == '/' || b == '*'))
+                return 1;
+        return (CHAR_INFO(a)->charClass == CHAR_PUNCT || CHAR_INFO(a)->charClass == CHAR_SLASH)
+                && (CHAR_INFO(a)->character2 == b || CHAR_INFO(a)->character3 == b);
+}
+
+/* The last character of the output */
+static int last_output_char(struct GP_Parser *parser)
+{
+        struct GP_ShaderfileAst *fa = parser->currentAst;
+        if (fa->outputSize == 0)
+                return '\n';
+        if (parser->ctx->outputMode != GP_OUTPUT_MODE_SPANS)
+                return (unsigned char) fa->output[fa->outputSize - 1];
+        const struct GP_Span *span = &fa->outputSpans[fa->numOutputSpans - 1];
+        int pos = span->offset + span->length - 1;
+        if (span->fileIndex == GP_GENERATED_TEXT)
+                return (unsigned char) fa->generatedText[pos];
+        if (span->fileIndex == parser->file.fileIndex
+            && parser->file.windowStart <= pos && pos < parser->file.windowStart + parser->file.size)
+                return (unsigned char) parser->file.contents[pos - parser->file.windowStart];
+        /* The span is from another file (an including or included one), or
+         * from before the window of a streamed file */
+        struct GP_Span lastCharSpan = { span->fileIndex, pos, 1 };
+        char c;
+        copy_span_data(parser->ctx, lastCharSpan, &c);
+        return (unsigned char) c;
+}
+
+/* Writes the expanded tokens to the output. Spaces are inserted where the
+ * tokens had whitespace before them, and where tokens would run together. */
+static void write_expansion_to_output(struct GP_Parser *parser, int nextChar)
+{
+        int lastChar = last_output_char(parser);
+        for (int i = 0; i < parser->numExpandedTokens; i++) {
+                const struct GP_PPToken *token = &parser->expandedTokens[i];
+                if (token->textLength == 0)
+                        continue;
+                if ((i > 0 && (token->flags & GP_PPTOKEN_LEADING_SPACE))
+                    || would_paste(lastChar, token->text[0]))
+                        append_output_text(parser, " ", 1);
+                append_output_text(parser, token->text, token->textLength);
+                lastChar = (unsigned char) token->text[token->textLength - 1];
+        }
+        if (nextChar != -1 && would_paste(lastChar, nextChar))
+                append_output_text(parser, " ", 1);
+}
+
+/* The current token is the name of a macro, and it is from the file. The
+ * invocation is replaced by its expansion in the output, and the tokens of the
+ * expansion become the pending tokens. */
+static void expand_macro_in_file(struct GP_Parser *parser, int m)
+{
+        int invocationPos = parser->tokenStart;
+        /* The output up to the invocation is final. The invocation itself
+         * (the name and the arguments) is not copied. */
+        parser->file.indexOfFirstUnconsumedToken = invocationPos;
+        if (parser->file.tentativeOutputSize != -1)
+                parser->pendingOutputStart = parser->file.tentativeOutputSize;
+        else
+                parser->pendingOutputStart = parser->currentAst->outputSize;
+        parser->file.tentativeOutputSize = -1;
+        copy_remaining_bytes(parser);
+        int wasSuspended = parser->file.outputSuspended;
+        parser->file.outputSuspended = 1;
+        clear_expansion_state(parser);
+        struct GP_PPToken nameToken;
+        make_pptoken(parser, &parser->scratchArena, &nameToken);
+        consume_token(parser);
+        parser->lexNoPop = 1;
+        if (begin_macro_invocation(parser, m, &nameToken, 0, 1))
+                expand_frames(parser, 0, 1);
+        else
+                push_expanded_token(parser, nameToken);
+        parser->lexNoPop = 0;
+        int afterPos = parser->file.indexOfFirstUnconsumedToken;
+        int nextChar = char_at(parser, afterPos, afterPos);
+        parser->file.outputFilePosition = afterPos;
+        parser->file.outputSuspended = wasSuspended;
+        if (!wasSuspended) {
+                write_expansion_to_output(parser, nextChar);
+                // the invocation might be on multiple lines
+                append_line_breaks(parser, invocationPos, afterPos);
+        }
+        parser->pendingTokenIndex = 0;
+        parser->pendingTokenEnd = parser->numExpandedTokens;
+        parser->pendingTokenPos = invocationPos;
+}
+
+static void load_pending_token(struct GP_Parser *parser)
+{
+        const struct GP_PPToken *token = &parser->expandedTokens[parser->pendingTokenIndex];
+        parser->tokenKind = token->tokenKind;
+        parser->tokenKeywordKind = token->keywordKind;
+        parser->tokenTypeKind = token->typeKind;
+        parser->tokenLiteralKind = token->literalKind;
+        parser->tokenFloatingValue = token->floatingValue;
+        parser->tokenSpan = token->span;
+        parser->tokenText = token->tokenKind == GP_TOKEN_STRING ? token->text + 1 : token->text;
+        parser->tokenHasLeadingSpace = (token->flags & GP_PPTOKEN_LEADING_SPACE) != 0;
+        parser->tokenStart = parser->pendingTokenPos;
+        parser->tokenEnd = parser->pendingTokenPos;
+        parser->tokenIsPending = 1;
+        parser->haveSavedToken = 1;
+}
+
+/* Returns the position of the newline that ends the line, or the end of the
+ * file. Block comments and backslashes before a newline continue the line.
+ * The window keeps keepPos, or if it is -1, only what is still to be read. */
+static int find_line_end(struct GP_Parser *parser, int pos, int keepPos)
+{
+#define CHAR_AT(pos) char_at(parser, (pos), keepPos == -1 ? (pos) : keepPos)
+        for (;;) {
+                int c = CHAR_AT(pos);
+                if (c == -1 || c == '\n')
+                        return pos;
+                if (c == '\\') {
+                        c = CHAR_AT(pos + 1);
+                        if (c == '\n') {
+                                pos += 2;
+                                continue;
+                        }
+                        if (c == '\r' && CHAR_AT(pos + 2) == '\n') {
+                                pos += 3;
+                                continue;
+                        }
+                }
+                else if (c == '/') {
+                        c = CHAR_AT(pos + 1);
+                        if (c == '*') {
+                                pos += 2;
+                                for (;;) {
+                                        c = CHAR_AT(pos);
+                                        if (c == -1)
+                                                return pos;
+                                        if (c == '*' && CHAR_AT(pos + 1) == '/')
+                                                break;
+                                        pos++;
+                                }
+                                pos += 2;
+                                continue;
+                        }
+                        if (c == '/') {
+                                pos += 2;
+                                while ((c = CHAR_AT(pos)) != -1 && c != '\n')
+                                        pos++;
+                                return pos;
+                        }
+                }
+                pos++;
+        }
+#undef CHAR_AT
+}
+
+/* Called after the '#' was consumed. The lexer stops at the end of the line. */
+static void begin_directive(struct GP_Parser *parser, int hashPos)
+{
+        parser->lexEnd = find_line_end(parser, parser->file.cursorPos, hashPos);
+        parser->lexNoPop = 1;
+}
+
+/* Skips the rest of the directive. The newline at its end is not part of the
+ * directive, so it will be copied to the output. */
+static void end_directive(struct GP_Parser *parser)
+{
+        parser->haveSavedToken = 0;
+        parser->file.cursorPos = parser->lexEnd;
+        parser->file.indexOfFirstUnconsumedToken = parser->lexEnd;
+        parser->lexEnd = INT_MAX;
+        parser->lexNoPop = 0;
+}
+
+static void expect_end_of_directive(struct GP_Parser *parser, const char *directiveName)
+{
+        if (look_token_no_preproc(parser))
+                gp_fatal_parse_error_f(parser, "Unexpected tokens after #%s directive", directiveName);
+}
+
+static int classify_directive_name(const char *name, int length)
+{
+        static const struct {
+                const char *name;
+                int directiveKind;
+        } directives[] = {
+                { "if", PP_DIRECTIVE_IF },
+                { "ifdef", PP_DIRECTIVE_IF },
+                { "ifndef", PP_DIRECTIVE_IF },
+                { "elif", PP_DIRECTIVE_ELIF },
+                { "else", PP_DIRECTIVE_ELSE },
+                { "endif", PP_DIRECTIVE_ENDIF },
+        };
+        for (int i = 0; i < LENGTH(directives); i++)
+                if ((int) strlen(directives[i].name) == length && !memcmp(directives[i].name, name, length))
+                        return directives[i].directiveKind;
+        return PP_DIRECTIVE_OTHER;
+}
+
+static int is_horizontal_space(int c)
+{
+        return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+/* Skips a group whose condition is false, from the end of the current line up
+ * to the #elif, #else or #endif that ends it. The lines are not lexed, and
+ * nested conditionals are skipped, too. Returns the PP_DIRECTIVE_* kind of the
+ * directive that ends the group, and leaves the cursor after its name. */
+static int skip_conditional_group(struct GP_Parser *parser)
+{
+        int depth = 0;
+        int pos = find_line_end(parser, parser->file.cursorPos, -1);
+        for (;;) {
+                if (char_at(parser, pos, pos) == -1) {
+                        const struct GP_Conditional *conditional = &parser->conditionals[parser->numConditionals - 1];
+                        parser->file.cursorPos = pos;
+                        gp_fatal_parse_error_f(parser, "EOF encountered while looking for the #endif of the conditional at %d:%d",
+                                               conditional->loc.line, conditional->loc.column);
+                }
+                pos++;  // newline
+                int c;
+                while (is_horizontal_space(c = char_at(parser, pos, pos)))
+                        pos++;
+                if (c == '#') {
+                        pos++;
+                        while (is_horizontal_space(c = char_at(parser, pos, pos)))
+                                pos++;
+                        char name[8];
+                        int nameStart = pos;
+                        while ((c = char_at(parser, pos, nameStart)) != -1 && CHAR_INFO(c)->nameChar) {
+                                if (pos - nameStart < (int) sizeof name)
+                                        name[pos - nameStart] = (char) c;
+                                pos++;
+                        }
+                        int length = pos - nameStart;
+                        int kind = length <= (int) sizeof name ? classify_directive_name(name, length) : PP_DIRECTIVE_OTHER;
+                        if (kind == PP_DIRECTIVE_IF) {
+                                depth++;
+                        }
+                        else if (kind != PP_DIRECTIVE_OTHER && depth == 0) {
+                                parser->file.cursorPos = pos;
+                                return kind;
+                        }
+                        else if (kind == PP_DIRECTIVE_ENDIF) {
+                                depth--;
+                        }
+                }
+                pos = find_line_end(parser, pos, -1);
+        }
+}
+
+static long long parse_pp_integer(struct GP_Parser *parser, const struct GP_PPToken *token)
+{
+        if (token->literalKind != GP_LITERAL_INT && token->literalKind != GP_LITERAL_UINT)
+                gp_fatal_parse_error_f(parser, "Invalid integer in preprocessor expression: '%s'", token->text);
+        return (long long) token->floatingValue;
+}
+
+static int pp_binop_precedence(int tokenKind)
+{
+        switch (tokenKind) {
+        case GP_TOKEN_DOUBLEPIPE: return 1;
+        case GP_TOKEN_DOUBLEAMPERSAND: return 2;
+        case GP_TOKEN_PIPE: return 3;
+        case GP_TOKEN_CARET: return 4;
+        case GP_TOKEN_AMPERSAND: return 5;
+        case GP_TOKEN_DOUBLEEQUALS: case GP_TOKEN_NE: return 6;
+        case GP_TOKEN_LT: case GP_TOKEN_GT: case GP_TOKEN_LE: case GP_TOKEN_GE: return 7;
+        case GP_TOKEN_LEFTSHIFT: case GP_TOKEN_RIGHTSHIFT: return 8;
+        case GP_TOKEN_PLUS: case GP_TOKEN_MINUS: return 9;
+        case GP_TOKEN_STAR: case GP_TOKEN_SLASH: case GP_TOKEN_PERCENT: return 10;
+        default: return 0;
+        }
+}
+
+/* Arithmetic wraps around instead of overflowing. Division by zero is only an
+ * error if the operation is evaluated. */
+static long long apply_pp_binop(struct GP_Parser *parser, int tokenKind, long long a, long long b, int isEvaluated)
+{
+        unsigned long long ua = (unsigned long long) a;
+        unsigned long long ub = (unsigned long long) b;
+        switch (tokenKind) {
+        case GP_TOKEN_DOUBLEPIPE: return a || b;
+        case GP_TOKEN_DOUBLEAMPERSAND: return a && b;
+        case GP_TOKEN_PIPE: return a | b;
+        case GP_TOKEN_CARET: return a ^ b;
+        case GP_TOKEN_AMPERSAND: return a & b;
+        case GP_TOKEN_DOUBLEEQUALS: return a == b;
+        case GP_TOKEN_NE: return a != b;
+        case GP_TOKEN_LT: return a < b;
+        case GP_TOKEN_GT: return a > b;
+        case GP_TOKEN_LE: return a <= b;
+        case GP_TOKEN_GE: return a >= b;
+        case GP_TOKEN_LEFTSHIFT: return b < 0 || b > 63 ? 0 : (long long) (ua << b);
+        case GP_TOKEN_RIGHTSHIFT: return b < 0 || b > 63 ? (a < 0 ? -1 : 0) : a >> b;
+        case GP_TOKEN_PLUS: return (long long) (ua + ub);
+        case GP_TOKEN_MINUS: return (long long) (ua - ub);
+        case GP_TOKEN_STAR: return (long long) (ua * ub);
+        case GP_TOKEN_SLASH:
+        case GP_TOKEN_PERCENT:
+                if (b == 0) {
+                        if (isEvaluated)
+                                gp_fatal_parse_error_f(parser, "Division by zero in preprocessor expression");
+                        return 0;
+                }
+                if (b == -1)  // LLONG_MIN / -1 overflows
+                        return tokenKind == GP_TOKEN_SLASH ? (long long) (0 - ua) : 0;
+                return tokenKind == GP_TOKEN_SLASH ? a / b : a % b;
+        default:
+                gp_fatal_f("Unhandled preprocessor operator %d", tokenKind);
+        }
 }
 
-static void gp_pop_file(struct GP_Ctx *ctx)
+static long long evaluate_pp_expression(struct GP_Parser *parser, int *pos, int minPrecedence,
+                                        int isEvaluated, int depth);  // forward declare: recursion
+
+static long long evaluate_pp_operand(struct GP_Parser *parser, int *pos, int isEvaluated, int depth)
 {
-        GP_ENSURE(ctx->fileStackSize > 0);
-        copy_remaining_bytes(ctx);
-        //gp_message_f("pop file '%s'", ctx->desc.fileInfo[ctx->fileStackSize - 1].fileID);
-        --ctx->fileStackSize;
-        if (ctx->fileStackSize > 0)
-                ctx->file = ctx->fileStack[ctx->fileStackSize - 1];
+        if (depth > MAX_PP_EXPRESSION_DEPTH)
+                gp_fatal_parse_error_f(parser, "Preprocessor expression nested too deeply");
+        if (*pos == parser->numExpandedTokens)
+                gp_fatal_parse_error_f(parser, "Unexpected end of preprocessor expression");
+        const struct GP_PPToken *token = &parser->expandedTokens[(*pos)++];
+        long long value;
+        switch (token->tokenKind) {
+        case GP_TOKEN_LITERAL:
+                return parse_pp_integer(parser, token);
+        case GP_TOKEN_PLUS:
+                return evaluate_pp_operand(parser, pos, isEvaluated, depth + 1);
+        case GP_TOKEN_MINUS:
+                value = evaluate_pp_operand(parser, pos, isEvaluated, depth + 1);
+                return (long long) (0 - (unsigned long long) value);
+        case GP_TOKEN_NOT:
+                return !evaluate_pp_operand(parser, pos, isEvaluated, depth + 1);
+        case GP_TOKEN_TILDE:
+                return ~evaluate_pp_operand(parser, pos, isEvaluated, depth + 1);
+        case GP_TOKEN_LEFTPAREN:
+                value = evaluate_pp_expression(parser, pos, 1, isEvaluated, depth + 1);
+                if (*pos == parser->numExpandedTokens || parser->expandedTokens[*pos].tokenKind != GP_TOKEN_RIGHTPAREN)
+                        gp_fatal_parse_error_f(parser, "Expected ')' in preprocessor expression");
+                (*pos)++;
+                return value;
+        case GP_TOKEN_NAME:
+                // like in glslang, "defined(X) && X" is fine
+                if (!isEvaluated)
+                        return 0;
+                gp_fatal_parse_error_f(parser, "Undefined identifier in preprocessor expression: '%s'", token->text);
+        default:
+                gp_fatal_parse_error_f(parser, "Unexpected token in preprocessor expression: '%s'", token->text);
+        }
 }
 
-int gp_find_file_index_from_id_or_fatal_error(struct GP_Ctx *ctx, const char *fileID)
+/* Precedence climbing over the expandedTokens, starting at *pos. If
+ * isEvaluated is not set, the expression is only parsed (this is for the
+ * right side of && and || when the left side decides). */
+static long long evaluate_pp_expression(struct GP_Parser *parser, int *pos, int minPrecedence,
+                                        int isEvaluated, int depth)
 {
-        for (int i = 0; i < ctx->desc.numFiles; i++)
-                if (!strcmp(fileID, ctx->desc.fileInfo[i].fileID))
-                        return i;
-        gp_fatal_parse_error_f(ctx, "No file with this fileID available: '%s'", fileID);
+        long long value = evaluate_pp_operand(parser, pos, isEvaluated, depth);
+        while (*pos < parser->numExpandedTokens) {
+                int tokenKind = parser->expandedTokens[*pos].tokenKind;
+                int precedence = pp_binop_precedence(tokenKind);
+                if (precedence == 0 || precedence < minPrecedence)
+                        break;
+                (*pos)++;
+                int isRightEvaluated = isEvaluated
+                        && !(tokenKind == GP_TOKEN_DOUBLEAMPERSAND && !value)
+                        && !(tokenKind == GP_TOKEN_DOUBLEPIPE && value);
+                long long right = evaluate_pp_expression(parser, pos, precedence + 1, isRightEvaluated, depth);
+                value = apply_pp_binop(parser, tokenKind, value, right, isRightEvaluated);
+        }
+        return value;
 }
 
-static int look_character(struct GP_Ctx *ctx)
+/* Reads the rest of an #if or #elif line. "defined" is handled before the
+ * other macros are expanded. */
+static int evaluate_condition(struct GP_Parser *parser)
 {
-        if (ctx->file.haveSavedCharacter)
-                return ctx->file.savedCharacter;
-        while (ctx->file.cursorPos == ctx->file.size) {
-                gp_pop_file(ctx);
-                if (ctx->fileStackSize == 0)
-                        return -1;
+        clear_expansion_state(parser);
+        struct GP_PPToken token;
+        while (look_token_no_preproc(parser)) {
+                if (parser->tokenKind == GP_TOKEN_NAME && token_equals(parser, "defined")) {
+                        consume_token(parser);
+                        int haveParen = look_token_no_preproc(parser) && parser->tokenKind == GP_TOKEN_LEFTPAREN;
+                        if (haveParen)
+                                consume_token(parser);
+                        if (!look_token_no_preproc(parser) || parser->tokenKind != GP_TOKEN_NAME)
+                                gp_fatal_parse_error_f(parser, "Expected macro name after 'defined'");
+                        int isDefined = find_macro(parser, token_data(parser), parser->tokenSpan.length) != -1;
+                        consume_token(parser);
+                        if (haveParen) {
+                                if (!look_token_no_preproc(parser) || parser->tokenKind != GP_TOKEN_RIGHTPAREN)
+                                        gp_fatal_parse_error_f(parser, "Expected ')' after 'defined('");
+                                consume_token(parser);
+                        }
+                        make_number_pptoken(parser, isDefined, &token);
+                        push_expanded_token(parser, token);
+                        continue;
+                }
+                make_pptoken(parser, &parser->scratchArena, &token);
+                consume_token(parser);
+                int m = token.tokenKind == GP_TOKEN_NAME ? find_macro(parser, token.text, token.textLength) : -1;
+                if (m != -1 && begin_macro_invocation(parser, m, &token, 0, 1))
+                        expand_frames(parser, 0, 1);
+                else
+                        push_expanded_token(parser, token);
         }
-        int c = ctx->file.contents[ctx->file.cursorPos];
-        ctx->file.cursorPos++;
-        ctx->file.savedCharacter = c;
-        ctx->file.haveSavedCharacter = 1;
-        return c;
+        int pos = 0;
+        long long value = evaluate_pp_expression(parser, &pos, 1, 1, 0);
+        if (pos != parser->numExpandedTokens)
+                gp_fatal_parse_error_f(parser, "Unexpected token in preprocessor expression: '%s'",
+                                       parser->expandedTokens[pos].text);
+        parser->numExpandedTokens = 0;
+        return value != 0;
 }
 
-static void consume_character(struct GP_Ctx *ctx)
+static int is_same_macro_definition(const struct GP_Macro *macro, int isFunctionLike, int numParams,
+                                    const char **paramNames, const struct GP_PPToken *body, int numBodyTokens)
 {
-        GP_ENSURE(ctx->file.haveSavedCharacter);
-        ctx->file.haveSavedCharacter = 0;
+        if (macro->isFunctionLike != isFunctionLike || macro->numParams != numParams
+            || macro->numBodyTokens != numBodyTokens)
+                return 0;
+        for (int i = 0; i < numParams; i++)
+                if (strcmp(macro->paramNames[i], paramNames[i]))
+                        return 0;
+        for (int i = 0; i < numBodyTokens; i++) {
+                const struct GP_PPToken *a = &macro->body[i];
+                const struct GP_PPToken *b = &body[i];
+                if (a->tokenKind != b->tokenKind || a->flags != b->flags || a->paramIndex != b->paramIndex
+                    || a->textLength != b->textLength || memcmp(a->text, b->text, a->textLength))
+                        return 0;
+        }
+        return 1;
 }
 
-static void reset_tokenbuffer(struct GP_Ctx *ctx)
+/* The macro that is about to be defined by the user */
+static int add_user_macro(struct GP_Parser *parser, const char *name, int length)
 {
-        ctx->tokenBufferLength = 0;
+        if (length >= 3 && !memcmp(name, "GL_", 3))
+                gp_fatal_parse_error_f(parser, "Macro names starting with 'GL_' are reserved");
+        int m = add_macro(parser, name, length);
+        if (parser->macros[m].builtinKind != GP_BUILTIN_MACRO_NONE)
+                gp_fatal_parse_error_f(parser, "Cannot redefine built-in macro '%s'", parser->macros[m].name);
+        return m;
 }
 
-static void append_to_tokenbuffer(struct GP_Ctx *ctx, int character)
+/* Defines macro m with the body that was collected on the ppTokenStack */
+static void install_macro(struct GP_Parser *parser, int m, int isFunctionLike,
+                          int numParams, const char **paramNames)
 {
-        if (ctx->tokenBufferLength + 1 >= ctx->tokenBufferCapacity) {
-                int capacity;
-                if (ctx->tokenBufferCapacity == 0)
-                        capacity = 32;
-                else
-                        capacity = 2 * ctx->tokenBufferCapacity;
-                REALLOC_MEMORY(&ctx->tokenBuffer, capacity);
-                ctx->tokenBufferCapacity = capacity;
+        struct GP_Macro *macro = &parser->macros[m];
+        int numBodyTokens = parser->ppTokenStackSize;
+        parser->ppTokenStackSize = 0;
+        if (macro->isDefined) {
+                if (!is_same_macro_definition(macro, isFunctionLike, numParams, paramNames,
+                                              parser->ppTokenStack, numBodyTokens))
+                        gp_fatal_parse_error_f(parser, "Macro '%s' redefined differently", macro->name);
+                return;
         }
-        int pos = ctx->tokenBufferLength ++;
-        ctx->tokenBuffer[pos] = character;
-        ctx->tokenBuffer[pos + 1] = '\0';
+        ARENA_ALLOC_MEMORY(&parser->ppArena, &macro->body, numBodyTokens);
+        if (numBodyTokens > 0)  // the stack might not be allocated
+                memcpy(macro->body, parser->ppTokenStack, numBodyTokens * sizeof *macro->body);
+        macro->isDefined = 1;
+        macro->isFunctionLike = isFunctionLike;
+        macro->numParams = numParams;
+        macro->paramNames = paramNames;
+        macro->numBodyTokens = numBodyTokens;
+        macro->hasPaste = 0;
+        for (int i = 0; i < numBodyTokens; i++)
+                if (macro->body[i].flags & GP_PPTOKEN_PASTE)
+                        macro->hasPaste = 1;
+        macro->expansionGeneration = -1;
+        parser->numUserMacros++;
+        parser->macroGeneration++;
 }
 
-static int look_token_no_preproc(struct GP_Ctx *ctx)
+static void parse_define(struct GP_Parser *parser)
 {
-        if (ctx->haveSavedToken)
-                return 1;
-        int c;
-skipwhitespace:
-        for (;;) {
-                c = look_character(ctx);
-                if (c > 32)
-                        break;
-                if (c == -1) {
-                        ctx->tokenKind = GP_TOKEN_EOF;
-                        return 0;
-                }
-                consume_character(ctx);
-        }
-        /* skip comments... */
-        if (c == '/') {
-                consume_character(ctx);
-                c = look_character(ctx);
-                if (c == '*') {
-                        consume_character(ctx);
+        if (!look_token_no_preproc(parser) || parser->tokenKind != GP_TOKEN_NAME)
+                gp_fatal_parse_error_f(parser, "Expected macro name after #define");
+        int m = add_user_macro(parser, token_data(parser), parser->tokenSpan.length);
+        int nameEnd = parser->tokenEnd;
+        consume_token(parser);
+        int isFunctionLike = 0;
+        int numParams = 0;
+        const char **paramNames = NULL;
+        // only a '(' directly after the name starts a parameter list
+        if (look_token_no_preproc(parser) && parser->tokenKind == GP_TOKEN_LEFTPAREN && parser->tokenStart == nameEnd) {
+                isFunctionLike = 1;
+                consume_token(parser);
+                if (look_token_no_preproc(parser) && parser->tokenKind != GP_TOKEN_RIGHTPAREN) {
                         for (;;) {
-                                c = look_character(ctx);
-                                if (c == -1) {
-                                        gp_fatal_parse_error_f(ctx,
-                        "EOF encountered while expecting end of comment");
-                                }
-                                consume_character(ctx);
-                                if (c == '*' && look_character(ctx) == '/') {
-                                        consume_character(ctx);
+                                if (!look_token_no_preproc(parser) || parser->tokenKind != GP_TOKEN_NAME)
+                                        gp_fatal_parse_error_f(parser, "Expected parameter name in definition of macro '%s'",
+                                                               parser->macros[m].name);
+                                for (int i = 0; i < numParams; i++)
+                                        if (token_equals(parser, paramNames[i]))
+                                                gp_fatal_parse_error_f(parser, "Duplicate parameter '%s' in definition of macro '%s'",
+                                                                       paramNames[i], parser->macros[m].name);
+                                ARENA_REALLOC_MEMORY(&parser->ppArena, &paramNames, numParams, numParams + 1);
+                                paramNames[numParams++] = copy_text(&parser->ppArena, token_data(parser), parser->tokenSpan.length);
+                                consume_token(parser);
+                                if (look_token_no_preproc(parser) && parser->tokenKind == GP_TOKEN_RIGHTPAREN)
                                         break;
-                                }
+                                if (!look_token_no_preproc(parser) || parser->tokenKind != GP_TOKEN_COMMA)
+                                        gp_fatal_parse_error_f(parser, "Expected ',' or ')' in parameter list of macro '%s'",
+                                                               parser->macros[m].name);
+                                consume_token(parser);
                         }
-                        goto skipwhitespace;
                 }
-                else if (c == '/') {
-                        consume_character(ctx);
-                        for (;;) {
-                                c = look_character(ctx);
-                                if (c == -1) {
-                                        // let's not consider that a failure
-                                        // here... just back out
-                                        goto skipwhitespace;
-                                }
-                                consume_character(ctx);
-                                if (c == '\n') {
-                                        goto skipwhitespace;
-                                }
-                        }
-                }
-                else {
-                        ctx->tokenKind = GP_TOKEN_SLASH;
+                if (!look_token_no_preproc(parser))
+                        gp_fatal_parse_error_f(parser, "Unterminated parameter list of macro '%s'", parser->macros[m].name);
+                consume_token(parser);  // ')'
+        }
+        /* The body is collected on the ppTokenStack, which is unused
+         * between expansions. */
+        parser->ppTokenStackSize = 0;
+        while (look_token_no_preproc(parser)) {
+                if (parser->tokenKind == GP_TOKEN_HASH && char_at(parser, parser->tokenEnd, parser->tokenStart) == '#') {
+                        // "##" marks the token before it
+                        if (parser->ppTokenStackSize == 0)
+                                gp_fatal_parse_error_f(parser, "'##' at the start of the body of macro '%s'",
+                                                       parser->macros[m].name);
+                        consume_token(parser);
+                        look_token_no_preproc(parser);
+                        consume_token(parser);
+                        if (!look_token_no_preproc(parser))
+                                gp_fatal_parse_error_f(parser, "'##' at the end of the body of macro '%s'",
+                                                       parser->macros[m].name);
+                        parser->ppTokenStack[parser->ppTokenStackSize - 1].flags |= GP_PPTOKEN_PASTE;
+                        continue;
                 }
+                if (parser->tokenKind == GP_TOKEN_HASH)
+                        gp_fatal_parse_error_f(parser, "'#' in the body of macro '%s' (GLSL has no '#' operator)",
+                                               parser->macros[m].name);
+                struct GP_PPToken token;
+                make_pptoken(parser, &parser->ppArena, &token);
+                if (parser->ppTokenStackSize == 0)
+                        token.flags &= ~GP_PPTOKEN_LEADING_SPACE;
+                if (token.tokenKind == GP_TOKEN_NAME)
+                        for (int i = 0; i < numParams; i++)
+                                if (!strcmp(token.text, paramNames[i]))
+                                        token.paramIndex = i;
+                push_pptoken(parser, token);
+                consume_token(parser);
         }
-        else if (('a' <= c && c <= 'z')
-            || ('A' <= c && c <= 'Z')
-            || (c == '_')) {
-                ctx->tokenKind = GP_TOKEN_NAME;
-                reset_tokenbuffer(ctx);
-                for (;;) {
-                        append_to_tokenbuffer(ctx, c);
-                        consume_character(ctx);
-                        c = look_character(ctx);
-                        if (!(('a' <= c && c <= 'z')
-                              || ('A' <= c && c <= 'Z')
-                              || (c == '_')
-                              || ('0' <= c && c <= '9')))
-                                break;
+        install_macro(parser, m, isFunctionLike, numParams, paramNames);
+}
+
+/* Defines the macros of a parse unit, as if by "#define NAME VALUE" at the
+ * start of the file. The items are "NAME" or "NAME=VALUE", separated by
+ * whitespace, so the value can't contain whitespace. It defaults to 1. */
+static void define_predefined_macros(struct GP_Parser *parser, const char *defines)
+{
+        const char *p = defines;
+        for (;;) {
+                // '\0' is a space character for the lexer
+                while (*p != '\0' && CHAR_INFO(*p)->charClass == CHAR_SPACE)
+                        p++;
+                if (*p == '\0')
+                        break;
+                const char *itemEnd = p;
+                while (*itemEnd != '\0' && CHAR_INFO(*itemEnd)->charClass != CHAR_SPACE)
+                        itemEnd++;
+                struct GP_LexedToken lexed;
+                const char *nameEnd = lex_token_text(p, itemEnd, &lexed);
+                if (nameEnd == NULL || lexed.tokenKind != GP_TOKEN_NAME
+                    || (nameEnd < itemEnd && *nameEnd != '='))
+                        gp_fatal_f("Invalid predefined macro '%.*s'", (int) (itemEnd - p), p);
+                int m = add_user_macro(parser, p, (int) (nameEnd - p));
+                const char *value = nameEnd < itemEnd ? nameEnd + 1 : "1";
+                const char *valueEnd = nameEnd < itemEnd ? itemEnd : value + 1;
+                parser->ppTokenStackSize = 0;
+                while (value < valueEnd) {
+                        const char *tokenEnd = lex_token_text(value, valueEnd, &lexed);
+                        if (tokenEnd == NULL || lexed.tokenKind == GP_TOKEN_HASH)
+                                gp_fatal_f("Failed to lex the value of predefined macro '%.*s'",
+                                           (int) (itemEnd - p), p);
+                        struct GP_PPToken token;
+                        int length = (int) (tokenEnd - value);
+                        make_lexed_pptoken(&lexed, copy_text(&parser->ppArena, value, length), length, &token);
+                        // not from the file. Only the length matters.
+                        token.span.fileIndex = parser->file.fileIndex;
+                        token.span.offset = 0;
+                        push_pptoken(parser, token);
+                        value = tokenEnd;
                 }
+                install_macro(parser, m, 0, 0, NULL);
+                p = itemEnd;
         }
-        else if ('0' <= c && c <= '9') {
-                ctx->tokenKind = GP_TOKEN_LITERAL;
-                long long d = c - '0';
-                int haveDot = 0;
-                int nAfter = 0;
-                for (;;) {
-                        consume_character(ctx);
-                        c = look_character(ctx);
-                        if ('0' <= c && c <= '9') {
-                                d = 10 * d + c - '0';
-                                if (haveDot)
-                                        nAfter++;
-                        }
-                        else if (!haveDot && c == '.')
-                                haveDot = 1;
-                        else
-                                break;
+}
+
+static void parse_undef(struct GP_Parser *parser)
+{
+        if (!look_token_no_preproc(parser) || parser->tokenKind != GP_TOKEN_NAME)
+                gp_fatal_parse_error_f(parser, "Expected macro name after #undef");
+        int m = find_macro(parser, token_data(parser), parser->tokenSpan.length);
+        if (m != -1) {
+                if (parser->macros[m].builtinKind != GP_BUILTIN_MACRO_NONE)
+                        gp_fatal_parse_error_f(parser, "Cannot undefine built-in macro '%s'", parser->macros[m].name);
+                parser->macros[m].isDefined = 0;
+                parser->macroGeneration++;
+        }
+        consume_token(parser);
+        expect_end_of_directive(parser, "undef");
+}
+
+static struct GP_Conditional *get_current_conditional(struct GP_Parser *parser, const char *directiveName)
+{
+        if (parser->numConditionals == 0
+            || parser->conditionals[parser->numConditionals - 1].fileStackSize != parser->fileStackSize)
+                gp_fatal_parse_error_f(parser, "#%s without #if", directiveName);
+        return &parser->conditionals[parser->numConditionals - 1];
+}
+
+/* After the condition of an #if, #ifdef or #ifndef was read. If it is false,
+ * the groups are skipped until one is found whose condition is true. */
+static void begin_conditional(struct GP_Parser *parser, struct GP_SourceLoc loc, int condition)
+{
+        if (parser->numConditionalsAllocated == parser->numConditionals) {
+                parser->numConditionalsAllocated = parser->numConditionals ? 2 * parser->numConditionals : 16;
+                REALLOC_MEMORY(&parser->conditionals, parser->numConditionalsAllocated);
+        }
+        struct GP_Conditional *conditional = &parser->conditionals[parser->numConditionals++];
+        conditional->fileStackSize = parser->fileStackSize;
+        conditional->haveElse = 0;
+        conditional->loc = loc;
+        end_directive(parser);
+        while (!condition) {
+                int directiveKind = skip_conditional_group(parser);
+                begin_directive(parser, parser->file.cursorPos);
+                if (directiveKind == PP_DIRECTIVE_ENDIF) {
+                        parser->numConditionals--;
+                        condition = 1;
                 }
-                double floatingValue = (double) d;
-                while (nAfter > 0) {
-                        nAfter--;
-                        floatingValue /= 10.0;
+                else if (conditional->haveElse) {
+                        gp_fatal_parse_error_f(parser, "#%s after #else",
+                                               directiveKind == PP_DIRECTIVE_ELSE ? "else" : "elif");
                 }
-                //message_f("read floating value: %f", floatingValue);
-        }
-        else if (c == '"') {
-                ctx->tokenKind = GP_TOKEN_STRING;
-                /* I believe there are no strings in GLSL, but we will
-                 * have a use for them... */
-                consume_character(ctx);
-                reset_tokenbuffer(ctx);
-                for (;;) {
-                        c = look_character(ctx);
-                        if (c == '"') {
-                                consume_character(ctx);
-                                break;
-                        }
-                        else if (c == -1) {
-                                //message_s("EOF");
-                                break;
-                        }
-                        else {
-                                consume_character(ctx);
-                                append_to_tokenbuffer(ctx, c);
-                        }
+                else if (directiveKind == PP_DIRECTIVE_ELSE) {
+                        conditional->haveElse = 1;
+                        condition = 1;
+                }
+                else {
+                        condition = evaluate_condition(parser);
                 }
+                end_directive(parser);
+        }
+}
+
+/* At an #elif or #else after a group that was included. The remaining groups
+ * are skipped. */
+static void skip_remaining_groups(struct GP_Parser *parser, int directiveKind)
+{
+        struct GP_Conditional *conditional = get_current_conditional(parser, directiveKind == PP_DIRECTIVE_ELSE ? "else" : "elif");
+        for (;;) {
+                if (conditional->haveElse)
+                        gp_fatal_parse_error_f(parser, "#%s after #else",
+                                               directiveKind == PP_DIRECTIVE_ELSE ? "else" : "elif");
+                if (directiveKind == PP_DIRECTIVE_ELSE)
+                        conditional->haveElse = 1;
+                end_directive(parser);
+                directiveKind = skip_conditional_group(parser);
+                begin_directive(parser, parser->file.cursorPos);
+                if (directiveKind == PP_DIRECTIVE_ENDIF)
+                        break;
         }
+        end_directive(parser);
+        parser->numConditionals--;
+}
+
+/* #pragma, #extension and #line are for the GLSL compiler. They are written
+ * to the output on a line of their own. */
+/* nameStart is the position of the directive name */
+static void pass_directive_through(struct GP_Parser *parser, int nameStart)
+{
+        append_line_breaks(parser, parser->file.outputFilePosition, nameStart);
+        int c = last_output_char(parser);
+        if (c != '\n')
+                append_output_text(parser, "\n#", 2);
+        else
+                append_output_text(parser, "#", 1);
+        append_output(parser, nameStart, parser->lexEnd);
+        // the line breaks up to here are in the output
+        parser->file.outputFilePosition = parser->lexEnd;
+        end_directive(parser);
+}
+
+/* After the "#ifndef X" at the start of a file, which began conditional
+ * conditionalIndex. If X was defined, the group was skipped already: the file
+ * is still guarded if it was skipped up to the #endif. */
+static void begin_guard(struct GP_Parser *parser, int guardMacro, int conditionalIndex, int wasDefined)
+{
+        struct GP_FileStackItem *file = &parser->file;
+        if (parser->numConditionals == conditionalIndex)
+                file->guardState = GP_GUARD_AFTER;
+        else if (wasDefined)
+                file->guardState = GP_GUARD_NONE;  // there was an #elif or #else
         else {
-                for (int i = 0; i < LENGTH(tokInfo1); i++) {
-                        if (c == tokInfo1[i].character) {
-                                consume_character(ctx);
-                                ctx->tokenKind = tokInfo1[i].tokenKind;
-                                goto ok;
-                        }
-                }
-                for (int i = 0; i < LENGTH(tokInfo2); i++) {
-                        if (c == tokInfo2[i].character1) {
-                                consume_character(ctx);
-                                if (look_character(ctx)
-                                    == tokInfo2[i].character2) {
-                                        consume_character(ctx);
-                                        ctx->tokenKind = tokInfo2[i].tokenKind2;
-                                }
-                                else {
-                                        ctx->tokenKind = tokInfo2[i].tokenKind1;
-                                }
-                                goto ok;
-                        }
-                }
-                gp_fatal_parse_error_f(ctx,
-                                "Failed to lex; initial character: '%c'", c);
-ok:
-                ;
+                file->guardState = GP_GUARD_INSIDE;
+                file->guardMacro = guardMacro;
+                file->guardConditional = conditionalIndex;
         }
-        ctx->haveSavedToken = 1;
-        return 1;
 }
 
-static void consume_token(struct GP_Ctx *ctx)
+static int is_in_guard_group(struct GP_Parser *parser)
 {
-        GP_ENSURE(ctx->haveSavedToken);
-        ctx->haveSavedToken = 0;
-        ctx->file.indexOfFirstUnconsumedToken = ctx->file.cursorPos;
+        return parser->file.guardState == GP_GUARD_INSIDE
+                && parser->file.guardConditional == parser->numConditionals - 1;
 }
 
-static int look_token(struct GP_Ctx *ctx)
+/* Whether an #include of the file can be skipped */
+static int is_file_guarded(struct GP_Parser *parser, int fileIndex)
 {
-        if (!look_token_no_preproc(ctx))
-                return 0;
-        if (ctx->tokenKind != GP_TOKEN_HASH)
-                return 1;
-        /* We have a TOKEN_HASH. Suspend copying input to output until the end
-         * of this preprocessor directive. */
-        suspend_copying(ctx);
-        consume_token(ctx);
-        if (!look_token_no_preproc(ctx)
-            || ctx->tokenKind != GP_TOKEN_NAME)
-                gp_fatal_parse_error_f(ctx,
+        int guard = parser->fileGuards[fileIndex];
+        return guard == GP_FILE_ONCE || (guard >= 0 && parser->macros[guard].isDefined);
+}
+
+/* The '#' is the current token */
+static void handle_directive(struct GP_Parser *parser)
+{
+        // only the directives inside the guard group keep a file guarded
+        int guardState = parser->file.guardState;
+        if (guardState != GP_GUARD_INSIDE)
+                parser->file.guardState = GP_GUARD_NONE;
+        int hashPos = parser->tokenStart;
+        /* Suspend copying input to output until the end of this preprocessor
+         * directive. */
+        suspend_copying(parser);
+        consume_token(parser);
+        begin_directive(parser, hashPos);
+        if (!look_token_no_preproc(parser)) {
+                // null directive
+                end_directive(parser);
+                resume_copying(parser);
+                return;
+        }
+        if (parser->tokenKind != GP_TOKEN_NAME)
+                gp_fatal_parse_error_f(parser,
                                 "parse error while looking for name of preprocessing directive");
-        if (!strcmp(ctx->tokenBuffer, "include")) {
-                consume_token(ctx);
-                if (!look_token_no_preproc(ctx)
-                    || ctx->tokenKind != GP_TOKEN_STRING)
-                        gp_fatal_parse_error_f(ctx,
+        if (token_equals(parser, "include")) {
+                consume_token(parser);
+                if (!look_token_no_preproc(parser)
+                    || parser->tokenKind != GP_TOKEN_STRING)
+                        gp_fatal_parse_error_f(parser,
                                         "Expected string literal giving file to #include");
-                consume_token(ctx);
-                /* TODO: make sure to resume _after end of line_ */
-                resume_copying(ctx);
-                /* TODO: make sure line is terminated after string literal token */
-                int fileIndex = gp_find_file_index_from_id_or_fatal_error(ctx, ctx->tokenBuffer);
-                gp_push_file(ctx, fileIndex);
-        }
-        else if (!strcmp(ctx->tokenBuffer, "version")) {
-                consume_token(ctx);
-                if (!look_token_no_preproc(ctx)
-                    || ctx->tokenKind != GP_TOKEN_LITERAL)
-                        gp_fatal_parse_error_f(ctx,
+                int fileIndex = find_file_index_from_token_or_fatal_error(parser);
+                consume_token(parser);
+                expect_end_of_directive(parser, "include");
+                end_directive(parser);
+                resume_copying(parser);
+                if (!is_file_guarded(parser, fileIndex))
+                        gp_push_file(parser, fileIndex);
+                return;
+        }
+        if (token_equals(parser, "version")) {
+                consume_token(parser);
+                if (!look_token_no_preproc(parser)
+                    || parser->tokenKind != GP_TOKEN_LITERAL)
+                        gp_fatal_parse_error_f(parser,
                                         "Expected version num in #version directive");
-                consume_token(ctx);
-                resume_copying(ctx);
+                parser->versionNumber = (int) parser->tokenFloatingValue;
+                consume_token(parser);
+                // profile
+                if (look_token_no_preproc(parser) && parser->tokenKind == GP_TOKEN_NAME)
+                        consume_token(parser);
+                expect_end_of_directive(parser, "version");
+                end_directive(parser);
+        }
+        else if (token_equals(parser, "define")) {
+                consume_token(parser);
+                parse_define(parser);
+                end_directive(parser);
+        }
+        else if (token_equals(parser, "undef")) {
+                consume_token(parser);
+                parse_undef(parser);
+                end_directive(parser);
+        }
+        else if (token_equals(parser, "ifdef") || token_equals(parser, "ifndef")) {
+                int isIfdef = token_equals(parser, "ifdef");
+                struct GP_SourceLoc loc = compute_current_source_loc(parser);
+                consume_token(parser);
+                if (!look_token_no_preproc(parser) || parser->tokenKind != GP_TOKEN_NAME)
+                        gp_fatal_parse_error_f(parser, "Expected macro name after #%s", isIfdef ? "ifdef" : "ifndef");
+                int isDefined = find_macro(parser, token_data(parser), parser->tokenSpan.length) != -1;
+                int isGuard = !isIfdef && guardState == GP_GUARD_START;
+                int guardMacro = isGuard ? add_macro(parser, token_data(parser), parser->tokenSpan.length) : -1;
+                consume_token(parser);
+                expect_end_of_directive(parser, isIfdef ? "ifdef" : "ifndef");
+                int conditionalIndex = parser->numConditionals;
+                begin_conditional(parser, loc, isIfdef ? isDefined : !isDefined);
+                if (isGuard)
+                        begin_guard(parser, guardMacro, conditionalIndex, isDefined);
+        }
+        else if (token_equals(parser, "if")) {
+                struct GP_SourceLoc loc = compute_current_source_loc(parser);
+                consume_token(parser);
+                begin_conditional(parser, loc, evaluate_condition(parser));
+        }
+        else if (token_equals(parser, "elif")) {
+                if (is_in_guard_group(parser))
+                        parser->file.guardState = GP_GUARD_NONE;
+                skip_remaining_groups(parser, PP_DIRECTIVE_ELIF);
+        }
+        else if (token_equals(parser, "else")) {
+                if (is_in_guard_group(parser))
+                        parser->file.guardState = GP_GUARD_NONE;
+                consume_token(parser);
+                expect_end_of_directive(parser, "else");
+                skip_remaining_groups(parser, PP_DIRECTIVE_ELSE);
+        }
+        else if (token_equals(parser, "endif")) {
+                get_current_conditional(parser, "endif");
+                consume_token(parser);
+                expect_end_of_directive(parser, "endif");
+                if (is_in_guard_group(parser))
+                        parser->file.guardState = GP_GUARD_AFTER;
+                parser->numConditionals--;
+                end_directive(parser);
+        }
+        else if (token_equals(parser, "error")) {
+                int start = parser->tokenEnd;
+                const char *text = parser->file.contents + (start - parser->file.windowStart);
+                gp_fatal_parse_error_f(parser, "#error%.*s", parser->lexEnd - start, text);
+        }
+        else if (token_equals(parser, "pragma")) {
+                int nameStart = parser->tokenStart;
+                consume_token(parser);
+                if (look_token_no_preproc(parser) && parser->tokenKind == GP_TOKEN_NAME
+                    && token_equals(parser, "once")) {
+                        consume_token(parser);
+                        expect_end_of_directive(parser, "pragma once");
+                        parser->fileGuards[parser->file.fileIndex] = GP_FILE_ONCE;
+                        end_directive(parser);
+                }
+                else {
+                        pass_directive_through(parser, nameStart);
+                }
+        }
+        else if (token_equals(parser, "extension") || token_equals(parser, "line")) {
+                pass_directive_through(parser, parser->tokenStart);
         }
         else {
-                gp_fatal_parse_error_f(ctx,
-                                "Unknown preprocessing directive: #%s", ctx->tokenBuffer);
+                gp_fatal_parse_error_f(parser,
+                                "Unknown preprocessing directive: #%.*s",
+                                parser->tokenSpan.length, token_data(parser));
         }
-        return look_token(ctx);
+        resume_copying(parser);
 }
 
-static int is_keyword(struct GP_Ctx *ctx, const char *keyword)
+/* Like look_token_no_preproc(), but preprocessing directives are handled and
+ * macros are expanded. */
+static int look_token(struct GP_Parser *parser)
 {
-        GP_ENSURE(ctx->haveSavedToken);
-        if (ctx->tokenKind != GP_TOKEN_NAME)
-                return 0;
-        return !strcmp(ctx->tokenBuffer, keyword);
+        for (;;) {
+                if (parser->haveSavedToken)
+                        return 1;
+                if (parser->pendingTokenIndex < parser->pendingTokenEnd) {
+                        load_pending_token(parser);
+                        return 1;
+                }
+                if (!look_token_no_preproc(parser))
+                        return 0;
+                if (parser->tokenKind == GP_TOKEN_HASH) {
+                        handle_directive(parser);
+                        continue;
+                }
+                if (parser->file.guardState != GP_GUARD_INSIDE)
+                        parser->file.guardState = GP_GUARD_NONE;
+                if (parser->tokenKind == GP_TOKEN_NAME) {
+                        int m = find_macro(parser, token_data(parser), parser->tokenSpan.length);
+                        if (m != -1) {
+                                expand_macro_in_file(parser, m);
+                                continue;
+                        }
+                }
+                return 1;
+        }
 }
 
-static int is_known_type_name(struct GP_Ctx *ctx)
+static int is_keyword(struct GP_Parser *parser, int keywordKind)
 {
-        for (int i = 0; i < GP_NUM_TYPE_KINDS; i++)
-                if (!strcmp(ctx->tokenBuffer, gp_typeString[i]))
-                        return 1;
-        return 0;
+        GP_ENSURE(parser->haveSavedToken);
+        return parser->tokenKind == GP_TOKEN_NAME && parser->tokenKeywordKind == keywordKind;
+}
+
+static int is_known_type_name(struct GP_Parser *parser)
+{
+        GP_ENSURE(parser->haveSavedToken);
+        return parser->tokenKind == GP_TOKEN_NAME && parser->tokenTypeKind != -1;
 }
 
-static int is_binop_token(struct GP_Ctx *ctx, int *binopKind)
+static int is_binop_token(struct GP_Parser *parser, int *binopKind)
 {
-        GP_ENSURE(ctx->haveSavedToken);
+        GP_ENSURE(parser->haveSavedToken);
         for (int i = 0; i < gp_numBinopTokens; i++) {
-                if (ctx->tokenKind == gp_binopTokenInfo[i].tokenKind) {
+                if (parser->tokenKind == gp_binopTokenInfo[i].tokenKind) {
                         *binopKind = gp_binopTokenInfo[i].binopKind;
                         return 1;
                 }
@@ -430,341 +2685,1046 @@ static int is_binop_token(struct GP_Ctx *ctx, int *binopKind)
         return 0;
 }
 
-static int look_token_kind(struct GP_Ctx *ctx, int tokenKind)
+static int look_token_kind(struct GP_Parser *parser, int tokenKind)
 {
-        return look_token(ctx) && ctx->tokenKind == tokenKind;
+        return look_token(parser) && parser->tokenKind == tokenKind;
 }
 
-static void expect_token_kind(struct GP_Ctx *ctx, int tokenKind)
+static void expect_token_kind(struct GP_Parser *parser, int tokenKind)
 {
-        if (!look_token_kind(ctx, tokenKind))
-                gp_fatal_parse_error_f(ctx, "expected '%s' token, found: '%s'",
+        if (!look_token_kind(parser, tokenKind))
+                gp_fatal_parse_error_f(parser, "expected '%s' token, found: '%s'",
                                     gp_tokenKindString[tokenKind],
-                                    gp_tokenKindString[ctx->tokenKind]);
+                                    gp_tokenKindString[parser->tokenKind]);
 }
 
-static char *alloc_string(struct GP_Ctx *ctx, const char *data)
+static void parse_simple_token(struct GP_Parser *parser, int tokenKind)
 {
-        int length = (int) strlen(data);
-        char *string;
-        ALLOC_MEMORY(&string, length + 1);
-        memcpy(string, data, length + 1);
-        return string;
-}
-
-static void parse_simple_token(struct GP_Ctx *ctx, int tokenKind)
-{
-        expect_token_kind(ctx, tokenKind);
-        consume_token(ctx);
+        expect_token_kind(parser, tokenKind);
+        consume_token(parser);
 }
 
-static void parse_semicolon(struct GP_Ctx *ctx)
+static void parse_semicolon(struct GP_Parser *parser)
 {
-        parse_simple_token(ctx, GP_TOKEN_SEMICOLON);
+        parse_simple_token(parser, GP_TOKEN_SEMICOLON);
 }
 
-static char *parse_name(struct GP_Ctx *ctx)
+static GP_Atom parse_name(struct GP_Parser *parser)
 {
-        expect_token_kind(ctx, GP_TOKEN_NAME);
-        //message_f("name is '%s'", ctx->tokenBuffer);
-        char *name = alloc_string(ctx, ctx->tokenBuffer);
-        consume_token(ctx);
+        expect_token_kind(parser, GP_TOKEN_NAME);
+        GP_Atom name = intern_token(parser);
+        consume_token(parser);
         return name;
 }
 
-// TODO: attach to context
-#define DEFINE_ALLOCATOR_FUNCTION(type, name) type *name(struct GP_Ctx *ctx) \
+#define DEFINE_ALLOCATOR_FUNCTION(type, name) static type *name(struct GP_Parser *parser) \
 { \
         type *x; \
-        ALLOC_MEMORY(&x, sizeof *x); \
+        ARENA_ALLOC_MEMORY(&parser->arena, &x, 1); \
         return x; \
 }
 
 DEFINE_ALLOCATOR_FUNCTION(struct GP_TypeExpr, create_typeexpr)
 DEFINE_ALLOCATOR_FUNCTION(struct GP_UniformDecl, create_uniformdecl)
+DEFINE_ALLOCATOR_FUNCTION(struct GP_BlockDecl, create_blockdecl)
 DEFINE_ALLOCATOR_FUNCTION(struct GP_VariableDecl, create_variabledecl)
 DEFINE_ALLOCATOR_FUNCTION(struct GP_FuncDecl, create_funcdecl)
 DEFINE_ALLOCATOR_FUNCTION(struct GP_FuncDefn, create_funcdefn)
+DEFINE_ALLOCATOR_FUNCTION(struct GP_ToplevelNode, create_toplevelnode)
 
-struct GP_ToplevelNode *gp_add_new_toplevel_node(struct GP_Ctx *ctx)
+struct GP_ToplevelNode *gp_add_new_toplevel_node(struct GP_Parser *parser)
 {
-        struct GP_ShaderfileAst *fa = &ctx->shaderfileAsts[ctx->currentShaderIndex];
+        struct GP_ShaderfileAst *fa = parser->currentAst;
+        if (fa->numToplevelNodes == fa->numToplevelNodesAllocated) {
+                int numAllocated = fa->numToplevelNodesAllocated ? 2 * fa->numToplevelNodesAllocated : 16;
+                ARENA_REALLOC_MEMORY(&parser->arena, &fa->toplevelNodes, fa->numToplevelNodes, numAllocated);
+                fa->numToplevelNodesAllocated = numAllocated;
+        }
         int idx = fa->numToplevelNodes ++;
-        REALLOC_MEMORY(&fa->toplevelNodes, fa->numToplevelNodes);
-        ALLOC_MEMORY(&fa->toplevelNodes[idx], 1);
+        fa->toplevelNodes[idx] = create_toplevelnode(parser);
+        fa->toplevelNodes[idx]->loc = parser->currentToplevelLoc;
+        fa->toplevelNodes[idx]->outputStart = -1;
+        fa->toplevelNodes[idx]->outputEnd = -1;
         return fa->toplevelNodes[idx];
 }
 
 //XXX: if we detect that this is an interface block, we'll return NULL
-static struct GP_TypeExpr *parse_typeexpr(struct GP_Ctx *ctx)
+static struct GP_TypeExpr *parse_typeexpr(struct GP_Parser *parser)
 {
-        expect_token_kind(ctx, GP_TOKEN_NAME);
-        while (is_keyword(ctx, "flat")) {
+        expect_token_kind(parser, GP_TOKEN_NAME);
+        while (is_keyword(parser, GP_KEYWORD_FLAT)) {
                 // XXX ignoring "flat" specifier for now. Not interesting to us.
-                consume_token(ctx);
-                expect_token_kind(ctx, GP_TOKEN_NAME);
+                consume_token(parser);
+                expect_token_kind(parser, GP_TOKEN_NAME);
         }
-        for (int i = 0; i < GP_NUM_TYPE_KINDS; i++) {
-                if (is_keyword(ctx, gp_typeString[i])) {
-                        consume_token(ctx);
-                        //message_f("parsed type %s", typeInfo[i].name);
-                        struct GP_TypeExpr *typeExpr = create_typeexpr(ctx);
-                        typeExpr->typeKind = i;
-                        return typeExpr;
-                }
+        if (is_known_type_name(parser)) {
+                int typeKind = parser->tokenTypeKind;
+                consume_token(parser);
+                //message_f("parsed type %s", gp_typeString[typeKind]);
+                struct GP_TypeExpr *typeExpr = create_typeexpr(parser);
+                typeExpr->typeKind = typeKind;
+                return typeExpr;
         }
         // maybe this is an interface block...
-        consume_token(ctx);
-        if (look_token_kind(ctx, GP_TOKEN_LEFTBRACE)) {
+        consume_token(parser);
+        if (look_token_kind(parser, GP_TOKEN_LEFTBRACE)) {
                 // this is an interface block. Parse it and ignore the contents (for now)
-                consume_token(ctx);
-                while (!look_token_kind(ctx, GP_TOKEN_RIGHTBRACE)) {
+                consume_token(parser);
+                while (!look_token_kind(parser, GP_TOKEN_RIGHTBRACE)) {
                         //XXX ignoreing stuff for now
-                        parse_typeexpr(ctx);
-                        parse_name(ctx);
-                        parse_semicolon(ctx);
+                        parse_typeexpr(parser);
+                        parse_name(parser);
+                        parse_semicolon(parser);
                 }
-                consume_token(ctx);
+                consume_token(parser);
                 return NULL;
         }
-        gp_fatal_parse_error_f(ctx, "type expected or interface block was expected, got: %s", ctx->tokenBuffer);
+        gp_fatal_parse_error_f(parser, "type expected or interface block was expected, got: %.*s",
+                               parser->tokenSpan.length, token_data(parser));
 }
 
-static struct GP_TypeExpr *parse_type_or_void(struct GP_Ctx *ctx)
+static struct GP_TypeExpr *parse_type_or_void(struct GP_Parser *parser)
 {
-        expect_token_kind(ctx, GP_TOKEN_NAME);
-        if (is_keyword(ctx, "void")) {
-                consume_token(ctx);
-                struct GP_TypeExpr *typeExpr = create_typeexpr(ctx);
+        expect_token_kind(parser, GP_TOKEN_NAME);
+        if (is_keyword(parser, GP_KEYWORD_VOID)) {
+                consume_token(parser);
+                struct GP_TypeExpr *typeExpr = create_typeexpr(parser);
                 typeExpr->typeKind = -1;
                 return typeExpr;
         }
-        return parse_typeexpr(ctx);
+        return parse_typeexpr(parser);
 }
 
-static struct GP_VariableDecl *parse_variable(struct GP_Ctx *ctx)
+static struct GP_VariableDecl *parse_variable(struct GP_Parser *parser)
 {
         int inOrOut;
-        if (is_keyword(ctx, "flat")) {
-                consume_token(ctx);
-                look_token(ctx);
+        if (is_keyword(parser, GP_KEYWORD_FLAT)) {
+                consume_token(parser);
+                look_token(parser);
         }
-        if (is_keyword(ctx, "in")) {
+        if (is_keyword(parser, GP_KEYWORD_IN)) {
                 inOrOut = 0;
         }
-        else if (is_keyword(ctx, "out")) {
+        else if (is_keyword(parser, GP_KEYWORD_OUT)) {
                 inOrOut = 1;
         }
         else {
-                gp_fatal_parse_error_f(ctx,
-                        "Invalid token %s, expected 'in' or 'out'",
-                        ctx->tokenBuffer);
+                gp_fatal_parse_error_f(parser,
+                        "Invalid token %.*s, expected 'in' or 'out'",
+                        parser->tokenSpan.length, token_data(parser));
         }
-        consume_token(ctx); // "in" or "out"
-        struct GP_TypeExpr *typeExpr = parse_typeexpr(ctx);
+        consume_token(parser); // "in" or "out"
+        struct GP_TypeExpr *typeExpr = parse_typeexpr(parser);
         // XXX WARNING currently parse_typeexpr() may return NULL, which means that this was an interface block. Is it safe to proceed?
-        char *name = parse_name(ctx);
-        parse_semicolon(ctx);
-        struct GP_VariableDecl *variableDecl = create_variabledecl(ctx);
+        GP_Atom name = parse_name(parser);
+        parse_semicolon(parser);
+        struct GP_VariableDecl *variableDecl = create_variabledecl(parser);
         variableDecl->inOrOut = inOrOut;
         variableDecl->name = name;
         variableDecl->typeExpr = typeExpr;
         return variableDecl;
 }
 
-static struct GP_UniformDecl *parse_uniform(struct GP_Ctx *ctx)
+/* After "uniform", the type is a known type */
+static struct GP_UniformDecl *parse_uniform(struct GP_Parser *parser)
 {
-        consume_token(ctx); // "uniform"
-        struct GP_TypeExpr *typeExpr = parse_typeexpr(ctx);
-        // currently parse_typeexpr may return NULL, but this is not valid for uniforms.
-        if (typeExpr == NULL)
-                gp_fatal_parse_error_f(ctx, "Can't use an interface block as a type for a uniform.");
-        char *name = parse_name(ctx);
-        parse_semicolon(ctx);
-        struct GP_UniformDecl *uniformDecl = create_uniformdecl(ctx);
+        struct GP_TypeExpr *typeExpr = parse_typeexpr(parser);
+        GP_Atom name = parse_name(parser);
+        parse_semicolon(parser);
+        struct GP_UniformDecl *uniformDecl = create_uniformdecl(parser);
         uniformDecl->uniDeclName = name;
         uniformDecl->uniDeclTypeExpr = typeExpr;
-        //printf("parse uniform (%s) %s %s\n", ctx->filepath, name, typeKindString[typeExpr->typeKind]);
+        //printf("parse uniform (%s) %s %s\n", parser->filepath, name, typeKindString[typeExpr->typeKind]);
         return uniformDecl;
 }
 
-static void parse_expression(struct GP_Ctx *ctx)
+/* The qualifiers in "layout(...)" that are of interest. The others are
+ * skipped. */
+struct GP_LayoutQualifiers {
+        int layoutKind;  // GP_BLOCK_LAYOUT_*. This and the others are -1 if not given
+        int isRowMajor;
+        int binding;
+        int offset;
+        int align;
+};
+
+static int parse_integer_literal(struct GP_Parser *parser)
 {
-        if (!look_token(ctx))
-                gp_fatal_parse_error_f(ctx, "Expected expression");
-        if (ctx->tokenKind == GP_TOKEN_NAME) {
-                consume_token(ctx);
-        }
-        else if (ctx->tokenKind == GP_TOKEN_LITERAL) {
-                consume_token(ctx);
+        if (!look_token_kind(parser, GP_TOKEN_LITERAL)
+            || (parser->tokenLiteralKind != GP_LITERAL_INT && parser->tokenLiteralKind != GP_LITERAL_UINT)
+            || parser->tokenFloatingValue < 0)
+                gp_fatal_parse_error_f(parser, "Expected a non-negative integer literal");
+        int value = (int) parser->tokenFloatingValue;
+        consume_token(parser);
+        return value;
+}
+
+/* Qualifiers that are not given are left as they are */
+static void parse_layout_qualifiers(struct GP_Parser *parser, struct GP_LayoutQualifiers *qualifiers)
+{
+        consume_token(parser); // "layout"
+        parse_simple_token(parser, GP_TOKEN_LEFTPAREN);
+        for (;;) {
+                expect_token_kind(parser, GP_TOKEN_NAME);
+                int *valuePtr = NULL;
+                if (token_equals(parser, "shared"))
+                        qualifiers->layoutKind = GP_BLOCK_LAYOUT_SHARED;
+                else if (token_equals(parser, "packed"))
+                        qualifiers->layoutKind = GP_BLOCK_LAYOUT_PACKED;
+                else if (token_equals(parser, "std140"))
+                        qualifiers->layoutKind = GP_BLOCK_LAYOUT_STD140;
+                else if (token_equals(parser, "std430"))
+                        qualifiers->layoutKind = GP_BLOCK_LAYOUT_STD430;
+                else if (token_equals(parser, "row_major"))
+                        qualifiers->isRowMajor = 1;
+                else if (token_equals(parser, "column_major"))
+                        qualifiers->isRowMajor = 0;
+                else if (token_equals(parser, "binding"))
+                        valuePtr = &qualifiers->binding;
+                else if (token_equals(parser, "offset"))
+                        valuePtr = &qualifiers->offset;
+                else if (token_equals(parser, "align"))
+                        valuePtr = &qualifiers->align;
+                consume_token(parser);
+                if (look_token_kind(parser, GP_TOKEN_EQUALS)) {
+                        consume_token(parser);
+                        int value = parse_integer_literal(parser);
+                        if (valuePtr != NULL)
+                                *valuePtr = value;
+                }
+                if (!look_token_kind(parser, GP_TOKEN_COMMA))
+                        break;
+                consume_token(parser);
         }
-        else if (ctx->tokenKind == GP_TOKEN_LEFTPAREN) {
-                consume_token(ctx);
-                parse_expression(ctx);
-                parse_simple_token(ctx, GP_TOKEN_RIGHTPAREN);
+        parse_simple_token(parser, GP_TOKEN_RIGHTPAREN);
+}
+
+static struct GP_BlockMember *add_block_member(struct GP_Parser *parser, struct GP_BlockDecl *block, int *numAllocated)
+{
+        if (block->numMembers == *numAllocated) {
+                int newNumAllocated = *numAllocated ? 2 * *numAllocated : 8;
+                ARENA_REALLOC_MEMORY(&parser->arena, &block->members, block->numMembers, newNumAllocated);
+                *numAllocated = newNumAllocated;
         }
-        else {
-                /* unary operator? */
-                for (int i = 0; i < GP_NUM_UNOP_KINDS; i++) {
-                        if (gp_unopTokenInfo[i].tokenKind == ctx->tokenKind) {
-                                consume_token(ctx);
-                                parse_expression(ctx);
-                                goto ok;
+        struct GP_BlockMember *member = &block->members[block->numMembers++];
+        memset(member, 0, sizeof *member);
+        return member;
+}
+
+/* After "uniform" or "buffer" and the name of the block */
+static struct GP_BlockDecl *parse_block(struct GP_Parser *parser, int blockKind, GP_Atom blockName,
+                                        const struct GP_LayoutQualifiers *qualifiers)
+{
+        struct GP_BlockDecl *block = create_blockdecl(parser);
+        block->blockKind = blockKind;
+        block->layoutKind = qualifiers->layoutKind;
+        block->binding = qualifiers->binding;
+        block->blockName = blockName;
+        block->members = NULL;
+        block->numMembers = 0;
+        if (blockKind == GP_BLOCK_UNIFORM && block->layoutKind == GP_BLOCK_LAYOUT_STD430)
+                gp_fatal_parse_error_f(parser, "The std430 layout is only allowed for buffer blocks");
+        if (qualifiers->offset != -1)
+                gp_fatal_parse_error_f(parser, "The offset qualifier is only allowed on the members of a block");
+        int haveExplicitLayout = block->layoutKind == GP_BLOCK_LAYOUT_STD140 || block->layoutKind == GP_BLOCK_LAYOUT_STD430;
+        int numMembersAllocated = 0;
+        parse_simple_token(parser, GP_TOKEN_LEFTBRACE);
+        while (!look_token_kind(parser, GP_TOKEN_RIGHTBRACE)) {
+                // the align qualifier of the block applies to each member
+                struct GP_LayoutQualifiers memberQualifiers = *qualifiers;
+                if (is_keyword(parser, GP_KEYWORD_LAYOUT)) {
+                        parse_layout_qualifiers(parser, &memberQualifiers);
+                        look_token(parser);
+                }
+                if ((memberQualifiers.offset != -1 || memberQualifiers.align != -1) && !haveExplicitLayout)
+                        gp_fatal_parse_error_f(parser, "The offset and align qualifiers are only allowed in std140 and std430 blocks");
+                if (memberQualifiers.align != -1
+                    && (memberQualifiers.align == 0 || (memberQualifiers.align & (memberQualifiers.align - 1)) != 0))
+                        gp_fatal_parse_error_f(parser, "The align qualifier must be a power of 2");
+                while (is_keyword(parser, GP_KEYWORD_LOWP)
+                       || is_keyword(parser, GP_KEYWORD_MEDIUMP)
+                       || is_keyword(parser, GP_KEYWORD_HIGHP)) {
+                        consume_token(parser);
+                        look_token(parser);
+                }
+                expect_token_kind(parser, GP_TOKEN_NAME);
+                int typeKind = parser->tokenTypeKind;
+                int componentTypeKind;
+                int numColumns;
+                int numRows;
+                if (typeKind == -1 || !gp_get_type_shape(typeKind, &componentTypeKind, &numColumns, &numRows))
+                        gp_fatal_parse_error_f(parser, "Expected the type of a block member, got: %.*s",
+                                               parser->tokenSpan.length, token_data(parser));
+                consume_token(parser);
+                for (;;) {
+                        if (block->numMembers > 0 && block->members[block->numMembers - 1].arrayLength == -1)
+                                gp_fatal_parse_error_f(parser, "Only the last member of a block can be a runtime-sized array");
+                        struct GP_BlockMember *member = add_block_member(parser, block, &numMembersAllocated);
+                        member->typeKind = typeKind;
+                        member->name = parse_name(parser);
+                        member->isRowMajor = memberQualifiers.isRowMajor;
+                        // the offset is that of the first member of the declaration
+                        member->explicitOffset = memberQualifiers.offset;
+                        member->explicitAlignment = memberQualifiers.align;
+                        memberQualifiers.offset = -1;
+                        if (look_token_kind(parser, GP_TOKEN_LEFTBRACKET)) {
+                                consume_token(parser);
+                                if (look_token_kind(parser, GP_TOKEN_RIGHTBRACKET)) {
+                                        if (blockKind != GP_BLOCK_BUFFER)
+                                                gp_fatal_parse_error_f(parser, "Only buffer blocks can have runtime-sized arrays");
+                                        member->arrayLength = -1;
+                                }
+                                else {
+                                        member->arrayLength = parse_integer_literal(parser);
+                                        if (member->arrayLength == 0)
+                                                gp_fatal_parse_error_f(parser, "An array can't have length 0");
+                                }
+                                parse_simple_token(parser, GP_TOKEN_RIGHTBRACKET);
                         }
+                        if (!look_token_kind(parser, GP_TOKEN_COMMA))
+                                break;
+                        consume_token(parser);
+                }
+                parse_semicolon(parser);
+        }
+        if (block->numMembers == 0)
+                gp_fatal_parse_error_f(parser, "A block must have at least one member");
+        consume_token(parser);
+        block->instanceName = -1;
+        block->instanceArrayLength = 0;
+        if (look_token_kind(parser, GP_TOKEN_NAME)) {
+                block->instanceName = parse_name(parser);
+                if (look_token_kind(parser, GP_TOKEN_LEFTBRACKET)) {
+                        consume_token(parser);
+                        block->instanceArrayLength = parse_integer_literal(parser);
+                        parse_simple_token(parser, GP_TOKEN_RIGHTBRACKET);
+                }
+        }
+        parse_semicolon(parser);
+        int badMember = gp_compute_block_layout(block);
+        if (badMember != -1)
+                gp_fatal_parse_error_f(parser, "The offset of block member '%s' is not a multiple of the alignment of its type, or it is within the previous member",
+                                       gp_atom_string(parser->ctx, block->members[badMember].name));
+        return block;
+}
+
+/* A uniform, or a block, or the default block layout ("layout(std140)
+ * uniform;"), with optional layout qualifiers. Also variables with layout
+ * qualifiers (the qualifiers are ignored). */
+static void parse_uniform_or_block(struct GP_Parser *parser)
+{
+        struct GP_LayoutQualifiers qualifiers = { -1, -1, -1, -1, -1 };
+        if (is_keyword(parser, GP_KEYWORD_LAYOUT)) {
+                parse_layout_qualifiers(parser, &qualifiers);
+                expect_token_kind(parser, GP_TOKEN_NAME);
+        }
+        if (is_keyword(parser, GP_KEYWORD_IN)
+            || is_keyword(parser, GP_KEYWORD_OUT)
+            || is_keyword(parser, GP_KEYWORD_FLAT)) {
+                struct GP_ToplevelNode *node = gp_add_new_toplevel_node(parser);
+                node->directiveKind = GP_DIRECTIVE_VARIABLE;
+                node->data.tVariable = parse_variable(parser);
+                return;
+        }
+        int blockKind;
+        if (is_keyword(parser, GP_KEYWORD_UNIFORM))
+                blockKind = GP_BLOCK_UNIFORM;
+        else if (is_keyword(parser, GP_KEYWORD_BUFFER))
+                blockKind = GP_BLOCK_BUFFER;
+        else
+                gp_fatal_parse_error_f(parser, "Expected 'uniform', 'buffer', 'in' or 'out' after the layout qualifiers");
+        consume_token(parser); // "uniform" or "buffer"
+        if (look_token_kind(parser, GP_TOKEN_SEMICOLON)) {
+                consume_token(parser);
+                if (qualifiers.layoutKind != -1)
+                        parser->defaultBlockLayoutKinds[blockKind] = qualifiers.layoutKind;
+                if (qualifiers.isRowMajor != -1)
+                        parser->defaultBlockIsRowMajor[blockKind] = qualifiers.isRowMajor;
+                return;
+        }
+        expect_token_kind(parser, GP_TOKEN_NAME);
+        if (blockKind == GP_BLOCK_UNIFORM && is_known_type_name(parser)) {
+                struct GP_ToplevelNode *node = gp_add_new_toplevel_node(parser);
+                node->directiveKind = GP_DIRECTIVE_UNIFORM;
+                node->data.tUniform = parse_uniform(parser);
+                return;
+        }
+        GP_Atom blockName = parse_name(parser);
+        if (!look_token_kind(parser, GP_TOKEN_LEFTBRACE))
+                gp_fatal_parse_error_f(parser, "type expected or interface block was expected, got: %.*s",
+                                       parser->tokenSpan.length, token_data(parser));
+        if (qualifiers.layoutKind == -1)
+                qualifiers.layoutKind = parser->defaultBlockLayoutKinds[blockKind];
+        if (qualifiers.isRowMajor == -1)
+                qualifiers.isRowMajor = parser->defaultBlockIsRowMajor[blockKind];
+        struct GP_ToplevelNode *node = gp_add_new_toplevel_node(parser);
+        node->directiveKind = GP_DIRECTIVE_BLOCK;
+        node->data.tBlock = parse_block(parser, blockKind, blockName, &qualifiers);
+}
+
+static int add_node(struct GP_NodePool *pool, int kind, int operand0, int operand1, int operand2)
+{
+        if (pool->numNodes == pool->numNodesAllocated) {
+                pool->numNodesAllocated = pool->numNodesAllocated ? 2 * pool->numNodesAllocated : 64;
+                REALLOC_MEMORY(&pool->kinds, pool->numNodesAllocated);
+                REALLOC_MEMORY(&pool->operand0, pool->numNodesAllocated);
+                REALLOC_MEMORY(&pool->operand1, pool->numNodesAllocated);
+                REALLOC_MEMORY(&pool->operand2, pool->numNodesAllocated);
+        }
+        int node = pool->numNodes++;
+        pool->kinds[node] = (unsigned char) kind;
+        pool->operand0[node] = operand0;
+        pool->operand1[node] = operand1;
+        pool->operand2[node] = operand2;
+        return node;
+}
+
+static GP_Expr add_expr(struct GP_Parser *parser, int exprKind, int operand0, int operand1, int operand2)
+{
+        return add_node(&parser->currentAst->exprPool, exprKind, operand0, operand1, operand2);
+}
+
+static GP_Stmt add_stmt(struct GP_Parser *parser, int stmtKind, int operand0, int operand1, int operand2)
+{
+        return add_node(&parser->currentAst->stmtPool, stmtKind, operand0, operand1, operand2);
+}
+
+static int add_literal_value(struct GP_Parser *parser, int literalKind, double value)
+{
+        struct GP_ShaderfileAst *fa = parser->currentAst;
+        if (fa->numLiteralValues == fa->numLiteralValuesAllocated) {
+                fa->numLiteralValuesAllocated = fa->numLiteralValuesAllocated ? 2 * fa->numLiteralValuesAllocated : 64;
+                REALLOC_MEMORY(&fa->literalValues, fa->numLiteralValuesAllocated);
+                REALLOC_MEMORY(&fa->literalKinds, fa->numLiteralValuesAllocated);
+        }
+        int idx = fa->numLiteralValues++;
+        fa->literalValues[idx] = value;
+        fa->literalKinds[idx] = (unsigned char) literalKind;
+        return idx;
+}
+
+static void push_node(struct GP_Parser *parser, int node)
+{
+        if (parser->nodeStackSize == parser->nodeStackAllocated) {
+                parser->nodeStackAllocated = parser->nodeStackAllocated ? 2 * parser->nodeStackAllocated : 64;
+                REALLOC_MEMORY(&parser->nodeStack, parser->nodeStackAllocated);
+        }
+        parser->nodeStack[parser->nodeStackSize++] = node;
+}
+
+/* Makes a node list from the nodes that were pushed since the node stack had
+ * size stackBase, and pops them. */
+static int add_node_list(struct GP_Parser *parser, int stackBase)
+{
+        struct GP_ShaderfileAst *fa = parser->currentAst;
+        int numNodes = parser->nodeStackSize - stackBase;
+        if (fa->nodeListsAllocated < fa->nodeListsSize + 1 + numNodes) {
+                int numAllocated = fa->nodeListsAllocated ? 2 * fa->nodeListsAllocated : 256;
+                while (numAllocated < fa->nodeListsSize + 1 + numNodes)
+                        numAllocated *= 2;
+                REALLOC_MEMORY(&fa->nodeLists, numAllocated);
+                fa->nodeListsAllocated = numAllocated;
+        }
+        int nodeList = fa->nodeListsSize;
+        fa->nodeLists[nodeList] = numNodes;
+        if (numNodes > 0)  // the stack might not be allocated
+                memcpy(&fa->nodeLists[nodeList + 1], &parser->nodeStack[stackBase], numNodes * sizeof *parser->nodeStack);
+        fa->nodeListsSize += 1 + numNodes;
+        parser->nodeStackSize = stackBase;
+        return nodeList;
+}
+
+static GP_Expr parse_expression(struct GP_Parser *parser); // forward declare: recursion
+
+static int is_unop_token(struct GP_Parser *parser, int *unopKind)
+{
+        GP_ENSURE(parser->haveSavedToken);
+        for (int i = 0; i < gp_numUnopToken; i++) {
+                if (parser->tokenKind == gp_unopTokenInfo[i].tokenKind) {
+                        *unopKind = gp_unopTokenInfo[i].unopKind;
+                        return 1;
+                }
+        }
+        return 0;
+}
+
+/* Consumes the current token. If constants are folded, *start and *end are
+ * set to where the token is in the output, or to -1 if it is not there as it
+ * is (for example if it comes from a macro expansion). */
+static void consume_token_in_output(struct GP_Parser *parser, int *start, int *end)
+{
+        int isInOutput = parser->ctx->foldConstants
+                && !parser->tokenIsPending && !parser->file.outputSuspended;
+        int length = parser->tokenEnd - parser->tokenStart;
+        consume_token(parser);
+        *start = -1;
+        *end = -1;
+        if (isInOutput) {
+                copy_remaining_bytes(parser);
+                *end = parser->currentAst->outputSize;
+                *start = *end - length;
+        }
+}
+
+static int is_literal_expr(struct GP_Parser *parser, GP_Expr expr)
+{
+        return parser->currentAst->exprPool.kinds[expr] == GP_EXPR_LITERAL;
+}
+
+/* The output of the literal is only kept if constants are folded */
+static GP_Expr add_literal_expr(struct GP_Parser *parser, int literalKind, double value, struct GP_LiteralOutput output)
+{
+        int literal = add_literal_value(parser, literalKind, value);
+        if (parser->ctx->foldConstants) {
+                if (parser->literalOutputsAllocated <= literal) {
+                        parser->literalOutputsAllocated = parser->currentAst->numLiteralValuesAllocated;
+                        REALLOC_MEMORY(&parser->literalOutputs, parser->literalOutputsAllocated);
+                }
+                parser->literalOutputs[literal] = output;
+        }
+        return add_expr(parser, GP_EXPR_LITERAL, literal, 0, 0);
+}
+
+/* Text that begins (or ends) with characters of the same class is lexed the
+ * same way together with the text before (or after) it. */
+static char get_fold_char_class(char c)
+{
+        return charInfo[(unsigned char) c].nameChar || c == '.' ? 'a' : c;
+}
+
+/* Adds the literal that an operation was folded to. The text of the
+ * operation, from the start of first to the end of last, is replaced in the
+ * output, if it is known. */
+static GP_Expr add_folded_literal(struct GP_Parser *parser, int literalKind, double value,
+                                  struct GP_LiteralOutput first, struct GP_LiteralOutput last)
+{
+        struct GP_LiteralOutput output = { -1, -1, 0, 0 };
+        if (first.start != -1 && last.start != -1) {
+                char buffer[GP_LITERAL_BUFFER_SIZE + 2];
+                char *text = buffer + 1;
+                int length = gp_format_literal(literalKind, value, text);
+                if (get_fold_char_class(text[0]) != get_fold_char_class(first.firstChar)
+                    || get_fold_char_class(text[length - 1]) != get_fold_char_class(last.lastChar)) {
+                        // "1.0 - 2.0" becomes "(-1.0)"
+                        text = buffer;
+                        text[0] = '(';
+                        text[length + 1] = ')';
+                        length += 2;
+                }
+                replace_output(parser, first.start, last.end, text, length);
+                output.start = first.start;
+                output.end = first.start + length;
+                output.firstChar = text[0];
+                output.lastChar = text[length - 1];
+        }
+        return add_literal_expr(parser, literalKind, value, output);
+}
+
+/* Returns 1 if the negation of the literal is folded */
+static int fold_negate(int literalKind, double value, double *result)
+{
+        switch (literalKind) {
+        case GP_LITERAL_INT:
+                if (value == INT_MIN)
+                        return 0;
+                *result = 0.0 - value;  // not -0.0
+                return 1;
+        case GP_LITERAL_UINT:
+                return 0;
+        case GP_LITERAL_FLOAT:
+        case GP_LITERAL_DOUBLE:
+                *result = -value;
+                return 1;
+        default:
+                gp_fatal_f("Unhandled literal kind %d", literalKind);
+        }
+}
+
+/* Returns 1 if the operation on two literals of the given kind is folded.
+ * Operations that overflow an int, or whose result is undefined, are not
+ * folded. uints wrap around. */
+static int fold_binop(int binopKind, int literalKind, double a, double b, double *result)
+{
+        switch (literalKind) {
+        case GP_LITERAL_INT:
+        case GP_LITERAL_UINT: {
+                long long x = (long long) a;
+                long long y = (long long) b;
+                long long r;
+                switch (binopKind) {
+                case GP_BINOP_PLUS: r = x + y; break;
+                case GP_BINOP_MINUS: r = x - y; break;
+                case GP_BINOP_MUL: r = (long long) ((unsigned long long) x * (unsigned long long) y); break;
+                case GP_BINOP_BITAND: r = x & y; break;
+                case GP_BINOP_BITOR: r = x | y; break;
+                case GP_BINOP_DIV:
+                        if (y == 0)
+                                return 0;
+                        r = x / y;
+                        break;
+                case GP_BINOP_MOD:
+                        if (x < 0 || y <= 0)
+                                return 0;
+                        r = x % y;
+                        break;
+                default:
+                        return 0;
+                }
+                if (literalKind == GP_LITERAL_UINT)
+                        r &= 0xFFFFFFFFll;
+                else if (r < INT_MIN || r > INT_MAX)
+                        return 0;
+                *result = (double) r;
+                return 1;
+        }
+        case GP_LITERAL_FLOAT:
+        case GP_LITERAL_DOUBLE: {
+                double r;
+                switch (binopKind) {
+                case GP_BINOP_PLUS: r = a + b; break;
+                case GP_BINOP_MINUS: r = a - b; break;
+                case GP_BINOP_MUL: r = a * b; break;
+                case GP_BINOP_DIV: r = a / b; break;
+                default:
+                        return 0;
+                }
+                // the operation on doubles, rounded, is the operation on floats
+                if (literalKind == GP_LITERAL_FLOAT)
+                        r = (float) r;
+                if (r - r != 0.0)
+                        return 0;  // infinite or NaN
+                *result = r;
+                return 1;
+        }
+        default:
+                gp_fatal_f("Unhandled literal kind %d", literalKind);
+        }
+}
+
+static GP_Expr make_unop_expr(struct GP_Parser *parser, int unopKind, int unopStart, GP_Expr operand)
+{
+        if (parser->ctx->foldConstants && unopKind == GP_UNOP_NEGATE && is_literal_expr(parser, operand)) {
+                struct GP_ShaderfileAst *fa = parser->currentAst;
+                int literal = fa->exprPool.operand0[operand];
+                double value;
+                if (fold_negate(fa->literalKinds[literal], fa->literalValues[literal], &value)) {
+                        struct GP_LiteralOutput unopOutput = { unopStart, unopStart + 1, '-', '-' };
+                        return add_folded_literal(parser, fa->literalKinds[literal], value,
+                                                  unopOutput, parser->literalOutputs[literal]);
+                }
+        }
+        return add_expr(parser, GP_EXPR_UNOP, unopKind, operand, 0);
+}
+
+static GP_Expr make_binop_expr(struct GP_Parser *parser, int binopKind, GP_Expr left, GP_Expr right)
+{
+        if (parser->ctx->foldConstants && is_literal_expr(parser, left) && is_literal_expr(parser, right)) {
+                struct GP_ShaderfileAst *fa = parser->currentAst;
+                int leftLiteral = fa->exprPool.operand0[left];
+                int rightLiteral = fa->exprPool.operand0[right];
+                int literalKind = fa->literalKinds[leftLiteral];
+                double value;
+                if (fa->literalKinds[rightLiteral] == literalKind
+                    && fold_binop(binopKind, literalKind, fa->literalValues[leftLiteral],
+                                  fa->literalValues[rightLiteral], &value))
+                        return add_folded_literal(parser, literalKind, value,
+                                                  parser->literalOutputs[leftLiteral],
+                                                  parser->literalOutputs[rightLiteral]);
+        }
+        return add_expr(parser, GP_EXPR_BINOP, binopKind, left, right);
+}
+
+/* An operand of a binary operator: a primary expression with prefix
+ * (unary) and postfix operators. The prefix operators are collected on the
+ * node stack (with their output position), such that long chains of them
+ * don't recurse. */
+static GP_Expr parse_unary_expression(struct GP_Parser *parser)
+{
+        int stackBase = parser->nodeStackSize;
+        int unopKind;
+        while (look_token(parser) && is_unop_token(parser, &unopKind)) {
+                int unopStart;
+                int unopEnd;
+                consume_token_in_output(parser, &unopStart, &unopEnd);
+                push_node(parser, unopStart);
+                push_node(parser, unopKind);
+        }
+        GP_Expr expr;
+        if (!look_token(parser))
+                gp_fatal_parse_error_f(parser, "Expected expression");
+        if (parser->tokenKind == GP_TOKEN_NAME) {
+                GP_Atom name = intern_token(parser);
+                consume_token(parser);
+                expr = add_expr(parser, GP_EXPR_NAME, name, 0, 0);
+        }
+        else if (parser->tokenKind == GP_TOKEN_LITERAL) {
+                if (parser->tokenLiteralKind == -1)
+                        gp_fatal_parse_error_f(parser, "Invalid number literal");
+                int literalKind = parser->tokenLiteralKind;
+                double value = parser->tokenFloatingValue;
+                struct GP_LiteralOutput output = { -1, -1, '0', '0' };
+                consume_token_in_output(parser, &output.start, &output.end);
+                expr = add_literal_expr(parser, literalKind, value, output);
+        }
+        else if (parser->tokenKind == GP_TOKEN_LEFTPAREN) {
+                int parenStart;
+                int parenEnd;
+                consume_token_in_output(parser, &parenStart, &parenEnd);
+                expr = parse_expression(parser);
+                expect_token_kind(parser, GP_TOKEN_RIGHTPAREN);
+                int unused;
+                consume_token_in_output(parser, &unused, &parenEnd);
+                if (parser->ctx->foldConstants && is_literal_expr(parser, expr)) {
+                        // the parentheses belong to the text of the literal
+                        int literal = parser->currentAst->exprPool.operand0[expr];
+                        struct GP_LiteralOutput *output = &parser->literalOutputs[literal];
+                        output->start = parenEnd != -1 ? parenStart : -1;
+                        output->end = parenStart != -1 ? parenEnd : -1;
+                        output->firstChar = '(';
+                        output->lastChar = ')';
                 }
-                gp_fatal_parse_error_f(ctx, "Expected expression");
-ok:
-                ;
+        }
+        else {
+                gp_fatal_parse_error_f(parser, "Expected expression");
         }
         for (;;) {
                 // function call?
-                if (look_token_kind(ctx, GP_TOKEN_LEFTPAREN)) {
-                        consume_token(ctx);
-                        if (!look_token_kind(ctx, GP_TOKEN_RIGHTPAREN)) {
+                if (look_token_kind(parser, GP_TOKEN_LEFTPAREN)) {
+                        consume_token(parser);
+                        int argsBase = parser->nodeStackSize;
+                        if (!look_token_kind(parser, GP_TOKEN_RIGHTPAREN)) {
                                 for (;;) {
-                                        parse_expression(ctx);
-                                        if (!look_token_kind(ctx, GP_TOKEN_COMMA))
+                                        GP_Expr arg = parse_expression(parser);
+                                        push_node(parser, arg);
+                                        if (!look_token_kind(parser, GP_TOKEN_COMMA))
                                                 break;
-                                        consume_token(ctx);
+                                        consume_token(parser);
                                 }
                         }
-                        parse_simple_token(ctx, GP_TOKEN_RIGHTPAREN);
+                        parse_simple_token(parser, GP_TOKEN_RIGHTPAREN);
+                        int args = add_node_list(parser, argsBase);
+                        expr = add_expr(parser, GP_EXPR_CALL, expr, args, 0);
                 }
                 // member descend?
-                else if (look_token_kind(ctx, GP_TOKEN_DOT)) {
-                        consume_token(ctx);
-                        parse_name(ctx);
+                else if (look_token_kind(parser, GP_TOKEN_DOT)) {
+                        consume_token(parser);
+                        GP_Atom member = parse_name(parser);
+                        expr = add_expr(parser, GP_EXPR_MEMBER, expr, member, 0);
                 }
                 else {
                         break;
-                }
+                }
+        }
+        // the prefix operators apply after the postfix ones, innermost first
+        while (parser->nodeStackSize > stackBase) {
+                unopKind = parser->nodeStack[--parser->nodeStackSize];
+                int unopStart = parser->nodeStack[--parser->nodeStackSize];
+                expr = make_unop_expr(parser, unopKind, unopStart, expr);
+        }
+        return expr;
+}
+
+/* Whether the operator binopKind1, which is to the left of an operand, takes
+ * that operand before the operator binopKind2 to its right does. */
+static int binop_binds_first(int binopKind1, int binopKind2)
+{
+        const struct GP_BinopInfo *left = &gp_binopInfo[binopKind1];
+        const struct GP_BinopInfo *right = &gp_binopInfo[binopKind2];
+        if (left->precedence != right->precedence)
+                return left->precedence > right->precedence;
+        return !right->isRightAssociative;
+}
+
+/* The node stack above stackBase holds operands and binary operators
+ * alternately: operand, binop, operand, ..., operand. The operators have
+ * non-decreasing precedence, as far as they are not yet reduced. This reduces
+ * the operators at the top that bind before binopKind, or all of them if
+ * binopKind is -1. */
+static void reduce_binops(struct GP_Parser *parser, int stackBase, int binopKind)
+{
+        while (parser->nodeStackSize - stackBase >= 3) {
+                int *top = &parser->nodeStack[parser->nodeStackSize - 3];
+                GP_Expr left = top[0];
+                int topBinopKind = top[1];
+                GP_Expr right = top[2];
+                if (binopKind != -1 && !binop_binds_first(topBinopKind, binopKind))
+                        break;
+                parser->nodeStackSize -= 3;
+                push_node(parser, make_binop_expr(parser, topBinopKind, left, right));
         }
-        // binary operators
+}
+
+/* Precedence climbing with an explicit stack instead of recursion, such that
+ * expressions with many operators need no C stack. Recursion happens only
+ * for parentheses and function arguments, and its depth is limited. */
+static GP_Expr parse_expression(struct GP_Parser *parser)
+{
+        if (parser->expressionDepth >= MAX_EXPRESSION_DEPTH)
+                gp_fatal_parse_error_f(parser, "Expression nested too deeply");
+        parser->expressionDepth++;
+        int stackBase = parser->nodeStackSize;
+        GP_Expr operand = parse_unary_expression(parser);
+        push_node(parser, operand);
         int binopKind;
-        if (look_token(ctx) && is_binop_token(ctx, &binopKind)) {
-                consume_token(ctx);
-                //message_f("Found '%s' binop", binopInfo[binopKind].text);
-                parse_expression(ctx);
+        while (look_token(parser) && is_binop_token(parser, &binopKind)) {
+                consume_token(parser);
+                reduce_binops(parser, stackBase, binopKind);
+                push_node(parser, binopKind);
+                operand = parse_unary_expression(parser);
+                push_node(parser, operand);
         }
+        reduce_binops(parser, stackBase, -1);
+        GP_ENSURE(parser->nodeStackSize == stackBase + 1);
+        parser->expressionDepth--;
+        return parser->nodeStack[--parser->nodeStackSize];
 }
 
-static void parse_stmt(struct GP_Ctx *ctx); // forward declare: recursion
+static GP_Stmt parse_stmt(struct GP_Parser *parser); // forward declare: recursion
 
-static void parse_compound_stmt(struct GP_Ctx *ctx)
+static GP_Stmt parse_compound_stmt(struct GP_Parser *parser)
 {
-        parse_simple_token(ctx, GP_TOKEN_LEFTBRACE);
-        while (!look_token_kind(ctx, GP_TOKEN_RIGHTBRACE))
-                parse_stmt(ctx);
-        parse_simple_token(ctx, GP_TOKEN_RIGHTBRACE);
+        parse_simple_token(parser, GP_TOKEN_LEFTBRACE);
+        int stackBase = parser->nodeStackSize;
+        while (!look_token_kind(parser, GP_TOKEN_RIGHTBRACE))
+                push_node(parser, parse_stmt(parser));
+        parse_simple_token(parser, GP_TOKEN_RIGHTBRACE);
+        int stmts = add_node_list(parser, stackBase);
+        return add_stmt(parser, GP_STMT_COMPOUND, stmts, 0, 0);
 }
 
-static void parse_variable_declaration_stmt(struct GP_Ctx *ctx)
+static GP_Stmt parse_variable_declaration_stmt(struct GP_Parser *parser)
 {
-        parse_typeexpr(ctx);
-        parse_name(ctx);
-        if (look_token_kind(ctx, GP_TOKEN_EQUALS)) {
-                consume_token(ctx);
-                parse_expression(ctx);
-                parse_semicolon(ctx);
+        struct GP_TypeExpr *typeExpr = parse_typeexpr(parser);
+        GP_Atom name = parse_name(parser);
+        GP_Expr initExpr = -1;
+        if (look_token_kind(parser, GP_TOKEN_EQUALS)) {
+                consume_token(parser);
+                initExpr = parse_expression(parser);
         }
+        parse_semicolon(parser);
+        return add_stmt(parser, GP_STMT_VARIABLE, typeExpr->typeKind, name, initExpr);
 }
 
-static void parse_if_stmt(struct GP_Ctx *ctx)
+static GP_Stmt parse_if_stmt(struct GP_Parser *parser)
 {
-        consume_token(ctx); // "if"
-        parse_simple_token(ctx, GP_TOKEN_LEFTPAREN);
-        parse_expression(ctx);
-        parse_simple_token(ctx, GP_TOKEN_RIGHTPAREN);
-        parse_stmt(ctx);
-        if (look_token_kind(ctx, GP_TOKEN_NAME) && is_keyword(ctx, "else")) {
-                consume_token(ctx); // "if"
-                parse_stmt(ctx);
+        consume_token(parser); // "if"
+        parse_simple_token(parser, GP_TOKEN_LEFTPAREN);
+        GP_Expr condExpr = parse_expression(parser);
+        parse_simple_token(parser, GP_TOKEN_RIGHTPAREN);
+        GP_Stmt ifBranchStmt = parse_stmt(parser);
+        GP_Stmt elseBranchStmt = -1;
+        if (look_token_kind(parser, GP_TOKEN_NAME) && is_keyword(parser, GP_KEYWORD_ELSE)) {
+                consume_token(parser); // "else"
+                elseBranchStmt = parse_stmt(parser);
         }
+        return add_stmt(parser, GP_STMT_IF, condExpr, ifBranchStmt, elseBranchStmt);
 }
 
-static void parse_return_stmt(struct GP_Ctx *ctx)
+static GP_Stmt parse_return_stmt(struct GP_Parser *parser)
 {
-        consume_token(ctx); // "return"
-        parse_expression(ctx);
-        parse_semicolon(ctx);
+        consume_token(parser); // "return"
+        GP_Expr expr = -1;
+        if (!look_token_kind(parser, GP_TOKEN_SEMICOLON))
+                expr = parse_expression(parser);
+        parse_semicolon(parser);
+        return add_stmt(parser, GP_STMT_RETURN, expr, 0, 0);
 }
 
-static void parse_discard_stmt(struct GP_Ctx *ctx)
+static GP_Stmt parse_discard_stmt(struct GP_Parser *parser)
 {
-        consume_token(ctx); // "discard"
-        parse_semicolon(ctx);
+        consume_token(parser); // "discard"
+        parse_semicolon(parser);
+        return add_stmt(parser, GP_STMT_DISCARD, 0, 0, 0);
 }
 
-static void parse_expression_stmt(struct GP_Ctx *ctx)
+static GP_Stmt parse_expression_stmt(struct GP_Parser *parser)
 {
-        parse_expression(ctx);
-        parse_semicolon(ctx);
+        GP_Expr expr = parse_expression(parser);
+        parse_semicolon(parser);
+        return add_stmt(parser, GP_STMT_EXPR, expr, 0, 0);
 }
 
-static void parse_stmt(struct GP_Ctx *ctx)
+static GP_Stmt parse_stmt(struct GP_Parser *parser)
 {
-        if (!look_token(ctx))
-                gp_fatal_parse_error_f(ctx, "Expected statement");
-        if (ctx->tokenKind == GP_TOKEN_LEFTBRACE)
-                parse_compound_stmt(ctx);
-        else if (is_known_type_name(ctx))
-                parse_variable_declaration_stmt(ctx);
-        else if (is_keyword(ctx, "if"))
-                parse_if_stmt(ctx);
-        else if (is_keyword(ctx, "return"))
-                parse_return_stmt(ctx);
-        else if (is_keyword(ctx, "discard"))
-                parse_discard_stmt(ctx);
+        if (!look_token(parser))
+                gp_fatal_parse_error_f(parser, "Expected statement");
+        if (parser->tokenKind == GP_TOKEN_LEFTBRACE)
+                return parse_compound_stmt(parser);
+        else if (is_known_type_name(parser))
+                return parse_variable_declaration_stmt(parser);
+        else if (is_keyword(parser, GP_KEYWORD_IF))
+                return parse_if_stmt(parser);
+        else if (is_keyword(parser, GP_KEYWORD_RETURN))
+                return parse_return_stmt(parser);
+        else if (is_keyword(parser, GP_KEYWORD_DISCARD))
+                return parse_discard_stmt(parser);
         else
-                parse_expression_stmt(ctx);
+                return parse_expression_stmt(parser);
+}
+
+/* Whether a name in [p, end) is a defined macro. The names in comments and
+ * strings are looked up, too, which is only conservative. */
+static int has_macro_name(struct GP_Parser *parser, const char *p, const char *end)
+{
+        while (p < end) {
+                if (!CHAR_INFO(*p)->nameChar) {
+                        p++;
+                        continue;
+                }
+                const char *nameStart = p;
+                while (p < end && CHAR_INFO(*p)->nameChar)
+                        p++;
+                // a run that starts with a digit is (part of) a number
+                if (CHAR_INFO(*nameStart)->charClass != CHAR_DIGIT
+                    && find_macro(parser, nameStart, (int) (p - nameStart)) != -1)
+                        return 1;
+        }
+        return 0;
+}
+
+/* Skips the rest of a compound statement whose '{' was just consumed, by
+ * scanning the raw bytes for the matching '}'. Comments and string literals
+ * are skipped like the lexer does. The scan does not understand preprocessor
+ * directives, so if it finds one (or the end of the file) before the matching
+ * '}', nothing is skipped and we return 0. The same if a macro is used in the
+ * block, since it might expand to braces. Streamed files are not scanned. */
+static int skip_block_fast(struct GP_Parser *parser)
+{
+        GP_ENSURE(!parser->haveSavedToken);
+        // the window of a streamed file might end in the middle of the block
+        if (parser->file.isStreamed)
+                return 0;
+        if (parser->pendingTokenIndex < parser->pendingTokenEnd)
+                return 0;
+        const char *contents = parser->file.contents;
+        const char *end = contents + parser->file.size;
+        const char *p = contents + parser->file.cursorPos;
+        int depth = 1;
+        for (;;) {
+                p = gp_scan_find_block_char(p, end);
+                if (p == end || *p == '#')
+                        return 0;
+                if (*p == '{') {
+                        depth++;
+                        p++;
+                }
+                else if (*p == '}') {
+                        p++;
+                        if (--depth == 0)
+                                break;
+                }
+                else if (*p == '"') {
+                        p++;
+                        while (p < end && *p != '"')
+                                p++;
+                        if (p < end)
+                                p++;
+                }
+                else if (p + 1 < end && p[1] == '*') {
+                        p = gp_scan_find_comment_end(p + 2, end);
+                        if (p == NULL)
+                                return 0;  // let the lexer report the error
+                        p += 2;
+                }
+                else if (p + 1 < end && p[1] == '/') {
+                        p = gp_scan_find_newline(p + 2, end);
+                }
+                else {
+                        p++;  // '/' operator
+                }
+        }
+        const char *blockStart = contents + parser->file.cursorPos;
+        if (parser->numUserMacros > 0) {
+                if (has_macro_name(parser, blockStart, p))
+                        return 0;
+        }
+        else {
+                /* Only the built-in macros (__LINE__ and friends) are
+                 * defined. This is quicker, and conservative: any "__" is
+                 * enough. */
+                for (const char *q = blockStart; (q = memchr(q, '_', p - q)) != NULL; q++)
+                        if (q + 1 < p && q[1] == '_')
+                                return 0;
+        }
+        // as if all the tokens including the '}' were consumed
+        parser->file.cursorPos = (int) (p - contents);
+        parser->file.indexOfFirstUnconsumedToken = parser->file.cursorPos;
+        return 1;
+}
+
+/* For GP_PARSE_MODE_REFLECTION. Skips the body of a function definition
+ * after its '{' was consumed. If the body contains preprocessor directives
+ * we need to go through the lexer, which handles them, but we still only
+ * count braces. */
+static void skip_function_body(struct GP_Parser *parser)
+{
+        if (skip_block_fast(parser))
+                return;
+        int depth = 1;
+        while (depth > 0) {
+                if (!look_token(parser))
+                        gp_fatal_parse_error_f(parser,
+                                "EOF encountered while expecting end of function body");
+                if (parser->tokenKind == GP_TOKEN_LEFTBRACE)
+                        depth++;
+                else if (parser->tokenKind == GP_TOKEN_RIGHTBRACE)
+                        depth--;
+                consume_token(parser);
+        }
 }
 
-static void parse_FuncDefn_or_FuncDecl(struct GP_Ctx *ctx)
+static void parse_FuncDefn_or_FuncDecl(struct GP_Parser *parser)
 {
-        struct GP_TypeExpr *returnTypeExpr = parse_type_or_void(ctx);
-        char *name = parse_name(ctx);
-        parse_simple_token(ctx, GP_TOKEN_LEFTPAREN);
+        struct GP_TypeExpr *returnTypeExpr = parse_type_or_void(parser);
+        GP_Atom name = parse_name(parser);
+        parse_simple_token(parser, GP_TOKEN_LEFTPAREN);
         int numArgs = 0;
-        char **argNames = NULL;
+        GP_Atom *argNames = NULL;
         struct GP_TypeExpr **argTypeExprs = NULL;
-        if (!look_token_kind(ctx, GP_TOKEN_RIGHTPAREN)) {
+        if (!look_token_kind(parser, GP_TOKEN_RIGHTPAREN)) {
                 for (;;) {
                         numArgs++;
-                        REALLOC_MEMORY(&argTypeExprs, numArgs);
-                        REALLOC_MEMORY(&argNames, numArgs);
-                        argTypeExprs[numArgs - 1] = parse_typeexpr(ctx);
-                        argNames[numArgs - 1] = parse_name(ctx);
-                        if (!look_token_kind(ctx, GP_TOKEN_COMMA))
+                        ARENA_REALLOC_MEMORY(&parser->arena, &argTypeExprs, numArgs - 1, numArgs);
+                        ARENA_REALLOC_MEMORY(&parser->arena, &argNames, numArgs - 1, numArgs);
+                        argTypeExprs[numArgs - 1] = parse_typeexpr(parser);
+                        argNames[numArgs - 1] = parse_name(parser);
+                        if (!look_token_kind(parser, GP_TOKEN_COMMA))
                                 break;
-                        consume_token(ctx);
+                        consume_token(parser);
                 }
         }
-        parse_simple_token(ctx, GP_TOKEN_RIGHTPAREN);
-        if (look_token_kind(ctx, GP_TOKEN_SEMICOLON)) {
+        parse_simple_token(parser, GP_TOKEN_RIGHTPAREN);
+        if (look_token_kind(parser, GP_TOKEN_SEMICOLON)) {
                 // it's only a decl
-                consume_token(ctx);
-                struct GP_FuncDecl *funcDecl = create_funcdecl(ctx);
+                consume_token(parser);
+                struct GP_FuncDecl *funcDecl = create_funcdecl(parser);
                 funcDecl->name = name;
                 funcDecl->returnTypeExpr = returnTypeExpr;
                 funcDecl->argTypeExprs = argTypeExprs;
                 funcDecl->argNames = argNames;
                 funcDecl->numArgs = numArgs;
-                struct GP_ToplevelNode *node = gp_add_new_toplevel_node(ctx);
+                struct GP_ToplevelNode *node = gp_add_new_toplevel_node(parser);
                 node->directiveKind = GP_DIRECTIVE_FUNCDECL;
                 node->data.tFuncdecl = funcDecl;
         }
         else {
-                parse_simple_token(ctx, GP_TOKEN_LEFTBRACE);
-                while (!look_token_kind(ctx, GP_TOKEN_RIGHTBRACE))
-                        parse_stmt(ctx);
-                parse_simple_token(ctx, GP_TOKEN_RIGHTBRACE);
-                struct GP_FuncDefn *funcDefn = create_funcdefn(ctx);
+                GP_Stmt bodyStmt = -1;
+                if (parser->ctx->parseMode == GP_PARSE_MODE_REFLECTION) {
+                        parse_simple_token(parser, GP_TOKEN_LEFTBRACE);
+                        skip_function_body(parser);
+                }
+                else {
+                        expect_token_kind(parser, GP_TOKEN_LEFTBRACE);
+                        bodyStmt = parse_compound_stmt(parser);
+                }
+                struct GP_FuncDefn *funcDefn = create_funcdefn(parser);
                 funcDefn->name = name;
                 funcDefn->returnTypeExpr = returnTypeExpr;
                 funcDefn->argTypeExprs = argTypeExprs;
                 funcDefn->argNames = argNames;
                 funcDefn->numArgs = numArgs;
-                struct GP_ToplevelNode *node = gp_add_new_toplevel_node(ctx);
+                funcDefn->bodyStmt = bodyStmt;
+                struct GP_ToplevelNode *node = gp_add_new_toplevel_node(parser);
                 node->directiveKind = GP_DIRECTIVE_FUNCDEFN;
                 node->data.tFuncdefn = funcDefn;
         }
@@ -776,10 +3736,37 @@ static int gp_compare_ProgramUniforms(const void *a, const void *b)
         const struct GP_ProgramUniform *y = b;
         if (x->programIndex != y->programIndex)
                 return (x->programIndex > y->programIndex) - (x->programIndex < y->programIndex);
-        return strcmp(x->uniformName, y->uniformName);
+        return (x->uniformAtom > y->uniformAtom) - (x->uniformAtom < y->uniformAtom);
 }
 
 static int gp_compare_ProgramAttributes(const void *a, const void *b)
+{
+        const struct GP_ProgramAttribute *x = a;
+        const struct GP_ProgramAttribute *y = b;
+        if (x->programIndex != y->programIndex)
+                return (x->programIndex > y->programIndex) - (x->programIndex < y->programIndex);
+        return (x->attributeAtom > y->attributeAtom) - (x->attributeAtom < y->attributeAtom);
+}
+
+static int gp_compare_ProgramBlocks(const void *a, const void *b)
+{
+        const struct GP_ProgramBlock *x = a;
+        const struct GP_ProgramBlock *y = b;
+        if (x->programIndex != y->programIndex)
+                return (x->programIndex > y->programIndex) - (x->programIndex < y->programIndex);
+        return (x->blockAtom > y->blockAtom) - (x->blockAtom < y->blockAtom);
+}
+
+static int gp_compare_ProgramUniformNames(const void *a, const void *b)
+{
+        const struct GP_ProgramUniform *x = a;
+        const struct GP_ProgramUniform *y = b;
+        if (x->programIndex != y->programIndex)
+                return (x->programIndex > y->programIndex) - (x->programIndex < y->programIndex);
+        return strcmp(x->uniformName, y->uniformName);
+}
+
+static int gp_compare_ProgramAttributeNames(const void *a, const void *b)
 {
         const struct GP_ProgramAttribute *x = a;
         const struct GP_ProgramAttribute *y = b;
@@ -788,46 +3775,115 @@ static int gp_compare_ProgramAttributes(const void *a, const void *b)
         return strcmp(x->attributeName, y->attributeName);
 }
 
-static void gp_parse_shader(struct GP_Ctx *ctx, int shaderIndex)
+static int gp_compare_ProgramBlockNames(const void *a, const void *b)
+{
+        const struct GP_ProgramBlock *x = a;
+        const struct GP_ProgramBlock *y = b;
+        if (x->programIndex != y->programIndex)
+                return (x->programIndex > y->programIndex) - (x->programIndex < y->programIndex);
+        return strcmp(x->blockName, y->blockName);
+}
+
+/* Whether the blocks of the same name in two shaders can be linked */
+static int blocks_are_compatible(const struct GP_BlockDecl *a, const struct GP_BlockDecl *b)
+{
+        if (a->blockKind != b->blockKind
+            || a->layoutKind != b->layoutKind
+            || a->binding != b->binding
+            || a->numMembers != b->numMembers)
+                return 0;
+        for (int i = 0; i < a->numMembers; i++) {
+                const struct GP_BlockMember *x = &a->members[i];
+                const struct GP_BlockMember *y = &b->members[i];
+                if (x->typeKind != y->typeKind
+                    || x->name != y->name
+                    || x->arrayLength != y->arrayLength
+                    || x->isRowMajor != y->isRowMajor
+                    || x->explicitOffset != y->explicitOffset
+                    || x->explicitAlignment != y->explicitAlignment)
+                        return 0;
+        }
+        return 1;
+}
+
+/* Returns where the output of the toplevel item that begins with the current
+ * token starts, or -1 if it shares a macro expansion with what is before it. */
+static int get_toplevel_item_output_start(struct GP_Parser *parser)
+{
+        if (parser->tokenIsPending)
+                return parser->pendingTokenIndex == 0 ? parser->pendingOutputStart : -1;
+        if (parser->file.outputSuspended)
+                return -1;
+        if (parser->file.tentativeOutputSize != -1)
+                return parser->file.tentativeOutputSize;
+        copy_remaining_bytes(parser);
+        return parser->currentAst->outputSize;
+}
+
+/* Returns where the output of the toplevel item that was just parsed ends, or
+ * -1 if it shares a macro expansion with what is after it. */
+static int get_toplevel_item_output_end(struct GP_Parser *parser)
 {
-        const char *fileID = ctx->desc.shaderInfo[shaderIndex].fileID;
-        int fileIndex = gp_find_file_index_from_id_or_fatal_error(ctx, fileID);
+        if (parser->haveSavedToken || parser->pendingTokenIndex < parser->pendingTokenEnd)
+                return -1;
+        if (parser->fileStackSize == 0 || parser->file.outputSuspended)
+                return -1;
+        copy_remaining_bytes(parser);
+        return parser->currentAst->outputSize;
+}
 
-        gp_push_file(ctx, fileIndex);
+static void gp_parse_unit(struct GP_Parser *parser, int unitIndex)
+{
+        const struct GP_ParseUnit *unit = &parser->ctx->parseUnits[unitIndex];
 
-        ctx->haveSavedToken = 0;
-        ctx->tokenKind = GP_TOKEN_EOF;  // this is always valid. That's nice for error printing
-        ctx->tokenBuffer = NULL;
-        ctx->tokenBufferLength = 0;
-        ctx->tokenBufferCapacity = 0;
+        parser->haveSavedToken = 0;
+        parser->tokenKind = GP_TOKEN_EOF;  // this is always valid. That's nice for error printing
 
         {
-        struct GP_ShaderfileAst *fa = &ctx->shaderfileAsts[shaderIndex];
+        struct GP_ShaderfileAst *fa = &parser->ctx->unitAsts[unitIndex];
         memset(fa, 0, sizeof *fa);
         // switch
-        ctx->currentShaderIndex = shaderIndex;
+        parser->currentAst = fa;
         }
 
-        while (look_token(ctx)) {
-                if (is_keyword(ctx, "uniform")) {
-                        struct GP_ToplevelNode *node = gp_add_new_toplevel_node(ctx);
-                        node->directiveKind = GP_DIRECTIVE_UNIFORM;
-                        node->data.tUniform = parse_uniform(ctx);
+        reset_preprocessor(parser);
+        for (int i = 0; i < GP_NUM_BLOCK_KINDS; i++) {
+                parser->defaultBlockLayoutKinds[i] = GP_BLOCK_LAYOUT_SHARED;
+                parser->defaultBlockIsRowMajor[i] = 0;
+        }
+        gp_push_file(parser, unit->fileIndex);
+        define_predefined_macros(parser, unit->defines);
+
+        while (look_token(parser)) {
+                parser->currentToplevelLoc = compute_current_source_loc(parser);
+                int firstNode = parser->currentAst->numToplevelNodes;
+                int outputStart = get_toplevel_item_output_start(parser);
+                if (is_keyword(parser, GP_KEYWORD_UNIFORM)
+                    || is_keyword(parser, GP_KEYWORD_BUFFER)
+                    || is_keyword(parser, GP_KEYWORD_LAYOUT)) {
+                        parse_uniform_or_block(parser);
                 }
-                else if (is_keyword(ctx, "in")
-                         || is_keyword(ctx, "out")
-                         || is_keyword(ctx, "flat")) {
-                        struct GP_ToplevelNode *node = gp_add_new_toplevel_node(ctx);
+                else if (is_keyword(parser, GP_KEYWORD_IN)
+                         || is_keyword(parser, GP_KEYWORD_OUT)
+                         || is_keyword(parser, GP_KEYWORD_FLAT)) {
+                        struct GP_ToplevelNode *node = gp_add_new_toplevel_node(parser);
                         node->directiveKind = GP_DIRECTIVE_VARIABLE;
-                        node->data.tVariable = parse_variable(ctx);
+                        node->data.tVariable = parse_variable(parser);
                 }
-                else if (ctx->tokenKind == GP_TOKEN_NAME) {
-                        parse_FuncDefn_or_FuncDecl(ctx);
+                else if (parser->tokenKind == GP_TOKEN_NAME) {
+                        parse_FuncDefn_or_FuncDecl(parser);
                 }
                 else {
-                        gp_fatal_parse_error_f(ctx,
+                        gp_fatal_parse_error_f(parser,
                                 "While expecting toplevel syntax item: Unexpected token type %s!",
-                                  gp_tokenKindString[ctx->tokenKind]);
+                                  gp_tokenKindString[parser->tokenKind]);
+                }
+                int outputEnd = get_toplevel_item_output_end(parser);
+                if (outputStart == -1 || outputEnd == -1)
+                        outputStart = outputEnd = -1;
+                for (int i = firstNode; i < parser->currentAst->numToplevelNodes; i++) {
+                        parser->currentAst->toplevelNodes[i]->outputStart = outputStart;
+                        parser->currentAst->toplevelNodes[i]->outputEnd = outputEnd;
                 }
         }
 }
@@ -856,7 +3912,23 @@ static void gp_postprocess(struct GP_Ctx *ctx)
                                                 REALLOC_MEMORY(&ctx->programUniforms, ctx->numProgramUniforms);
                                                 ctx->programUniforms[uniformIndex].programIndex = programIndex;
                                                 ctx->programUniforms[uniformIndex].typeKind = decl->uniDeclTypeExpr->typeKind;
-                                                ctx->programUniforms[uniformIndex].uniformName = decl->uniDeclName;
+                                                ctx->programUniforms[uniformIndex].uniformAtom = decl->uniDeclName;
+                                                ctx->programUniforms[uniformIndex].uniformName = gp_atom_string(ctx, decl->uniDeclName);
+                                        }
+                                }
+                        }
+                        else if (node->directiveKind == GP_DIRECTIVE_BLOCK) {
+                                struct GP_BlockDecl *decl = node->data.tBlock;
+                                for (int k = 0; k < ctx->desc.numLinks; k++) {
+                                        struct GP_LinkInfo *linkInfo = &ctx->desc.linkInfo[k];
+                                        if (linkInfo->shaderIndex == i) {
+                                                int programIndex = linkInfo->programIndex;
+                                                int blockIndex = ctx->numProgramBlocks++;
+                                                REALLOC_MEMORY(&ctx->programBlocks, ctx->numProgramBlocks);
+                                                ctx->programBlocks[blockIndex].programIndex = programIndex;
+                                                ctx->programBlocks[blockIndex].blockAtom = decl->blockName;
+                                                ctx->programBlocks[blockIndex].blockName = gp_atom_string(ctx, decl->blockName);
+                                                ctx->programBlocks[blockIndex].blockDecl = decl;
                                         }
                                 }
                         }
@@ -875,21 +3947,28 @@ static void gp_postprocess(struct GP_Ctx *ctx)
                                                 REALLOC_MEMORY(&ctx->programAttributes, ctx->numProgramAttributes);
                                                 ctx->programAttributes[attributeIndex].programIndex = programIndex;
                                                 ctx->programAttributes[attributeIndex].typeKind = decl->typeExpr->typeKind;
-                                                ctx->programAttributes[attributeIndex].attributeName = decl->name;
+                                                ctx->programAttributes[attributeIndex].attributeAtom = decl->name;
+                                                ctx->programAttributes[attributeIndex].attributeName = gp_atom_string(ctx, decl->name);
                                         }
                                 }
                         }
                 }
         }
 
+        /* Sorting by atom groups equal names together, so duplicates can be
+         * found with integer compares. Only the deduplicated lists are sorted
+         * by name afterwards, to keep the output order independent of the
+         * parsing order. */
         qsort(ctx->programUniforms, ctx->numProgramUniforms, sizeof *ctx->programUniforms, gp_compare_ProgramUniforms);
         qsort(ctx->programAttributes, ctx->numProgramAttributes, sizeof *ctx->programAttributes, gp_compare_ProgramAttributes);
+        if (ctx->numProgramBlocks > 0)  // most shaders have none
+                qsort(ctx->programBlocks, ctx->numProgramBlocks, sizeof *ctx->programBlocks, gp_compare_ProgramBlocks);
 
         int j = 0;
         for (int i = 0; i < ctx->numProgramUniforms; i++) {
                 if (j > 0
                         && ctx->programUniforms[i].programIndex == ctx->programUniforms[j-1].programIndex
-                        && !strcmp(ctx->programUniforms[i].uniformName, ctx->programUniforms[j-1].uniformName)) {
+                        && ctx->programUniforms[i].uniformAtom == ctx->programUniforms[j-1].uniformAtom) {
                         if (ctx->programUniforms[i].typeKind != ctx->programUniforms[j-1].typeKind) {
                                 const char *programName = ctx->desc.programInfo[ctx->programUniforms[i].programIndex].programName;
                                 const char *uniformName = ctx->programUniforms[i].uniformName;
@@ -908,7 +3987,7 @@ static void gp_postprocess(struct GP_Ctx *ctx)
         for (int i = 0; i < ctx->numProgramAttributes; i++) {
                 if (j > 0
                         && ctx->programAttributes[i].programIndex == ctx->programAttributes[j-1].programIndex
-                        && !strcmp(ctx->programAttributes[i].attributeName, ctx->programAttributes[j-1].attributeName)) {
+                        && ctx->programAttributes[i].attributeAtom == ctx->programAttributes[j-1].attributeAtom) {
                         if (ctx->programAttributes[i].typeKind != ctx->programAttributes[j-1].typeKind) {
                                 const char *programName = ctx->desc.programInfo[ctx->programAttributes[i].programIndex].programName;
                                 const char *attributeName = ctx->programAttributes[i].attributeName;
@@ -923,24 +4002,659 @@ static void gp_postprocess(struct GP_Ctx *ctx)
         }
         ctx->numProgramAttributes = j;
 
+        j = 0;
+        for (int i = 0; i < ctx->numProgramBlocks; i++) {
+                if (j > 0
+                        && ctx->programBlocks[i].programIndex == ctx->programBlocks[j-1].programIndex
+                        && ctx->programBlocks[i].blockAtom == ctx->programBlocks[j-1].blockAtom) {
+                        if (!blocks_are_compatible(ctx->programBlocks[i].blockDecl, ctx->programBlocks[j-1].blockDecl)) {
+                                const char *programName = ctx->desc.programInfo[ctx->programBlocks[i].programIndex].programName;
+                                const char *blockName = ctx->programBlocks[i].blockName;
+                                gp_fatal_f("The shader program '%s' cannot be linked since there are multiple blocks '%s' with different members or layouts.",
+                                        programName, blockName);
+                        }
+                }
+                else {
+                        ctx->programBlocks[j] = ctx->programBlocks[i];
+                        j++;
+                }
+        }
+        ctx->numProgramBlocks = j;
+
+        qsort(ctx->programUniforms, ctx->numProgramUniforms, sizeof *ctx->programUniforms, gp_compare_ProgramUniformNames);
+        qsort(ctx->programAttributes, ctx->numProgramAttributes, sizeof *ctx->programAttributes, gp_compare_ProgramAttributeNames);
+        if (ctx->numProgramBlocks > 0)  // most shaders have none
+                qsort(ctx->programBlocks, ctx->numProgramBlocks, sizeof *ctx->programBlocks, gp_compare_ProgramBlockNames);
+
+        for (int i = 0; i < ctx->numProgramAttributes;) {
+                int end = i + 1;
+                while (end < ctx->numProgramAttributes && ctx->programAttributes[end].programIndex == ctx->programAttributes[i].programIndex)
+                        end++;
+                gp_compute_vertex_layout(ctx->programAttributes + i, end - i);
+                i = end;
+        }
+
         /* TODO: I guess it's not allowed to have a uniform and a variable by the same name? */
 }
 
-void gp_parse(struct GP_Ctx *ctx)
+/* The parse units that are parsed for the shaders in the ctx are
+ * ctx->parseUnits[0, numParseUnits) */
+struct GP_ParseJob {
+        int *shaderUnitIndices;  // indexed by shaderIndex
+};
+
+static void prepare_parse(struct GP_Ctx *ctx, struct GP_ParseJob *job)
+{
+        gp_scan_init();
+        if (ctx->fileIDTable.numAtoms != ctx->desc.numFiles)
+                gp_index_files(ctx);
+        allocate_line_indices(ctx);
+        allocate_token_caches(ctx);
+        ALLOC_MEMORY(&ctx->parseUnits, ctx->desc.numShaders);
+        ALLOC_MEMORY(&job->shaderUnitIndices, ctx->desc.numShaders);
+        ctx->numParseUnits = 0;
+        /* The shaders with the same file and the same defines string share
+         * a parse unit. The units are numbered by interning their keys. */
+        struct GP_InternTable unitKeys;
+        gp_intern_setup(&unitKeys);
+        for (int i = 0; i < ctx->desc.numShaders; i++) {
+                const char *fileID = ctx->desc.shaderInfo[i].fileID;
+                const char *defines = ctx->desc.shaderInfo[i].defines;
+                if (defines == NULL)
+                        defines = "";
+                int fileIndex = gp_find_file_index_from_id_or_fatal_error(ctx, fileID);
+                int keyLength = snprintf(NULL, 0, "%d %s", fileIndex, defines);
+                char *key;
+                ALLOC_MEMORY(&key, keyLength + 1);
+                snprintf(key, keyLength + 1, "%d %s", fileIndex, defines);
+                int unitIndex = gp_intern_string(&unitKeys, key, keyLength);
+                FREE_MEMORY(&key);
+                if (unitIndex == ctx->numParseUnits) {
+                        ctx->parseUnits[unitIndex].fileIndex = fileIndex;
+                        ctx->parseUnits[unitIndex].defines = defines;
+                        ctx->numParseUnits++;
+                }
+                job->shaderUnitIndices[i] = unitIndex;
+        }
+        gp_intern_teardown(&unitKeys);
+        ALLOC_MEMORY(&ctx->unitAsts, ctx->numParseUnits);
+        memset(ctx->unitAsts, 0, ctx->numParseUnits * sizeof *ctx->unitAsts);
+}
+
+/* The minifier (GP_OUTPUT_MODE_MINIFIED). The output is lexed again and
+ * written anew, with only the whitespace that is needed to keep the tokens
+ * apart. The parameters and local variables of the functions get the
+ * shortest names that are not used anywhere in the output, so they can't
+ * clash with anything. Names that are used outside of the functions
+ * (uniforms, attributes, varyings) and function names are kept. */
+
+enum {
+        GP_NAME_NOT_RENAMED = -1,
+        GP_NAME_TO_BE_RENAMED = -2,
+};
+
+struct GP_MinifyToken {
+        int start;
+        int end;
+        int tokenKind;  // GP_TOKEN_*, or -1 for a directive line or unknown text
+        int name;  // in the names of the GP_Minifier, or -1
+        int shortName;  // index of the short name that replaces the name, or -1
+};
+
+struct GP_Minifier {
+        struct GP_Ctx *ctx;
+        struct GP_ShaderfileAst *fa;
+        struct GP_MinifyToken *tokens;
+        int numTokens;
+        int numTokensAllocated;
+        struct GP_InternTable names;  // all names in the output
+        // indexed by name
+        unsigned char *isGlobal;
+        int *newName;  // index of the short name, or GP_NAME_*
+        // the names of the current function that are in newName
+        int *localNames;
+        int numLocalNames;
+        int numLocalNamesAllocated;
+        int numShortNames;  // used by the current function
+};
+
+static const char *directive_line_end(const char *p, const char *end)
+{
+        for (; p < end; p++) {
+                if (*p == '\n' && p[-1] != '\\' && !(p[-1] == '\r' && p[-2] == '\\'))
+                        break;
+        }
+        return p;
+}
+
+static void lex_output_for_minifier(struct GP_Minifier *m)
+{
+        const char *text = m->fa->output;
+        const char *end = text + m->fa->outputSize;
+        for (const char *p = text;;) {
+                const char *start = skip_space_in_text(p, end);
+                GP_ENSURE(start != NULL);
+                if (start == end)
+                        break;
+                if (m->numTokens == m->numTokensAllocated) {
+                        m->numTokensAllocated = m->numTokensAllocated ? 2 * m->numTokensAllocated : 1024;
+                        REALLOC_MEMORY(&m->tokens, m->numTokensAllocated);
+                }
+                struct GP_MinifyToken *token = &m->tokens[m->numTokens++];
+                struct GP_LexedToken lexed;
+                token->start = (int) (start - text);
+                token->tokenKind = -1;
+                token->name = -1;
+                token->shortName = -1;
+                if (*start == '#') {
+                        // a directive that was passed through, it is kept as it is
+                        p = directive_line_end(start, end);
+                }
+                else if ((p = lex_token_text(start, end, &lexed)) != NULL) {
+                        token->tokenKind = lexed.tokenKind;
+                        if (lexed.tokenKind == GP_TOKEN_NAME)
+                                token->name = gp_intern_string(&m->names, start, (int) (p - start));
+                }
+                else {
+                        p = start + 1;
+                }
+                token->end = (int) (p - text);
+        }
+}
+
+/* Writes the index'th short name: a letter, followed by index / 52 in
+ * decimal digits. No keyword looks like that. */
+static int make_short_name(int index, char *buffer)
+{
+        static const char letters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+        int length = 1;
+        int count = 52;
+        while (index >= count) {
+                index -= count;
+                count *= 10;
+                length++;
+        }
+        buffer[0] = letters[index % 52];
+        index /= 52;
+        for (int i = 1; i < length; i++) {
+                buffer[i] = (char) ('0' + index % 10);
+                index /= 10;
+        }
+        return length;
+}
+
+static GP_Atom find_name(struct GP_Minifier *m, GP_Atom atom)
+{
+        return gp_intern_find_string(&m->names, gp_atom_string(m->ctx, atom), gp_atom_length(m->ctx, atom));
+}
+
+static void add_local_name(struct GP_Minifier *m, GP_Atom atom)
+{
+        int name = find_name(m, atom);
+        if (name == -1 || m->isGlobal[name] || m->newName[name] != GP_NAME_NOT_RENAMED)
+                return;
+        if (m->numLocalNames == m->numLocalNamesAllocated) {
+                m->numLocalNamesAllocated = m->numLocalNamesAllocated ? 2 * m->numLocalNamesAllocated : 64;
+                REALLOC_MEMORY(&m->localNames, m->numLocalNamesAllocated);
+        }
+        m->localNames[m->numLocalNames++] = name;
+        m->newName[name] = GP_NAME_TO_BE_RENAMED;
+}
+
+static void add_local_variable_names(struct GP_Minifier *m, GP_Stmt stmt)
+{
+        const struct GP_NodePool *pool = &m->fa->stmtPool;
+        switch (pool->kinds[stmt]) {
+        case GP_STMT_COMPOUND: {
+                int length = gp_node_list_length(m->fa, pool->operand0[stmt]);
+                const int *nodes = gp_node_list_nodes(m->fa, pool->operand0[stmt]);
+                for (int i = 0; i < length; i++)
+                        add_local_variable_names(m, nodes[i]);
+                break;
+        }
+        case GP_STMT_VARIABLE:
+                add_local_name(m, pool->operand1[stmt]);
+                break;
+        case GP_STMT_IF:
+                add_local_variable_names(m, pool->operand1[stmt]);
+                if (pool->operand2[stmt] != -1)
+                        add_local_variable_names(m, pool->operand2[stmt]);
+                break;
+        case GP_STMT_RETURN:
+        case GP_STMT_DISCARD:
+        case GP_STMT_EXPR:
+                break;
+        default:
+                gp_fatal_f("Unhandled statement kind %d", pool->kinds[stmt]);
+        }
+}
+
+static int is_member_name(struct GP_Minifier *m, int t)
+{
+        return t > 0 && m->tokens[t - 1].tokenKind == GP_TOKEN_DOT;
+}
+
+/* Renames the parameters and local variables of a function. Its tokens are
+ * firstToken to endToken - 1. */
+static void rename_local_names(struct GP_Minifier *m, const struct GP_ToplevelNode *node,
+                               int firstToken, int endToken)
+{
+        m->numLocalNames = 0;
+        if (node->directiveKind == GP_DIRECTIVE_FUNCDEFN) {
+                const struct GP_FuncDefn *fdefn = node->data.tFuncdefn;
+                for (int i = 0; i < fdefn->numArgs; i++)
+                        add_local_name(m, fdefn->argNames[i]);
+                if (fdefn->bodyStmt != -1)
+                        add_local_variable_names(m, fdefn->bodyStmt);
+        }
+        else {
+                const struct GP_FuncDecl *fdecl = node->data.tFuncdecl;
+                for (int i = 0; i < fdecl->numArgs; i++)
+                        add_local_name(m, fdecl->argNames[i]);
+        }
+        // names that are called are kept, a local variable can hide a built-in function
+        for (int t = firstToken; t + 1 < endToken; t++)
+                if (m->tokens[t].name != -1 && m->tokens[t + 1].tokenKind == GP_TOKEN_LEFTPAREN
+                    && m->newName[m->tokens[t].name] == GP_NAME_TO_BE_RENAMED)
+                        m->newName[m->tokens[t].name] = GP_NAME_NOT_RENAMED;
+        // the names are numbered in the order in which they appear
+        m->numShortNames = 0;
+        for (int t = firstToken; t < endToken; t++) {
+                int name = m->tokens[t].name;
+                if (name == -1 || is_member_name(m, t))
+                        continue;
+                if (m->newName[name] == GP_NAME_TO_BE_RENAMED) {
+                        int numShortNamesBefore = m->numShortNames;
+                        char buffer[16];
+                        int length;
+                        do
+                                length = make_short_name(m->numShortNames++, buffer);
+                        while (gp_intern_find_string(&m->names, buffer, length) != -1);
+                        if (length < m->tokens[t].end - m->tokens[t].start)
+                                m->newName[name] = m->numShortNames - 1;
+                        else {
+                                m->newName[name] = GP_NAME_NOT_RENAMED;
+                                m->numShortNames = numShortNamesBefore;
+                        }
+                }
+                if (m->newName[name] >= 0)
+                        m->tokens[t].shortName = m->newName[name];
+        }
+        for (int i = 0; i < m->numLocalNames; i++)
+                m->newName[m->localNames[i]] = GP_NAME_NOT_RENAMED;
+}
+
+static void minify_output(struct GP_Ctx *ctx, struct GP_ShaderfileAst *fa)
+{
+        fa->unminifiedSize = fa->outputSize;
+        if (fa->outputSize == 0)
+                return;
+        struct GP_Minifier m = {0};
+        m.ctx = ctx;
+        m.fa = fa;
+        gp_intern_setup(&m.names);
+        lex_output_for_minifier(&m);
+        if (m.numTokens == 0) {
+                gp_intern_teardown(&m.names);
+                return;
+        }
+
+        /* Names outside of the function ranges are global, and so are
+         * the names of the functions. */
+        int numNames = m.names.numAtoms + 1;
+        ALLOC_MEMORY(&m.isGlobal, numNames);
+        ALLOC_MEMORY(&m.newName, numNames);
+        memset(m.isGlobal, 0, numNames);
+        for (int i = 0; i < numNames; i++)
+                m.newName[i] = GP_NAME_NOT_RENAMED;
+        int t = 0;
+        for (int i = 0; i < fa->numToplevelNodes; i++) {
+                const struct GP_ToplevelNode *node = fa->toplevelNodes[i];
+                if (node->directiveKind != GP_DIRECTIVE_FUNCDEFN && node->directiveKind != GP_DIRECTIVE_FUNCDECL)
+                        continue;
+                GP_Atom name = node->directiveKind == GP_DIRECTIVE_FUNCDEFN
+                        ? node->data.tFuncdefn->name : node->data.tFuncdecl->name;
+                int n = find_name(&m, name);
+                if (n != -1)
+                        m.isGlobal[n] = 1;
+                if (node->outputStart == -1)
+                        continue;
+                for (; t < m.numTokens && m.tokens[t].start < node->outputStart; t++)
+                        if (m.tokens[t].name != -1)
+                                m.isGlobal[m.tokens[t].name] = 1;
+                while (t < m.numTokens && m.tokens[t].start < node->outputEnd)
+                        t++;
+        }
+        for (; t < m.numTokens; t++)
+                if (m.tokens[t].name != -1)
+                        m.isGlobal[m.tokens[t].name] = 1;
+
+        t = 0;
+        for (int i = 0; i < fa->numToplevelNodes; i++) {
+                const struct GP_ToplevelNode *node = fa->toplevelNodes[i];
+                if ((node->directiveKind != GP_DIRECTIVE_FUNCDEFN && node->directiveKind != GP_DIRECTIVE_FUNCDECL)
+                    || node->outputStart == -1)
+                        continue;
+                while (t < m.numTokens && m.tokens[t].start < node->outputStart)
+                        t++;
+                int firstToken = t;
+                while (t < m.numTokens && m.tokens[t].start < node->outputEnd)
+                        t++;
+                rename_local_names(&m, node, firstToken, t);
+        }
+
+        /* The new output is written to the AST directly. */
+        char *text = fa->output;
+        fa->output = NULL;
+        fa->outputSize = 0;
+        fa->outputAllocated = 0;
+        /* The line breaks between the tokens are kept, so the lines of the
+         * output don't move, and the line numbers that the GLSL compiler
+         * reports are those of the unminified output. */
+        int lastChar = '\n';
+        int lastEnd = 0;
+        int isDirective = 0;
+        for (int i = 0; i < m.numTokens; i++) {
+                const struct GP_MinifyToken *token = &m.tokens[i];
+                for (const char *p = text + lastEnd; (p = memchr(p, '\n', token->start - (p - text))) != NULL; p++) {
+                        append_output_bytes(fa, "\n", 1);
+                        lastChar = '\n';
+                }
+                lastEnd = token->end;
+                const char *data = text + token->start;
+                int size = token->end - token->start;
+                char buffer[16];
+                if (token->shortName != -1) {
+                        size = make_short_name(token->shortName, buffer);
+                        data = buffer;
+                }
+                isDirective = *data == '#';
+                if (isDirective && lastChar != '\n')
+                        append_output_bytes(fa, "\n", 1);
+                else if (would_paste(lastChar, *data))
+                        append_output_bytes(fa, " ", 1);
+                append_output_bytes(fa, data, size);
+                lastChar = (unsigned char) data[size - 1];
+        }
+        if (isDirective)
+                append_output_bytes(fa, "\n", 1);  // a directive ends with a line break
+        FREE_MEMORY(&text);
+
+        gp_intern_teardown(&m.names);
+        FREE_MEMORY(&m.tokens);
+        FREE_MEMORY(&m.isGlobal);
+        FREE_MEMORY(&m.newName);
+        FREE_MEMORY(&m.localNames);
+}
+
+static void finish_parse(struct GP_Ctx *ctx, struct GP_ParseJob *job)
 {
+        if (ctx->removeDeadFunctions)
+                for (int i = 0; i < ctx->numParseUnits; i++)
+                        gp_remove_dead_functions(ctx, &ctx->unitAsts[i]);
+        if (ctx->outputMode == GP_OUTPUT_MODE_MINIFIED)
+                for (int i = 0; i < ctx->numParseUnits; i++)
+                        minify_output(ctx, &ctx->unitAsts[i]);
         for (int i = 0; i < ctx->desc.numShaders; i++)
-                gp_parse_shader(ctx, i);
+                ctx->shaderfileAsts[i] = ctx->unitAsts[job->shaderUnitIndices[i]];
+        FREE_MEMORY(&job->shaderUnitIndices);
         gp_postprocess(ctx);
 }
 
+static void setup_parser(struct GP_Parser *parser, struct GP_Ctx *ctx)
+{
+        memset(parser, 0, sizeof *parser);
+        parser->ctx = ctx;
+        parser->lexEnd = INT_MAX;
+}
+
+/* This is not thread safe since it moves the AST memory to the ctx */
+static void teardown_parser(struct GP_Parser *parser)
+{
+        gp_arena_merge(&parser->ctx->arena, &parser->arena);
+        FREE_MEMORY(&parser->fileStack);
+        FREE_MEMORY(&parser->nodeStack);
+        FREE_MEMORY(&parser->literalOutputs);
+        teardown_preprocessor(parser);
+        memset(parser, 0, sizeof *parser);
+}
+
+static void parse_units_serially(struct GP_Ctx *ctx)
+{
+        struct GP_Parser parser;
+        setup_parser(&parser, ctx);
+        for (int i = 0; i < ctx->numParseUnits; i++)
+                gp_parse_unit(&parser, i);
+        teardown_parser(&parser);
+}
+
+void gp_parse(struct GP_Ctx *ctx)
+{
+        struct GP_ParseJob job;
+        prepare_parse(ctx, &job);
+        parse_units_serially(ctx);
+        finish_parse(ctx, &job);
+}
+
+/* The parse units of a parallel parse are distributed over one queue per
+ * worker. A worker takes work from the back of its own queue, and when that
+ * is empty, it steals from the front of the other queues. */
+struct GP_WorkQueue {
+        struct GP_Mutex mutex;
+        // the units [head, tail) are not yet taken
+        int head;
+        int tail;
+};
+
+struct GP_Worker {
+        struct GP_Thread thread;
+        struct GP_Parser parser;
+        struct GP_WorkQueue *queues;
+        int numQueues;
+        int workerIndex;
+};
+
+static int take_work(struct GP_Worker *worker, int *outUnitIndex)
+{
+        for (int i = 0; i < worker->numQueues; i++) {
+                struct GP_WorkQueue *queue = &worker->queues[(worker->workerIndex + i) % worker->numQueues];
+                int haveWork = 0;
+                gp_mutex_lock(&queue->mutex);
+                if (queue->head < queue->tail) {
+                        if (i == 0)
+                                *outUnitIndex = --queue->tail;
+                        else
+                                *outUnitIndex = queue->head++;
+                        haveWork = 1;
+                }
+                gp_mutex_unlock(&queue->mutex);
+                if (haveWork)
+                        return 1;
+        }
+        return 0;
+}
+
+static void run_worker(void *arg)
+{
+        struct GP_Worker *worker = arg;
+        int unitIndex;
+        while (take_work(worker, &unitIndex))
+                gp_parse_unit(&worker->parser, unitIndex);
+}
+
+void gp_parse_parallel(struct GP_Ctx *ctx, int numThreads)
+{
+        struct GP_ParseJob job;
+        if (numThreads <= 0)
+                numThreads = gp_get_number_of_cpus();
+        prepare_parse(ctx, &job);
+        if (numThreads > ctx->numParseUnits)
+                numThreads = ctx->numParseUnits;
+        if (numThreads <= 1) {
+                parse_units_serially(ctx);
+                finish_parse(ctx, &job);
+                return;
+        }
+
+        struct GP_Mutex lineIndexMutex;
+        gp_mutex_setup(&lineIndexMutex);
+        ALLOC_MEMORY(&ctx->internShardMutexes, GP_NUM_INTERN_SHARDS);
+        for (int i = 0; i < GP_NUM_INTERN_SHARDS; i++)
+                gp_mutex_setup(&ctx->internShardMutexes[i]);
+        ctx->lineIndexMutex = &lineIndexMutex;
+
+        struct GP_WorkQueue *queues;
+        struct GP_Worker *workers;
+        ALLOC_MEMORY(&queues, numThreads);
+        ALLOC_MEMORY(&workers, numThreads);
+        for (int i = 0; i < numThreads; i++) {
+                gp_mutex_setup(&queues[i].mutex);
+                queues[i].head = (int) ((long long) i * ctx->numParseUnits / numThreads);
+                queues[i].tail = (int) ((long long) (i + 1) * ctx->numParseUnits / numThreads);
+                setup_parser(&workers[i].parser, ctx);
+                workers[i].queues = queues;
+                workers[i].numQueues = numThreads;
+                workers[i].workerIndex = i;
+        }
+        // the calling thread is worker 0
+        for (int i = 1; i < numThreads; i++)
+                gp_thread_start(&workers[i].thread, run_worker, &workers[i]);
+        run_worker(&workers[0]);
+        for (int i = 1; i < numThreads; i++)
+                gp_thread_join(&workers[i].thread);
+
+        for (int i = 0; i < numThreads; i++) {
+                teardown_parser(&workers[i].parser);
+                gp_mutex_teardown(&queues[i].mutex);
+        }
+        FREE_MEMORY(&queues);
+        FREE_MEMORY(&workers);
+        ctx->lineIndexMutex = NULL;
+        gp_mutex_teardown(&lineIndexMutex);
+        for (int i = 0; i < GP_NUM_INTERN_SHARDS; i++)
+                gp_mutex_teardown(&ctx->internShardMutexes[i]);
+        FREE_MEMORY(&ctx->internShardMutexes);
+
+        finish_parse(ctx, &job);
+}
+
+const char *gp_span_data(struct GP_Ctx *ctx, struct GP_Span span)
+{
+        return ctx->desc.fileInfo[span.fileIndex].contents + span.offset;
+}
+
+const char *gp_output_span_data(struct GP_Ctx *ctx, const struct GP_ShaderfileAst *fa, struct GP_Span span)
+{
+        if (span.fileIndex == GP_GENERATED_TEXT)
+                return fa->generatedText + span.offset;
+        return gp_span_data(ctx, span);
+}
+
+int gp_span_equals(struct GP_Ctx *ctx, struct GP_Span span, const char *string)
+{
+        return !strncmp(gp_span_data(ctx, span), string, span.length)
+                && string[span.length] == '\0';
+}
+
+char *gp_alloc_span_string(struct GP_Ctx *ctx, struct GP_Span span)
+{
+        char *string;
+        ALLOC_MEMORY(&string, span.length + 1);
+        copy_span_data(ctx, span, string);
+        string[span.length] = '\0';
+        return string;
+}
+
+char *gp_alloc_output_string(struct GP_Ctx *ctx, const struct GP_ShaderfileAst *fa)
+{
+        char *string;
+        ALLOC_MEMORY(&string, fa->outputSize + 1);
+        if (ctx->outputMode == GP_OUTPUT_MODE_SPANS) {
+                int pos = 0;
+                for (int i = 0; i < fa->numOutputSpans; i++) {
+                        struct GP_Span span = fa->outputSpans[i];
+                        if (span.fileIndex == GP_GENERATED_TEXT)
+                                memcpy(string + pos, fa->generatedText + span.offset, span.length);
+                        else
+                                copy_span_data(ctx, span, string + pos);
+                        pos += span.length;
+                }
+        }
+        else if (fa->outputSize > 0) {
+                memcpy(string, fa->output, fa->outputSize);
+        }
+        string[fa->outputSize] = '\0';
+        return string;
+}
+
+GP_Atom gp_intern_span(struct GP_Ctx *ctx, struct GP_Span span)
+{
+        return intern_string(ctx, gp_span_data(ctx, span), span.length);
+}
+
+const char *gp_atom_string(struct GP_Ctx *ctx, GP_Atom atom)
+{
+        struct GP_InternTable *table = &ctx->internShards[atom & (GP_NUM_INTERN_SHARDS - 1)];
+        return gp_intern_table_string(table, atom >> GP_INTERN_SHARD_BITS);
+}
+
+int gp_atom_length(struct GP_Ctx *ctx, GP_Atom atom)
+{
+        struct GP_InternTable *table = &ctx->internShards[atom & (GP_NUM_INTERN_SHARDS - 1)];
+        return gp_intern_table_length(table, atom >> GP_INTERN_SHARD_BITS);
+}
+
 void gp_setup(struct GP_Ctx *ctx)
 {
         memset(ctx, 0, sizeof *ctx);
+        gp_arena_setup(&ctx->arena);
+        for (int i = 0; i < GP_NUM_INTERN_SHARDS; i++)
+                gp_intern_setup(&ctx->internShards[i]);
+        gp_intern_setup(&ctx->fileIDTable);
+}
+
+static void teardown_node_pool(struct GP_NodePool *pool)
+{
+        FREE_MEMORY(&pool->kinds);
+        FREE_MEMORY(&pool->operand0);
+        FREE_MEMORY(&pool->operand1);
+        FREE_MEMORY(&pool->operand2);
+}
+
+/* The toplevel nodes are in the arena of the ctx */
+static void teardown_shaderfile_ast(struct GP_ShaderfileAst *fa)
+{
+        FREE_MEMORY(&fa->output);
+        FREE_MEMORY(&fa->outputSpans);
+        FREE_MEMORY(&fa->generatedText);
+        teardown_node_pool(&fa->exprPool);
+        teardown_node_pool(&fa->stmtPool);
+        FREE_MEMORY(&fa->nodeLists);
+        FREE_MEMORY(&fa->literalValues);
+        FREE_MEMORY(&fa->literalKinds);
 }
 
 void gp_teardown(struct GP_Ctx *ctx)
 {
-        FREE_MEMORY(&ctx->tokenBuffer);
+        if (ctx->unitAsts != NULL)
+                for (int i = 0; i < ctx->numParseUnits; i++)
+                        teardown_shaderfile_ast(&ctx->unitAsts[i]);
+        gp_arena_teardown(&ctx->arena);
+        for (int i = 0; i < GP_NUM_INTERN_SHARDS; i++)
+                gp_intern_teardown(&ctx->internShards[i]);
+        gp_intern_teardown(&ctx->fileIDTable);
+        FREE_MEMORY(&ctx->programUniforms);
+        FREE_MEMORY(&ctx->programAttributes);
+        FREE_MEMORY(&ctx->programBlocks);
+        FREE_MEMORY(&ctx->parseUnits);
+        FREE_MEMORY(&ctx->unitAsts);
         FREE_MEMORY(&ctx->shaderfileAsts);
+        FREE_MEMORY(&ctx->lineIndices);
+        FREE_MEMORY(&ctx->tokenCaches);
+        FREE_MEMORY(&ctx->fileParseCounts);
+        FREE_MEMORY(&ctx->desc.fileInfo);
+        FREE_MEMORY(&ctx->desc.programInfo);
+        FREE_MEMORY(&ctx->desc.shaderInfo);
+        FREE_MEMORY(&ctx->desc.linkInfo);
         memset(ctx, 0, sizeof *ctx);
 }
@@ -0,0 +1,367 @@
+#include <glsl-processor/defs.h>
+#include <glsl-processor/logging.h>
+#include <glsl-processor/scan.h>
+#include <glsl-processor/thread.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HAVE_SSE2 1
+#include <emmintrin.h>
+#else
+#define HAVE_SSE2 0
+#endif
+
+/* The AVX2 code is compiled with a target attribute (or without any flags on
+ * MSVC) and only called if the CPU supports it. */
+#if HAVE_SSE2 && (defined(__GNUC__) || defined(__clang__))
+#define HAVE_AVX2 1
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif HAVE_SSE2 && defined(_MSC_VER)
+#define HAVE_AVX2 1
+#define TARGET_AVX2
+#include <immintrin.h>
+#include <intrin.h>
+#else
+#define HAVE_AVX2 0
+#endif
+
+#if defined(_MSC_VER)
+static int count_trailing_zeros(unsigned x)
+{
+        unsigned long index;
+        _BitScanForward(&index, x);
+        return (int) index;
+}
+
+/* __popcnt() needs a CPU with POPCNT, which we don't want to check for */
+static int count_bits(unsigned x)
+{
+        x = x - ((x >> 1) & 0x55555555u);
+        x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+        x = (x + (x >> 4)) & 0x0F0F0F0Fu;
+        return (int) ((x * 0x01010101u) >> 24);
+}
+#else
+static int count_trailing_zeros(unsigned x)
+{
+        return __builtin_ctz(x);
+}
+
+static int count_bits(unsigned x)
+{
+        return __builtin_popcount(x);
+}
+#endif
+
+const char *const gp_scanImplKindString[GP_NUM_SCAN_IMPL_KINDS] = {
+        [GP_SCAN_IMPL_SCALAR] = "scalar",
+        [GP_SCAN_IMPL_SSE2] = "sse2",
+        [GP_SCAN_IMPL_AVX2] = "avx2",
+};
+
+static const char *scalar_skip_whitespace(const char *p, const char *end)
+{
+        while (p < end && (unsigned char) *p <= 32)
+                p++;
+        return p;
+}
+
+static const char *scalar_find_newline(const char *p, const char *end)
+{
+        while (p < end && *p != '\n')
+                p++;
+        return p;
+}
+
+static const char *scalar_find_comment_end(const char *p, const char *end)
+{
+        for (; end - p >= 2; p++)
+                if (p[0] == '*' && p[1] == '/')
+                        return p;
+        return NULL;
+}
+
+static int scalar_count_newlines(const char *p, const char *end)
+{
+        int count = 0;
+        for (; p < end; p++)
+                count += *p == '\n';
+        return count;
+}
+
+static int is_block_char(char c)
+{
+        return c == '{' || c == '}' || c == '/' || c == '"' || c == '#';
+}
+
+static const char *scalar_find_block_char(const char *p, const char *end)
+{
+        while (p < end && !is_block_char(*p))
+                p++;
+        return p;
+}
+
+#if HAVE_SSE2
+static const char *sse2_skip_whitespace(const char *p, const char *end)
+{
+        const __m128i space = _mm_set1_epi8(32);
+        while (end - p >= 16) {
+                __m128i x = _mm_loadu_si128((const __m128i *) p);
+                /* x <= 32 (unsigned) iff max(x, 32) == 32 */
+                __m128i isSpace = _mm_cmpeq_epi8(_mm_max_epu8(x, space), space);
+                unsigned mask = ~_mm_movemask_epi8(isSpace) & 0xFFFF;
+                if (mask)
+                        return p + count_trailing_zeros(mask);
+                p += 16;
+        }
+        return scalar_skip_whitespace(p, end);
+}
+
+static const char *sse2_find_newline(const char *p, const char *end)
+{
+        const __m128i newline = _mm_set1_epi8('\n');
+        while (end - p >= 16) {
+                __m128i x = _mm_loadu_si128((const __m128i *) p);
+                unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, newline));
+                if (mask)
+                        return p + count_trailing_zeros(mask);
+                p += 16;
+        }
+        return scalar_find_newline(p, end);
+}
+
+static const char *sse2_find_comment_end(const char *p, const char *end)
+{
+        const __m128i star = _mm_set1_epi8('*');
+        const __m128i slash = _mm_set1_epi8('/');
+        /* we load 16 bytes at p and at p + 1 */
+        while (end - p >= 17) {
+                __m128i x = _mm_loadu_si128((const __m128i *) p);
+                __m128i y = _mm_loadu_si128((const __m128i *) (p + 1));
+                __m128i match = _mm_and_si128(_mm_cmpeq_epi8(x, star),
+                                              _mm_cmpeq_epi8(y, slash));
+                unsigned mask = _mm_movemask_epi8(match);
+                if (mask)
+                        return p + count_trailing_zeros(mask);
+                p += 16;
+        }
+        return scalar_find_comment_end(p, end);
+}
+
+static int sse2_count_newlines(const char *p, const char *end)
+{
+        const __m128i newline = _mm_set1_epi8('\n');
+        int count = 0;
+        while (end - p >= 16) {
+                __m128i x = _mm_loadu_si128((const __m128i *) p);
+                count += count_bits(_mm_movemask_epi8(_mm_cmpeq_epi8(x, newline)));
+                p += 16;
+        }
+        return count + scalar_count_newlines(p, end);
+}
+
+static const char *sse2_find_block_char(const char *p, const char *end)
+{
+        const __m128i leftBrace = _mm_set1_epi8('{');
+        const __m128i rightBrace = _mm_set1_epi8('}');
+        const __m128i slash = _mm_set1_epi8('/');
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i hash = _mm_set1_epi8('#');
+        while (end - p >= 16) {
+                __m128i x = _mm_loadu_si128((const __m128i *) p);
+                __m128i match = _mm_or_si128(
+                        _mm_or_si128(_mm_cmpeq_epi8(x, leftBrace), _mm_cmpeq_epi8(x, rightBrace)),
+                        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, slash), _mm_cmpeq_epi8(x, quote)),
+                                     _mm_cmpeq_epi8(x, hash)));
+                unsigned mask = _mm_movemask_epi8(match);
+                if (mask)
+                        return p + count_trailing_zeros(mask);
+                p += 16;
+        }
+        return scalar_find_block_char(p, end);
+}
+#endif
+
+#if HAVE_AVX2
+TARGET_AVX2 static const char *avx2_skip_whitespace(const char *p, const char *end)
+{
+        const __m256i space = _mm256_set1_epi8(32);
+        while (end - p >= 32) {
+                __m256i x = _mm256_loadu_si256((const __m256i *) p);
+                __m256i isSpace = _mm256_cmpeq_epi8(_mm256_max_epu8(x, space), space);
+                unsigned mask = ~(unsigned) _mm256_movemask_epi8(isSpace);
+                if (mask)
+                        return p + count_trailing_zeros(mask);
+                p += 32;
+        }
+        return sse2_skip_whitespace(p, end);
+}
+
+TARGET_AVX2 static const char *avx2_find_newline(const char *p, const char *end)
+{
+        const __m256i newline = _mm256_set1_epi8('\n');
+        while (end - p >= 32) {
+                __m256i x = _mm256_loadu_si256((const __m256i *) p);
+                unsigned mask = (unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, newline));
+                if (mask)
+                        return p + count_trailing_zeros(mask);
+                p += 32;
+        }
+        return sse2_find_newline(p, end);
+}
+
+TARGET_AVX2 static const char *avx2_find_comment_end(const char *p, const char *end)
+{
+        const __m256i star = _mm256_set1_epi8('*');
+        const __m256i slash = _mm256_set1_epi8('/');
+        while (end - p >= 33) {
+                __m256i x = _mm256_loadu_si256((const __m256i *) p);
+                __m256i y = _mm256_loadu_si256((const __m256i *) (p + 1));
+                __m256i match = _mm256_and_si256(_mm256_cmpeq_epi8(x, star),
+                                                 _mm256_cmpeq_epi8(y, slash));
+                unsigned mask = (unsigned) _mm256_movemask_epi8(match);
+                if (mask)
+                        return p + count_trailing_zeros(mask);
+                p += 32;
+        }
+        return sse2_find_comment_end(p, end);
+}
+
+TARGET_AVX2 static int avx2_count_newlines(const char *p, const char *end)
+{
+        const __m256i newline = _mm256_set1_epi8('\n');
+        int count = 0;
+        while (end - p >= 32) {
+                __m256i x = _mm256_loadu_si256((const __m256i *) p);
+                count += count_bits((unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, newline)));
+                p += 32;
+        }
+        return count + sse2_count_newlines(p, end);
+}
+
+TARGET_AVX2 static const char *avx2_find_block_char(const char *p, const char *end)
+{
+        const __m256i leftBrace = _mm256_set1_epi8('{');
+        const __m256i rightBrace = _mm256_set1_epi8('}');
+        const __m256i slash = _mm256_set1_epi8('/');
+        const __m256i quote = _mm256_set1_epi8('"');
+        const __m256i hash = _mm256_set1_epi8('#');
+        while (end - p >= 32) {
+                __m256i x = _mm256_loadu_si256((const __m256i *) p);
+                __m256i match = _mm256_or_si256(
+                        _mm256_or_si256(_mm256_cmpeq_epi8(x, leftBrace), _mm256_cmpeq_epi8(x, rightBrace)),
+                        _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(x, slash), _mm256_cmpeq_epi8(x, quote)),
+                                        _mm256_cmpeq_epi8(x, hash)));
+                unsigned mask = (unsigned) _mm256_movemask_epi8(match);
+                if (mask)
+                        return p + count_trailing_zeros(mask);
+                p += 32;
+        }
+        return sse2_find_block_char(p, end);
+}
+
+#if defined(_MSC_VER)
+static int cpu_supports_avx2(void)
+{
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+                return 0;
+        __cpuid(info, 1);
+        /* OSXSAVE and AVX, and the OS must save the YMM registers */
+        if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0)
+                return 0;
+        if ((_xgetbv(0) & 6) != 6)
+                return 0;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+}
+#else
+static int cpu_supports_avx2(void)
+{
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+}
+#endif
+#endif
+
+static const struct GP_ScanImpl scanImpls[GP_NUM_SCAN_IMPL_KINDS] = {
+        [GP_SCAN_IMPL_SCALAR] = {
+                scalar_skip_whitespace, scalar_find_newline, scalar_find_comment_end,
+                scalar_count_newlines, scalar_find_block_char
+        },
+#if HAVE_SSE2
+        [GP_SCAN_IMPL_SSE2] = {
+                sse2_skip_whitespace, sse2_find_newline, sse2_find_comment_end,
+                sse2_count_newlines, sse2_find_block_char
+        },
+#endif
+#if HAVE_AVX2
+        [GP_SCAN_IMPL_AVX2] = {
+                avx2_skip_whitespace, avx2_find_newline, avx2_find_comment_end,
+                avx2_count_newlines, avx2_find_block_char
+        },
+#endif
+};
+
+struct GP_ScanImpl gp_scanImpl = {
+        scalar_skip_whitespace, scalar_find_newline, scalar_find_comment_end,
+                scalar_count_newlines, scalar_find_block_char
+};
+
+static int currentImplKind = GP_SCAN_IMPL_SCALAR;
+static struct GP_Once scanInitOnce = GP_ONCE_INIT;
+
+int gp_scan_impl_supported(int implKind)
+{
+        switch (implKind) {
+        case GP_SCAN_IMPL_SCALAR:
+                return 1;
+        case GP_SCAN_IMPL_SSE2:
+                return HAVE_SSE2;
+        case GP_SCAN_IMPL_AVX2:
+#if HAVE_AVX2
+                return cpu_supports_avx2();
+#else
+                return 0;
+#endif
+        default:
+                return 0;
+        }
+}
+
+static void set_impl(int implKind)
+{
+        gp_scanImpl = scanImpls[implKind];
+        currentImplKind = implKind;
+}
+
+void gp_scan_select_impl(int implKind)
+{
+        GP_ENSURE(gp_scan_impl_supported(implKind));
+        // the selection must not be overwritten by a later gp_scan_init()
+        gp_scan_init();
+        set_impl(implKind);
+}
+
+int gp_scan_get_impl(void)
+{
+        return currentImplKind;
+}
+
+static void select_best_impl(void)
+{
+        for (int i = GP_NUM_SCAN_IMPL_KINDS; i-- > 0;) {
+                if (gp_scan_impl_supported(i)) {
+                        set_impl(i);
+                        break;
+                }
+        }
+}
+
+/* The implementation is selected only once, so concurrent gp_parse() calls
+ * don't race on it. Every call returns only after the selection is made. */
+void gp_scan_init(void)
+{
+        gp_call_once(&scanInitOnce, select_best_impl);
+}
@@ -0,0 +1,135 @@
+#if !defined(_WIN32)
+#define _DEFAULT_SOURCE  // for _SC_NPROCESSORS_ONLN
+#endif
+
+#include <glsl-processor/defs.h>
+#include <glsl-processor/logging.h>
+#include <glsl-processor/thread.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+void gp_mutex_setup(struct GP_Mutex *mutex)
+{
+        InitializeSRWLock((PSRWLOCK) &mutex->srwlock);
+}
+
+void gp_mutex_teardown(struct GP_Mutex *mutex)
+{
+        UNUSED(mutex);
+}
+
+void gp_mutex_lock(struct GP_Mutex *mutex)
+{
+        AcquireSRWLockExclusive((PSRWLOCK) &mutex->srwlock);
+}
+
+void gp_mutex_unlock(struct GP_Mutex *mutex)
+{
+        ReleaseSRWLockExclusive((PSRWLOCK) &mutex->srwlock);
+}
+
+static DWORD WINAPI thread_entry(LPVOID param)
+{
+        struct GP_Thread *thread = param;
+        thread->func(thread->arg);
+        return 0;
+}
+
+void gp_thread_start(struct GP_Thread *thread, void (*func)(void *arg), void *arg)
+{
+        thread->func = func;
+        thread->arg = arg;
+        thread->handle = CreateThread(NULL, 0, thread_entry, thread, 0, NULL);
+        if (thread->handle == NULL)
+                gp_fatal_f("Failed to create thread");
+}
+
+void gp_thread_join(struct GP_Thread *thread)
+{
+        WaitForSingleObject(thread->handle, INFINITE);
+        CloseHandle(thread->handle);
+        thread->handle = NULL;
+}
+
+struct OnceCall {
+        void (*func)(void);
+};
+
+static BOOL CALLBACK once_entry(PINIT_ONCE initOnce, PVOID param, PVOID *context)
+{
+        UNUSED(initOnce);
+        UNUSED(context);
+        const struct OnceCall *call = param;
+        call->func();
+        return TRUE;
+}
+
+void gp_call_once(struct GP_Once *once, void (*func)(void))
+{
+        struct OnceCall call = { func };
+        InitOnceExecuteOnce((PINIT_ONCE) &once->initOnce, once_entry, &call, NULL);
+}
+
+int gp_get_number_of_cpus(void)
+{
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return (int) info.dwNumberOfProcessors;
+}
+#else
+#include <unistd.h>
+
+void gp_mutex_setup(struct GP_Mutex *mutex)
+{
+        if (pthread_mutex_init(&mutex->mutex, NULL) != 0)
+                gp_fatal_f("Failed to initialize mutex");
+}
+
+void gp_mutex_teardown(struct GP_Mutex *mutex)
+{
+        pthread_mutex_destroy(&mutex->mutex);
+}
+
+void gp_mutex_lock(struct GP_Mutex *mutex)
+{
+        pthread_mutex_lock(&mutex->mutex);
+}
+
+void gp_mutex_unlock(struct GP_Mutex *mutex)
+{
+        pthread_mutex_unlock(&mutex->mutex);
+}
+
+static void *thread_entry(void *param)
+{
+        struct GP_Thread *thread = param;
+        thread->func(thread->arg);
+        return NULL;
+}
+
+void gp_thread_start(struct GP_Thread *thread, void (*func)(void *arg), void *arg)
+{
+        thread->func = func;
+        thread->arg = arg;
+        if (pthread_create(&thread->thread, NULL, thread_entry, thread) != 0)
+                gp_fatal_f("Failed to create thread");
+}
+
+void gp_thread_join(struct GP_Thread *thread)
+{
+        pthread_join(thread->thread, NULL);
+}
+
+void gp_call_once(struct GP_Once *once, void (*func)(void))
+{
+        pthread_once(&once->once, func);
+}
+
+int gp_get_number_of_cpus(void)
+{
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        return n > 0 ? (int) n : 1;
+}
+#endif
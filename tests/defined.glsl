@@ -0,0 +1,31 @@
+// defines: A B=0
+#if defined(A) && defined B
+uniform float a_and_b;
+#endif
+#if defined(A) && defined(C)
+uniform float a_and_c;
+#endif
+#if defined C || defined(B)
+uniform float c_or_b;
+#endif
+#if defined(C) || defined(D)
+uniform float c_or_d;
+#endif
+#if !defined(C) && defined(A) && !B
+uniform float not_c_and_a_and_not_b;
+#endif
+// the right operand is not evaluated
+#if defined(C) && 1 / C
+uniform float c_and_division;
+#elif !defined(C) || 1 / C
+uniform float not_c_or_division;
+#endif
+#undef A
+#if defined(A) || defined(B) && B
+uniform float a_or_b_and_b;
+#elif (defined(A) || defined(B)) && !B
+uniform float parenthesized;
+#endif
+void main()
+{
+}
@@ -0,0 +1,28 @@
+// operations that overflow or are undefined are not folded
+// the preprocessor computes with 64 bits, and wraps around
+#if 0x7FFFFFFF + 1 > 0 && 0xFFFFFFFF == -1 && 4294967295u * 4294967295u < 0
+uniform float pp_wraps_at_64_bits;
+#endif
+void main()
+{
+        int a = 2147483647 + 1;
+        int b = 2147483646 + 1;
+        int c = -2147483647 - 1;
+        int d = -(-2147483647 - 1);
+        int e = 65536 * 65536;
+        int f = 1 / 0;
+        int g = -7 % 2;
+        uint h = 4294967295u + 1u;
+        uint i = 0u - 1u;
+        uint j = 65536u * 65536u;
+        float k = 3.0e38 * 10.0;
+        float l = 1.0e38 * 3.0;
+        float m = 3.4e38 + 3.4e37;
+        double n = 1.0e308lf * 10.0lf;
+        double o = 1.0e308lf * 1.5lf;
+        float p = 16777216.0 + 1.0;
+        double q = 16777216.0lf + 1.0lf;
+        float r = 0.1 + 0.2;
+        double s = 0.1lf + 0.2lf;
+        float t = 1.0 / 0.0;
+}
@@ -0,0 +1,25 @@
+#define CAT(a, b) a ## b
+#define CAT3(a, b, c) a ## b ## c
+#define XCAT(a, b) CAT(a, b)
+#define NAME(n) value_ ## n
+#define OBJECT prefix_ ## object
+#define PREFIX pre
+#define NUM 1
+#define ab 7
+// the arguments of ## are not expanded, XCAT() expands them first
+uniform float CAT(PREFIX, NUM);
+uniform float XCAT(PREFIX, NUM);
+uniform float CAT3(a, _, b);
+uniform float NAME(2);
+uniform float OBJECT;
+// an empty argument
+uniform float CAT(, empty);
+uniform float CAT(empty2, );
+void main()
+{
+        // the result is expanded again
+        int x = CAT(a, b);
+        // the result is a single number
+        int y = CAT(1, 6) + 1;
+        float z = CAT(1, .5) + CAT(2., 0);
+}
@@ -0,0 +1,212 @@
+/* The regression tests, run with "make test". The arguments are test files:
+ *
+ * For a file X.glsl, the file is preprocessed and parsed as a vertex shader,
+ * with constants folded, and the output must be the contents of X.expected.
+ * The file is processed in several ways (from memory, streamed in small
+ * blocks, and with the output kept as spans), which must all give the same
+ * output. Macros can be predefined in the first line of the file, for
+ * example "// defines: FOO BAR=2".
+ *
+ * For a file X.txt, each line that is not empty and does not start with '#'
+ * is a number literal and the text that gp_format_literal() gives for its
+ * value, separated by whitespace. Instead of the text, it is "invalid" if the
+ * literal is not valid, and "infinite" if its value is too large.
+ * The formatted text must be parsed to the same value again.
+ */
+
+#include <glsl-processor/defs.h>
+#include <glsl-processor/logging.h>
+#include <glsl-processor/memory.h>
+#include <glsl-processor/mapfile.h>
+#include <glsl-processor/parse.h>
+#include <glsl-processor/builder.h>
+#include <glsl-processor/literal.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+enum {
+        TEST_STREAM_BLOCK_SIZE = 64,
+        MAX_DEFINES_LENGTH = 256,
+        MAX_LITERAL_LENGTH = 128,
+};
+
+struct TestRun {
+        const char *name;
+        int isStreamed;
+        int outputMode;
+};
+
+static const struct TestRun testRuns[] = {
+        { "buffer", 0, GP_OUTPUT_MODE_BUFFER },
+        { "streamed", 1, GP_OUTPUT_MODE_BUFFER },
+        { "spans", 0, GP_OUTPUT_MODE_SPANS },
+        { "streamed spans", 1, GP_OUTPUT_MODE_SPANS },
+};
+
+static int numTests;
+static int numFailed;
+
+static int read_mapped_file(void *userData, int offset, char *buffer, int size)
+{
+        const struct GP_MappedFile *mappedFile = userData;
+        if (offset >= mappedFile->size)
+                return 0;
+        // short reads, so that tokens cross the reads
+        if (size > 13)
+                size = 13;
+        if (size > mappedFile->size - offset)
+                size = mappedFile->size - offset;
+        memcpy(buffer, mappedFile->data + offset, size);
+        return size;
+}
+
+static void get_defines(const struct GP_MappedFile *file, char *defines)
+{
+        static const char prefix[] = "// defines:";
+        int prefixLength = (int) sizeof prefix - 1;
+        defines[0] = '\0';
+        if (file->size < prefixLength || memcmp(file->data, prefix, prefixLength) != 0)
+                return;
+        int start = prefixLength;
+        int end = start;
+        while (end < file->size && file->data[end] != '\n')
+                end++;
+        if (end - start >= MAX_DEFINES_LENGTH)
+                gp_fatal_f("The defines line is too long");
+        memcpy(defines, file->data + start, end - start);
+        defines[end - start] = '\0';
+}
+
+static char *preprocess_file(struct GP_MappedFile *file, const char *defines,
+                             const struct TestRun *run, int *outputSize)
+{
+        struct GP_Builder builder;
+        gp_builder_setup(&builder);
+        if (run->isStreamed)
+                gp_builder_create_file_streamed(&builder, "test", &read_mapped_file, file);
+        else
+                gp_builder_create_file_borrowed(&builder, "test", file->data, file->size);
+        gp_builder_create_shader_variant(&builder, "shader", "test", GP_SHADERTYPE_VERTEX,
+                                         defines[0] != '\0' ? defines : NULL);
+        gp_builder_create_program(&builder, "program");
+        gp_builder_create_link(&builder, "program", "shader");
+        gp_builder_process(&builder);
+
+        struct GP_Ctx ctx;
+        gp_setup(&ctx);
+        gp_builder_to_ctx(&builder, &ctx);
+        ctx.outputMode = run->outputMode;
+        ctx.foldConstants = 1;
+        if (run->isStreamed)
+                ctx.streamBlockSize = TEST_STREAM_BLOCK_SIZE;
+        gp_parse(&ctx);
+        const struct GP_ShaderfileAst *fa = &ctx.shaderfileAsts[0];
+        char *output = gp_alloc_output_string(&ctx, fa);
+        *outputSize = fa->outputSize;
+        gp_teardown(&ctx);
+        gp_builder_teardown(&builder);
+        return output;
+}
+
+static void run_glsl_test(const char *filepath)
+{
+        char expectedPath[1024];
+        int pathLength = (int) strlen(filepath) - (int) strlen(".glsl");
+        if (pathLength + (int) strlen(".expected") >= (int) sizeof expectedPath)
+                gp_fatal_f("Test file path too long: %s", filepath);
+        snprintf(expectedPath, sizeof expectedPath, "%.*s.expected", pathLength, filepath);
+
+        struct GP_MappedFile file;
+        struct GP_MappedFile expected;
+        gp_map_file(&file, filepath);
+        gp_map_file(&expected, expectedPath);
+        char defines[MAX_DEFINES_LENGTH];
+        get_defines(&file, defines);
+        for (int i = 0; i < LENGTH(testRuns); i++) {
+                int outputSize;
+                char *output = preprocess_file(&file, defines, &testRuns[i], &outputSize);
+                numTests++;
+                if (outputSize != expected.size
+                    || (outputSize > 0 && memcmp(output, expected.data, outputSize) != 0)) {
+                        numFailed++;
+                        printf("FAIL: %s (%s), the output is:\n%s\n", filepath, testRuns[i].name, output);
+                }
+                FREE_MEMORY(&output);
+        }
+        gp_unmap_file(&expected);
+        gp_unmap_file(&file);
+}
+
+static void check_literal(const char *filepath, int lineNumber, const char *literal, const char *expected)
+{
+        char formatted[GP_LITERAL_BUFFER_SIZE + 1];
+        double value;
+        int literalKind = gp_parse_literal(literal, (int) strlen(literal), &value);
+        if (literalKind == -1)
+                strcpy(formatted, "invalid");
+        else if (value - value != 0.0)
+                strcpy(formatted, "infinite");
+        else {
+                int length = gp_format_literal(literalKind, value, formatted);
+                formatted[length] = '\0';
+                /* A negative value is written as a negated literal. Ints wrap
+                 * around, -2147483648 is INT_MIN. */
+                int isNegated = formatted[0] == '-';
+                double roundTripValue;
+                int roundTripKind = gp_parse_literal(formatted + isNegated, length - isNegated, &roundTripValue);
+                if (isNegated && !(roundTripKind == GP_LITERAL_INT && roundTripValue == INT_MIN))
+                        roundTripValue = -roundTripValue;
+                if (roundTripKind != literalKind || roundTripValue != value) {
+                        numFailed++;
+                        printf("FAIL: %s:%d: %s is formatted as %s, which is parsed to a different value\n",
+                               filepath, lineNumber, literal, formatted);
+                        return;
+                }
+        }
+        if (strcmp(formatted, expected) != 0) {
+                numFailed++;
+                printf("FAIL: %s:%d: %s is formatted as %s, expected %s\n",
+                       filepath, lineNumber, literal, formatted, expected);
+        }
+}
+
+static void run_literal_tests(const char *filepath)
+{
+        FILE *f = fopen(filepath, "r");
+        if (f == NULL)
+                gp_fatal_f("Failed to open %s", filepath);
+        char line[2 * MAX_LITERAL_LENGTH];
+        for (int lineNumber = 1; fgets(line, sizeof line, f) != NULL; lineNumber++) {
+                char literal[MAX_LITERAL_LENGTH];
+                char expected[MAX_LITERAL_LENGTH];
+                if (line[0] == '#' || line[0] == '\n')
+                        continue;
+                if (sscanf(line, "%127s %127s", literal, expected) != 2)
+                        gp_fatal_f("%s:%d: Expected a literal and its formatted text", filepath, lineNumber);
+                numTests++;
+                check_literal(filepath, lineNumber, literal, expected);
+        }
+        fclose(f);
+}
+
+static int ends_with(const char *string, const char *suffix)
+{
+        int length = (int) strlen(string);
+        int suffixLength = (int) strlen(suffix);
+        return length >= suffixLength && strcmp(string + length - suffixLength, suffix) == 0;
+}
+
+int main(int argc, const char **argv)
+{
+        for (int i = 1; i < argc; i++) {
+                if (ends_with(argv[i], ".glsl"))
+                        run_glsl_test(argv[i]);
+                else if (ends_with(argv[i], ".txt"))
+                        run_literal_tests(argv[i]);
+                else
+                        gp_fatal_f("Unknown kind of test file: %s", argv[i]);
+        }
+        printf("%d of %d tests passed\n", numTests - numFailed, numTests);
+        return numFailed > 0;
+}
@@ -0,0 +1,24 @@
+uniform int foo;
+uniform int x;
+uniform int y;
+uniform int z;
+int f(int a)
+{
+        return a;
+}
+// a macro is not expanded again in its own expansion
+#define foo foo + 1
+#define x (4 + y)
+#define y (2 * x)
+#define f(a) a * f(a)
+#define g(a) f(a)
+#define h(a) a(z)
+void main()
+{
+        int a = foo;
+        int b = x;
+        int c = y;
+        int d = f(z);
+        int e = g(f(z));
+        int i = h(h);
+}
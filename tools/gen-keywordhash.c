@@ -0,0 +1,83 @@
+#include <glsl-processor/defs.h>
+#include <glsl-processor/logging.h>
+#include <glsl-processor/memory.h>
+#include <glsl-processor/ast.h>
+#include <glsl-processor/keywordhash.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Generates src/keywordhash.c: the perfect hash table for the keywords and
+ * type names that are listed in src/data.c. Run "make keywordhash". */
+
+struct Entry {
+        const char *name;
+        const char *keywordKind;
+        const char *typeKind;
+};
+
+static struct Entry *entries;
+static int numEntries;
+
+static void add_entry(const char *name, const char *keywordKind, const char *typeKind)
+{
+        int idx = numEntries++;
+        REALLOC_MEMORY(&entries, numEntries);
+        entries[idx].name = name;
+        entries[idx].keywordKind = keywordKind;
+        entries[idx].typeKind = typeKind;
+}
+
+static int try_seed(unsigned seed, unsigned char *table)
+{
+        memset(table, 0, GP_KEYWORD_HASH_SIZE);
+        for (int i = 0; i < numEntries; i++) {
+                const char *name = entries[i].name;
+                unsigned h = gp_keyword_hash(seed, name, (int) strlen(name));
+                if (table[h])
+                        return 0;
+                table[h] = (unsigned char) (i + 1);
+        }
+        return 1;
+}
+
+int main(void)
+{
+        for (int i = 0; i < GP_NUM_KEYWORD_KINDS; i++)
+                add_entry(gp_keywordString[i], gp_keywordKindString[i], "-1");
+        for (int i = 0; i < GP_NUM_TYPE_KINDS; i++)
+                add_entry(gp_typeString[i], "-1", gp_typeKindString[i]);
+        for (int i = 0; i < gp_numTypeAliases; i++)
+                add_entry(gp_typeAlias[i].name, "-1", gp_typeKindString[gp_typeAlias[i].typeKind]);
+        if (numEntries >= 255)
+                gp_fatal_f("Too many entries for the table of unsigned char");
+
+        int maxLength = 0;
+        for (int i = 0; i < numEntries; i++)
+                if (maxLength < (int) strlen(entries[i].name))
+                        maxLength = (int) strlen(entries[i].name);
+
+        static unsigned char table[GP_KEYWORD_HASH_SIZE];
+        unsigned seed = 0;
+        while (!try_seed(seed, table)) {
+                seed++;
+                if (seed == 0)
+                        gp_fatal_f("No seed found. Increase GP_KEYWORD_HASH_SIZE");
+        }
+
+        printf("/* This file was generated by tools/gen-keywordhash.c. Do not edit. */\n\n");
+        printf("#include <glsl-processor/keywordhash.h>\n\n");
+        printf("const unsigned gp_keywordHashSeed = %uu;\n\n", seed);
+        printf("const int gp_keywordHashMaxLength = %d;\n\n", maxLength);
+        printf("const struct GP_KeywordHashEntry gp_keywordHashEntries[] = {\n");
+        for (int i = 0; i < numEntries; i++)
+                printf("        { \"%s\", %d, %s, %s },\n", entries[i].name,
+                       (int) strlen(entries[i].name),
+                       entries[i].keywordKind, entries[i].typeKind);
+        printf("};\n\n");
+        printf("const unsigned char gp_keywordHashTable[GP_KEYWORD_HASH_SIZE] = {");
+        for (int i = 0; i < GP_KEYWORD_HASH_SIZE; i++)
+                printf("%s%d,", i % 16 == 0 ? "\n        " : " ", table[i]);
+        printf("\n};\n");
+        FREE_MEMORY(&entries);
+        return 0;
+}